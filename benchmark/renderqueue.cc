@@ -0,0 +1,334 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <map>
+#include <random>
+
+#include "Renderer/renderer.h"
+#include "Renderer/renderqueue.h"
+#include "Renderer/particle.h"
+
+namespace pg
+{
+    namespace benchmark
+    {
+        struct SpriteRenderer : public AbstractRenderer
+        {
+            SpriteRenderer(MasterRenderer* masterRenderer) : AbstractRenderer(masterRenderer, RenderStage::Render) {}
+
+            void generate(size_t nbSprites, size_t nbMaterials, OpacityType opacity = OpacityType::Opaque)
+            {
+                std::mt19937 rng(1337);
+
+                renderCallList.clear();
+                renderCallList.reserve(nbSprites);
+
+                for (size_t i = 0; i < nbSprites; ++i)
+                {
+                    RenderCall call;
+
+                    call.setMaterial(rng() % nbMaterials);
+                    call.setDepth(rng() % 64);
+                    call.setOpacity(opacity);
+                    call.data = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f};
+
+                    renderCallList.push_back(std::move(call));
+                }
+
+                setDirty(true);
+            }
+        };
+
+        auto spriteCounts = {1000, 10000, 100000};
+
+        std::vector<RenderCall> generateCalls(size_t nbSprites, size_t nbMaterials)
+        {
+            std::mt19937 rng(1337);
+
+            std::vector<RenderCall> calls;
+            calls.reserve(nbSprites);
+
+            for (size_t i = 0; i < nbSprites; ++i)
+            {
+                RenderCall call;
+
+                call.setMaterial(rng() % nbMaterials);
+                call.setDepth(rng() % 64);
+                call.data = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f};
+
+                calls.push_back(std::move(call));
+            }
+
+            return calls;
+        }
+
+        void runMapBuckets(size_t nbSprites)
+        {
+            auto calls = generateCalls(nbSprites, 16);
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            std::map<uint64_t, std::vector<RenderCall>> buckets;
+
+            for (const auto& rc : calls)
+            {
+                auto& group = buckets[rc.key];
+                bool found = false;
+
+                for (auto& call : group)
+                {
+                    if (call.batchable and rc.batchable and call.state == rc.state)
+                    {
+                        call.data.insert(call.data.end(), rc.data.begin(), rc.data.end());
+                        found = true;
+                        break;
+                    }
+                }
+
+                if (not found)
+                    group.emplace_back(rc);
+            }
+
+            auto end = std::chrono::high_resolution_clock::now();
+
+            std::cout << "Map buckets batching for " << nbSprites << " sprites took: " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us (" << buckets.size() << " batches)" << std::endl;
+        }
+
+        void runRadixQueue(size_t nbSprites)
+        {
+            auto calls = generateCalls(nbSprites, 16);
+
+            FrameAllocator frame;
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            RenderQueue queue(&frame);
+            queue.reserve(calls.size());
+
+            for (auto& rc : calls)
+                queue.push(rc.key, &rc);
+
+            queue.sort();
+
+            std::vector<RenderCall> merged;
+            merged.reserve(queue.size());
+
+            size_t runStart = 0;
+            uint64_t runKey = 0;
+
+            for (const auto& entry : queue)
+            {
+                const auto& rc = *entry.call;
+
+                if (merged.empty() or entry.key != runKey)
+                {
+                    runStart = merged.size();
+                    runKey = entry.key;
+                }
+
+                bool found = false;
+
+                for (size_t i = runStart; rc.batchable and i < merged.size(); ++i)
+                {
+                    if (merged[i].batchable and merged[i].state == rc.state)
+                    {
+                        merged[i].data.insert(merged[i].data.end(), rc.data.begin(), rc.data.end());
+                        found = true;
+                        break;
+                    }
+                }
+
+                if (not found)
+                    merged.emplace_back(rc);
+            }
+
+            auto end = std::chrono::high_resolution_clock::now();
+
+            std::cout << "Radix queue batching for " << nbSprites << " sprites took: " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us (" << merged.size() << " batches)" << std::endl;
+        }
+
+        void runMasterRendererExecute(size_t nbSprites)
+        {
+            MasterRenderer masterRenderer;
+
+            for (size_t i = 0; i < 16; ++i)
+            {
+                Material material;
+                material.nbAttributes = 8;
+
+                masterRenderer.registerMaterial(material);
+            }
+
+
+            SpriteRenderer renderer(&masterRenderer);
+            renderer.generate(nbSprites, 16);
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            masterRenderer.execute();
+
+            auto end = std::chrono::high_resolution_clock::now();
+
+            std::cout << "MasterRenderer execute for " << nbSprites << " sprites took: " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us (" << masterRenderer.getRenderCalls(1).size() << " batches)" << std::endl;
+        }
+
+        void runHeadlessFrame(size_t nbSprites, OpacityType opacity)
+        {
+            MasterRenderer masterRenderer;
+
+            auto backend = new NullRenderBackend(false);
+            masterRenderer.setBackend(std::unique_ptr<RenderBackend>(backend));
+
+            for (size_t i = 0; i < 16; ++i)
+            {
+                Material material;
+                material.nbAttributes = 8;
+
+                masterRenderer.registerMaterial(material);
+            }
+
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            SpriteRenderer renderer(&masterRenderer);
+            renderer.generate(nbSprites, 16, opacity);
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            auto end = std::chrono::high_resolution_clock::now();
+
+            const auto& stats = backend->getStats();
+
+            // Opaque sprites are grouped by material, transparent ones must follow their depth
+            const auto frame = masterRenderer.getLastFrameStats();
+
+            std::cout << "Headless frame for " << nbSprites << (opacity == OpacityType::Opaque ? " opaque" : " transparent") << " sprites took: " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us (" << stats.nbDrawCalls << " draws, " << frame.nbProgramBinds << " program binds, " << frame.nbStateChanges << " state changes, " << stats.nbUploadedBytes / 1024 << " KB uploaded)" << std::endl;
+        }
+
+        void runChunkedMerge(size_t nbSprites, size_t chunkSize)
+        {
+            MasterRenderer masterRenderer;
+
+            masterRenderer.setMergeChunkSize(chunkSize);
+
+            for (size_t i = 0; i < 16; ++i)
+            {
+                Material material;
+                material.nbAttributes = 8;
+
+                masterRenderer.registerMaterial(material);
+            }
+
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            SpriteRenderer renderer(&masterRenderer);
+            renderer.generate(nbSprites, 16);
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            masterRenderer.execute();
+
+            auto end = std::chrono::high_resolution_clock::now();
+
+            std::cout << "MasterRenderer execute for " << nbSprites << " sprites " << (chunkSize == 0 ? "in one chunk per thread" : "in a single chunk") << " took: " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us (" << JobPool::get().getNbThreads() << " threads)" << std::endl;
+        }
+
+        void runParticles(size_t nbParticles)
+        {
+            ParticleEmitter emitter;
+            emitter.emitting = false;
+            emitter.maxParticles = nbParticles;
+            emitter.minLifetime = 100.0f;
+            emitter.maxLifetime = 100.0f;
+            emitter.acceleration = {0.0f, 98.0f};
+            emitter.burst(nbParticles);
+
+            simulateParticles(emitter, 0.016f);
+
+            RenderCall call;
+
+            const size_t nbFrames = 10;
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            for (size_t i = 0; i < nbFrames; ++i)
+            {
+                simulateParticles(emitter, 0.016f);
+                buildParticleRenderCall(emitter, 0, RenderStage::Render, call);
+            }
+
+            auto end = std::chrono::high_resolution_clock::now();
+
+            std::cout << "Particle update and instance write for " << nbParticles << " particles took: " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / nbFrames << " us per frame (" << JobPool::get().getNbThreads() << " threads)" << std::endl;
+        }
+
+        TEST(renderqueue_benchmark, map_buckets)
+        {
+            for (auto value : spriteCounts)
+            {
+                runMapBuckets(value);
+            }
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(renderqueue_benchmark, radix_queue)
+        {
+            for (auto value : spriteCounts)
+            {
+                runRadixQueue(value);
+            }
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(renderqueue_benchmark, master_renderer_execute)
+        {
+            for (auto value : spriteCounts)
+            {
+                runMasterRendererExecute(value);
+            }
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(renderqueue_benchmark, headless_frame)
+        {
+            for (auto value : spriteCounts)
+            {
+                runHeadlessFrame(value, OpacityType::Opaque);
+                runHeadlessFrame(value, OpacityType::Additive);
+            }
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(renderqueue_benchmark, chunked_merge)
+        {
+            for (auto value : {10000, 50000, 100000})
+            {
+                runChunkedMerge(value, static_cast<size_t>(-1));
+                runChunkedMerge(value, 0);
+            }
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(renderqueue_benchmark, particles)
+        {
+            for (auto value : {10000, 100000, 500000})
+            {
+                runParticles(value);
+            }
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+#include "Renderer/textureloader.h"
+
+namespace pg
+{
+    namespace benchmark
+    {
+        /** Resource sets of the example games, looked up from the working directory or its parent */
+        auto resourceSets = {"res/TetrisRes", "res/sprites", "res/tiled", "res/menu", "res/object"};
+
+        std::vector<std::string> findImages(const std::string& directory)
+        {
+            std::vector<std::string> images;
+
+            std::filesystem::path root = directory;
+
+            if (not std::filesystem::exists(root))
+                root = std::filesystem::path("..") / directory;
+
+            if (not std::filesystem::exists(root))
+                return images;
+
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(root))
+            {
+                if (entry.is_regular_file() and entry.path().extension() == ".png")
+                    images.push_back(entry.path().string());
+            }
+
+            return images;
+        }
+
+        size_t loadImages(const std::vector<std::string>& images, const TextureCache *cache)
+        {
+            size_t nbBytes = 0;
+
+            for (const auto& image : images)
+            {
+                DecodedTexture texture;
+
+                if (decodeTextureFile(image, texture, cache))
+                    nbBytes += texture.size();
+            }
+
+            return nbBytes;
+        }
+
+        void runTextureLoading(const std::string& directory)
+        {
+            const auto images = findImages(directory);
+
+            if (images.empty())
+            {
+                std::cout << "No images found in " << directory << ", skipping" << std::endl;
+                return;
+            }
+
+            const auto cacheDirectory = (std::filesystem::temp_directory_path() / "pg_texture_cache_benchmark").string();
+
+            std::filesystem::remove_all(cacheDirectory);
+
+            TextureCache cache(cacheDirectory);
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            auto nbBytes = loadImages(images, nullptr);
+
+            auto end = std::chrono::high_resolution_clock::now();
+
+            std::cout << "Cold load of " << images.size() << " textures (" << nbBytes / 1024 << " KB) from " << directory << " took: " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us" << std::endl;
+
+            start = std::chrono::high_resolution_clock::now();
+
+            loadImages(images, &cache);
+
+            end = std::chrono::high_resolution_clock::now();
+
+            std::cout << "First run load (decode and fill the cache) took: " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us" << std::endl;
+
+            start = std::chrono::high_resolution_clock::now();
+
+            nbBytes = loadImages(images, &cache);
+
+            end = std::chrono::high_resolution_clock::now();
+
+            std::cout << "Cached load of " << nbBytes / 1024 << " KB took: " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us" << std::endl;
+
+            std::filesystem::remove_all(cacheDirectory);
+        }
+
+        TEST(texturecache_benchmark, cold_vs_cached_startup)
+        {
+            for (auto value : resourceSets)
+            {
+                runTextureLoading(value);
+            }
+        }
+    }
+}
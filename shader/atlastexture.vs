@@ -12,10 +12,20 @@ layout (location = 6) in float aOpacity;
 layout (location = 7) in vec3 aMixColor;
 layout (location = 8) in float aMixColorRatio;
 
+#ifdef PG_CAMERA_BLOCK
+layout (std140) uniform CameraBlock
+{
+    mat4 projection;
+    mat4 view;
+    mat4 scale;
+    mat4 model;
+};
+#else
 uniform mat4 model;
 uniform mat4 scale;
 uniform mat4 view;
 uniform mat4 projection;
+#endif
 
 uniform float sWidth;
 uniform float sHeight;
@@ -1,10 +1,20 @@
 layout (location = 0) in vec2 aPos;
 layout (location = 1) in float aOpacity;
 
+#ifdef PG_CAMERA_BLOCK
+layout (std140) uniform CameraBlock
+{
+    mat4 projection;
+    mat4 view;
+    mat4 scale;
+    mat4 model;
+};
+#else
 uniform mat4 model;
 uniform mat4 scale;
 uniform mat4 view;
 uniform mat4 projection;
+#endif
 
 uniform float sWidth;
 uniform float sHeight;
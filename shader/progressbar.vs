@@ -9,10 +9,20 @@ layout (location = 4) in float rotation;
 layout (location = 5) in float aFillRatio;
 layout (location = 6) in float aDirection;
 
+#ifdef PG_CAMERA_BLOCK
+layout (std140) uniform CameraBlock
+{
+    mat4 projection;
+    mat4 view;
+    mat4 scale;
+    mat4 model;
+};
+#else
 uniform mat4 model;
 uniform mat4 scale;
 uniform mat4 view;
 uniform mat4 projection;
+#endif
 
 uniform float sWidth;
 uniform float sHeight;
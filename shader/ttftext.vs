@@ -15,10 +15,20 @@ layout (location = 7) in float aMixColorRatio;
 // These represent the top-left (u1,v1) and bottom-right (u2,v2) coordinates of the glyph in the atlas.
 layout (location = 8) in vec4 aUV;
 
+#ifdef PG_CAMERA_BLOCK
+layout (std140) uniform CameraBlock
+{
+    mat4 projection;
+    mat4 view;
+    mat4 scale;
+    mat4 model;
+};
+#else
 uniform mat4 model;
 uniform mat4 scale;
 uniform mat4 view;
 uniform mat4 projection;
+#endif
 
 uniform float sWidth;
 uniform float sHeight;
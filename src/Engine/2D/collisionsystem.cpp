@@ -315,7 +315,8 @@ namespace pg
 
         // LOG_INFO(DOM, "Resolving collision list");
 
-        std::set<_unique_id> touchedIds;
+        // Scratch list of the ids sharing a cell with this comp, built on the frame allocator and deduplicated afterward
+        std::vector<_unique_id, ArenaAllocator<_unique_id>> touchedIds(ArenaAllocator<_unique_id>(&ecsRef->getFrameAllocator()));
 
         // Get all ids in the same cell as our comp
         for (const auto& layer : comp->cells)
@@ -334,7 +335,7 @@ namespace pg
 
                             // LOG_INFO(DOM, "Checking cell: " << cell->pos.x + cell->pos.y * it->second.size.x << " (" << cell->pos.x << ", " << cell->pos.y << ") in page: " << layer.first.x << ", " << layer.first.y);
 
-                            touchedIds.insert(ids.begin(), ids.end());
+                            touchedIds.insert(touchedIds.end(), ids.begin(), ids.end());
                         }
                     }
                 }
@@ -356,7 +357,7 @@ namespace pg
 
                             // LOG_INFO(DOM, "Checking cell: " << cell->pos.x + cell->pos.y * it->second.size.x << " (" << cell->pos.x << ", " << cell->pos.y << ") in page: " << layer.first.x << ", " << layer.first.y);
 
-                            touchedIds.insert(ids.begin(), ids.end());
+                            touchedIds.insert(touchedIds.end(), ids.begin(), ids.end());
                         }
                     }
                 }
@@ -368,8 +369,11 @@ namespace pg
 
         // LOG_INFO(DOM, "Got all cell");
 
+        std::sort(touchedIds.begin(), touchedIds.end());
+        touchedIds.erase(std::unique(touchedIds.begin(), touchedIds.end()), touchedIds.end());
+
         // We remove our id as we don't want to test the collision on ourselves
-        touchedIds.erase(comp->entityId);
+        touchedIds.erase(std::remove(touchedIds.begin(), touchedIds.end(), comp->entityId), touchedIds.end());
 
         std::set<_unique_id> collidedIds;
 
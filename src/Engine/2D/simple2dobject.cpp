@@ -171,43 +171,44 @@ namespace pg
         if (not changed)
             return;
 
+        pendingShapes.clear();
+
         while (not shapeUpdateQueue.empty())
         {
             auto entityId = shapeUpdateQueue.front();
 
             auto entity = ecsRef->getEntity(entityId);
 
-            if (not entity)
+            if (entity)
             {
-                shapeUpdateQueue.pop();
-                continue;
+                pendingShapes.push_back(PendingShape{entity, entity->get<PositionComponent>(), entity->get<Simple2DObject>(), RenderCall{}});
             }
 
-            auto ui = entity->get<PositionComponent>();
-            auto obj = entity->get<Simple2DObject>();
+            shapeUpdateQueue.pop();
+        }
+
+        // Creating a render call only reads the components of its entity, so the calls are created in parallel chunks
+        parallelForChunks(pendingShapes.size(), CreateChunkSize, [this](size_t start, size_t end, size_t) {
+            for (size_t i = start; i < end; ++i)
+            {
+                pendingShapes[i].call = createRenderCall(pendingShapes[i].ui, pendingShapes[i].obj);
+            }
+        });
 
-            if (entity->has<Simple2DRenderCall>())
+        // Attaching components touches the ecs, so it stays on this thread
+        for (auto& shape : pendingShapes)
+        {
+            if (shape.entity->has<Simple2DRenderCall>())
             {
-                entity->get<Simple2DRenderCall>()->call = createRenderCall(ui, obj);
+                shape.entity->get<Simple2DRenderCall>()->call = std::move(shape.call);
             }
             else
             {
-                ecsRef->_attach<Simple2DRenderCall>(entity, createRenderCall(ui, obj));
+                ecsRef->_attach<Simple2DRenderCall>(shape.entity, shape.call);
             }
-
-            shapeUpdateQueue.pop();
         }
 
-        renderCallList.clear();
-
-        const auto& renderCallView = view<Simple2DRenderCall>();
-
-        renderCallList.reserve(renderCallView.nbComponents());
-
-        for (const auto& renderCall : renderCallView)
-        {
-            renderCallList.push_back(renderCall->call);
-        }
+        gatherRenderCalls(view<Simple2DRenderCall>());
 
         finishChanges();
     }
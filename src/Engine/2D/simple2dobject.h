@@ -117,6 +117,21 @@ namespace pg
         uint64_t materialId = 0;
 
         std::queue<_unique_id> shapeUpdateQueue;
+
+        /** An entity of the update queue waiting for its render call */
+        struct PendingShape
+        {
+            Entity *entity;
+            CompRef<PositionComponent> ui;
+            CompRef<Simple2DObject> obj;
+            RenderCall call;
+        };
+
+        /** Entities updated during the current execute, kept to reuse its storage */
+        std::vector<PendingShape> pendingShapes;
+
+        /** Smallest number of render calls created by a job */
+        static constexpr size_t CreateChunkSize = 512;
     };
 
     template <typename Type>
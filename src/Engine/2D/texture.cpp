@@ -117,6 +117,8 @@ namespace pg
             if (entity->has<TextureRenderCall>())
                 ecsRef->detach<TextureRenderCall>(entity);
 
+            removeFromBatch(id);
+
             changed = true;
         });
     }
@@ -141,28 +143,120 @@ namespace pg
             auto ui = entity->get<PositionComponent>();
             auto obj = entity->get<Texture2DComponent>();
 
+            auto call = createRenderCall(ui, obj);
+
+            // Only the slot of this entity is written, the other textures are not touched
+            updateBatch(entityId, call);
+
             if (entity->has<TextureRenderCall>())
             {
-                entity->get<TextureRenderCall>()->call = createRenderCall(ui, obj);
+                entity->get<TextureRenderCall>()->call = std::move(call);
             }
             else
             {
-                ecsRef->_attach<TextureRenderCall>(entity, createRenderCall(ui, obj));
+                ecsRef->_attach<TextureRenderCall>(entity, call);
             }
 
             textureUpdateQueue.pop();
         }
 
-        renderCallList.clear();
+        // The master renderer only needs to merge our render calls again if a batch appeared or disappeared
+        if (batchesChanged)
+            rebuildRenderCalls();
+        else
+            changed = false;
+    }
+
+    void Texture2DComponentSystem::updateBatch(_unique_id entityId, const RenderCall& call)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (call.data.empty())
+        {
+            removeFromBatch(entityId);
+            return;
+        }
 
-        const auto& renderCallView = view<TextureRenderCall>();
+        TextureBatch *target = nullptr;
 
-        renderCallList.reserve(renderCallView.nbComponents());
+        auto it = entityBatches.find(entityId);
 
-        for (const auto& renderCall : renderCallView)
+        // Most updates (moves, color changes, ...) keep the entity in the same batch
+        if (it != entityBatches.end() and it->second->call.key == call.key and it->second->call.state == call.state)
         {
-            renderCallList.push_back(renderCall->call);
+            target = it->second;
         }
+        else
+        {
+            removeFromBatch(entityId);
+
+            for (auto& batch : batches)
+            {
+                if (batch->call.key == call.key and batch->call.state == call.state and batch->slots->getStride() == call.data.size())
+                {
+                    target = batch.get();
+                    break;
+                }
+            }
+
+            if (not target)
+            {
+                auto batch = std::make_unique<TextureBatch>();
+
+                batch->call = call;
+                batch->call.data.clear();
+                batch->call.batchable = false;
+
+                batch->slots = std::make_shared<InstanceSlotBuffer>(call.data.size());
+                batch->call.slotBuffer = batch->slots;
+
+                target = batch.get();
+
+                batches.push_back(std::move(batch));
+
+                batchesChanged = true;
+            }
+
+            entityBatches[entityId] = target;
+        }
+
+        target->slots->set(entityId, call.data.data());
+    }
+
+    void Texture2DComponentSystem::removeFromBatch(_unique_id entityId)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        auto it = entityBatches.find(entityId);
+
+        if (it == entityBatches.end())
+            return;
+
+        auto batch = it->second;
+
+        entityBatches.erase(it);
+
+        batch->slots->remove(entityId);
+
+        if (batch->slots->size() == 0)
+            batchesChanged = true;
+    }
+
+    void Texture2DComponentSystem::rebuildRenderCalls()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        batches.erase(std::remove_if(batches.begin(), batches.end(), [](const std::unique_ptr<TextureBatch>& batch) { return batch->slots->size() == 0; }), batches.end());
+
+        renderCallList.clear();
+        renderCallList.reserve(batches.size());
+
+        for (const auto& batch : batches)
+        {
+            renderCallList.push_back(batch->call);
+        }
+
+        batchesChanged = false;
 
         finishChanges();
     }
@@ -181,8 +275,15 @@ namespace pg
 
         auto textureName = split(obj->textureName, '.');
 
+        PackedTexture packed;
+
+        // Small textures packed in the runtime atlas are drawn from their page, so they share a material with the other textures of the page
+        if (textureName.size() == 1 and masterRenderer->getPackedTexture(obj->textureName, packed))
+        {
+            setAtlasRenderCall(call, packed.pageName, packed.texture.getTextureLimit(), ui, obj);
+        }
         // No '.' detected in the texture name so it is not an atlas texture, proceed to generate a simple texture
-        if (textureName.size() == 1)
+        else if (textureName.size() == 1)
         {
             if (masterRenderer->hasMaterial(obj->textureName))
             {
@@ -226,49 +327,9 @@ namespace pg
             auto baseTexture = textureName[0];
             auto atlasTextureName = textureName[1];
 
-            if (masterRenderer->hasMaterial(baseTexture))
-            {
-                call.setMaterial(masterRenderer->getMaterialID(baseTexture));
-            }
-            else
-            {
-                Material altasShapeMaterial = atlasMaterialPreset;
-
-                altasShapeMaterial.textureId[0] = masterRenderer->getTexture(baseTexture).id;
-
-                call.setMaterial(masterRenderer->registerMaterial(baseTexture, altasShapeMaterial));
-            }
-
-            if (masterRenderer->getTexture(baseTexture).transparent)
-            {
-                call.setOpacity(OpacityType::Additive);
-            }
-            else
-            {
-                call.setOpacity(OpacityType::Opaque);
-            }
-
             auto atlasTexture = masterRenderer->getAtlasTexture(baseTexture, atlasTextureName);
 
-            auto limits = atlasTexture.getTextureLimit();
-
-            call.data.resize(15);
-
-            call.data[0] = ui->x;
-            call.data[1] = ui->y;
-            call.data[2] = ui->z;
-            call.data[3] = ui->width;
-            call.data[4] = ui->height;
-            call.data[5] = ui->rotation;
-            call.data[6] = limits.x;
-            call.data[7] = limits.y;
-            call.data[8] = limits.z;
-            call.data[9] = limits.w;
-            call.data[10] = obj->opacity;
-            call.data[11] = obj->overlappingColor.x;
-            call.data[12] = obj->overlappingColor.y;
-            call.data[13] = obj->overlappingColor.z;
-            call.data[14] = obj->overlappingColorRatio;
+            setAtlasRenderCall(call, baseTexture, atlasTexture.getTextureLimit(), ui, obj);
         }
         else
         {
@@ -281,6 +342,51 @@ namespace pg
         return call;
     }
 
+    void Texture2DComponentSystem::setAtlasRenderCall(RenderCall& call, const std::string& baseTexture, const constant::Vector4D& limits, CompRef<PositionComponent> ui, CompRef<Texture2DComponent> obj)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (masterRenderer->hasMaterial(baseTexture))
+        {
+            call.setMaterial(masterRenderer->getMaterialID(baseTexture));
+        }
+        else
+        {
+            Material altasShapeMaterial = atlasMaterialPreset;
+
+            altasShapeMaterial.textureId[0] = masterRenderer->getTexture(baseTexture).id;
+
+            call.setMaterial(masterRenderer->registerMaterial(baseTexture, altasShapeMaterial));
+        }
+
+        if (masterRenderer->getTexture(baseTexture).transparent)
+        {
+            call.setOpacity(OpacityType::Additive);
+        }
+        else
+        {
+            call.setOpacity(OpacityType::Opaque);
+        }
+
+        call.data.resize(15);
+
+        call.data[0] = ui->x;
+        call.data[1] = ui->y;
+        call.data[2] = ui->z;
+        call.data[3] = ui->width;
+        call.data[4] = ui->height;
+        call.data[5] = ui->rotation;
+        call.data[6] = limits.x;
+        call.data[7] = limits.y;
+        call.data[8] = limits.z;
+        call.data[9] = limits.w;
+        call.data[10] = obj->opacity;
+        call.data[11] = obj->overlappingColor.x;
+        call.data[12] = obj->overlappingColor.y;
+        call.data[13] = obj->overlappingColor.z;
+        call.data[14] = obj->overlappingColorRatio;
+    }
+
     void Texture2DComponentSystem::onEvent(const EntityChangedEvent& event)
     {
         LOG_THIS_MEMBER(DOM);
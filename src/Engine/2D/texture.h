@@ -123,6 +123,16 @@ namespace pg
         RenderCall call;
     };
 
+    /** Textures sharing the same key and state, drawn in a single call from a persistent instance buffer */
+    struct TextureBatch
+    {
+        /** Render call given to the master renderer, it holds no data as it draws from slots */
+        RenderCall call;
+
+        /** Attributes of all the textures of the batch, one slot per entity */
+        std::shared_ptr<InstanceSlotBuffer> slots;
+    };
+
     struct Texture2DComponentSystem : public AbstractRenderer, System<Own<Texture2DComponent>, Own<TextureRenderCall>, Listener<EntityChangedEvent>, Ref<PositionComponent>, InitSys>
     {
         Texture2DComponentSystem(MasterRenderer* masterRenderer) : AbstractRenderer(masterRenderer, RenderStage::Render) { }
@@ -135,10 +145,22 @@ namespace pg
 
         RenderCall createRenderCall(CompRef<PositionComponent> ui, CompRef<Texture2DComponent> obj);
 
+        /** Fill a render call drawing a part of an atlas texture (texture limits in uv coordinates) */
+        void setAtlasRenderCall(RenderCall& call, const std::string& baseTexture, const constant::Vector4D& limits, CompRef<PositionComponent> ui, CompRef<Texture2DComponent> obj);
+
         virtual void onEvent(const EntityChangedEvent& event) override;
 
         void onEventUpdate(_unique_id entityId);
 
+        /** Write the attributes of an entity in the batch matching its render call, moving it between batches if needed */
+        void updateBatch(_unique_id entityId, const RenderCall& call);
+
+        /** Free the slot of an entity in its batch */
+        void removeFromBatch(_unique_id entityId);
+
+        /** Drop the empty batches and give the render calls of the remaining ones to the master renderer */
+        void rebuildRenderCalls();
+
         // Use this material preset if a material is not specified when creating a texture component !
         Material baseMaterialPreset;
 
@@ -146,6 +168,14 @@ namespace pg
         Material atlasMaterialPreset;
 
         std::queue<_unique_id> textureUpdateQueue;
+
+        std::vector<std::unique_ptr<TextureBatch>> batches;
+
+        /** Batch holding the slot of each entity */
+        std::unordered_map<_unique_id, TextureBatch*> entityBatches;
+
+        /** Set when a batch is created or emptied, the master renderer then needs the new list of render calls */
+        bool batchesChanged = false;
     };
 
     /** Helper that create an entity with an Ui component and a Texture component */
@@ -0,0 +1,451 @@
+#include "stdafx.h"
+
+#include "tilemap.h"
+
+#include <algorithm>
+
+#include "logger.h"
+
+namespace pg
+{
+    namespace
+    {
+        static constexpr char const * DOM = "Tile Map";
+
+        /** Pack the position of a chunk in a single key */
+        inline uint64_t chunkKey(size_t layer, size_t tileset, int chunkX, int chunkY)
+        {
+            return (static_cast<uint64_t>(layer) << 48) | (static_cast<uint64_t>(tileset) << 40) | (static_cast<uint64_t>(chunkX) << 20) | static_cast<uint64_t>(chunkY);
+        }
+    }
+
+    uint32_t TileMapComponent::getTile(size_t layer, int x, int y) const
+    {
+        if (layer >= map.layers.size())
+            return 0;
+
+        const auto& tileLayer = map.layers[layer];
+
+        if (x < 0 or y < 0 or x >= tileLayer.width or y >= tileLayer.height)
+            return 0;
+
+        return tileLayer.tiles[y * tileLayer.width + x];
+    }
+
+    void TileMapComponent::setTile(size_t layer, int x, int y, uint32_t gid)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (layer >= map.layers.size())
+        {
+            LOG_ERROR(DOM, "Layer " << layer << " doesn't exist, the map only has " << map.layers.size() << " layers");
+            return;
+        }
+
+        auto& tileLayer = map.layers[layer];
+
+        if (x < 0 or y < 0 or x >= tileLayer.width or y >= tileLayer.height)
+        {
+            LOG_ERROR(DOM, "Tile [" << x << ", " << y << "] is out of the layer " << tileLayer.name);
+            return;
+        }
+
+        auto& tile = tileLayer.tiles[y * tileLayer.width + x];
+
+        if (tile == gid)
+            return;
+
+        tile = gid;
+
+        changedTiles.push_back(TileChange{layer, x, y});
+
+        if (ecsRef)
+        {
+            ecsRef->sendEvent(EntityChangedEvent{entityId});
+        }
+    }
+
+    void TileMapComponent::setPosition(float x, float y, float z)
+    {
+        if (areNotAlmostEqual(this->x, x) or areNotAlmostEqual(this->y, y) or areNotAlmostEqual(this->z, z))
+        {
+            this->x = x;
+            this->y = y;
+            this->z = z;
+
+            rebuild = true;
+
+            if (ecsRef)
+            {
+                ecsRef->sendEvent(EntityChangedEvent{entityId});
+            }
+        }
+    }
+
+    void TileMapComponent::setScale(float scale)
+    {
+        if (areNotAlmostEqual(this->scale, scale))
+        {
+            this->scale = scale;
+
+            rebuild = true;
+
+            if (ecsRef)
+            {
+                ecsRef->sendEvent(EntityChangedEvent{entityId});
+            }
+        }
+    }
+
+    void TileMapComponent::setLayerVisible(size_t layer, bool visible)
+    {
+        if (layer < map.layers.size() and map.layers[layer].visible != visible)
+        {
+            map.layers[layer].visible = visible;
+
+            rebuild = true;
+
+            if (ecsRef)
+            {
+                ecsRef->sendEvent(EntityChangedEvent{entityId});
+            }
+        }
+    }
+
+    void TileMapComponent::setViewport(size_t viewport)
+    {
+        if (this->viewport != viewport)
+        {
+            this->viewport = viewport;
+
+            rebuild = true;
+
+            if (ecsRef)
+            {
+                ecsRef->sendEvent(EntityChangedEvent{entityId});
+            }
+        }
+    }
+
+    int writeTileInstance(const TiledMap& map, size_t layer, int tileX, int tileY, float originX, float originY, float z, float scale, float *out)
+    {
+        const auto& tileLayer = map.layers[layer];
+
+        const uint32_t gid = tileLayer.tiles[tileY * tileLayer.width + tileX];
+
+        const int tilesetIndex = map.findTileset(gid);
+
+        if (tilesetIndex < 0)
+            return -1;
+
+        const auto& tileset = map.tilesets[tilesetIndex];
+
+        constant::Vector4D limits;
+
+        if (not tileset.getTileLimits(gid, limits))
+            return -1;
+
+        const float width = tileset.tileWidth * scale;
+        const float height = tileset.tileHeight * scale;
+
+        // Tiles are aligned on the bottom left corner of their cell
+        out[0] = originX + (tileLayer.offsetX + tileX * map.tileWidth) * scale;
+        out[1] = originY + (tileLayer.offsetY + (tileY + 1) * map.tileHeight) * scale - height;
+        out[2] = z;
+        out[3] = width;
+        out[4] = height;
+        out[5] = 0.0f;
+        out[6] = limits.x;
+        out[7] = limits.y;
+        out[8] = limits.z;
+        out[9] = limits.w;
+        out[10] = tileLayer.opacity;
+        out[11] = 0.0f;
+        out[12] = 0.0f;
+        out[13] = 0.0f;
+        out[14] = 0.0f;
+
+        return tilesetIndex;
+    }
+
+    CullRect computeTileChunkBounds(const TiledMap& map, size_t layer, size_t tileset, int chunkX, int chunkY, float originX, float originY, float scale)
+    {
+        const auto& tileLayer = map.layers[layer];
+        const auto& chunkTileset = map.tilesets[tileset];
+
+        CullRect bounds;
+
+        bounds.left = originX + (tileLayer.offsetX + chunkX * TileChunkSize * map.tileWidth) * scale;
+        bounds.top = originY + (tileLayer.offsetY + chunkY * TileChunkSize * map.tileHeight) * scale;
+        bounds.right = bounds.left + TileChunkSize * map.tileWidth * scale;
+        bounds.bottom = bounds.top + TileChunkSize * map.tileHeight * scale;
+
+        bounds.right += std::max(chunkTileset.tileWidth - map.tileWidth, 0) * scale;
+        bounds.top -= std::max(chunkTileset.tileHeight - map.tileHeight, 0) * scale;
+
+        return bounds;
+    }
+
+    void TileMapSystem::init()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        tilesetMaterialPreset.shader = masterRenderer->getShader("atlasTexture");
+
+        tilesetMaterialPreset.nbTextures = 1;
+
+        tilesetMaterialPreset.uniformMap.emplace("sWidth", "ScreenWidth");
+        tilesetMaterialPreset.uniformMap.emplace("sHeight", "ScreenHeight");
+
+        tilesetMaterialPreset.setSimpleMesh({3, 2, 1, 4, 1, 3, 1});
+
+        auto group = registerGroup<TileMapComponent>();
+
+        group->addOnGroup([this](EntityRef entity) {
+            LOG_MILE(DOM, "Add entity " << entity->id << " to tile map group !");
+
+            changedMaps.push_back(entity.id);
+
+            changed = true;
+        });
+
+        group->removeOfGroup([this](EntitySystem*, _unique_id id) {
+            LOG_MILE(DOM, "Remove entity " << id << " of tile map group !");
+
+            mapChunks.erase(id);
+
+            chunksChanged = true;
+            changed = true;
+        });
+    }
+
+    void TileMapSystem::execute()
+    {
+        if (not changed)
+            return;
+
+        for (auto entityId : changedMaps)
+        {
+            auto entity = ecsRef->getEntity(entityId);
+
+            if (not entity or not entity->has<TileMapComponent>())
+                continue;
+
+            auto map = entity->get<TileMapComponent>();
+
+            if (map->rebuild)
+            {
+                buildMap(entityId, map);
+            }
+            else
+            {
+                // Only the slots of the changed tiles are written, the rest of their chunk is not touched
+                for (const auto& change : map->changedTiles)
+                    updateTile(entityId, map, change.layer, change.x, change.y);
+            }
+
+            map->changedTiles.clear();
+        }
+
+        changedMaps.clear();
+
+        // The master renderer only needs to merge our render calls again if a chunk appeared or disappeared
+        if (chunksChanged)
+            rebuildRenderCalls();
+        else
+            changed = false;
+    }
+
+    void TileMapSystem::onEvent(const EntityChangedEvent& event)
+    {
+        auto entity = ecsRef->getEntity(event.id);
+
+        if (not entity or not entity->has<TileMapComponent>())
+            return;
+
+        changedMaps.push_back(event.id);
+
+        changed = true;
+    }
+
+    size_t TileMapSystem::getNbChunks() const
+    {
+        size_t nbChunks = 0;
+
+        for (const auto& chunks : mapChunks)
+            nbChunks += chunks.second.size();
+
+        return nbChunks;
+    }
+
+    void TileMapSystem::buildMap(_unique_id entityId, TileMapComponent *map)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        mapChunks[entityId].clear();
+
+        chunksChanged = true;
+
+        const auto& layers = map->map.layers;
+
+        for (size_t layer = 0; layer < layers.size(); ++layer)
+        {
+            for (int y = 0; y < layers[layer].height; ++y)
+            {
+                for (int x = 0; x < layers[layer].width; ++x)
+                {
+                    updateTile(entityId, map, layer, x, y);
+                }
+            }
+        }
+
+        map->rebuild = false;
+
+        LOG_INFO(DOM, "Built map " << entityId << " in " << mapChunks[entityId].size() << " chunks");
+    }
+
+    void TileMapSystem::updateTile(_unique_id entityId, const TileMapComponent *map, size_t layer, int x, int y)
+    {
+        const auto& tiledMap = map->map;
+
+        if (layer >= tiledMap.layers.size() or not tiledMap.layers[layer].visible)
+            return;
+
+        const int chunkX = x / TileChunkSize;
+        const int chunkY = y / TileChunkSize;
+
+        // Each tile owns the same slot id in the chunks of every tileset
+        const _unique_id slot = static_cast<_unique_id>((y % TileChunkSize) * TileChunkSize + (x % TileChunkSize));
+
+        float instance[TileInstanceSize];
+
+        const int tileset = writeTileInstance(tiledMap, layer, x, y, map->x, map->y, map->z + layer, map->scale, instance);
+
+        auto& chunks = mapChunks[entityId];
+
+        // The tile may come from another tileset than before, so it is removed from the chunks of the other tilesets
+        for (size_t i = 0; i < tiledMap.tilesets.size(); ++i)
+        {
+            if (static_cast<int>(i) == tileset)
+                continue;
+
+            auto it = chunks.find(chunkKey(layer, i, chunkX, chunkY));
+
+            if (it != chunks.end() and it->second->slots->remove(slot) and it->second->slots->size() == 0)
+                chunksChanged = true;
+        }
+
+        if (tileset < 0)
+            return;
+
+        auto chunk = getChunk(entityId, map, layer, tileset, chunkX, chunkY);
+
+        chunk->slots->set(slot, instance);
+    }
+
+    TileChunk* TileMapSystem::getChunk(_unique_id entityId, const TileMapComponent *map, size_t layer, size_t tileset, int chunkX, int chunkY)
+    {
+        auto& chunks = mapChunks[entityId];
+
+        const auto key = chunkKey(layer, tileset, chunkX, chunkY);
+
+        auto it = chunks.find(key);
+
+        if (it != chunks.end())
+            return it->second.get();
+
+        LOG_THIS_MEMBER(DOM);
+
+        const auto& tiledTileset = map->map.tilesets[tileset];
+
+        auto chunk = std::make_unique<TileChunk>();
+
+        chunk->layer = layer;
+        chunk->tileset = tileset;
+        chunk->chunkX = chunkX;
+        chunk->chunkY = chunkY;
+
+        chunk->slots = std::make_shared<InstanceSlotBuffer>(TileInstanceSize);
+        chunk->slots->setBounds(computeTileChunkBounds(map->map, layer, tileset, chunkX, chunkY, map->x, map->y, map->scale));
+
+        auto& call = chunk->call;
+
+        call.setVisibility(true);
+        call.setRenderStage(renderStage);
+        call.setViewport(map->viewport);
+        call.setDepth(static_cast<int>(map->z) + static_cast<int>(layer));
+        call.setMaterial(getTilesetMaterial(tiledTileset));
+
+        if (masterRenderer->getTexture(tiledTileset.textureName).transparent)
+        {
+            call.setOpacity(OpacityType::Additive);
+        }
+        else
+        {
+            call.setOpacity(OpacityType::Opaque);
+        }
+
+        call.batchable = false;
+        call.slotBuffer = chunk->slots;
+
+        chunksChanged = true;
+
+        auto result = chunk.get();
+
+        chunks.emplace(key, std::move(chunk));
+
+        return result;
+    }
+
+    uint64_t TileMapSystem::getTilesetMaterial(const TiledTileset& tileset)
+    {
+        const std::string materialName = "__tilemap_" + tileset.textureName;
+
+        if (masterRenderer->hasMaterial(materialName))
+            return masterRenderer->getMaterialID(materialName);
+
+        Material tilesetMaterial = tilesetMaterialPreset;
+
+        tilesetMaterial.textureId[0] = masterRenderer->getTexture(tileset.textureName).id;
+
+        return masterRenderer->registerMaterial(materialName, tilesetMaterial);
+    }
+
+    void TileMapSystem::rebuildRenderCalls()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        renderCallList.clear();
+
+        for (auto& chunks : mapChunks)
+        {
+            for (auto it = chunks.second.begin(); it != chunks.second.end();)
+            {
+                if (it->second->slots->size() == 0)
+                {
+                    it = chunks.second.erase(it);
+                    continue;
+                }
+
+                renderCallList.push_back(it->second->call);
+
+                ++it;
+            }
+        }
+
+        chunksChanged = false;
+
+        finishChanges();
+    }
+
+    void registerTiledTextures(MasterRenderer *masterRenderer, const TiledMap& map)
+    {
+        LOG_THIS(DOM);
+
+        for (const auto& tileset : map.tilesets)
+        {
+            if (not masterRenderer->hasTexture(tileset.textureName))
+                masterRenderer->queueRegisterTexture(tileset.textureName, tileset.imagePath.c_str());
+        }
+    }
+}
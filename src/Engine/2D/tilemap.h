@@ -0,0 +1,192 @@
+#pragma once
+
+/**
+ * @file tilemap.h
+ * @author Pigeon Codeur
+ * @brief Definition of the tile map component and of the system drawing the maps chunk by chunk
+ * @version 0.1
+ * @date 2025-04-26
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <memory>
+#include <unordered_map>
+
+#include "Renderer/renderer.h"
+#include "Loaders/tileloader.h"
+
+#include "logger.h"
+
+namespace pg
+{
+    /** Width and height of a chunk of a tile map, in tiles */
+    static constexpr int TileChunkSize = 16;
+
+    /** Number of floats of a tile instance (same layout as the atlas textures) */
+    static constexpr size_t TileInstanceSize = 15;
+
+    /**
+     * @brief A map made of tile layers, drawn in static chunks
+     *
+     * The whole map is a single entity, changing a tile only marks this tile to be written again by the TileMapSystem.
+     */
+    struct TileMapComponent : public Ctor
+    {
+        /** A tile changed since the last update of the map */
+        struct TileChange
+        {
+            size_t layer;
+            int x;
+            int y;
+        };
+
+        TileMapComponent(const TiledMap& map, size_t viewport = 0) : map(map), viewport(viewport) { }
+        virtual ~TileMapComponent() {}
+
+        virtual void onCreation(EntityRef entity) override
+        {
+            ecsRef = entity->world();
+
+            entityId = entity->id;
+        }
+
+        /** Get the gid of a tile, 0 if the cell is empty or out of the layer */
+        uint32_t getTile(size_t layer, int x, int y) const;
+
+        /**
+         * @brief Change a single tile of the map
+         *
+         * @param layer Index of the layer
+         * @param x Column of the tile
+         * @param y Row of the tile
+         * @param gid Global id of the new tile (0 to empty the cell), with its flip flags
+         */
+        void setTile(size_t layer, int x, int y, uint32_t gid);
+
+        /** Move the top left corner of the map, all the chunks are built again */
+        void setPosition(float x, float y, float z);
+
+        /** Scale the tiles, all the chunks are built again */
+        void setScale(float scale);
+
+        void setLayerVisible(size_t layer, bool visible);
+
+        void setViewport(size_t viewport);
+
+        TiledMap map;
+
+        float x = 0.0f;
+        float y = 0.0f;
+        float z = 0.0f;
+
+        float scale = 1.0f;
+
+        size_t viewport = 0;
+
+        /** Tiles changed since the last update */
+        std::vector<TileChange> changedTiles;
+
+        /** Set when every chunk of the map must be built again */
+        bool rebuild = true;
+
+        _unique_id entityId = 0;
+
+        EntitySystem *ecsRef = nullptr;
+    };
+
+    /** A part of a layer of a map drawn from the same tileset, the tiles are kept in a persistent instance buffer */
+    struct TileChunk
+    {
+        size_t layer = 0;
+        size_t tileset = 0;
+
+        /** Position of the chunk in the layer, in chunks */
+        int chunkX = 0;
+        int chunkY = 0;
+
+        /** Render call given to the master renderer, it holds no data as it draws from the slots */
+        RenderCall call;
+
+        /** One slot per non empty tile of the chunk */
+        std::shared_ptr<InstanceSlotBuffer> slots;
+    };
+
+    /**
+     * @brief Write the instance of a tile
+     *
+     * @param map Map of the tile
+     * @param layer Index of the layer of the tile
+     * @param tileX Column of the tile
+     * @param tileY Row of the tile
+     * @param originX Position of the top left corner of the map
+     * @param originY Position of the top left corner of the map
+     * @param z Depth of the map
+     * @param scale Scale of the tiles
+     * @param out Receive TileInstanceSize floats
+     *
+     * @return int The index of the tileset drawing the tile, -1 if the cell is empty
+     */
+    int writeTileInstance(const TiledMap& map, size_t layer, int tileX, int tileY, float originX, float originY, float z, float scale, float *out);
+
+    /**
+     * @brief Compute the area covered by a chunk of a layer
+     *
+     * Tiles taller or wider than the cells of the map overflow on the top and on the right, as in Tiled.
+     */
+    CullRect computeTileChunkBounds(const TiledMap& map, size_t layer, size_t tileset, int chunkX, int chunkY, float originX, float originY, float scale);
+
+    /**
+     * @brief Draw the tile maps, each chunk of TileChunkSize x TileChunkSize tiles is drawn with a single instanced call
+     *
+     * The tiles of a chunk are baked in a persistent instance buffer, only the slots of the changed tiles are sent again to the gpu.
+     * Chunks carry their bounds, so the master renderer skips the chunks out of the viewport without looking at their tiles,
+     * and a static map costs no cpu time when neither the map nor the camera changes.
+     */
+    struct TileMapSystem : public AbstractRenderer, System<Own<TileMapComponent>, Listener<EntityChangedEvent>, InitSys>
+    {
+        TileMapSystem(MasterRenderer* masterRenderer) : AbstractRenderer(masterRenderer, RenderStage::Render) { }
+
+        virtual std::string getSystemName() const override { return "Tile Map System"; }
+
+        virtual void init() override;
+
+        virtual void execute() override;
+
+        virtual void onEvent(const EntityChangedEvent& event) override;
+
+        /** Get the number of chunks currently drawn (for all the maps) */
+        size_t getNbChunks() const;
+
+        /** Build all the chunks of a map */
+        void buildMap(_unique_id entityId, TileMapComponent *map);
+
+        /** Write a single tile of a map in its chunk */
+        void updateTile(_unique_id entityId, const TileMapComponent *map, size_t layer, int x, int y);
+
+        /** Get the chunk drawing the tiles of a tileset in a part of a layer, it is created if needed */
+        TileChunk* getChunk(_unique_id entityId, const TileMapComponent *map, size_t layer, size_t tileset, int chunkX, int chunkY);
+
+        /** Get the material drawing a tileset */
+        uint64_t getTilesetMaterial(const TiledTileset& tileset);
+
+        /** Drop the empty chunks and give the render calls of the remaining ones to the master renderer */
+        void rebuildRenderCalls();
+
+        /** Material preset of the tilesets (atlas texture shader) */
+        Material tilesetMaterialPreset;
+
+        /** Chunks of each map, by key of chunk */
+        std::unordered_map<_unique_id, std::unordered_map<uint64_t, std::unique_ptr<TileChunk>>> mapChunks;
+
+        /** Maps changed since the last update */
+        std::vector<_unique_id> changedMaps;
+
+        /** Set when a chunk is created or emptied, the master renderer then needs the new list of render calls */
+        bool chunksChanged = false;
+    };
+
+    /** Register the textures of the tilesets of a map that are not registered yet */
+    void registerTiledTextures(MasterRenderer *masterRenderer, const TiledMap& map);
+}
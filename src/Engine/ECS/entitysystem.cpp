@@ -75,10 +75,16 @@ namespace pg
 #ifdef PROFILE
             auto startTask = std::chrono::steady_clock::now();
 #endif
+            // Nobody allocates in the buffer of two frames ago anymore, so it can be reclaimed before switching to it
+            frameAllocator.nextFrame();
+
             eventDispatcher.process();
 
             cmdDispatcher.process();
 
+            // Structural changes are done for this frame, use the remaining time of this window to defragment the sets
+            runCompaction();
+
             if (not stopRequested)
                 running = true;
 
@@ -275,6 +281,11 @@ namespace pg
                 }
             }
 
+            // Drop the init of the system if it was still waiting to run
+            pendingInits.erase(std::remove_if(pendingInits.begin(), pendingInits.end(), [system](const std::pair<AbstractSystem*, InitSys*>& pending) {
+                return pending.first == system;
+            }), pendingInits.end());
+
             // Delete the system
             delete system;
             systems.erase(it);
@@ -285,6 +296,8 @@ namespace pg
     {
         LOG_THIS_MEMBER("ECS");
 
+        runDeferredInits();
+
         bool keepRunning = running;
 
         running = true;
@@ -308,6 +321,241 @@ namespace pg
 
         return getEntity(getSystem<EntityNameSystem>()->getEntityId(name));
     }
+
+    void initSystem(AbstractSystem *system, InitSys *init)
+    {
+        LOG_THIS("ECS");
+
+        if (system->ecsRef)
+            system->ecsRef->handleSystemInit(system, init);
+        else
+            init->init();
+    }
+
+    void EntitySystem::handleSystemInit(AbstractSystem *system, InitSys *init)
+    {
+        LOG_THIS_MEMBER("ECS");
+
+        if (deferredInit)
+            pendingInits.emplace_back(system, init);
+        else
+            timedInit(system, init, false);
+    }
+
+    void EntitySystem::timedInit(AbstractSystem *system, InitSys *init, bool parallel)
+    {
+        LOG_THIS_MEMBER("ECS");
+
+        auto start = std::chrono::steady_clock::now();
+
+        try
+        {
+            init->init();
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR("ECS", "Exception thrown during the init of system [" << system->_id << "]: " << e.what());
+        }
+
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        SystemInitTiming timing;
+
+        timing.name = system->getSystemName() == "UnNamed" ? std::to_string(system->_id) : system->getSystemName();
+        timing.id = system->_id;
+        timing.duration = duration;
+        timing.parallel = parallel;
+
+        LOG_INFO("ECS", "Init of system " << timing.name << " took " << duration / 1000 << " us" << (parallel ? " (parallel)" : ""));
+
+        std::lock_guard<std::mutex> lock(initTimingMutex);
+
+        initTimings.push_back(timing);
+    }
+
+    /**
+     * @brief Run all the inits deferred since the deferred init mode was enabled
+     *
+     * The inits are processed as waves of a topological sort of the dependency graph.
+     * The inits that can't run in parallel keep their creation order between them and always run on the calling thread
+     * (they may need the OpenGL context), while the parallel ones are dispatched on the executor as soon as their dependencies are done.
+     */
+    void EntitySystem::runDeferredInits()
+    {
+        LOG_THIS_MEMBER("ECS");
+
+        if (pendingInits.empty())
+            return;
+
+        const auto nbInits = pendingInits.size();
+
+        LOG_INFO("ECS", "Running " << nbInits << " deferred inits");
+
+        std::unordered_map<_unique_id, size_t> indexOfSystem;
+
+        for (size_t i = 0; i < nbInits; i++)
+            indexOfSystem[pendingInits[i].first->_id] = i;
+
+        std::vector<std::vector<size_t>> dependents(nbInits);
+        std::vector<size_t> nbDependencies(nbInits, 0);
+
+        auto addEdge = [&](size_t before, size_t after) {
+            dependents[before].push_back(after);
+            nbDependencies[after]++;
+        };
+
+        // Inits that must run on this thread keep their relative creation order
+        size_t lastSerial = nbInits;
+
+        for (size_t i = 0; i < nbInits; i++)
+        {
+            if (pendingInits[i].second->canInitInParallel())
+                continue;
+
+            if (lastSerial != nbInits)
+                addEdge(lastSerial, i);
+
+            lastSerial = i;
+        }
+
+        for (const auto& dependency : initDependencies)
+        {
+            auto after = indexOfSystem.find(dependency.first);
+            auto before = indexOfSystem.find(dependency.second);
+
+            // Dependencies on systems that are already initialized are always satisfied
+            if (after == indexOfSystem.end() or before == indexOfSystem.end())
+                continue;
+
+            addEdge(before->second, after->second);
+        }
+
+        std::vector<bool> done(nbInits, false);
+        std::vector<bool> launched(nbInits, false);
+        size_t nbDone = 0;
+
+        auto markDone = [&](size_t index) {
+            done[index] = true;
+            nbDone++;
+
+            for (auto dependent : dependents[index])
+                nbDependencies[dependent]--;
+        };
+
+        while (nbDone < nbInits)
+        {
+            std::vector<std::pair<size_t, std::future<void>>> inFlight;
+
+            // Dispatch every parallel init that is ready
+            for (size_t i = 0; i < nbInits; i++)
+            {
+                if (launched[i] or nbDependencies[i] != 0 or not pendingInits[i].second->canInitInParallel())
+                    continue;
+
+                launched[i] = true;
+
+                auto pending = pendingInits[i];
+
+                inFlight.emplace_back(i, executor.async([this, pending]() { timedInit(pending.first, pending.second, true); }));
+            }
+
+            // Run the serial inits that are ready on this thread while the parallel ones are running
+            bool progress = not inFlight.empty();
+            bool serialRan = true;
+
+            while (serialRan)
+            {
+                serialRan = false;
+
+                for (size_t i = 0; i < nbInits; i++)
+                {
+                    if (launched[i] or nbDependencies[i] != 0 or pendingInits[i].second->canInitInParallel())
+                        continue;
+
+                    launched[i] = true;
+
+                    timedInit(pendingInits[i].first, pendingInits[i].second, false);
+
+                    markDone(i);
+
+                    serialRan = true;
+                    progress = true;
+
+                    break;
+                }
+            }
+
+            for (auto& flight : inFlight)
+            {
+                flight.second.wait();
+
+                markDone(flight.first);
+            }
+
+            if (not progress)
+            {
+                LOG_ERROR("ECS", "Cycle detected in the init dependencies, running the remaining inits in creation order");
+
+                for (size_t i = 0; i < nbInits; i++)
+                {
+                    if (launched[i])
+                        continue;
+
+                    launched[i] = true;
+
+                    timedInit(pendingInits[i].first, pendingInits[i].second, false);
+
+                    done[i] = true;
+                    nbDone++;
+                }
+            }
+        }
+
+        pendingInits.clear();
+    }
+
+    void EntitySystem::reportInitTimings() const
+    {
+        LOG_THIS_MEMBER("ECS");
+
+        auto timings = initTimings;
+
+        std::sort(timings.begin(), timings.end(), [](const SystemInitTiming& lhs, const SystemInitTiming& rhs) { return lhs.duration > rhs.duration; });
+
+        long long total = 0;
+
+        for (const auto& timing : timings)
+        {
+            total += timing.duration;
+
+            LOG_INFO("ECS", "System " << timing.name << " init: " << timing.duration / 1000 << " us" << (timing.parallel ? " (parallel)" : ""));
+        }
+
+        LOG_INFO("ECS", "Total time spent in system inits: " << total / 1000 << " us");
+    }
+
+    void EntitySystem::runCompaction()
+    {
+        LOG_THIS_MEMBER("ECS");
+
+        if (compactionBudget.count() <= 0 or compactionJobs.empty())
+            return;
+
+        const auto deadline = std::chrono::steady_clock::now() + compactionBudget;
+
+        // Each job is visited at most once per frame, an unfinished job is resumed first on the next frame
+        for (size_t i = 0; i < compactionJobs.size(); i++)
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+                break;
+
+            if (not compactionJobs[nextCompactionJob](deadline))
+                break;
+
+            nextCompactionJob = (nextCompactionJob + 1) % compactionJobs.size();
+        }
+    }
+
     void EntitySystem::reportSystemProfiles()
     {
 #ifdef PROFILE
@@ -16,6 +16,7 @@
 
 #include "logger.h"
 #include "Memory/memorypool.h"
+#include "Memory/frameallocator.h"
 
 #ifdef PROFILE
 #include <atomic>
@@ -60,6 +61,22 @@ namespace pg
 
     template<typename> inline constexpr bool always_false = false;
 
+    /** Time spent in the init of a system */
+    struct SystemInitTiming
+    {
+        /** Name of the system (or its id if it is not named) */
+        std::string name;
+
+        /** Id of the system */
+        _unique_id id = 0;
+
+        /** Duration of the init in nanoseconds */
+        long long duration = 0;
+
+        /** True if the init ran on a worker thread */
+        bool parallel = false;
+    };
+
     class EntitySystem
     {
     friend class Entity;
@@ -108,6 +125,8 @@ namespace pg
             if (running)
                 return;
 
+            runDeferredInits();
+
             stopRequested = false;
             running = true;
 
@@ -126,6 +145,8 @@ namespace pg
             if (running)
                 return;
 
+            runDeferredInits();
+
             stopRequested = false;
             running = true;
         }
@@ -442,7 +463,41 @@ namespace pg
             return sys;
         }
 
-        InterpreterSystem* createInterpreterSystem(std::shared_ptr<Environment> env, std::shared_ptr<ClassInstance> sysInstance);
+        /**
+         * @brief Register a component set to be compacted in the basic task of the ecs
+         *
+         * @tparam Comp The component type whose set should be compacted
+         * @param key Optional key used to order the components, entity ids are used if none is given
+         *
+         * The registered sets are compacted incrementally, in a round robin manner, while no other system is running.
+         * Nothing is done until a compaction budget is set with setCompactionBudget.
+         */
+        template <typename Comp>
+        void enableCompaction(const typename ComponentSet<Comp>::CompactionKey& key = nullptr)
+        {
+            LOG_THIS_MEMBER("ECS");
+
+            if (not registry.hasTypeId<Comp>())
+            {
+                LOG_ERROR("ECS", "Component [" << typeid(Comp).name() << "] is not registered, it can't be compacted");
+                return;
+            }
+
+            auto own = registry.retrieve<Comp>();
+
+            compactionJobs.emplace_back([own, key](const std::chrono::steady_clock::time_point& deadline) {
+                return own->components.compact(deadline, key);
+            });
+        }
+
+        /**
+         * @brief Set the time spent each frame in the compaction of the registered component sets
+         *
+         * @param budget Time allowed per frame, 0 disables the compaction
+         */
+        inline void setCompactionBudget(const std::chrono::microseconds& budget) { compactionBudget = budget; }
+
+                InterpreterSystem* createInterpreterSystem(std::shared_ptr<Environment> env, std::shared_ptr<ClassInstance> sysInstance);
 
         /**
          * Overload of deleteSystem mainly used for deleting Interpreter system
@@ -451,6 +506,42 @@ namespace pg
          */
         void deleteSystem(_unique_id id);
 
+        /**
+         * @brief Enable or disable the deferred init mode
+         *
+         * @param deferred If true, the init of the systems created from now on is not run in createSystem
+         * but later in runDeferredInits (called automatically by start, fakeStart and executeOnce).
+         *
+         * In this mode the inits run as a dependency graph: the inits that can run in parallel (see InitSys::canInitInParallel)
+         * are dispatched on the executor, while the others run on the calling thread in their creation order.
+         */
+        inline void setDeferredInit(bool deferred) { deferredInit = deferred; }
+
+        /**
+         * @brief Declare that the init of SysAfter must run after the init of SysBefore
+         *
+         * Only meaningful in deferred init mode, in immediate mode inits run in creation order
+         */
+        template <typename SysAfter, typename SysBefore>
+        void initAfter()
+        {
+            LOG_THIS_MEMBER("ECS");
+
+            initDependencies.emplace_back(registry.getTypeId<SysAfter>(), registry.getTypeId<SysBefore>());
+        }
+
+        /** Run all the inits deferred since the deferred init mode was enabled */
+        void runDeferredInits();
+
+        /** Run or defer the init of a system depending on the init mode (called during the registration of the system) */
+        void handleSystemInit(AbstractSystem *system, InitSys *init);
+
+        /** Get the time spent in the init of each system, in the order the inits finished */
+        inline const std::vector<SystemInitTiming>& getInitTimings() const { return initTimings; }
+
+        /** Log the init timings of all the systems, slowest first */
+        void reportInitTimings() const;
+
         // Todo make proceed
         template <typename SysAfter, typename SysBefore>
         void succeed()
@@ -698,6 +789,14 @@ namespace pg
 
         inline bool isRunning() const { return running; }
 
+        /**
+         * @brief Get the per frame allocator of the ecs
+         *
+         * Memory allocated here is valid until the end of the next frame and is reclaimed in bulk afterward.
+         * Use it with ArenaAllocator for the scratch containers built every frame by the systems.
+         */
+        inline FrameAllocator& getFrameAllocator() { return frameAllocator; }
+
         inline size_t getNbSystems() const { return systems.size(); }
 
         inline size_t getNbTasks() const { return tasks.size(); }
@@ -825,6 +924,27 @@ namespace pg
         /** All the entities generated from the ECS */
         ComponentSet<Entity> entityPool;
 
+        /** Run and time the init of a system */
+        void timedInit(AbstractSystem *system, InitSys *init, bool parallel);
+
+        /** If true, the inits of the systems are stored in pendingInits instead of being run in createSystem */
+        bool deferredInit = false;
+
+        /** Inits waiting for runDeferredInits, in creation order */
+        std::vector<std::pair<AbstractSystem*, InitSys*>> pendingInits;
+
+        /** Init dependencies as pairs of (after, before) system ids */
+        std::vector<std::pair<_unique_id, _unique_id>> initDependencies;
+
+        /** Time spent in the init of each system */
+        std::vector<SystemInitTiming> initTimings;
+
+        /** Guard of initTimings when inits run in parallel */
+        std::mutex initTimingMutex;
+
+        /** Scratch memory of the systems, reset every frame */
+        FrameAllocator frameAllocator;
+
         /** Running thread of the ECS */
         std::thread runningThread;
 
@@ -839,6 +959,18 @@ namespace pg
 
         /** Last task of the mandatory ecs base systems */
         tf::Task basicTask;
+
+        /** Run the registered compaction jobs until the compaction budget is spent */
+        void runCompaction();
+
+        /** Incremental compaction jobs of the registered component sets */
+        std::vector<std::function<bool(const std::chrono::steady_clock::time_point&)>> compactionJobs;
+
+        /** Time spent each frame in the compaction jobs */
+        std::chrono::microseconds compactionBudget {0};
+
+        /** Index of the next compaction job to run */
+        size_t nextCompactionJob = 0;
     };
 
     template <typename Comp>
@@ -122,6 +122,31 @@ namespace pg
     }
 
 
+    /**
+     * @brief Swap the ids stored at two indexes of the dense array
+     *
+     * @param lhs The first index to swap
+     * @param rhs The second index to swap
+     *
+     * The sparse array is updated accordingly so that the dense <-> sparse reciprocity still holds.
+     * Both indexes must be valid indexes of the set.
+     */
+    void SparseSet::swapSlots(const size_t& lhs, const size_t& rhs)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (lhs >= size or rhs >= size or lhs == 0 or rhs == 0)
+        {
+            LOG_ERROR(DOM, "Trying to swap out of bound indexes: " << lhs << " and " << rhs);
+            return;
+        }
+
+        std::swap(dense[lhs], dense[rhs]);
+
+        sparse[dense[lhs]] = lhs;
+        sparse[dense[rhs]] = rhs;
+    }
+
     // /**
     //  * @brief Remove a component by component index
     //  *
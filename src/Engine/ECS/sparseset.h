@@ -16,10 +16,15 @@
 #include <memory>
 #include <mutex>
 #include <atomic>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <unordered_map>
 
 #include "entity.h"
 
 #include "Memory/memorypool.h"
+#include "Memory/concurrentpool.h"
 
 #include "logger.h"
 
@@ -223,6 +228,11 @@ namespace pg
             return SparseSetList(nbElements(), dense);
         }
 
+        // Protected interface
+    protected:
+        /** Swap the ids stored at two indexes of the dense array, keeping the sparse array in sync */
+        void swapSlots(const size_t& lhs, const size_t& rhs);
+
         // Private interface
     private:
         /** Internal helper function used to expend the dense and the component list */
@@ -250,6 +260,64 @@ namespace pg
         size_t sparseCapacity = 2;
     };
 
+    /**
+     * @brief Trait used to allow the compaction pass of a component set to move the components in memory
+     *
+     * By default a compaction only reorders the dense array and the component pointers, the components themselves
+     * stay at the same address because CompRef and any other raw pointer holder would be invalidated otherwise.
+     * Specialize this trait to std::true_type for components that are only ever accessed through their component set
+     * (ie never kept as a raw pointer across frames) to also reorder the backing memory of the pool.
+     *
+     * @tparam Comp The component type
+     */
+    template <typename Comp>
+    struct RelocatableComponent : public std::false_type {};
+
+    /**
+     * @brief Trait used to select the allocator pool storing the components of a component set
+     *
+     * @tparam Comp The component type
+     *
+     * Specialize this trait to change the memory policy of a component, for example:
+     * template <> struct ComponentPoolTraits<Velocity> : public AlignedComponentPool<Velocity, 32> {};
+     */
+    template <typename Comp>
+    struct ComponentPoolTraits
+    {
+        using Pool = AllocatorPool<Comp>;
+    };
+
+    /**
+     * @brief Memory policy storing the components in packed and aligned blocks
+     *
+     * @tparam Comp The component type, must be trivially copyable
+     * @tparam Alignment Alignment in bytes of the blocks (32 for AVX, 64 for a cache line)
+     * @tparam BlockSize Number of components per block
+     *
+     * Meant for small plain components (positions, velocities, ...) that are processed by SIMD kernels.
+     */
+    template <typename Comp, size_t Alignment = 64, size_t BlockSize = 256>
+    struct AlignedComponentPool
+    {
+        static_assert(std::is_trivially_copyable_v<Comp>, "Packed aligned pools can only store trivially copyable components");
+
+        using Pool = AlignedAllocatorPool<Comp, Alignment, BlockSize>;
+    };
+
+    /**
+     * @brief Memory policy storing the components in a thread safe pool
+     *
+     * @tparam Comp The component type
+     *
+     * Allocation and release of the components can then happen from any thread.
+     * The dense and sparse arrays of the set are still not thread safe on their own.
+     */
+    template <typename Comp>
+    struct ConcurrentComponentPool
+    {
+        using Pool = ConcurrentAllocatorPool<Comp>;
+    };
+
     //
     /**
      * @brief A container object used to store components
@@ -277,6 +345,9 @@ namespace pg
         typedef typename std::aligned_storage<sizeof(Comp), alignof(Comp)>::type CompStorage;
 
     public:
+        /** Type of the allocator pool used to store the components, selected through ComponentPoolTraits */
+        using Pool = typename ComponentPoolTraits<Comp>::Pool;
+
         /**
          * @brief List representation of the component of the component set
          *
@@ -562,6 +633,8 @@ namespace pg
 
             lastEntityIndex = index;
 
+            resetCompaction();
+
             // Todo: Test if allocating memory in a pool is faster than direct memory allocation with new
             auto component = pool.allocate(std::forward<Args>(args)...);
 
@@ -597,6 +670,8 @@ namespace pg
 
             if (nbComponents <= 1)
                 nbComponents = 1;
+
+            resetCompaction();
         }
 
         // TODO make a sparse set implementation that doesn't delete components on remove but instead reuse dead memory
@@ -622,14 +697,181 @@ namespace pg
             return ComponentSetList(nbComponents, componentList);
         }
 
+        /** Signature of the key used to order the set during a compaction, lower keys are placed first */
+        using CompactionKey = std::function<uint64_t(_unique_id, const Comp*)>;
+
+        /**
+         * @brief Run an incremental compaction pass of the set until the deadline is reached
+         *
+         * @param deadline Point in time after which the pass stops and waits for the next call to resume
+         * @param key Optional key used to order the components (ie a spatial cell), entity ids are used if none is given
+         *
+         * @return true if the set is fully compacted
+         * @return false if the pass was interrupted and needs more calls to finish
+         *
+         * After some churn the dense order is pretty much random as removals swap the last element in the hole
+         * and the pool reuses freed chunks. This pass reorders the dense array (and the backing memory of the components
+         * when RelocatableComponent<Comp> is specialized) so that systems iterating over the same entities in multiple
+         * sets access memory in the same order.
+         *
+         * The target order is snapshotted at the start of a pass, any add or remove in between restarts the pass.
+         * The key is only used when a new pass is started.
+         *
+         * @warning Must not be called while a view of this set is being iterated over (ie while systems are running)
+         */
+        bool compact(const std::chrono::steady_clock::time_point& deadline, const CompactionKey& key = nullptr)
+        {
+            LOG_THIS_MEMBER("Component Set");
+
+            if (compacted)
+                return true;
+
+            if (compactionOrder.empty())
+                startCompaction(key);
+
+            size_t nbSteps = 0;
+
+            // Phase 1: put every id at its target dense index
+            while (compactionCursor < nbComponents)
+            {
+                // Only check the clock once in a while as it is way more costly than a swap
+                if ((++nbSteps & 31) == 0 and std::chrono::steady_clock::now() >= deadline)
+                    return false;
+
+                const auto target = find(compactionOrder[compactionCursor - 1]);
+
+                if (target != compactionCursor)
+                {
+                    swapSlots(compactionCursor, target);
+                    std::swap(componentList[compactionCursor], componentList[target]);
+                }
+
+                compactionCursor++;
+            }
+
+            // Phase 2: move the components in memory so that addresses follow the dense order
+            if constexpr (RelocatableComponent<Comp>::value)
+            {
+                if (compactionAddresses.empty() and nbComponents > 1)
+                {
+                    compactionAddresses.assign(componentList + 1, componentList + nbComponents);
+                    std::sort(compactionAddresses.begin(), compactionAddresses.end(), std::less<Comp*>());
+
+                    compactionSlots.reserve(nbComponents);
+
+                    for (size_t i = 1; i < nbComponents; i++)
+                        compactionSlots[componentList[i]] = i;
+
+                    compactionCursor = 1;
+                }
+
+                while (compactionCursor < compactionAddresses.size() + 1)
+                {
+                    if ((++nbSteps & 31) == 0 and std::chrono::steady_clock::now() >= deadline)
+                        return false;
+
+                    Comp* wanted = compactionAddresses[compactionCursor - 1];
+                    Comp* current = componentList[compactionCursor];
+
+                    if (wanted != current)
+                    {
+                        const auto slot = compactionSlots[wanted];
+
+                        std::swap(*current, *wanted);
+
+                        componentList[compactionCursor] = wanted;
+                        componentList[slot] = current;
+
+                        compactionSlots[wanted] = compactionCursor;
+                        compactionSlots[current] = slot;
+                    }
+
+                    compactionCursor++;
+                }
+            }
+
+            resetCompaction();
+
+            compacted = true;
+
+            return true;
+        }
+
+        /**
+         * @brief Run an incremental compaction pass of the set for a given amount of time
+         *
+         * @param budget Maximum time spent in this call
+         * @param key Optional key used to order the components, entity ids are used if none is given
+         *
+         * @return true if the set is fully compacted
+         */
+        inline bool compact(const std::chrono::microseconds& budget, const CompactionKey& key = nullptr)
+        {
+            return compact(std::chrono::steady_clock::now() + budget, key);
+        }
+
+        /** Drop the current compaction pass and mark the set as needing a new one (ie when the keys changed) */
+        inline void resetCompaction()
+        {
+            compactionOrder.clear();
+            compactionAddresses.clear();
+            compactionSlots.clear();
+            compactionCursor = 1;
+            compacted = false;
+        }
+
+        /** Return true if the set is in the order requested by the last completed compaction pass */
+        inline bool isCompacted() const { return compacted; }
+
+        /**
+         * @brief Get the pool holding the memory of the components
+         *
+         * @return const Pool& The allocator pool of this set
+         *
+         * Mainly useful with an AlignedComponentPool policy to run kernels directly on the aligned blocks
+         */
+        inline const Pool& getPool() const { return pool; }
+
         // Todo reimplement clear to correctly free components
 
+    private:
+        /** Snapshot the target order of a new compaction pass */
+        void startCompaction(const CompactionKey& key)
+        {
+            LOG_THIS_MEMBER("Component Set");
+
+            compactionOrder.reserve(nbComponents);
+
+            if (key)
+            {
+                std::vector<std::pair<uint64_t, _unique_id>> keys;
+                keys.reserve(nbComponents);
+
+                for (size_t i = 1; i < nbComponents; i++)
+                    keys.emplace_back(key(at(i), componentList[i]), at(i));
+
+                std::sort(keys.begin(), keys.end());
+
+                for (const auto& pair : keys)
+                    compactionOrder.push_back(pair.second);
+            }
+            else
+            {
+                for (size_t i = 1; i < nbComponents; i++)
+                    compactionOrder.push_back(at(i));
+
+                std::sort(compactionOrder.begin(), compactionOrder.end());
+            }
+
+            compactionCursor = 1;
+        }
+
     private:
         /** The component list holding the data of all the component of this sparse set */
         Comp** componentList;
 
         /** The allocator pool that store all the component memory in a packed manner */
-        AllocatorPool<Comp> pool;
+        Pool pool;
 
         /** Number of component actually allocated */
         size_t nbComponents = 1;
@@ -638,6 +880,21 @@ namespace pg
         size_t componentCapacity = 2;
 
         size_t lastEntityIndex = 0;
+
+        /** Target order of the entity ids of the current compaction pass (empty when no pass is running) */
+        std::vector<_unique_id> compactionOrder;
+
+        /** Address of the components sorted in ascending order, used when relocating the backing memory */
+        std::vector<Comp*> compactionAddresses;
+
+        /** Current slot index of each component address during the relocation phase */
+        std::unordered_map<Comp*, size_t> compactionSlots;
+
+        /** Next dense index to process in the current compaction pass */
+        size_t compactionCursor = 1;
+
+        /** True when the set is already in the requested order and no structural change happened since */
+        bool compacted = false;
     };
 
     /**
@@ -45,6 +45,15 @@ namespace pg
         virtual ~InitSys() {}
 
         virtual void init() = 0;
+
+        /**
+         * @brief Tell if this init can run on a worker thread, concurrently with the init of other systems
+         *
+         * Only used when the ecs defers the init of the systems (see EntitySystem::setDeferredInit).
+         * Return true only if the init doesn't touch the registry (no group, entity or component creation),
+         * nor any OpenGL resources, ie it only loads and parses data into the system itself.
+         */
+        virtual bool canInitInParallel() const { return false; }
     };
 
     struct SaveSys
@@ -107,6 +116,16 @@ namespace pg
         // Todo make function onAdd and onDelete of a component that default to nothing if not used
     };
 
+    /**
+     * @brief Run the init of a system, or defer it if the ecs of the system is in deferred init mode
+     *
+     * @param system The system to init
+     * @param init The InitSys interface of the system
+     *
+     * The init is timed in both cases, see EntitySystem::getInitTimings
+     */
+    void initSystem(AbstractSystem *system, InitSys *init);
+
     template <typename... Comps>
     struct System;
 
@@ -244,7 +263,7 @@ namespace pg
 
         LOG_INFO("System", "Running init");
 
-        system->init();
+        initSystem(system, static_cast<InitSys*>(system));
 
         registerComponents(system, registry, comps...);
     }
@@ -5,6 +5,8 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cstring>
+#include <algorithm>
 
 #include "logger.h"
 
@@ -65,7 +67,8 @@ namespace pg
         // Modern Windows drivers support 330 core or higher
         extraString = "#version 300 es\nprecision mediump float;\n"; // For WebGL or embedded
 #else
-        extraString = "#version 330 core\n";
+        // The camera matrices come from the CameraBlock uniform buffer on desktop, WebGL keeps the plain uniforms
+        extraString = "#version 330 core\n#define PG_CAMERA_BLOCK\n";
 #endif
 
         LOG_INFO(DOM, "Creating shader program from files: '" << vertexPath << ", " << fragmentPath << "'");
@@ -98,6 +101,10 @@ namespace pg
         glDeleteShader(vertex);
         glDeleteShader(fragment);
 
+        reflectUniforms();
+
+        bindCameraBlock();
+
         LOG_INFO(DOM, "Shader program created with ID: " << ID);
         printf("Shader program created with ID: %u\n", ID);
 
@@ -120,66 +127,49 @@ namespace pg
     // ------------------------------------------------------------------------
     void OpenGLShaderProgram::setUniformValue(const std::string &name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
-
-        glCheckError();
+        setUniformAt(getUniformIndex(name), static_cast<int>(value));
     }
     // ------------------------------------------------------------------------
     void OpenGLShaderProgram::setUniformValue(const std::string &name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
-
-        glCheckError();
+        setUniformAt(getUniformIndex(name), value);
     }
     // ------------------------------------------------------------------------
     void OpenGLShaderProgram::setUniformValue(const std::string &name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
-
-        glCheckError();
+        setUniformAt(getUniformIndex(name), value);
     }
     // ------------------------------------------------------------------------
     void OpenGLShaderProgram::setUniformValue(const std::string &name, const glm::vec2 &value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
-
-        glCheckError();
+        setUniformAt(getUniformIndex(name), value);
     }
     void OpenGLShaderProgram::setUniformValue(const std::string &name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
-
-        glCheckError();
+        setUniformAt(getUniformIndex(name), glm::vec2(x, y));
     }
     // ------------------------------------------------------------------------
     void OpenGLShaderProgram::setUniformValue(const std::string &name, const glm::vec3 &value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
-
-        glCheckError();
+        setUniformAt(getUniformIndex(name), value);
     }
     void OpenGLShaderProgram::setUniformValue(const std::string &name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
-
-        glCheckError();
+        setUniformAt(getUniformIndex(name), glm::vec3(x, y, z));
     }
     // ------------------------------------------------------------------------
     void OpenGLShaderProgram::setUniformValue(const std::string &name, const glm::vec4 &value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
-
-        glCheckError();
+        setUniformAt(getUniformIndex(name), value);
     }
     void OpenGLShaderProgram::setUniformValue(const std::string &name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
-
-        glCheckError();
+        setUniformAt(getUniformIndex(name), glm::vec4(x, y, z, w));
     }
     // ------------------------------------------------------------------------
     void OpenGLShaderProgram::setUniformValue(const std::string &name, const glm::mat2 &mat) const
     {
+        // Not cached, mat2 uniforms are not used by the engine shaders
         glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
 
         glCheckError();
@@ -187,6 +177,7 @@ namespace pg
     // ------------------------------------------------------------------------
     void OpenGLShaderProgram::setUniformValue(const std::string &name, const glm::mat3 &mat) const
     {
+        // Not cached, mat3 uniforms are not used by the engine shaders
         glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
 
         glCheckError();
@@ -194,9 +185,151 @@ namespace pg
     // ------------------------------------------------------------------------
     void OpenGLShaderProgram::setUniformValue(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setUniformAt(getUniformIndex(name), mat);
+    }
+
+    int OpenGLShaderProgram::getUniformIndex(const std::string &name) const
+    {
+        auto it = uniformIndex.find(name);
 
-        glCheckError();
+        if (it == uniformIndex.end())
+            return -1;
+
+        return it->second;
+    }
+
+    bool OpenGLShaderProgram::updateCache(int index, const void *value, size_t size) const
+    {
+        if (index < 0 or static_cast<size_t>(index) >= uniforms.size())
+            return false;
+
+        auto& slot = uniforms[index];
+
+        if (slot.cached and std::memcmp(slot.value, value, size) == 0)
+            return false;
+
+        std::memcpy(slot.value, value, size);
+        slot.cached = true;
+
+        return true;
+    }
+    // ------------------------------------------------------------------------
+    void OpenGLShaderProgram::setUniformAt(int index, int value) const
+    {
+        if (updateCache(index, &value, sizeof(int)))
+        {
+            glUniform1i(uniforms[index].location, value);
+
+            glCheckError();
+        }
+    }
+    // ------------------------------------------------------------------------
+    void OpenGLShaderProgram::setUniformAt(int index, float value) const
+    {
+        if (updateCache(index, &value, sizeof(float)))
+        {
+            glUniform1f(uniforms[index].location, value);
+
+            glCheckError();
+        }
+    }
+    // ------------------------------------------------------------------------
+    void OpenGLShaderProgram::setUniformAt(int index, const glm::vec2 &value) const
+    {
+        if (updateCache(index, &value[0], sizeof(glm::vec2)))
+        {
+            glUniform2fv(uniforms[index].location, 1, &value[0]);
+
+            glCheckError();
+        }
+    }
+    // ------------------------------------------------------------------------
+    void OpenGLShaderProgram::setUniformAt(int index, const glm::vec3 &value) const
+    {
+        if (updateCache(index, &value[0], sizeof(glm::vec3)))
+        {
+            glUniform3fv(uniforms[index].location, 1, &value[0]);
+
+            glCheckError();
+        }
+    }
+    // ------------------------------------------------------------------------
+    void OpenGLShaderProgram::setUniformAt(int index, const glm::vec4 &value) const
+    {
+        if (updateCache(index, &value[0], sizeof(glm::vec4)))
+        {
+            glUniform4fv(uniforms[index].location, 1, &value[0]);
+
+            glCheckError();
+        }
+    }
+    // ------------------------------------------------------------------------
+    void OpenGLShaderProgram::setUniformAt(int index, const glm::mat4 &mat) const
+    {
+        if (updateCache(index, &mat[0][0], sizeof(glm::mat4)))
+        {
+            glUniformMatrix4fv(uniforms[index].location, 1, GL_FALSE, &mat[0][0]);
+
+            glCheckError();
+        }
+    }
+
+    void OpenGLShaderProgram::reflectUniforms()
+    {
+        GLint nbUniforms = 0;
+        GLint maxLength = 0;
+
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &nbUniforms);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+        std::vector<GLchar> nameBuffer(std::max(maxLength, 1));
+
+        for (GLint i = 0; i < nbUniforms; ++i)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+
+            glGetActiveUniform(ID, i, static_cast<GLsizei>(nameBuffer.size()), &length, &size, &type, nameBuffer.data());
+
+            std::string name(nameBuffer.data(), length);
+
+            // Arrays are reported as name[0]
+            auto bracket = name.find('[');
+
+            if (bracket != std::string::npos)
+                name.resize(bracket);
+
+            GLint location = glGetUniformLocation(ID, name.c_str());
+
+            // Uniforms living in a uniform block don't have a location
+            if (location < 0)
+                continue;
+
+            uniformIndex[name] = static_cast<int>(uniforms.size());
+
+            UniformSlot slot;
+            slot.location = location;
+
+            uniforms.push_back(slot);
+        }
+
+        LOG_INFO(DOM, "Shader program " << ID << " has " << uniforms.size() << " active uniforms");
+    }
+
+    void OpenGLShaderProgram::bindCameraBlock()
+    {
+#ifndef __EMSCRIPTEN__
+        const GLuint blockIndex = glGetUniformBlockIndex(ID, "CameraBlock");
+
+        // Custom shaders may still declare the camera matrices as plain uniforms
+        if (blockIndex == GL_INVALID_INDEX)
+            return;
+
+        glUniformBlockBinding(ID, blockIndex, CameraBlockBinding);
+
+        cameraBlock = true;
+#endif
     }
 
     void OpenGLShaderProgram::checkCompileErrors(GLuint shader, std::string type)
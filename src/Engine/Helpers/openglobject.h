@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <unordered_map>
 
 #include "logger.h"
 
@@ -60,10 +62,66 @@ namespace pg
         void setUniformValue(const std::string &name, const glm::mat3 &mat) const;
         // ------------------------------------------------------------------------
         void setUniformValue(const std::string &name, const glm::mat4 &mat) const;
+
+        /**
+         * @brief Get the index of an active uniform in the uniform table of the program
+         *
+         * @param name Name of the uniform (without the [0] of arrays)
+         * @return int The index to use with setUniformAt, -1 if the uniform is not active in the program
+         */
+        int getUniformIndex(const std::string &name) const;
+
+        // Indexed uniform setters, values equal to the last one written are not sent to GL again
+        // ------------------------------------------------------------------------
+        void setUniformAt(int index, int value) const;
+        void setUniformAt(int index, float value) const;
+        void setUniformAt(int index, const glm::vec2 &value) const;
+        void setUniformAt(int index, const glm::vec3 &value) const;
+        void setUniformAt(int index, const glm::vec4 &value) const;
+        void setUniformAt(int index, const glm::mat4 &mat) const;
+
+        /** Get the number of active uniforms found when the program was linked */
+        inline size_t getNbUniforms() const { return uniforms.size(); }
+
+        /** Check if the program reads the camera matrices from the CameraBlock uniform buffer */
+        inline bool usesCameraBlock() const { return cameraBlock; }
+
+        /** Uniform buffer binding point of the CameraBlock, shared by all the programs */
+        static constexpr unsigned int CameraBlockBinding = 0;
+
     private:
         // utility function for checking shader compilation/linking errors.
         // ------------------------------------------------------------------------
         void checkCompileErrors(GLuint shader, std::string type);
+
+        /** Read all the active uniforms of the program once linked */
+        void reflectUniforms();
+
+        /** Attach the CameraBlock of the program, if it declares one, to the CameraBlockBinding binding point */
+        void bindCameraBlock();
+
+        /**
+         * @brief Compare a value with the last one written in a uniform and store it if it changed
+         *
+         * @return true If the value needs to be sent to GL
+         */
+        bool updateCache(int index, const void *value, size_t size) const;
+
+        /** An active uniform of the program and the last value written in it */
+        struct UniformSlot
+        {
+            GLint location = -1;
+
+            bool cached = false;
+
+            unsigned char value[sizeof(glm::mat4)];
+        };
+
+        std::unordered_map<std::string, int> uniformIndex;
+
+        mutable std::vector<UniformSlot> uniforms;
+
+        bool cameraBlock = false;
     };
 
     class OpenGLVertexArrayObject
@@ -229,6 +287,8 @@ namespace pg
 
         inline void allocate(int count) { allocate(nullptr, count); }
 
+        inline GLuint bufferId() const { return buffer; }
+
     private:
         GLuint buffer;
 
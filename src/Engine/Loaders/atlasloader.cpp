@@ -73,6 +73,32 @@ namespace pg
         }
     }
 
+    size_t LoadedAtlas::addTexture(const AtlasTexture& texture)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        auto it = textureDict.find(texture.getName());
+
+        if (it != textureDict.end())
+        {
+            textureList[it->second] = texture;
+            textureList[it->second].setId(it->second);
+
+            return it->second;
+        }
+
+        const size_t id = textureList.size();
+
+        textureList.push_back(texture);
+        textureList.back().setId(id);
+
+        textureDict[texture.getName()] = static_cast<int>(id);
+
+        nbTextureId = textureList.size();
+
+        return id;
+    }
+
     void LoadedAtlas::setFile(const std::string& atlasFile, std::unordered_map<std::string, ParserCallback> callbacks)
     {
         LOG_THIS(DOM);
@@ -34,6 +34,7 @@ namespace pg {
         inline void setHeight(unsigned int h) { this->height = h; }
         inline void setOffset(unsigned int offset) { this->yOffset = offset; }
         inline void setName(const std::string &name) { this->name = name; }
+        inline void setTextureLimit(const constant::Vector4D &limit) { this->textureLimit = limit; }
 
         void setMesh(unsigned int xPos, unsigned int yPos, unsigned int atlasWidth, unsigned int atlasHeight);
 
@@ -88,6 +89,16 @@ namespace pg {
 
         bool isEmpty() const { return nbTextureId == 0; }
 
+        /** Set the size of an atlas built at runtime */
+        void setSize(unsigned int width, unsigned int height) { atlasWidth = width; atlasHeight = height; }
+
+        /**
+         * @brief Add a texture to an atlas built at runtime, replacing any texture with the same name
+         *
+         * @return size_t The id of the texture in the atlas
+         */
+        size_t addTexture(const AtlasTexture &texture);
+
     protected:
         std::string version;
         std::string imagePath;
@@ -1,161 +1,570 @@
-// Todo
-
-// #include "tileloader.h"
-
-// #include "../Files/parser.h"
-// #include "../logger.h"
-
-// namespace pg
-// {
-// 	namespace
-// 	{
-// 		//TODO make this a param of the atlas somewhere in a file
-// 		#define NBROWTEXTUREATLAS 16.0f
-// 		#define SPRITESIZE 64.0f
-// 		#define ATLASSIZE 1024.0f
-
-// 		static constexpr char const * DOM = "Tile Loader";
-// 	}
-
-// 	TilesLoader::TilesId::TilesId()
-// 	{
-// 		LOG_THIS_MEMBER(DOM);
+#include "stdafx.h"
 
-// 		initializeOpenGLFunctions(); 
-
-// 		VAO = new QOpenGLVertexArrayObject();
-// 		VBO = new QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
-// 		EBO = new QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
-
-// 		VAO->create();
-// 		VBO->create();
-// 		EBO->create();
-// 	}
+#include "tileloader.h"
 
-// 	TilesLoader::TilesId::~TilesId()
-// 	{
-// 		LOG_THIS_MEMBER(DOM);
-
-// 		delete VAO;
-// 		delete VBO;
-// 		delete EBO;
-// 	}
+#include <cstdlib>
+#include <algorithm>
+#include <utility>
+#include <filesystem>
 
-// 	void TilesLoader::TilesId::setMesh(int textureId)
-// 	{
-// 		LOG_THIS_MEMBER(DOM);
-
-// 		int column = textureId % (int)NBROWTEXTUREATLAS;
-// 		float xMin = (column * SPRITESIZE) / ATLASSIZE;
-// 		float xMax = ((column + 1) * SPRITESIZE) / ATLASSIZE;
-
-// 		int row = (float)textureId / NBROWTEXTUREATLAS;
-// 		float yMin = (row * SPRITESIZE)  / ATLASSIZE;
-// 		float yMax = ((row + 1) * SPRITESIZE)  / ATLASSIZE;
+#include "Files/filemanager.h"
 
-// 		//texpos x                 texpos y
-// 		modelInfo.vertices[3] =  xMin; modelInfo.vertices[4] =  yMin;   
-// 		modelInfo.vertices[8] =  xMax; modelInfo.vertices[9] =  yMin;
-// 		modelInfo.vertices[13] = xMin; modelInfo.vertices[14] = yMax;
-// 		modelInfo.vertices[18] = xMax; modelInfo.vertices[19] = yMax;
-
-// 		VAO->bind();
-
-// 		// position attribute
-// 		glEnableVertexAttribArray(0);
-// 		VBO->bind();
-// 		VBO->setUsagePattern(QOpenGLBuffer::StreamDraw);
-// 		VBO->allocate(modelInfo.vertices, modelInfo.nbVertices * sizeof(float));
-
-// 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-
-// 		// texture coord attribute
-// 		glEnableVertexAttribArray(1);
-// 		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-
-// 		EBO->bind();
-// 		EBO->setUsagePattern(QOpenGLBuffer::StreamDraw);
-// 		EBO->allocate(modelInfo.indices, modelInfo.nbIndices * sizeof(unsigned int));
-
-// 		VAO->release();
-// 	}
-
-// 	void TilesLoader::TilesId::setType(std::string type)
-// 	{
-// 		LOG_THIS_MEMBER(DOM);
-
-// 		if(type == "Blank")
-// 			tileType = TileType::BLANK;
-// 		else if(type == "House")
-// 			tileType = TileType::HOUSE;
-// 		else if(type == "Shop")
-// 			tileType = TileType::SHOP;
-// 		else if(type == "Road")
-// 			tileType = TileType::ROAD;
-// 		else if(type == "Misc")
-// 			tileType = TileType::MISC;
-// 		else if(type == "Pathfinding")
-// 			tileType = TileType::PATHFINDING;
-// 		else
-// 			tileType = TileType::BLANK;
-// 	}
-
-// 	TilesLoader::TilesLoader(const std::string& tilesFolder) : nbTilesId(0)
-// 	{
-// 		LOG_THIS_MEMBER(DOM);
-
-// 		std::shared_ptr<TilesLoader::TilesId> newTile;
-
-// 		std::vector<TextFile> folder = ResourceAccessor::openTextFolder(tilesFolder);
-
-// 		for(auto file : folder)
-// 		{
-// 			newTile = std::make_shared<TilesLoader::TilesId>();
-// 			newTile->setId(nbTilesId);
-
-// 			FileParser parser(file);
-
-//         	parser.addCallback("Tile Name",  [&](const std::string&) { newTile->setName(parser.getNextLine()); } );
-//         	parser.addCallback("Texture",    [&](const std::string&) { newTile->setMesh(std::stoi(parser.getNextLine())); } );
-//         	parser.addCallback("Type",       [&](const std::string&) { newTile->setType(parser.getNextLine()); } );
-
-// 			parser.run();
-
-// 			tilesList.push_back(newTile);
-// 			tilesDict[newTile->getName()] = nbTilesId;
-
-// 			nbTilesId++; 
-// 		}
-// 	}
-
-// 	TilesLoader::~TilesLoader()
-// 	{
-// 		LOG_THIS_MEMBER(DOM);
-
-// 		tilesList.clear();
-// 		tilesList.shrink_to_fit();
-// 		//std::vector<TilesLoader::TilesId* >().swap(tilesList); //delete block list
-// 	}
-
-// 	const TilesLoader::TilesId* TilesLoader::getTile(int id) const
-// 	{
-// 		LOG_THIS_MEMBER(DOM);
-
-// 		if(id < nbTilesId)
-// 			return tilesList[id].get();
-// 		else
-// 			return nullptr;
-// 	}
-
-// 	const TilesLoader::TilesId* TilesLoader::getTile(std::string tileName) const
-// 	{
-// 		LOG_THIS_MEMBER(DOM);
-
-// 		auto it = tilesDict.find(tileName);
-
-// 		if(it != tilesDict.end())
-// 			return tilesList[tilesDict.at(tileName)].get();
-// 		else
-// 			return nullptr;
-// 	}
-// }
\ No newline at end of file
+#include "logger.h"
+
+namespace pg
+{
+    namespace
+    {
+        static constexpr char const * DOM = "Tile Loader";
+
+        /** Just enough of a json document to read the maps of Tiled */
+        struct JsonValue
+        {
+            enum class Type
+            {
+                Null,
+                Bool,
+                Number,
+                String,
+                Array,
+                Object
+            };
+
+            const JsonValue* find(const std::string& key) const
+            {
+                for (const auto& member : object)
+                {
+                    if (member.first == key)
+                        return &member.second;
+                }
+
+                return nullptr;
+            }
+
+            double getNumber(const std::string& key, double defaultValue) const
+            {
+                auto value = find(key);
+
+                return value and value->type == Type::Number ? value->number : defaultValue;
+            }
+
+            std::string getString(const std::string& key, const std::string& defaultValue = "") const
+            {
+                auto value = find(key);
+
+                return value and value->type == Type::String ? value->string : defaultValue;
+            }
+
+            bool getBool(const std::string& key, bool defaultValue) const
+            {
+                auto value = find(key);
+
+                return value and value->type == Type::Bool ? value->boolean : defaultValue;
+            }
+
+            Type type = Type::Null;
+
+            bool boolean = false;
+
+            double number = 0.0;
+
+            std::string string;
+
+            std::vector<JsonValue> array;
+
+            std::vector<std::pair<std::string, JsonValue>> object;
+        };
+
+        class JsonParser
+        {
+        public:
+            JsonParser(const std::string& text) : text(text) {}
+
+            bool parse(JsonValue& value)
+            {
+                if (not parseValue(value))
+                    return false;
+
+                skipWhitespace();
+
+                return pos == text.size();
+            }
+
+            size_t getPosition() const { return pos; }
+
+        private:
+            void skipWhitespace()
+            {
+                while (pos < text.size() and (text[pos] == ' ' or text[pos] == '\n' or text[pos] == '\r' or text[pos] == '\t'))
+                    ++pos;
+            }
+
+            bool consume(char c)
+            {
+                skipWhitespace();
+
+                if (pos < text.size() and text[pos] == c)
+                {
+                    ++pos;
+                    return true;
+                }
+
+                return false;
+            }
+
+            bool parseLiteral(const char *literal)
+            {
+                const std::string expected = literal;
+
+                if (text.compare(pos, expected.size(), expected) != 0)
+                    return false;
+
+                pos += expected.size();
+
+                return true;
+            }
+
+            bool parseValue(JsonValue& value)
+            {
+                skipWhitespace();
+
+                if (pos >= text.size())
+                    return false;
+
+                switch (text[pos])
+                {
+                    case '{':
+                        return parseObject(value);
+
+                    case '[':
+                        return parseArray(value);
+
+                    case '"':
+                        value.type = JsonValue::Type::String;
+                        return parseString(value.string);
+
+                    case 't':
+                        value.type = JsonValue::Type::Bool;
+                        value.boolean = true;
+                        return parseLiteral("true");
+
+                    case 'f':
+                        value.type = JsonValue::Type::Bool;
+                        value.boolean = false;
+                        return parseLiteral("false");
+
+                    case 'n':
+                        value.type = JsonValue::Type::Null;
+                        return parseLiteral("null");
+
+                    default:
+                        return parseNumber(value);
+                }
+            }
+
+            bool parseNumber(JsonValue& value)
+            {
+                const char *start = text.c_str() + pos;
+                char *end = nullptr;
+
+                value.type = JsonValue::Type::Number;
+                value.number = std::strtod(start, &end);
+
+                if (end == start)
+                    return false;
+
+                pos += end - start;
+
+                return true;
+            }
+
+            bool parseString(std::string& out)
+            {
+                // Skip the opening quote
+                ++pos;
+
+                while (pos < text.size())
+                {
+                    const char c = text[pos++];
+
+                    if (c == '"')
+                        return true;
+
+                    if (c != '\\')
+                    {
+                        out += c;
+                        continue;
+                    }
+
+                    if (pos >= text.size())
+                        return false;
+
+                    const char escaped = text[pos++];
+
+                    switch (escaped)
+                    {
+                        case 'n': out += '\n'; break;
+                        case 't': out += '\t'; break;
+                        case 'r': out += '\r'; break;
+                        case 'b': out += '\b'; break;
+                        case 'f': out += '\f'; break;
+
+                        case 'u':
+                        {
+                            if (pos + 4 > text.size())
+                                return false;
+
+                            const auto code = std::strtoul(text.substr(pos, 4).c_str(), nullptr, 16);
+
+                            pos += 4;
+
+                            // Only used in names, so the code point is written in utf8 without handling surrogate pairs
+                            if (code < 0x80)
+                            {
+                                out += static_cast<char>(code);
+                            }
+                            else if (code < 0x800)
+                            {
+                                out += static_cast<char>(0xC0 | (code >> 6));
+                                out += static_cast<char>(0x80 | (code & 0x3F));
+                            }
+                            else
+                            {
+                                out += static_cast<char>(0xE0 | (code >> 12));
+                                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                                out += static_cast<char>(0x80 | (code & 0x3F));
+                            }
+
+                            break;
+                        }
+
+                        default:
+                            out += escaped;
+                            break;
+                    }
+                }
+
+                return false;
+            }
+
+            bool parseArray(JsonValue& value)
+            {
+                value.type = JsonValue::Type::Array;
+
+                // Skip the opening bracket
+                ++pos;
+
+                if (consume(']'))
+                    return true;
+
+                do
+                {
+                    value.array.emplace_back();
+
+                    if (not parseValue(value.array.back()))
+                        return false;
+                } while (consume(','));
+
+                return consume(']');
+            }
+
+            bool parseObject(JsonValue& value)
+            {
+                value.type = JsonValue::Type::Object;
+
+                // Skip the opening brace
+                ++pos;
+
+                if (consume('}'))
+                    return true;
+
+                do
+                {
+                    skipWhitespace();
+
+                    if (pos >= text.size() or text[pos] != '"')
+                        return false;
+
+                    value.object.emplace_back();
+
+                    auto& member = value.object.back();
+
+                    if (not parseString(member.first) or not consume(':') or not parseValue(member.second))
+                        return false;
+                } while (consume(','));
+
+                return consume('}');
+            }
+
+            const std::string& text;
+
+            size_t pos = 0;
+        };
+
+        bool decodeBase64(const std::string& encoded, std::vector<unsigned char>& out)
+        {
+            auto decodeChar = [](char c) -> int {
+                if (c >= 'A' and c <= 'Z') return c - 'A';
+                if (c >= 'a' and c <= 'z') return c - 'a' + 26;
+                if (c >= '0' and c <= '9') return c - '0' + 52;
+                if (c == '+') return 62;
+                if (c == '/') return 63;
+
+                return -1;
+            };
+
+            uint32_t buffer = 0;
+            int nbBits = 0;
+
+            for (char c : encoded)
+            {
+                if (c == '=')
+                    break;
+
+                // Tiled may wrap the data on several lines
+                if (c == '\n' or c == '\r' or c == ' ')
+                    continue;
+
+                const int value = decodeChar(c);
+
+                if (value < 0)
+                    return false;
+
+                buffer = (buffer << 6) | static_cast<uint32_t>(value);
+                nbBits += 6;
+
+                if (nbBits >= 8)
+                {
+                    nbBits -= 8;
+
+                    out.push_back(static_cast<unsigned char>((buffer >> nbBits) & 0xFF));
+                }
+            }
+
+            return true;
+        }
+
+        bool parseTileData(const JsonValue& layer, TiledLayer& result)
+        {
+            auto data = layer.find("data");
+
+            if (not data)
+            {
+                LOG_ERROR(DOM, "Layer " << result.name << " has no data, infinite maps are not supported");
+                return false;
+            }
+
+            const size_t nbTiles = static_cast<size_t>(result.width) * result.height;
+
+            result.tiles.reserve(nbTiles);
+
+            if (data->type == JsonValue::Type::Array)
+            {
+                for (const auto& tile : data->array)
+                    result.tiles.push_back(static_cast<uint32_t>(tile.number));
+            }
+            else if (data->type == JsonValue::Type::String)
+            {
+                if (layer.getString("encoding") != "base64" or not layer.getString("compression").empty())
+                {
+                    LOG_ERROR(DOM, "Layer " << result.name << " is compressed, only uncompressed base64 layers are supported");
+                    return false;
+                }
+
+                std::vector<unsigned char> bytes;
+
+                if (not decodeBase64(data->string, bytes))
+                {
+                    LOG_ERROR(DOM, "Layer " << result.name << " holds invalid base64 data");
+                    return false;
+                }
+
+                // Gids are stored as little endian unsigned ints
+                for (size_t i = 0; i + 3 < bytes.size(); i += 4)
+                    result.tiles.push_back(bytes[i] | (bytes[i + 1] << 8) | (bytes[i + 2] << 16) | (static_cast<uint32_t>(bytes[i + 3]) << 24));
+            }
+
+            if (result.tiles.size() != nbTiles)
+            {
+                LOG_ERROR(DOM, "Layer " << result.name << " holds " << result.tiles.size() << " tiles instead of " << nbTiles);
+                return false;
+            }
+
+            return true;
+        }
+
+        void parseLayers(const JsonValue& layers, float offsetX, float offsetY, float opacity, bool visible, TiledMap& map)
+        {
+            for (const auto& layer : layers.array)
+            {
+                const auto type = layer.getString("type");
+
+                const float layerOffsetX = offsetX + static_cast<float>(layer.getNumber("offsetx", 0.0));
+                const float layerOffsetY = offsetY + static_cast<float>(layer.getNumber("offsety", 0.0));
+                const float layerOpacity = opacity * static_cast<float>(layer.getNumber("opacity", 1.0));
+                const bool layerVisible = visible and layer.getBool("visible", true);
+
+                if (type == "group")
+                {
+                    if (auto children = layer.find("layers"))
+                        parseLayers(*children, layerOffsetX, layerOffsetY, layerOpacity, layerVisible, map);
+
+                    continue;
+                }
+
+                // Object and image layers hold gameplay data, they are not drawn as tiles
+                if (type != "tilelayer")
+                    continue;
+
+                TiledLayer result;
+
+                result.name = layer.getString("name");
+                result.width = static_cast<int>(layer.getNumber("width", 0));
+                result.height = static_cast<int>(layer.getNumber("height", 0));
+                result.offsetX = layerOffsetX;
+                result.offsetY = layerOffsetY;
+                result.opacity = layerOpacity;
+                result.visible = layerVisible;
+
+                if (parseTileData(layer, result))
+                    map.layers.push_back(std::move(result));
+            }
+        }
+    }
+
+    bool TiledTileset::getTileLimits(uint32_t gid, constant::Vector4D& limits) const
+    {
+        const uint32_t id = gid & TiledGidMask;
+
+        if (id < firstGid or id - firstGid >= tileCount or columns <= 0 or imageWidth <= 0 or imageHeight <= 0)
+            return false;
+
+        const int index = static_cast<int>(id - firstGid);
+
+        const float x = static_cast<float>(margin + (index % columns) * (tileWidth + spacing));
+        const float y = static_cast<float>(margin + (index / columns) * (tileHeight + spacing));
+
+        limits.x = x / imageWidth;
+        limits.y = y / imageHeight;
+        limits.z = (x + tileWidth) / imageWidth;
+        limits.w = (y + tileHeight) / imageHeight;
+
+        // The shader interpolates from the first to the second limit, so swapping them flips the tile
+        if (gid & TiledFlipHorizontal)
+            std::swap(limits.x, limits.z);
+
+        if (gid & TiledFlipVertical)
+            std::swap(limits.y, limits.w);
+
+        return true;
+    }
+
+    int TiledMap::findTileset(uint32_t gid) const
+    {
+        const uint32_t id = gid & TiledGidMask;
+
+        if (id == 0)
+            return -1;
+
+        // Tilesets are sorted by first gid, the tile belongs to the last one starting before it
+        for (int i = static_cast<int>(tilesets.size()) - 1; i >= 0; --i)
+        {
+            const auto& tileset = tilesets[i];
+
+            if (id >= tileset.firstGid)
+                return id - tileset.firstGid < tileset.tileCount ? i : -1;
+        }
+
+        return -1;
+    }
+
+    bool parseTiledMap(const std::string& json, const std::string& folder, TiledMap& map)
+    {
+        LOG_THIS(DOM);
+
+        JsonValue root;
+
+        JsonParser parser(json);
+
+        if (not parser.parse(root) or root.type != JsonValue::Type::Object)
+        {
+            LOG_ERROR(DOM, "Invalid json, parsing stopped at character " << parser.getPosition());
+            return false;
+        }
+
+        if (root.getString("orientation", "orthogonal") != "orthogonal")
+        {
+            LOG_ERROR(DOM, "Only orthogonal maps are supported");
+            return false;
+        }
+
+        if (root.getBool("infinite", false))
+        {
+            LOG_ERROR(DOM, "Infinite maps are not supported");
+            return false;
+        }
+
+        map = TiledMap{};
+
+        map.width = static_cast<int>(root.getNumber("width", 0));
+        map.height = static_cast<int>(root.getNumber("height", 0));
+        map.tileWidth = static_cast<int>(root.getNumber("tilewidth", 0));
+        map.tileHeight = static_cast<int>(root.getNumber("tileheight", 0));
+
+        if (auto tilesets = root.find("tilesets"))
+        {
+            for (const auto& tileset : tilesets->array)
+            {
+                if (tileset.find("source"))
+                {
+                    LOG_ERROR(DOM, "External tileset " << tileset.getString("source") << " is not supported, embed it in the map");
+                    continue;
+                }
+
+                TiledTileset result;
+
+                result.name = tileset.getString("name");
+                result.firstGid = static_cast<uint32_t>(tileset.getNumber("firstgid", 1));
+                result.tileCount = static_cast<uint32_t>(tileset.getNumber("tilecount", 0));
+                result.columns = static_cast<int>(tileset.getNumber("columns", 0));
+                result.tileWidth = static_cast<int>(tileset.getNumber("tilewidth", map.tileWidth));
+                result.tileHeight = static_cast<int>(tileset.getNumber("tileheight", map.tileHeight));
+                result.margin = static_cast<int>(tileset.getNumber("margin", 0));
+                result.spacing = static_cast<int>(tileset.getNumber("spacing", 0));
+                result.imageWidth = static_cast<int>(tileset.getNumber("imagewidth", 0));
+                result.imageHeight = static_cast<int>(tileset.getNumber("imageheight", 0));
+
+                const auto image = tileset.getString("image");
+
+                result.imagePath = folder.empty() ? image : (std::filesystem::path(folder) / image).lexically_normal().generic_string();
+                result.textureName = result.imagePath;
+
+                map.tilesets.push_back(std::move(result));
+            }
+        }
+
+        std::sort(map.tilesets.begin(), map.tilesets.end(), [](const TiledTileset& lhs, const TiledTileset& rhs) { return lhs.firstGid < rhs.firstGid; });
+
+        if (auto layers = root.find("layers"))
+            parseLayers(*layers, 0.0f, 0.0f, 1.0f, true, map);
+
+        LOG_INFO(DOM, "Parsed a map of " << map.width << "x" << map.height << " tiles with " << map.layers.size() << " layers and " << map.tilesets.size() << " tilesets");
+
+        return true;
+    }
+
+    bool loadTiledMap(const std::string& path, TiledMap& map)
+    {
+        LOG_THIS(DOM);
+
+        auto file = UniversalFileAccessor::openTextFile(path);
+
+        if (file.data.empty())
+        {
+            LOG_ERROR(DOM, "Can't read the map " << path);
+            return false;
+        }
+
+        return parseTiledMap(file.data, std::filesystem::path(path).parent_path().generic_string(), map);
+    }
+}
@@ -1,81 +1,141 @@
-// Todo
-
 #pragma once
 
-// #include <QOpenGLFunctions>
-// #include <QOpenGLTexture>
-// #include <QOpenGLVertexArrayObject>
-// #include <QOpenGLBuffer>
-
-// #include <vector>
-// #include <string>
-// #include <map>
-// #include <memory>
-
-// #include "../constant.h"
-
-// namespace pg
-// {
-// 	enum class TileType 
-// 	{
-// 		BLANK,
-// 		HOUSE,
-// 		SHOP,
-// 		ROAD,
-// 		TERRAIN,
-// 		PATHFINDING,
-// 		MISC
-// 	};
-
-// 	class TilesLoader
-// 	{
-// 	public:
-// 		class TilesId : protected QOpenGLFunctions
-// 		{
-// 		friend class TilesLoader;
-// 		public:
-// 			TilesId();
-// 			~TilesId();
-
-// 			inline int getId() const { return id; }
-// 			inline std::string getName() const { return name; }
-// 			inline QOpenGLVertexArrayObject* getMesh() const { return VAO; }
-
-// 			inline bool operator==(const std::string& rhs) const { return name == rhs; } 
-// 			inline bool operator==(const TileType& rhs) const { return tileType == rhs; }
-
-// 			inline bool operator!=(const std::string& rhs) const { return !(name == rhs); } 
-// 			inline bool operator!=(const TileType& rhs) const { return !(tileType == rhs); }
-
-// 			inline constant::SquareInfo getModelInfo() const { return modelInfo; }
-
-// 		protected:
-// 			inline void setId(int id) { this->id = id; }
-// 			inline void setName(std::string name) { this->name = name; }
-// 			void setMesh(int textureId); 
-// 			void setType(std::string type);
-
-// 		private:
-// 			int id = 0;
-// 			std::string name = "";
-// 			TileType tileType;
-
-// 			constant::SquareInfo modelInfo;
-
-// 			QOpenGLVertexArrayObject *VAO;
-// 			QOpenGLBuffer *VBO;
-// 			QOpenGLBuffer *EBO;
-// 		};
-
-// 		TilesLoader(const std::string& tilesFolder);
-// 		~TilesLoader();
-
-// 		const TilesLoader::TilesId* getTile(int id) const;
-// 		const TilesLoader::TilesId* getTile(std::string tileName) const;
-
-// 	private:
-// 		std::vector<std::shared_ptr<TilesLoader::TilesId>> tilesList;
-// 		std::map<std::string, int> tilesDict;
-// 		int nbTilesId;
-// 	};
-// }
\ No newline at end of file
+/**
+ * @file tileloader.h
+ * @author Pigeon Codeur
+ * @brief Definition of the loader of the tile maps exported by Tiled in the json format
+ * @version 0.1
+ * @date 2025-04-26
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "constant.h"
+
+namespace pg
+{
+    /** Flags stored in the highest bits of a gid by Tiled */
+    static constexpr uint32_t TiledFlipHorizontal = 0x80000000;
+    static constexpr uint32_t TiledFlipVertical   = 0x40000000;
+    static constexpr uint32_t TiledFlipDiagonal   = 0x20000000;
+    static constexpr uint32_t TiledRotateHexagonal = 0x10000000;
+
+    /** Mask giving back the id of a tile without its flags */
+    static constexpr uint32_t TiledGidMask = 0x0FFFFFFF;
+
+    /** An image cut in tiles of the same size */
+    struct TiledTileset
+    {
+        /**
+         * @brief Compute the part of the image drawn for a tile
+         *
+         * @param gid Global id of the tile, with its flip flags
+         * @param limits Receive the limits of the tile in uv coordinates (u0, v0, u1, v1), swapped when the tile is flipped
+         *
+         * Horizontal and vertical flips are supported, diagonal flips (used by rotated tiles) are ignored.
+         *
+         * @return true If the tile belongs to this tileset
+         */
+        bool getTileLimits(uint32_t gid, constant::Vector4D& limits) const;
+
+        std::string name;
+
+        /** Path of the image, relative to the working directory */
+        std::string imagePath;
+
+        /** Name of the texture drawing the tileset, the image path by default */
+        std::string textureName;
+
+        /** Global id of the first tile of the tileset */
+        uint32_t firstGid = 1;
+
+        uint32_t tileCount = 0;
+
+        int columns = 0;
+
+        int tileWidth = 0;
+        int tileHeight = 0;
+
+        /** Pixels around the tiles and between two tiles of the image */
+        int margin = 0;
+        int spacing = 0;
+
+        int imageWidth = 0;
+        int imageHeight = 0;
+    };
+
+    /** A grid of tiles, stored row by row */
+    struct TiledLayer
+    {
+        std::string name;
+
+        int width = 0;
+        int height = 0;
+
+        /** Offset of the layer in pixels (the offsets of its parent groups are included) */
+        float offsetX = 0.0f;
+        float offsetY = 0.0f;
+
+        float opacity = 1.0f;
+
+        bool visible = true;
+
+        /** Global id of each tile (0 for an empty cell), with its flip flags */
+        std::vector<uint32_t> tiles;
+    };
+
+    /** An orthogonal map made of tile layers */
+    struct TiledMap
+    {
+        /**
+         * @brief Find the tileset holding a tile
+         *
+         * @param gid Global id of the tile, flip flags are ignored
+         *
+         * @return int The index of the tileset, -1 if no tileset holds the tile
+         */
+        int findTileset(uint32_t gid) const;
+
+        /** Size of the map in tiles */
+        int width = 0;
+        int height = 0;
+
+        /** Size of a cell of the map in pixels */
+        int tileWidth = 0;
+        int tileHeight = 0;
+
+        std::vector<TiledTileset> tilesets;
+
+        /** Tile layers in drawing order, the object layers are not kept */
+        std::vector<TiledLayer> layers;
+    };
+
+    /**
+     * @brief Parse a map exported by Tiled in the json format
+     *
+     * Tile layers can be stored as arrays or in uncompressed base64, the layers of groups are flattened.
+     * Infinite maps, compressed layers and external tilesets are not supported.
+     *
+     * @param json Content of the map file
+     * @param folder Folder of the map file, the paths of the tileset images are relative to it
+     * @param map Receive the map
+     *
+     * @return true If the map could be parsed
+     */
+    bool parseTiledMap(const std::string& json, const std::string& folder, TiledMap& map);
+
+    /**
+     * @brief Load a map exported by Tiled in the json format
+     *
+     * @param path Path of the map file
+     * @param map Receive the map
+     *
+     * @return true If the map could be loaded
+     */
+    bool loadTiledMap(const std::string& path, TiledMap& map);
+}
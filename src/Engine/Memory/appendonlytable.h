@@ -0,0 +1,190 @@
+#pragma once
+
+/**
+ * @file appendonlytable.h
+ * @author Pigeon Codeur
+ * @brief Definition of a table of named values that only grows, read without any lock
+ * @version 0.1
+ * @date 2025-05-04
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+#include "logger.h"
+
+namespace pg
+{
+    /**
+     * @brief A table where values are appended and never moved nor removed, so their ids and references stay valid
+     *
+     * Values are stored in chunks that are never reallocated, and the names are indexed in an open addressing table
+     * that is only inserted into. Appending takes a lock shared by the writers, reading never locks:
+     * a value (and its name) is written before the size is published, so readers only see complete values.
+     *
+     * A value can't be changed once appended, registering a name again points the name to the new value.
+     *
+     * @tparam Type Type of the values, must be default constructible
+     * @tparam ChunkSize Number of values of a chunk
+     * @tparam MaxChunks Number of chunks, the table holds at most ChunkSize * MaxChunks values
+     */
+    template <typename Type, size_t ChunkSize = 64, size_t MaxChunks = 512>
+    class AppendOnlyTable
+    {
+        /** A value and the name it was registered with */
+        struct Entry
+        {
+            std::string name;
+            Type value;
+        };
+
+    public:
+        /** Maximum number of values of the table */
+        static constexpr size_t Capacity = ChunkSize * MaxChunks;
+
+        AppendOnlyTable() : nameSlots(new std::atomic<uint32_t>[NbNameSlots])
+        {
+            for (size_t i = 0; i < NbNameSlots; ++i)
+                nameSlots[i].store(0, std::memory_order_relaxed);
+
+            for (auto& chunk : chunks)
+                chunk.store(nullptr, std::memory_order_relaxed);
+        }
+
+        ~AppendOnlyTable()
+        {
+            for (auto& chunk : chunks)
+                delete[] chunk.load(std::memory_order_relaxed);
+        }
+
+        AppendOnlyTable(const AppendOnlyTable&) = delete;
+        AppendOnlyTable& operator=(const AppendOnlyTable&) = delete;
+
+        /**
+         * @brief Append a value, it can be read by any thread as soon as this returns
+         *
+         * @param name Name of the value, an empty name is not indexed
+         * @param value Value to append
+         *
+         * @return size_t The id of the value, 0 if the table is full
+         */
+        size_t push(const std::string& name, Type value)
+        {
+            std::lock_guard<std::mutex> lock(writeMutex);
+
+            const size_t id = count.load(std::memory_order_relaxed);
+
+            if (id >= Capacity)
+            {
+                LOG_ERROR("Append Only Table", "The table is full (" << Capacity << " values), can't add: " << name);
+
+                return 0;
+            }
+
+            auto *chunk = chunks[id / ChunkSize].load(std::memory_order_relaxed);
+
+            if (not chunk)
+            {
+                chunk = new Entry[ChunkSize];
+                chunks[id / ChunkSize].store(chunk, std::memory_order_relaxed);
+            }
+
+            auto& entry = chunk[id % ChunkSize];
+
+            entry.name = name;
+            entry.value = std::move(value);
+
+            // Publish the value before its name, so a name found by a reader always points to a readable value
+            count.store(id + 1, std::memory_order_release);
+
+            if (not name.empty())
+                indexName(name, id);
+
+            return id;
+        }
+
+        /** Get the number of values, every id lower than this can be read */
+        inline size_t size() const { return count.load(std::memory_order_acquire); }
+
+        /** Get a value, the id must be lower than size() */
+        inline const Type& operator[](size_t id) const
+        {
+            return chunks[id / ChunkSize].load(std::memory_order_acquire)[id % ChunkSize].value;
+        }
+
+        /**
+         * @brief Find the id of the last value registered with a name
+         *
+         * @param name Name to look for
+         * @param id Receive the id of the value
+         *
+         * @return true If a value was registered with this name
+         */
+        bool find(const std::string& name, size_t& id) const
+        {
+            if (name.empty())
+                return false;
+
+            for (size_t slot = hashName(name);; slot = (slot + 1) & (NbNameSlots - 1))
+            {
+                const uint32_t stored = nameSlots[slot].load(std::memory_order_acquire);
+
+                if (stored == 0)
+                    return false;
+
+                if (getEntry(stored - 1).name == name)
+                {
+                    id = stored - 1;
+                    return true;
+                }
+            }
+        }
+
+    private:
+        /** Twice as many slots as values, so the probes stay short */
+        static constexpr size_t NbNameSlots = Capacity * 2;
+
+        static_assert((NbNameSlots & (NbNameSlots - 1)) == 0, "The capacity of the table must be a power of 2");
+
+        inline const Entry& getEntry(size_t id) const
+        {
+            return chunks[id / ChunkSize].load(std::memory_order_acquire)[id % ChunkSize];
+        }
+
+        inline size_t hashName(const std::string& name) const
+        {
+            return std::hash<std::string>{}(name) & (NbNameSlots - 1);
+        }
+
+        /** Point a name to a value, only called by push with the write lock held */
+        void indexName(const std::string& name, size_t id)
+        {
+            for (size_t slot = hashName(name);; slot = (slot + 1) & (NbNameSlots - 1))
+            {
+                const uint32_t stored = nameSlots[slot].load(std::memory_order_relaxed);
+
+                // Slots store the id + 1, 0 being an empty slot
+                if (stored == 0 or getEntry(stored - 1).name == name)
+                {
+                    nameSlots[slot].store(static_cast<uint32_t>(id + 1), std::memory_order_release);
+                    return;
+                }
+            }
+        }
+
+        std::atomic<Entry*> chunks[MaxChunks];
+
+        std::unique_ptr<std::atomic<uint32_t>[]> nameSlots;
+
+        std::atomic<size_t> count {0};
+
+        /** Serialize the writers, the readers never take it */
+        std::mutex writeMutex;
+    };
+}
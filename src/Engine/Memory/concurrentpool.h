@@ -0,0 +1,395 @@
+#pragma once
+
+/**
+ * @file concurrentpool.h
+ * @author Pigeon Codeur
+ * @brief Definition of a thread safe memory pool
+ * @version 0.1
+ * @date 2025-02-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <new>
+#include <algorithm>
+
+#include "concurrentqueue.h"
+
+#include "logger.h"
+
+namespace pg
+{
+    /**
+     * @brief Get a small index unique to the calling thread
+     *
+     * @return size_t The index of the thread, attributed on the first call made by the thread
+     */
+    inline size_t getThreadSlotIndex()
+    {
+        static std::atomic<size_t> nbThreadsSeen {0};
+        thread_local const size_t slot = nbThreadsSeen.fetch_add(1, std::memory_order_relaxed);
+
+        return slot;
+    }
+
+    /** Snapshot of the statistics of a concurrent allocator pool */
+    struct ConcurrentPoolStats
+    {
+        /** Number of objects currently alive in the pool */
+        size_t nbElements = 0;
+
+        /** Number of slots reserved by the pool */
+        size_t capacity = 0;
+
+        /** Total number of allocations since the creation of the pool */
+        size_t nbAllocations = 0;
+
+        /** Total number of releases since the creation of the pool */
+        size_t nbReleases = 0;
+
+        /** Number of times a thread cache had to be refilled from the shared depot */
+        size_t nbDepotRefills = 0;
+
+        /** Number of times a thread cache was flushed back into the shared depot */
+        size_t nbDepotFlushes = 0;
+
+        /** Number of new blocks allocated by the pool */
+        size_t nbBlocks = 0;
+    };
+
+    /**
+     * @brief A thread safe implementation of an allocator pool
+     *
+     * @tparam T Type of the object to be created
+     * @tparam MagazineSize Number of free slots moved at once between a thread cache and the shared depot
+     * @tparam BlockSize Number of objects created at once when the pool runs out of free slots
+     *
+     * Each thread works on its own cache (magazine) of free slots, so most allocations and releases don't touch any shared state.
+     * When a magazine is empty it is refilled in bulk from a lock free depot, and when it is full half of it is flushed back to the depot.
+     * A mutex is only taken when the pool needs to grow.
+     *
+     * Threads are mapped to magazines using getThreadSlotIndex, each magazine being guarded by a spinlock
+     * that is only contended if more than NbMagazines threads use the pool at the same time.
+     */
+    template <typename T, size_t MagazineSize = 64, size_t BlockSize = 1024>
+    class ConcurrentAllocatorPool
+    {
+        static_assert(MagazineSize > 0, "Magazine size must be greater than 0");
+        static_assert(BlockSize >= MagazineSize, "A block must be able to fill at least one magazine");
+
+        /** Number of thread caches of a pool */
+        static constexpr size_t NbMagazines = 16;
+
+        /** A thread cache of free slots */
+        struct alignas(64) Magazine
+        {
+            /** Acquire the spinlock of this magazine */
+            inline void lock() { while (flag.test_and_set(std::memory_order_acquire)) { } }
+
+            /** Release the spinlock of this magazine */
+            inline void unlock() { flag.clear(std::memory_order_release); }
+
+            std::atomic_flag flag = ATOMIC_FLAG_INIT;
+
+            size_t nbSlots = 0;
+
+            T* slots[2 * MagazineSize];
+        };
+
+    public:
+        ConcurrentAllocatorPool() { LOG_THIS_MEMBER("Concurrent Memory Pool"); }
+
+        /** Pools can't be copied as they own memory */
+        ConcurrentAllocatorPool(const ConcurrentAllocatorPool&) = delete;
+
+        /**
+         * @brief Destroy the Concurrent Allocator Pool object
+         *
+         * @warning If the user forget to release memory, the destructors of the elements are never called !
+         */
+        ~ConcurrentAllocatorPool()
+        {
+            LOG_THIS_MEMBER("Concurrent Memory Pool");
+
+            for (T* block : blockList)
+                ::operator delete(block, std::align_val_t(alignof(T)));
+        }
+
+        /**
+         * @brief Reserve enough space in the pool to hold the requested number of objects
+         *
+         * @param reserveSize The needed size of the pool
+         */
+        void reserve(size_t reserveSize)
+        {
+            LOG_THIS_MEMBER("Concurrent Memory Pool");
+
+            std::lock_guard<std::mutex> lock(growMutex);
+
+            while (reserveSize >= capacity.load(std::memory_order_relaxed))
+                addBlock(nullptr);
+        }
+
+        /**
+         * @brief Function used to allocate a new T object
+         *
+         * @tparam Args Type of the arguments to be passed to create an object
+         * @param args Argument to create a new T object
+         * @return T* A pointer to the new T object created
+         *
+         * Can be called from any thread
+         *
+         * @see release
+         */
+        template <typename... Args>
+        T* allocate(Args&&... args)
+        {
+            LOG_THIS_MEMBER("Concurrent Memory Pool");
+
+            auto& magazine = getMagazine();
+
+            magazine.lock();
+
+            if (magazine.nbSlots == 0)
+                refill(magazine);
+
+            T* slot = magazine.slots[--magazine.nbSlots];
+
+            magazine.unlock();
+
+            nbElements.fetch_add(1, std::memory_order_relaxed);
+            nbAllocations.fetch_add(1, std::memory_order_relaxed);
+
+            return ::new(slot) T(std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Allocate multiple objects at once
+         *
+         * @param out Array receiving the pointers to the created objects
+         * @param count Number of objects to create
+         * @param args Arguments copied to construct every object
+         *
+         * Free slots are taken in bulk from the shared depot, bypassing the thread cache as much as possible
+         */
+        template <typename... Args>
+        void allocateN(T** out, size_t count, const Args&... args)
+        {
+            LOG_THIS_MEMBER("Concurrent Memory Pool");
+
+            size_t nbTaken = depot.try_dequeue_bulk(out, count);
+
+            if (nbTaken < count)
+            {
+                std::lock_guard<std::mutex> lock(growMutex);
+
+                // Another thread may have pushed slots in the depot while we were waiting
+                nbTaken += depot.try_dequeue_bulk(out + nbTaken, count - nbTaken);
+
+                while (nbTaken < count)
+                    nbTaken += addBlock(out + nbTaken, count - nbTaken);
+            }
+
+            for (size_t i = 0; i < count; i++)
+                ::new(out[i]) T(args...);
+
+            nbElements.fetch_add(count, std::memory_order_relaxed);
+            nbAllocations.fetch_add(count, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Function used to release the memory of a T object create using the pool
+         *
+         * @param pointer A pointer to a T object
+         *
+         * Can be called from any thread, not necessarily the one that allocated the object
+         *
+         * @see allocate
+         */
+        void release(T* pointer)
+        {
+            LOG_THIS_MEMBER("Concurrent Memory Pool");
+
+            if (pointer == nullptr)
+                return;
+
+            pointer->~T();
+
+            auto& magazine = getMagazine();
+
+            magazine.lock();
+
+            if (magazine.nbSlots == 2 * MagazineSize)
+            {
+                // Keep the most recently released slots (the hottest ones in cache) in the magazine
+                depot.enqueue_bulk(magazine.slots, MagazineSize);
+
+                std::move(magazine.slots + MagazineSize, magazine.slots + 2 * MagazineSize, magazine.slots);
+                magazine.nbSlots = MagazineSize;
+
+                nbDepotFlushes.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            magazine.slots[magazine.nbSlots++] = pointer;
+
+            magazine.unlock();
+
+            nbElements.fetch_sub(1, std::memory_order_relaxed);
+            nbReleases.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Release multiple objects at once
+         *
+         * @param pointers Array of objects to release
+         * @param count Number of objects in the array
+         *
+         * The slots are directly given back to the shared depot in a single bulk operation
+         */
+        void releaseN(T* const* pointers, size_t count)
+        {
+            LOG_THIS_MEMBER("Concurrent Memory Pool");
+
+            size_t nbReleased = 0;
+
+            for (size_t i = 0; i < count; i++)
+            {
+                if (pointers[i] != nullptr)
+                {
+                    pointers[i]->~T();
+                    nbReleased++;
+                }
+            }
+
+            if (nbReleased == count)
+                depot.enqueue_bulk(pointers, count);
+            else
+            {
+                for (size_t i = 0; i < count; i++)
+                    if (pointers[i] != nullptr)
+                        depot.enqueue(pointers[i]);
+            }
+
+            nbElements.fetch_sub(nbReleased, std::memory_order_relaxed);
+            nbReleases.fetch_add(nbReleased, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Get the number of elements in the pool
+         *
+         * @return size_t The number of element in the pool
+         */
+        inline size_t getNbElements() const { return nbElements.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Get the current size of the pool (current nb max elements)
+         *
+         * @return size_t The size of the pool
+         */
+        inline size_t getSize() const { return capacity.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Get a snapshot of the statistics of the pool
+         *
+         * @return ConcurrentPoolStats The current statistics
+         *
+         * Each counter is read independently, so the snapshot may be slightly inconsistent while other threads use the pool
+         */
+        ConcurrentPoolStats getStats() const
+        {
+            ConcurrentPoolStats stats;
+
+            stats.nbElements = nbElements.load(std::memory_order_relaxed);
+            stats.capacity = capacity.load(std::memory_order_relaxed);
+            stats.nbAllocations = nbAllocations.load(std::memory_order_relaxed);
+            stats.nbReleases = nbReleases.load(std::memory_order_relaxed);
+            stats.nbDepotRefills = nbDepotRefills.load(std::memory_order_relaxed);
+            stats.nbDepotFlushes = nbDepotFlushes.load(std::memory_order_relaxed);
+            stats.nbBlocks = nbBlocks.load(std::memory_order_relaxed);
+
+            return stats;
+        }
+
+    private:
+        /** Get the magazine associated with the calling thread */
+        inline Magazine& getMagazine() { return magazines[getThreadSlotIndex() % NbMagazines]; }
+
+        /** Fill an empty magazine from the depot, growing the pool if the depot is empty (magazine must be locked) */
+        void refill(Magazine& magazine)
+        {
+            magazine.nbSlots = depot.try_dequeue_bulk(magazine.slots, MagazineSize);
+
+            if (magazine.nbSlots == 0)
+            {
+                std::lock_guard<std::mutex> lock(growMutex);
+
+                magazine.nbSlots = depot.try_dequeue_bulk(magazine.slots, MagazineSize);
+
+                if (magazine.nbSlots == 0)
+                    magazine.nbSlots = addBlock(magazine.slots, MagazineSize);
+            }
+
+            nbDepotRefills.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Allocate a new block of slots (growMutex must be held)
+         *
+         * @param out Optional array receiving up to maxOut slots of the new block, the rest goes to the depot
+         * @param maxOut Size of the out array
+         *
+         * @return size_t The number of slots written in out
+         */
+        size_t addBlock(T** out, size_t maxOut = 0)
+        {
+            LOG_MILE("Concurrent Memory Pool", "Adding a new block of " << BlockSize << " elements");
+
+            auto block = static_cast<T*>(::operator new(BlockSize * sizeof(T), std::align_val_t(alignof(T))));
+
+            blockList.push_back(block);
+
+            const size_t nbOut = out ? std::min(maxOut, BlockSize) : 0;
+
+            for (size_t i = 0; i < nbOut; i++)
+                out[i] = block + i;
+
+            std::vector<T*> remaining;
+            remaining.reserve(BlockSize - nbOut);
+
+            for (size_t i = nbOut; i < BlockSize; i++)
+                remaining.push_back(block + i);
+
+            depot.enqueue_bulk(remaining.begin(), remaining.size());
+
+            capacity.fetch_add(BlockSize, std::memory_order_relaxed);
+            nbBlocks.fetch_add(1, std::memory_order_relaxed);
+
+            return nbOut;
+        }
+
+    private:
+        /** Thread caches of free slots */
+        Magazine magazines[NbMagazines];
+
+        /** Shared lock free depot of free slots */
+        moodycamel::ConcurrentQueue<T*> depot;
+
+        /** Mutex only used when the pool needs to grow */
+        std::mutex growMutex;
+
+        /** Blocks used in the pool (used to free the memory) */
+        std::vector<T*> blockList;
+
+        std::atomic<size_t> nbElements {0};
+        std::atomic<size_t> capacity {0};
+        std::atomic<size_t> nbAllocations {0};
+        std::atomic<size_t> nbReleases {0};
+        std::atomic<size_t> nbDepotRefills {0};
+        std::atomic<size_t> nbDepotFlushes {0};
+        std::atomic<size_t> nbBlocks {0};
+    };
+}
@@ -0,0 +1,179 @@
+#include "stdafx.h"
+
+#include "frameallocator.h"
+
+#include "concurrentpool.h"
+
+namespace pg
+{
+    namespace
+    {
+        static constexpr char const * DOM = "Frame Allocator";
+
+        /** Round up an offset to the next multiple of alignment (alignment must be a power of 2) */
+        inline size_t alignUp(size_t offset, size_t alignment)
+        {
+            return (offset + alignment - 1) & ~(alignment - 1);
+        }
+    }
+
+    FrameArena::FrameArena(size_t slabSize) : slabSize(slabSize)
+    {
+        LOG_THIS_MEMBER(DOM);
+    }
+
+    FrameArena::~FrameArena()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        for (auto& slab : slabs)
+            ::operator delete(slab.data, std::align_val_t(alignof(std::max_align_t)));
+    }
+
+    /**
+     * @brief Allocate a block of memory of a given size and alignment
+     *
+     * @param size Size in bytes of the block
+     * @param alignment Alignment of the block, must be a power of 2
+     *
+     * @return void* A pointer to the block, valid until the next reset
+     */
+    void* FrameArena::allocate(size_t size, size_t alignment)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (size == 0)
+            size = 1;
+
+        while (currentSlab < slabs.size())
+        {
+            const auto& slab = slabs[currentSlab];
+
+            // Align the real address as the alignment requested can be greater than the one of the slab
+            const auto base = reinterpret_cast<uintptr_t>(slab.data);
+            const size_t start = alignUp(base + offset, alignment) - base;
+
+            if (start + size <= slab.size)
+            {
+                offset = start + size;
+                usedBytes += size;
+
+                return slab.data + start;
+            }
+
+            currentSlab++;
+            offset = 0;
+        }
+
+        addSlab(size + alignment);
+
+        return allocate(size, alignment);
+    }
+
+    /**
+     * @brief Give back all the memory allocated since the last reset
+     *
+     * If the last frame needed more than one slab, all of them are merged into a single big slab
+     * so that the arena stabilizes on one contiguous block after a few frames.
+     */
+    void FrameArena::reset()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (slabs.size() > 1)
+        {
+            LOG_MILE(DOM, "Merging " << slabs.size() << " slabs into a single one of " << capacity << " bytes");
+
+            const auto totalSize = capacity;
+
+            for (auto& slab : slabs)
+                ::operator delete(slab.data, std::align_val_t(alignof(std::max_align_t)));
+
+            slabs.clear();
+            capacity = 0;
+
+            addSlab(totalSize);
+        }
+
+        currentSlab = 0;
+        offset = 0;
+        usedBytes = 0;
+    }
+
+    void FrameArena::addSlab(size_t minSize)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        const size_t size = minSize > slabSize ? minSize : slabSize;
+
+        auto data = static_cast<char*>(::operator new(size, std::align_val_t(alignof(std::max_align_t))));
+
+        slabs.push_back(Slab{data, size});
+
+        capacity += size;
+
+        currentSlab = slabs.size() - 1;
+        offset = 0;
+    }
+
+    FrameAllocator::FrameAllocator(size_t slabSize)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        arenas.reserve(NbBuffers * NbThreadSlots);
+
+        for (size_t i = 0; i < NbBuffers * NbThreadSlots; i++)
+            arenas.push_back(std::make_unique<ThreadArena>(slabSize));
+    }
+
+    /**
+     * @brief Allocate a block of memory valid until the end of the next frame
+     *
+     * @param size Size in bytes of the block
+     * @param alignment Alignment of the block, must be a power of 2
+     *
+     * @return void* A pointer to the block
+     */
+    void* FrameAllocator::allocate(size_t size, size_t alignment)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        const auto buffer = frameIndex.load(std::memory_order_acquire) % NbBuffers;
+
+        auto& threadArena = *arenas[buffer * NbThreadSlots + getThreadSlotIndex() % NbThreadSlots];
+
+        while (threadArena.lock.test_and_set(std::memory_order_acquire)) { }
+
+        auto block = threadArena.arena.allocate(size, alignment);
+
+        threadArena.lock.clear(std::memory_order_release);
+
+        return block;
+    }
+
+    void FrameAllocator::nextFrame()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        const auto next = frameIndex.load(std::memory_order_relaxed) + 1;
+        const auto buffer = next % NbBuffers;
+
+        // The buffer we switch to was used two frames ago, its content can be safely discarded
+        for (size_t i = 0; i < NbThreadSlots; i++)
+            arenas[buffer * NbThreadSlots + i]->arena.reset();
+
+        frameIndex.store(next, std::memory_order_release);
+    }
+
+    size_t FrameAllocator::getUsedBytes() const
+    {
+        const auto buffer = frameIndex.load(std::memory_order_acquire) % NbBuffers;
+
+        size_t used = 0;
+
+        for (size_t i = 0; i < NbThreadSlots; i++)
+            used += arenas[buffer * NbThreadSlots + i]->arena.getUsedBytes();
+
+        return used;
+    }
+}
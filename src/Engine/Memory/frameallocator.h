@@ -0,0 +1,209 @@
+#pragma once
+
+/**
+ * @file frameallocator.h
+ * @author Pigeon Codeur
+ * @brief Definition of the per frame linear allocators
+ * @version 0.1
+ * @date 2025-02-20
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include <new>
+#include <memory>
+
+#include "logger.h"
+
+namespace pg
+{
+    /**
+     * @brief A bump allocator working on a list of slabs
+     *
+     * Allocations only move a pointer forward, nothing is ever freed individually.
+     * All the memory is given back at once with reset.
+     *
+     * @warning This class is not thread safe
+     */
+    class FrameArena
+    {
+    public:
+        /**
+         * @brief Construct a new Frame Arena object
+         *
+         * @param slabSize Size in bytes of the slabs created when the arena runs out of memory
+         */
+        FrameArena(size_t slabSize = 64 * 1024);
+
+        /** Arenas can't be copied as they own memory */
+        FrameArena(const FrameArena&) = delete;
+
+        /** Destroy the Frame Arena object and free all the slabs */
+        ~FrameArena();
+
+        /** Allocate a block of memory of a given size and alignment */
+        void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+        /** Give back all the memory allocated since the last reset */
+        void reset();
+
+        /** Get the number of bytes allocated since the last reset */
+        inline size_t getUsedBytes() const { return usedBytes; }
+
+        /** Get the total amount of memory held by the arena */
+        inline size_t getCapacity() const { return capacity; }
+
+    private:
+        /** A contiguous block of memory of the arena */
+        struct Slab
+        {
+            char *data;
+            size_t size;
+        };
+
+        /** Append a new slab able to hold at least minSize bytes */
+        void addSlab(size_t minSize);
+
+        /** Size of a default slab */
+        size_t slabSize;
+
+        /** All the slabs of the arena, in allocation order */
+        std::vector<Slab> slabs;
+
+        /** Index of the slab currently used */
+        size_t currentSlab = 0;
+
+        /** Offset of the next free byte in the current slab */
+        size_t offset = 0;
+
+        /** Number of bytes allocated since the last reset */
+        size_t usedBytes = 0;
+
+        /** Sum of the sizes of all the slabs */
+        size_t capacity = 0;
+    };
+
+    /**
+     * @brief A double buffered per frame allocator with one arena per thread
+     *
+     * Memory allocated during a frame stays valid until the end of the next frame,
+     * so data produced in a frame can still be read while the next one is being built.
+     * Everything allocated two frames ago is reclaimed at once by nextFrame.
+     *
+     * Each thread allocates from its own arena (mapped with getThreadSlotIndex), so allocations from
+     * parallel systems don't contend with each other.
+     */
+    class FrameAllocator
+    {
+    public:
+        /** Number of frames a block of memory stays valid */
+        static constexpr size_t NbBuffers = 2;
+
+        /** Number of thread arenas per buffer */
+        static constexpr size_t NbThreadSlots = 16;
+
+        /**
+         * @brief Construct a new Frame Allocator object
+         *
+         * @param slabSize Size in bytes of the slabs of each thread arena
+         */
+        FrameAllocator(size_t slabSize = 256 * 1024);
+
+        /** Allocators can't be copied as they own memory */
+        FrameAllocator(const FrameAllocator&) = delete;
+
+        /** Allocate a block of memory valid until the end of the next frame, can be called from any thread */
+        void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+        /**
+         * @brief Allocate an uninitialized array of T valid until the end of the next frame
+         *
+         * @tparam T Type of the elements
+         * @param count Number of elements
+         * @return T* Pointer to the first element, no constructor is called
+         */
+        template <typename T>
+        inline T* allocate(size_t count) { return static_cast<T*>(allocate(count * sizeof(T), alignof(T))); }
+
+        /**
+         * @brief Start a new frame
+         *
+         * Flip the current buffer and reset it, all the memory allocated two frames ago is reclaimed.
+         *
+         * Only the buffer we switch to is reset, threads still allocating in the current frame are not affected.
+         *
+         * @warning Must be called from a single thread (it is called in the basic task of the ecs)
+         */
+        void nextFrame();
+
+        /** Get the number of frames started since the creation of the allocator */
+        inline size_t getFrameIndex() const { return frameIndex.load(std::memory_order_acquire); }
+
+        /** Get the number of bytes allocated in the current frame, for all the threads */
+        size_t getUsedBytes() const;
+
+    private:
+        /** Arena of a thread guarded by a spinlock, only contended if more than NbThreadSlots threads allocate */
+        struct alignas(64) ThreadArena
+        {
+            ThreadArena(size_t slabSize) : arena(slabSize) {}
+
+            std::atomic_flag lock = ATOMIC_FLAG_INIT;
+
+            FrameArena arena;
+        };
+
+        /** Index of the buffer of the current frame */
+        std::atomic<size_t> frameIndex {0};
+
+        /** Thread arenas of each buffer */
+        std::vector<std::unique_ptr<ThreadArena>> arenas;
+    };
+
+    /**
+     * @brief STL compatible allocator adaptor allocating from a FrameAllocator
+     *
+     * @tparam T Type of the allocated elements
+     *
+     * Deallocation does nothing as the memory is reclaimed in bulk when the frame ends.
+     * When no frame allocator is given, the adaptor falls back to the default operator new.
+     *
+     * @warning Containers using this allocator must not outlive the next frame
+     */
+    template <typename T>
+    struct ArenaAllocator
+    {
+        using value_type = T;
+
+        ArenaAllocator(FrameAllocator *frame = nullptr) noexcept : frame(frame) {}
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) noexcept : frame(other.frame) {}
+
+        T* allocate(size_t n)
+        {
+            if (frame)
+                return frame->allocate<T>(n);
+
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+        }
+
+        void deallocate(T* pointer, size_t) noexcept
+        {
+            if (not frame)
+                ::operator delete(pointer, std::align_val_t(alignof(T)));
+        }
+
+        template <typename U>
+        inline bool operator==(const ArenaAllocator<U>& rhs) const noexcept { return frame == rhs.frame; }
+
+        template <typename U>
+        inline bool operator!=(const ArenaAllocator<U>& rhs) const noexcept { return frame != rhs.frame; }
+
+        FrameAllocator *frame;
+    };
+}
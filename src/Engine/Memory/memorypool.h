@@ -17,6 +17,8 @@
 #include <mutex>
 #include <cmath>
 #include <atomic>
+#include <new>
+#include <algorithm>
 
 #include "logger.h"
 namespace pg
@@ -259,4 +261,218 @@ namespace pg
         /** Chunk Lists used in the pool (used to free the memory) */
         std::vector<Chunk<T>*> chunkList;
     };
+
+    /**
+     * @brief An allocator pool that guarantees the alignment of its blocks and a packed stride between elements
+     *
+     * @tparam T Type of the object to be created
+     * @tparam Alignment Alignment in bytes of each block of the pool (ie 32 for AVX or 64 for a cache line)
+     * @tparam BlockSize Number of elements stored in a single block
+     *
+     * Contrary to AllocatorPool, the free list is not stored inside of the released elements, so the elements
+     * are packed with a stride of exactly sizeof(T) and each block starts on an Alignment boundary.
+     * Every element is aligned on Alignment when sizeof(T) is a multiple of it (see elementAligned).
+     *
+     * This makes it possible to run SIMD kernels directly on the blocks of the pool using aligned loads.
+     *
+     * @warning This whole class is not thread safe ! The user should implement thread safety when using this in a concurrent environment
+     */
+    template <typename T, size_t Alignment = 64, size_t BlockSize = 256>
+    class AlignedAllocatorPool
+    {
+        static_assert(Alignment != 0 and (Alignment & (Alignment - 1)) == 0, "Alignment must be a power of 2");
+        static_assert(Alignment >= alignof(T), "Alignment must be at least the natural alignment of the type");
+        static_assert(BlockSize > 0, "Block size must be greater than 0");
+
+    public:
+        /** Distance in bytes between two consecutive elements of a block */
+        static constexpr size_t stride = sizeof(T);
+
+        /** Alignment in bytes of the start of each block */
+        static constexpr size_t alignment = Alignment;
+
+        /** Number of elements in a block */
+        static constexpr size_t blockSize = BlockSize;
+
+        /** True if every single element (and not only the blocks) is aligned on Alignment */
+        static constexpr bool elementAligned = sizeof(T) % Alignment == 0;
+
+        AlignedAllocatorPool() { LOG_THIS_MEMBER("Aligned Memory Pool"); }
+
+        /** Pools can't be copied as they own memory */
+        AlignedAllocatorPool(const AlignedAllocatorPool&) = delete;
+
+        /**
+         * @brief Destroy the Aligned Allocator Pool object
+         *
+         * @warning If the user forget to release memory, the destructors of the elements are never called !
+         */
+        ~AlignedAllocatorPool()
+        {
+            LOG_THIS_MEMBER("Aligned Memory Pool");
+
+            for (T* block : blockList)
+                ::operator delete(block, std::align_val_t(Alignment));
+        }
+
+        /**
+         * @brief Reserve enough space in the pool to hold the requested number of objects
+         *
+         * @param reserveSize The needed size of the pool
+         */
+        void reserve(size_t reserveSize)
+        {
+            LOG_THIS_MEMBER("Aligned Memory Pool");
+
+            while (reserveSize >= size)
+            {
+                auto newBlock = static_cast<T*>(::operator new(BlockSize * sizeof(T), std::align_val_t(Alignment)));
+
+                blockList.push_back(newBlock);
+
+                size += BlockSize;
+            }
+        }
+
+        /**
+         * @brief Function used to allocate a new T object
+         *
+         * @tparam Args Type of the arguments to be passed to create an object
+         * @param args Argument to create a new T object
+         * @return T* A pointer to the new T object created
+         *
+         * @see release
+         */
+        template <typename... Args>
+        T* allocate(Args&&... args)
+        {
+            LOG_THIS_MEMBER("Aligned Memory Pool");
+
+            T* slot = nullptr;
+
+            if (not freeList.empty())
+            {
+                slot = freeList.back();
+                freeList.pop_back();
+            }
+            else
+            {
+                const size_t index = highWaterMark++;
+
+                if (index >= size) reserve(index);
+
+                slot = blockList[index / BlockSize] + index % BlockSize;
+            }
+
+            nbElements++;
+
+            return ::new(slot) T(std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Function used to release the memory of a T object create using the pool
+         *
+         * @param pointer A pointer to a T object
+         *
+         * @see allocate
+         */
+        void release(T* pointer)
+        {
+            LOG_THIS_MEMBER("Aligned Memory Pool");
+
+            if (pointer != nullptr)
+            {
+                pointer->~T();
+
+                freeList.push_back(pointer);
+
+                nbElements--;
+            }
+        }
+
+        /**
+         * @brief Get the number of elements in the pool
+         *
+         * @return constexpr size_t The number of element in the pool
+         */
+        inline constexpr size_t getNbElements() const { return nbElements; }
+
+        /**
+         * @brief Get the current size of the pool (current nb max elements)
+         *
+         * @return constexpr size_t The size of the pool
+         */
+        inline constexpr size_t getSize() const { return size; }
+
+        /**
+         * @brief Get a specific element in the pool by his index
+         *
+         * @param index The position of the item in the pool
+         * @return T* A pointer to the object
+         *
+         * @warning The object requested should be allocated prior to calling this
+         */
+        inline T* getElement(size_t index) const
+        {
+            LOG_THIS_MEMBER("Aligned Memory Pool");
+
+            if (index >= size)
+            {
+                LOG_ERROR("Aligned Memory Pool", "Trying to acces an element outside of the pool");
+                return nullptr;
+            }
+
+            return blockList[index / BlockSize] + index % BlockSize;
+        }
+
+        /**
+         * @brief Get the number of blocks currently allocated by the pool
+         *
+         * @return size_t The number of blocks
+         */
+        inline size_t getNbBlocks() const { return blockList.size(); }
+
+        /**
+         * @brief Get the start of a block, aligned on Alignment
+         *
+         * @param index Index of the block
+         * @return T* A pointer to the first element of the block
+         *
+         * Only the first getNbUsedInBlock(index) elements of a block were ever handed out,
+         * released elements stay in place so a kernel working on raw blocks must skip them itself.
+         */
+        inline T* getBlock(size_t index) const { return blockList[index]; }
+
+        /**
+         * @brief Get the number of elements of a block that were already handed out at least once
+         *
+         * @param index Index of the block
+         * @return size_t The number of elements touched in this block
+         */
+        inline size_t getNbUsedInBlock(size_t index) const
+        {
+            const size_t start = index * BlockSize;
+
+            if (highWaterMark <= start)
+                return 0;
+
+            return std::min(highWaterMark - start, BlockSize);
+        }
+
+    private:
+        /** Current size of the memory pool */
+        size_t size = 0;
+
+        /** Current number of elements allocated in the memory pool */
+        size_t nbElements = 0;
+
+        /** Number of slots handed out at least once, slots above are fresh memory */
+        size_t highWaterMark = 0;
+
+        /** Released slots ready to be reused */
+        std::vector<T*> freeList;
+
+        /** Aligned blocks used in the pool (used to free the memory) */
+        std::vector<T*> blockList;
+    };
 }
@@ -2,42 +2,206 @@
 
 namespace pg
 {
-    void parallelFor(const size_t& nb_elements, std::function<void (size_t start, size_t end)> functor, bool use_threads)
+    namespace
+    {
+        /** Set on the threads running jobs, so batches started from a job run in place */
+        thread_local bool runningJob = false;
+
+        /** Flag a thread as running jobs for the duration of a scope */
+        struct RunningJobGuard
+        {
+            RunningJobGuard() : previous(runningJob) { runningJob = true; }
+            ~RunningJobGuard() { runningJob = previous; }
+
+            bool previous;
+        };
+    }
+
+    JobPool& JobPool::get()
+    {
+        static JobPool pool;
+
+        return pool;
+    }
+
+    JobPool::JobPool(size_t nbWorkers) : nbWorkers(nbWorkers)
+    {
+#ifdef __EMSCRIPTEN__
+        // No threads on the web, everything runs in place
+        this->nbWorkers = 0;
+#else
+        if (nbWorkers == 0)
+        {
+            const unsigned int nbCores = std::thread::hardware_concurrency();
+
+            // The calling thread runs jobs too, and a core is kept for the render thread when there are enough of them
+            this->nbWorkers = nbCores > 2 ? nbCores - 2 : (nbCores == 2 ? 1 : 0);
+        }
+#endif
+    }
+
+    JobPool::~JobPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+
+        wakeCv.notify_all();
+
+        for (auto& worker : workers)
+        {
+            if (worker.joinable())
+                worker.join();
+        }
+    }
+
+    void JobPool::start()
     {
-        // -------
-        unsigned nb_threads_hint = std::thread::hardware_concurrency();
-        unsigned nb_threads = nb_threads_hint == 0 ? 8 : (nb_threads_hint);
+        workers.reserve(nbWorkers);
 
-        size_t batch_size = nb_elements / nb_threads;
-        size_t batch_remainder = nb_elements % nb_threads;
+        for (size_t i = 0; i < nbWorkers; ++i)
+            workers.emplace_back(&JobPool::workerLoop, this, i + 1);
+    }
 
-        std::vector< std::thread > my_threads(nb_threads);
+    void JobPool::workerLoop(size_t thread)
+    {
+        runningJob = true;
 
-        if( use_threads )
+        size_t seenGeneration = 0;
+
+        while (true)
         {
-            // Multithread execution
-            for(size_t i = 0; i < nb_threads; ++i)
+            const Job *job;
+            size_t nbJobs;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+
+                wakeCv.wait(lock, [&]() { return stop or generation != seenGeneration; });
+
+                if (stop)
+                    return;
+
+                seenGeneration = generation;
+
+                // The batch may already be over, there is nothing to run then
+                if (not currentJob)
+                    continue;
+
+                job = currentJob;
+                nbJobs = nbCurrentJobs;
+
+                ++nbActiveWorkers;
+            }
+
+            work(*job, nbJobs, thread);
+
             {
-                size_t start = i * batch_size;
-                my_threads[i] = std::thread(functor, start, start+batch_size);
+                std::lock_guard<std::mutex> lock(mutex);
+
+                --nbActiveWorkers;
             }
+
+            doneCv.notify_all();
+        }
+    }
+
+    void JobPool::work(const Job& job, size_t nbJobs, size_t thread)
+    {
+        while (true)
+        {
+            const size_t index = nextJob.fetch_add(1, std::memory_order_relaxed);
+
+            if (index >= nbJobs)
+                return;
+
+            job(index, thread);
         }
-        else
+    }
+
+    void JobPool::run(size_t nbJobs, const Job& job)
+    {
+        if (nbJobs == 0)
+            return;
+
+        std::unique_lock<std::mutex> batchLock(batchMutex, std::defer_lock);
+
+        // Single jobs, nested batches and pools without workers don't need to wake anyone
+        if (nbJobs == 1 or nbWorkers == 0 or runningJob or not batchLock.try_lock())
         {
-            // Single thread execution (for easy debugging)
-            for(size_t i = 0; i < nb_threads; ++i){
-                size_t start = i * batch_size;
-                functor( start, start+batch_size );
-            }
+            RunningJobGuard guard;
+
+            for (size_t i = 0; i < nbJobs; ++i)
+                job(i, 0);
+
+            return;
+        }
+
+        std::call_once(startFlag, [this]() { start(); });
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            currentJob = &job;
+            nbCurrentJobs = nbJobs;
+            nextJob.store(0, std::memory_order_relaxed);
+
+            ++generation;
+        }
+
+        wakeCv.notify_all();
+
+        {
+            RunningJobGuard guard;
+
+            work(job, nbJobs, 0);
         }
 
-        // Deform the elements left
-        size_t start = nb_threads * batch_size;
-        functor( start, start+batch_remainder);
+        std::unique_lock<std::mutex> lock(mutex);
+
+        // Every job was taken, wait for the workers still running theirs
+        doneCv.wait(lock, [this]() { return nbActiveWorkers == 0; });
+
+        currentJob = nullptr;
+        nbCurrentJobs = 0;
+    }
+
+    void parallelFor(const size_t& nb_elements, std::function<void (size_t start, size_t end)> functor, bool use_threads)
+    {
+        if (not use_threads)
+        {
+            // Single thread execution (for easy debugging)
+            functor(0, nb_elements);
+            return;
+        }
 
-        // Wait for the other thread to finish their task
-        if( use_threads )
-            std::for_each(my_threads.begin(), my_threads.end(), std::mem_fn(&std::thread::join));
+        parallelForChunks(nb_elements, 1, [&functor](size_t start, size_t end, size_t) { functor(start, end); });
     }
 
-}
\ No newline at end of file
+    void parallelForChunks(size_t nbElements, size_t minChunkSize, const std::function<void (size_t start, size_t end, size_t thread)>& functor)
+    {
+        if (nbElements == 0)
+            return;
+
+        auto& pool = JobPool::get();
+
+        minChunkSize = std::max(minChunkSize, static_cast<size_t>(1));
+
+        // A few chunks per thread, so a slow chunk doesn't leave the other threads idle
+        const size_t nbChunks = std::min(nbElements / minChunkSize, pool.getNbThreads() * 4);
+
+        if (nbChunks <= 1)
+        {
+            functor(0, nbElements, 0);
+            return;
+        }
+
+        pool.run(nbChunks, [&](size_t chunk, size_t thread) {
+            const size_t start = nbElements * chunk / nbChunks;
+            const size_t end = nbElements * (chunk + 1) / nbChunks;
+
+            functor(start, end, thread);
+        });
+    }
+}
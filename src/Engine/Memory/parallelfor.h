@@ -1,12 +1,86 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <thread>
 #include <functional>
+#include <mutex>
 #include <vector>
 
 namespace pg
 {
+    /**
+     * @brief A pool of persistent worker threads running batches of jobs
+     *
+     * The thread starting a batch runs jobs as well, so a pool without workers simply runs everything in place.
+     * Only one batch runs at a time: a batch started from inside a job, or while another thread is running a batch,
+     * is run in place on the calling thread.
+     *
+     * The workers are only started on the first batch.
+     */
+    class JobPool
+    {
+    public:
+        /** A job receives its index in the batch and the index of the thread running it, 0 being the calling thread */
+        using Job = std::function<void (size_t job, size_t thread)>;
+
+        /** Get the pool shared by the engine */
+        static JobPool& get();
+
+        /**
+         * @brief Construct a new Job Pool object
+         *
+         * @param nbWorkers Number of worker threads, 0 to use the cores left to the calling thread and the render thread
+         */
+        JobPool(size_t nbWorkers = 0);
+
+        /** Pools can't be copied as they own threads */
+        JobPool(const JobPool&) = delete;
+
+        ~JobPool();
+
+        /** Get the number of threads running the jobs of a batch (the calling thread included), to size per thread buffers */
+        inline size_t getNbThreads() const { return nbWorkers + 1; }
+
+        /** Run nbJobs jobs and wait for all of them to be done */
+        void run(size_t nbJobs, const Job& job);
+
+    private:
+        void start();
+
+        void workerLoop(size_t thread);
+
+        /** Run the jobs of the current batch until none is left */
+        void work(const Job& job, size_t nbJobs, size_t thread);
+
+        size_t nbWorkers;
+
+        std::once_flag startFlag;
+
+        std::vector<std::thread> workers;
+
+        /** Held while a batch runs */
+        std::mutex batchMutex;
+
+        std::mutex mutex;
+        std::condition_variable wakeCv;
+        std::condition_variable doneCv;
+
+        const Job *currentJob = nullptr;
+        size_t nbCurrentJobs = 0;
+
+        std::atomic<size_t> nextJob {0};
+
+        /** Incremented for each batch, so sleeping workers know a new one started */
+        size_t generation = 0;
+
+        /** Workers running jobs of the current batch */
+        size_t nbActiveWorkers = 0;
+
+        bool stop = false;
+    };
+
     /**
      * @param[in] nb_elements : size of your for loop
      * @param[in] functor(start, end): Your function processing a sub chunk of the for loop.
@@ -14,4 +88,14 @@ namespace pg
      * "start" is the first index to process (included) until the index "end" (excluded)
      */
     void parallelFor(const size_t& nb_elements, std::function<void (size_t start, size_t end)> functor, bool use_threads = true);
-}
\ No newline at end of file
+
+    /**
+     * @brief Split a loop in chunks run on the shared job pool
+     *
+     * @param nbElements Size of the loop
+     * @param minChunkSize Smallest number of elements worth a job, loops smaller than two chunks are run in place
+     * @param functor(start, end, thread) Process the elements [start, end[, thread is the index of the running thread
+     * in the pool so each chunk can write in a per thread buffer
+     */
+    void parallelForChunks(size_t nbElements, size_t minChunkSize, const std::function<void (size_t start, size_t end, size_t thread)>& functor);
+}
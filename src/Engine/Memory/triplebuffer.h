@@ -0,0 +1,96 @@
+#pragma once
+
+/**
+ * @file triplebuffer.h
+ * @author Pigeon Codeur
+ * @brief Definition of a lock free triple buffer handing values from a single producer to a single consumer
+ * @version 0.1
+ * @date 2025-05-03
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <atomic>
+#include <cstdint>
+
+namespace pg
+{
+    /**
+     * @brief Three slots exchanged through a single atomic index, so neither side ever waits for the other
+     *
+     * The producer fills its back slot and publishes it, the published slot is swapped with the back slot.
+     * The consumer takes the published slot when a new one is available and keeps its front slot otherwise.
+     * A value published before the consumer took the previous one replaces it, so the consumer always gets the newest value
+     * and is at most one publication behind the producer.
+     *
+     * Only one thread may produce and only one thread may consume.
+     */
+    template <typename Type>
+    class TripleBuffer
+    {
+    public:
+        /** Slot being written by the producer */
+        inline Type& back() { return slots[backIndex]; }
+
+        /** Slot being read by the consumer */
+        inline Type& front() { return slots[frontIndex]; }
+        inline const Type& front() const { return slots[frontIndex]; }
+
+        /**
+         * @brief Hand the back slot to the consumer, the producer gets a free slot to write the next value in
+         *
+         * @return true If the previous publication was never taken by the consumer and got dropped
+         */
+        bool publish()
+        {
+            lastPublished.store(backIndex, std::memory_order_relaxed);
+
+            const uint8_t previous = middle.exchange(backIndex | FreshFlag, std::memory_order_acq_rel);
+
+            backIndex = previous & IndexMask;
+
+            return (previous & FreshFlag) != 0;
+        }
+
+        /**
+         * @brief Take the newest published slot as the front slot
+         *
+         * @return true If a new slot was published since the last call, the front slot is unchanged otherwise
+         */
+        bool acquire()
+        {
+            if ((middle.load(std::memory_order_relaxed) & FreshFlag) == 0)
+                return false;
+
+            frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & IndexMask;
+
+            return true;
+        }
+
+        /**
+         * @brief Get the last published slot, whether the consumer took it or not
+         *
+         * It stays untouched until the next publication, so it is only safe to read from the producer thread.
+         */
+        inline const Type& latest() const { return slots[lastPublished.load(std::memory_order_relaxed)]; }
+
+    private:
+        static constexpr uint8_t IndexMask = 0b011;
+        static constexpr uint8_t FreshFlag = 0b100;
+
+        Type slots[3];
+
+        /** Slot owned by the producer */
+        uint8_t backIndex = 0;
+
+        /** Slot exchanged between the two threads, with a flag set while it holds a publication not taken yet */
+        std::atomic<uint8_t> middle {1};
+
+        /** Slot owned by the consumer */
+        uint8_t frontIndex = 2;
+
+        /** Last slot given by publish, the front slot until the first publication */
+        std::atomic<uint8_t> lastPublished {2};
+    };
+}
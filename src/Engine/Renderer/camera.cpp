@@ -38,16 +38,23 @@ namespace pg
         return {worldX, worldY};
     }
 
-    void BaseCamera2D::constructMatrices()
+    glm::mat4 BaseCamera2D::computeViewMatrix() const
     {
-        viewMatrix = glm::mat4(1.0f);
+        glm::mat4 view = glm::mat4(1.0f);
 
         auto realX = x + xOffset;
         auto realY = y + yOffset;
 
-        viewMatrix[3][0] = -realX * 2.0f / width;
-        viewMatrix[3][1] =  realY * 2.0f / height;
-        viewMatrix[3][2] = -2;
+        view[3][0] = -realX * 2.0f / width;
+        view[3][1] =  realY * 2.0f / height;
+        view[3][2] = -2;
+
+        return view;
+    }
+
+    void BaseCamera2D::constructMatrices()
+    {
+        viewMatrix = computeViewMatrix();
 
         projectionMatrix = getProjectionMatrix();
 
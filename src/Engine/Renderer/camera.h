@@ -45,6 +45,9 @@ namespace pg
 
         void constructMatrices();
 
+        /** Compute the view matrix of the current position without storing it */
+        glm::mat4 computeViewMatrix() const;
+
         virtual ~BaseCamera2D() {}
 
         float width = 0.0f;
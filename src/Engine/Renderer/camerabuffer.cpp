@@ -0,0 +1,113 @@
+#include "stdafx.h"
+
+#include "camerabuffer.h"
+
+#include <cstring>
+
+#include "logger.h"
+
+#include "Helpers/openglobject.h"
+
+namespace pg
+{
+    namespace
+    {
+        static constexpr const char * const DOM = "Camera Uniform Buffer";
+    }
+
+    CameraUniformBuffer::~CameraUniformBuffer()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (bufferId != 0)
+            glDeleteBuffers(1, &bufferId);
+    }
+
+    void CameraUniformBuffer::beginFrame(size_t nbViewports)
+    {
+        blocks.assign(nbViewports, CameraBlock{});
+
+        // Other code may have touched the binding point between two frames
+        boundViewport = -1;
+        uploaded = false;
+    }
+
+#ifndef __EMSCRIPTEN__
+    void CameraUniformBuffer::initialize()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        GLint alignment = 256;
+
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+        if (alignment <= 0)
+            alignment = 256;
+
+        alignedSize = ((sizeof(CameraBlock) + alignment - 1) / alignment) * alignment;
+
+        glGenBuffers(1, &bufferId);
+
+        LOG_INFO(DOM, "Created camera uniform buffer with blocks of " << alignedSize << " bytes");
+    }
+
+    void CameraUniformBuffer::upload()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (bufferId == 0)
+            initialize();
+
+        const size_t totalSize = blocks.size() * alignedSize;
+
+        staging.resize(totalSize);
+
+        for (size_t i = 0; i < blocks.size(); ++i)
+            std::memcpy(staging.data() + i * alignedSize, &blocks[i], sizeof(CameraBlock));
+
+        glBindBuffer(GL_UNIFORM_BUFFER, bufferId);
+
+        if (totalSize > capacity)
+        {
+            capacity = totalSize;
+
+            glBufferData(GL_UNIFORM_BUFFER, capacity, staging.data(), GL_DYNAMIC_DRAW);
+        }
+        else
+        {
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, totalSize, staging.data());
+        }
+
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        uploaded = true;
+        nbUploads++;
+    }
+
+    void CameraUniformBuffer::bind(size_t viewport)
+    {
+        if (viewport >= blocks.size())
+        {
+            LOG_ERROR(DOM, "No camera block for viewport " << viewport);
+            return;
+        }
+
+        if (not uploaded)
+            upload();
+
+        if (boundViewport == static_cast<long long>(viewport))
+            return;
+
+        glBindBufferRange(GL_UNIFORM_BUFFER, OpenGLShaderProgram::CameraBlockBinding, bufferId, viewport * alignedSize, sizeof(CameraBlock));
+
+        boundViewport = static_cast<long long>(viewport);
+    }
+#else
+    // WebGL shaders keep the plain camera uniforms, so the buffer is never bound
+    void CameraUniformBuffer::initialize() {}
+
+    void CameraUniformBuffer::upload() {}
+
+    void CameraUniformBuffer::bind(size_t) {}
+#endif
+}
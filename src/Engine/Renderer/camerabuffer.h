@@ -0,0 +1,110 @@
+#pragma once
+
+/**
+ * @file camerabuffer.h
+ * @author Pigeon Codeur
+ * @brief Definition of the uniform buffer holding the camera matrices of every viewport
+ * @version 0.1
+ * @date 2025-03-17
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+namespace pg
+{
+    /**
+     * @brief Matrices of a viewport, laid out to match the std140 CameraBlock declared in the engine shaders
+     *
+     * layout (std140) uniform CameraBlock { mat4 projection; mat4 view; mat4 scale; mat4 model; };
+     */
+    struct CameraBlock
+    {
+        glm::mat4 projection = glm::mat4(1.0f);
+        glm::mat4 view = glm::mat4(1.0f);
+        glm::mat4 scale = glm::mat4(1.0f);
+        glm::mat4 model = glm::mat4(1.0f);
+    };
+
+    /**
+     * @brief A uniform buffer holding one CameraBlock per viewport
+     *
+     * The blocks are set once per frame, and uploaded in a single call the first time a shader needs them.
+     * Each draw then only selects the range of its viewport on the OpenGLShaderProgram::CameraBlockBinding binding point,
+     * and the range is only rebound when the viewport changes from the previous draw.
+     *
+     * The GL objects are only created on the first bind, so a renderer running without a context never touches GL.
+     *
+     * @warning Must only be used from the render thread
+     */
+    class CameraUniformBuffer
+    {
+    public:
+        CameraUniformBuffer() {}
+
+        /** Camera buffers can't be copied as they own a GL buffer */
+        CameraUniformBuffer(const CameraUniformBuffer&) = delete;
+
+        /** Destroy the Camera Uniform Buffer object and delete the GL buffer */
+        ~CameraUniformBuffer();
+
+        /**
+         * @brief Start a new frame, the blocks must be set again before any bind
+         *
+         * @param nbViewports Number of blocks of the frame
+         */
+        void beginFrame(size_t nbViewports);
+
+        /** Set the matrices of a viewport for the current frame */
+        inline void setBlock(size_t viewport, const CameraBlock& block) { blocks[viewport] = block; }
+
+        /** Get the matrices of a viewport for the current frame */
+        inline const CameraBlock& getBlock(size_t viewport) const { return blocks[viewport]; }
+
+        /** Get the number of blocks of the current frame */
+        inline size_t size() const { return blocks.size(); }
+
+        /**
+         * @brief Bind the block of a viewport on the camera block binding point
+         *
+         * @param viewport Index of the block to bind
+         *
+         * Upload all the blocks on the first bind of the frame.
+         */
+        void bind(size_t viewport);
+
+        /** Get the number of uploads done since the creation of the buffer */
+        inline size_t getNbUploads() const { return nbUploads; }
+
+    private:
+        /** Create the GL buffer and query the offset alignment of the uniform buffer ranges */
+        void initialize();
+
+        /** Send all the blocks of the frame to the gpu */
+        void upload();
+
+        std::vector<CameraBlock> blocks;
+
+        /** Cpu side copy of the blocks, each one padded to the uniform buffer offset alignment */
+        std::vector<unsigned char> staging;
+
+        /** Size in bytes of a block once padded to the alignment */
+        size_t alignedSize = 0;
+
+        /** Size in bytes of the GL buffer storage */
+        size_t capacity = 0;
+
+        unsigned int bufferId = 0;
+
+        /** Viewport currently bound on the binding point, -1 when nothing is bound */
+        long long boundViewport = -1;
+
+        bool uploaded = false;
+
+        size_t nbUploads = 0;
+    };
+}
@@ -0,0 +1,98 @@
+#include "stdafx.h"
+
+#include "culling.h"
+
+#include <cmath>
+
+namespace pg
+{
+    namespace
+    {
+        constexpr float Epsilon = 1e-6f;
+
+        /** Test the bounds of a single instance, written without early outs so the loops over instances stay branchless */
+        inline bool isQuadVisible(const float *instance, const CullRect& rect, bool rotated)
+        {
+            const float x = instance[0];
+            const float y = instance[1];
+            const float w = instance[3];
+            const float h = instance[4];
+
+            float minX = std::fmin(x, x + w);
+            float maxX = std::fmax(x, x + w);
+            float minY = std::fmin(y, y + h);
+            float maxY = std::fmax(y, y + h);
+
+            // Quads rotate around their center, so their bounds are the ones of the circumscribed circle
+            if (rotated and instance[5] != 0.0f)
+            {
+                const float radius = 0.5f * std::sqrt(w * w + h * h);
+                const float centerX = x + 0.5f * w;
+                const float centerY = y + 0.5f * h;
+
+                minX = centerX - radius;
+                maxX = centerX + radius;
+                minY = centerY - radius;
+                maxY = centerY + radius;
+            }
+
+            return (minX < rect.right) & (maxX > rect.left) & (minY < rect.bottom) & (maxY > rect.top);
+        }
+    }
+
+    bool computeCullRect(const glm::mat4& view, float screenWidth, float screenHeight, CullRect& rect)
+    {
+        if (screenWidth <= 0.0f or screenHeight <= 0.0f)
+            return false;
+
+        // Only views translating the world in the xy plane can be inverted into a rectangle
+        if (std::fabs(view[0][0] - 1.0f) > Epsilon or std::fabs(view[1][1] - 1.0f) > Epsilon or
+            std::fabs(view[0][1]) > Epsilon or std::fabs(view[1][0]) > Epsilon or
+            std::fabs(view[2][0]) > Epsilon or std::fabs(view[2][1]) > Epsilon)
+            return false;
+
+        const float tx = view[3][0];
+        const float ty = view[3][1];
+
+        // Inverse of the position transform of the shaders: ndc.x = -1 + 2 * x / sWidth + tx, ndc.y = 1 - 2 * y / sHeight + ty
+        rect.left = -tx * screenWidth * 0.5f;
+        rect.right = (2.0f - tx) * screenWidth * 0.5f;
+        rect.top = ty * screenHeight * 0.5f;
+        rect.bottom = (2.0f + ty) * screenHeight * 0.5f;
+
+        return true;
+    }
+
+    size_t countVisibleQuads(const float *data, size_t nbInstances, size_t stride, const CullRect& rect, bool rotated)
+    {
+        size_t nbVisible = 0;
+
+        for (size_t i = 0; i < nbInstances; ++i)
+        {
+            nbVisible += isQuadVisible(data + i * stride, rect, rotated);
+        }
+
+        return nbVisible;
+    }
+
+    size_t copyVisibleQuads(const float *data, size_t nbInstances, size_t stride, const CullRect& rect, bool rotated, std::vector<float>& out)
+    {
+        out.clear();
+        out.reserve(nbInstances * stride);
+
+        size_t nbVisible = 0;
+
+        for (size_t i = 0; i < nbInstances; ++i)
+        {
+            const float *instance = data + i * stride;
+
+            if (isQuadVisible(instance, rect, rotated))
+            {
+                out.insert(out.end(), instance, instance + stride);
+                nbVisible++;
+            }
+        }
+
+        return nbVisible;
+    }
+}
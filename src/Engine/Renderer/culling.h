@@ -0,0 +1,76 @@
+#pragma once
+
+/**
+ * @file culling.h
+ * @author Pigeon Codeur
+ * @brief Definition of the helpers used to cull the instances of render calls outside of a viewport
+ * @version 0.1
+ * @date 2025-03-24
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+namespace pg
+{
+    /** Rectangle of the world visible in a viewport, in pixels */
+    struct CullRect
+    {
+        float left = 0.0f;
+        float top = 0.0f;
+        float right = 0.0f;
+        float bottom = 0.0f;
+
+        bool operator==(const CullRect& other) const { return left == other.left and top == other.top and right == other.right and bottom == other.bottom; }
+        bool operator!=(const CullRect& other) const { return not (*this == other); }
+
+        /** Check if the two rectangles overlap, rectangles only sharing an edge don't */
+        bool intersects(const CullRect& other) const { return left < other.right and right > other.left and top < other.bottom and bottom > other.top; }
+    };
+
+    /**
+     * @brief Compute the part of the world visible through a view matrix
+     *
+     * @param view View matrix of the viewport
+     * @param screenWidth Width of the screen in pixels
+     * @param screenHeight Height of the screen in pixels
+     * @param rect Receive the visible rectangle
+     *
+     * @return true If the rectangle could be computed
+     * @return false If the view rotates or scales the world, in which case nothing should be culled
+     */
+    bool computeCullRect(const glm::mat4& view, float screenWidth, float screenHeight, CullRect& rect);
+
+    /**
+     * @brief Count the quads intersecting a rectangle
+     *
+     * @param data Instance data, each instance starts with x, y, z, width, height (and a rotation in degree if rotated is set)
+     * @param nbInstances Number of instances in data
+     * @param stride Number of floats of an instance
+     * @param rect Visible rectangle
+     * @param rotated Whether the instances hold a rotation after their size
+     *
+     * @return size_t The number of visible quads
+     *
+     * Rotated quads are tested with the bounding box of their circumscribed circle.
+     */
+    size_t countVisibleQuads(const float *data, size_t nbInstances, size_t stride, const CullRect& rect, bool rotated);
+
+    /**
+     * @brief Copy the quads intersecting a rectangle
+     *
+     * @param data Instance data, same layout as countVisibleQuads
+     * @param nbInstances Number of instances in data
+     * @param stride Number of floats of an instance
+     * @param rect Visible rectangle
+     * @param rotated Whether the instances hold a rotation after their size
+     * @param out Receive the visible instances, in their original order
+     *
+     * @return size_t The number of visible quads
+     */
+    size_t copyVisibleQuads(const float *data, size_t nbInstances, size_t stride, const CullRect& rect, bool rotated, std::vector<float>& out);
+}
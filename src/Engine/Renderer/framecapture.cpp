@@ -0,0 +1,303 @@
+#include "stdafx.h"
+
+#include "framecapture.h"
+
+#include <cstring>
+
+#include "logger.h"
+
+#include "Helpers/openglobject.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "Helpers/stbi_image_write.h"
+
+namespace pg
+{
+    namespace
+    {
+        static constexpr const char * const DOM = "Frame Capture";
+
+        /** Time the encoding worker sleeps on an empty queue before checking if it should stop */
+        static constexpr std::int64_t WorkerWaitUs = 50000;
+    }
+
+    bool encodeFramePng(const CapturedFrame& frame)
+    {
+        const size_t rowSize = static_cast<size_t>(frame.width) * 4;
+
+        if (frame.width <= 0 or frame.height <= 0 or frame.pixels.size() < rowSize * frame.height)
+        {
+            LOG_ERROR(DOM, "Can't save frame " << frame.frame << " to " << frame.path << ", it doesn't hold any pixels");
+            return false;
+        }
+
+        // glReadPixels starts with the bottom row, png files with the top one
+        std::vector<unsigned char> flipped(rowSize * frame.height);
+
+        for (int y = 0; y < frame.height; ++y)
+        {
+            std::memcpy(flipped.data() + y * rowSize, frame.pixels.data() + (frame.height - 1 - y) * rowSize, rowSize);
+        }
+
+        if (stbi_write_png(frame.path.c_str(), frame.width, frame.height, 4, flipped.data(), static_cast<int>(rowSize)) == 0)
+        {
+            LOG_ERROR(DOM, "Failed to write frame " << frame.frame << " to " << frame.path);
+            return false;
+        }
+
+        return true;
+    }
+
+    FrameCapture::~FrameCapture()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+#ifndef __EMSCRIPTEN__
+        for (auto& buffer : buffers)
+        {
+            if (buffer.fence)
+                glDeleteSync(static_cast<GLsync>(buffer.fence));
+
+            if (buffer.id != 0)
+                glDeleteBuffers(1, &buffer.id);
+        }
+#endif
+    }
+
+    void FrameCapture::capture(int width, int height, const std::string& path, size_t frame, bool headless)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (width <= 0 or height <= 0)
+        {
+            LOG_ERROR(DOM, "Can't capture a frame of size " << width << "x" << height);
+            return;
+        }
+
+        const size_t size = static_cast<size_t>(width) * height * 4;
+
+#ifdef __EMSCRIPTEN__
+        CapturedFrame captured;
+
+        captured.pixels.resize(size);
+        captured.width = width;
+        captured.height = height;
+        captured.path = path;
+        captured.frame = frame;
+
+        if (not headless)
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, captured.pixels.data());
+
+        ready.push_back(std::move(captured));
+#else
+        auto& buffer = buffers[next];
+
+        // Every buffer is in flight: wait for the oldest one instead of dropping a capture
+        if (buffer.pending)
+        {
+            LOG_MILE(DOM, "All the pixel buffers are in flight, waiting on the capture of frame " << buffer.frame.frame);
+
+            map(buffer, true);
+
+            ready.push_back(std::move(buffer.frame));
+        }
+
+        buffer.frame = CapturedFrame{};
+        buffer.frame.width = width;
+        buffer.frame.height = height;
+        buffer.frame.path = path;
+        buffer.frame.frame = frame;
+
+        buffer.headless = headless;
+        buffer.pending = true;
+
+        next = (next + 1) % NbPixelBuffers;
+
+        if (headless)
+            return;
+
+        if (buffer.id == 0)
+            glGenBuffers(1, &buffer.id);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.id);
+
+        if (buffer.capacity < size)
+        {
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+
+            buffer.capacity = size;
+        }
+
+        // With a pack buffer bound, the pixels are written at offset 0 of the buffer by the gpu and the call returns right away
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+#endif
+    }
+
+    void FrameCapture::collect(size_t frame, std::vector<CapturedFrame>& frames)
+    {
+        // Frames read while waiting on a full ring are always older than the ones still in flight
+        for (auto& captured : ready)
+            frames.push_back(std::move(captured));
+
+        ready.clear();
+
+        // Go through the buffers from the oldest to the newest, so the frames are handed back in order
+        for (size_t i = 0; i < NbPixelBuffers; ++i)
+        {
+            auto& buffer = buffers[(next + i) % NbPixelBuffers];
+
+            if (not buffer.pending)
+                continue;
+
+            if (frame < buffer.frame.frame + ReadbackLatency)
+                break;
+
+            if (not map(buffer, false))
+                break;
+
+            frames.push_back(std::move(buffer.frame));
+        }
+    }
+
+    size_t FrameCapture::getNbPending() const
+    {
+        size_t nbPending = ready.size();
+
+        for (const auto& buffer : buffers)
+        {
+            if (buffer.pending)
+                nbPending++;
+        }
+
+        return nbPending;
+    }
+
+    bool FrameCapture::map(PixelBuffer& buffer, bool wait)
+    {
+        const size_t size = static_cast<size_t>(buffer.frame.width) * buffer.frame.height * 4;
+
+        if (buffer.headless)
+        {
+            buffer.frame.pixels.assign(size, 0);
+            buffer.pending = false;
+
+            return true;
+        }
+
+#ifndef __EMSCRIPTEN__
+        if (buffer.fence)
+        {
+            auto fence = static_cast<GLsync>(buffer.fence);
+
+            GLenum result = glClientWaitSync(fence, 0, 0);
+
+            // Flush on the first wait only, so the fence is guaranteed to be signaled eventually
+            GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+
+            while (wait and result == GL_TIMEOUT_EXPIRED)
+            {
+                result = glClientWaitSync(fence, waitFlags, 1000000);
+
+                waitFlags = 0;
+            }
+
+            if (result == GL_TIMEOUT_EXPIRED)
+                return false;
+
+            if (result == GL_WAIT_FAILED)
+            {
+                LOG_ERROR(DOM, "Failed to wait on the readback of frame " << buffer.frame.frame);
+            }
+
+            glDeleteSync(fence);
+            buffer.fence = nullptr;
+        }
+
+        buffer.frame.pixels.resize(size);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.id);
+
+        auto data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+
+        if (data)
+        {
+            std::memcpy(buffer.frame.pixels.data(), data, size);
+
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        else
+        {
+            LOG_ERROR(DOM, "Failed to map the pixel buffer of frame " << buffer.frame.frame);
+
+            std::fill(buffer.frame.pixels.begin(), buffer.frame.pixels.end(), 0);
+        }
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+#else
+        buffer.frame.pixels.assign(size, 0);
+#endif
+
+        buffer.pending = false;
+
+        return true;
+    }
+
+    FrameEncoder::~FrameEncoder()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        running = false;
+
+        if (worker.joinable())
+            worker.join();
+    }
+
+    void FrameEncoder::request(CapturedFrame&& frame)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        nbPending++;
+
+#ifdef __EMSCRIPTEN__
+        encode(frame);
+#else
+        std::call_once(startFlag, [this]() {
+            running = true;
+
+            worker = std::thread(&FrameEncoder::workerLoop, this);
+        });
+
+        requests.enqueue(std::move(frame));
+#endif
+    }
+
+    void FrameEncoder::workerLoop()
+    {
+        CapturedFrame frame;
+
+        // Captures already queued are still written when the encoder is destroyed
+        while (running or nbPending > 0)
+        {
+            if (requests.wait_dequeue_timed(frame, WorkerWaitUs))
+                encode(frame);
+        }
+    }
+
+    void FrameEncoder::encode(const CapturedFrame& frame)
+    {
+        if (encodeFramePng(frame))
+        {
+            LOG_INFO(DOM, "Saved frame " << frame.frame << " to " << frame.path);
+        }
+        else
+        {
+            nbFailed++;
+        }
+
+        nbPending--;
+    }
+}
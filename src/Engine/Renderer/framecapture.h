@@ -0,0 +1,168 @@
+#pragma once
+
+/**
+ * @file framecapture.h
+ * @author Pigeon Codeur
+ * @brief Definition of the asynchronous readback of the framebuffer and of the worker encoding the captured frames
+ * @version 0.1
+ * @date 2025-04-22
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+#include "Memory/blockingconcurrentqueue.h"
+
+namespace pg
+{
+    /** Pixels of a frame read back from the framebuffer */
+    struct CapturedFrame
+    {
+        /** Pixels in RGBA, the first row is the bottom of the frame as returned by glReadPixels */
+        std::vector<unsigned char> pixels;
+
+        int width = 0;
+        int height = 0;
+
+        /** File the frame is saved to, empty if it is only sent to the ecs */
+        std::string path;
+
+        /** Number of the frame when it was captured */
+        size_t frame = 0;
+    };
+
+    /**
+     * @brief Save a captured frame as a png file
+     *
+     * The rows are flipped so the top of the frame is the top of the image.
+     *
+     * @return true If the file could be written
+     */
+    bool encodeFramePng(const CapturedFrame& frame);
+
+    /**
+     * @brief A ring of pixel buffers reading the framebuffer back without stalling the render thread
+     *
+     * A capture only queues a glReadPixels into the next pixel buffer, the copy is done by the gpu
+     * while the next frames are drawn. The buffer is mapped ReadbackLatency frames later, once its fence is signaled,
+     * so a frame can be captured every frame without waiting on the gpu.
+     *
+     * On emscripten, WebGL can't map buffers, so the frame is read synchronously.
+     */
+    class FrameCapture
+    {
+    public:
+        /** Number of pixel buffers in flight */
+        static constexpr size_t NbPixelBuffers = 3;
+
+        /** Number of frames between a capture and the mapping of its buffer */
+        static constexpr size_t ReadbackLatency = 2;
+
+        FrameCapture() {}
+
+        /** Delete the pixel buffers and the fences, must be done on the render thread */
+        ~FrameCapture();
+
+        FrameCapture(const FrameCapture&) = delete;
+
+        /**
+         * @brief Start the readback of the current framebuffer
+         *
+         * @param width Width of the framebuffer
+         * @param height Height of the framebuffer
+         * @param path File the frame will be saved to, empty to only send it to the ecs
+         * @param frame Number of the current frame
+         * @param headless If true, nothing is read and a blank frame is handed back
+         */
+        void capture(int width, int height, const std::string& path, size_t frame, bool headless = false);
+
+        /**
+         * @brief Hand back the frames whose readback is done
+         *
+         * @param frame Number of the current frame
+         * @param frames Receive the captured frames, oldest first
+         */
+        void collect(size_t frame, std::vector<CapturedFrame>& frames);
+
+        /** Get the number of captures not handed back yet */
+        size_t getNbPending() const;
+
+    private:
+        struct PixelBuffer
+        {
+            unsigned int id = 0;
+
+            /** Bytes allocated for the buffer */
+            size_t capacity = 0;
+
+            /** GLsync of the readback, null when nothing is being read */
+            void *fence = nullptr;
+
+            bool pending = false;
+
+            bool headless = false;
+
+            CapturedFrame frame;
+        };
+
+        /** Copy the content of a buffer into its frame, return false if the gpu is not done with it */
+        bool map(PixelBuffer& buffer, bool wait);
+
+        PixelBuffer buffers[NbPixelBuffers];
+
+        /** Next buffer written */
+        size_t next = 0;
+
+        /** Frames read synchronously, waiting to be collected */
+        std::vector<CapturedFrame> ready;
+    };
+
+    /**
+     * @brief A worker thread encoding the captured frames into png files
+     *
+     * The worker is only started with the first request. On platforms without threads (emscripten),
+     * the frame is encoded directly when requested.
+     */
+    class FrameEncoder
+    {
+    public:
+        FrameEncoder() {}
+
+        /** Encode the frames still queued, then stop and join the worker */
+        ~FrameEncoder();
+
+        FrameEncoder(const FrameEncoder&) = delete;
+
+        /** Queue a frame to be saved to its path */
+        void request(CapturedFrame&& frame);
+
+        /** Get the number of frames not written yet */
+        inline size_t getNbPending() const { return nbPending.load(); }
+
+        /** Get the number of frames that couldn't be written */
+        inline size_t getNbFailed() const { return nbFailed.load(); }
+
+    private:
+        void workerLoop();
+
+        void encode(const CapturedFrame& frame);
+
+        std::thread worker;
+
+        std::once_flag startFlag;
+
+        std::atomic<bool> running {false};
+
+        std::atomic<size_t> nbPending {0};
+
+        std::atomic<size_t> nbFailed {0};
+
+        moodycamel::BlockingConcurrentQueue<CapturedFrame> requests;
+    };
+}
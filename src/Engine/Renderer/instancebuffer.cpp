@@ -0,0 +1,264 @@
+#include "stdafx.h"
+
+#include "instancebuffer.h"
+
+#include <cstring>
+#include <atomic>
+
+#include "logger.h"
+
+#include "Helpers/openglobject.h"
+
+namespace pg
+{
+    namespace
+    {
+        static constexpr const char * const DOM = "Instance Ring Buffer";
+    }
+
+    size_t nextInstanceSourceVersion()
+    {
+        // Version 0 is reserved for the own instance VBO of the meshes
+        static std::atomic<size_t> lastVersion {0};
+
+        return lastVersion.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    InstanceRingBuffer::InstanceRingBuffer(size_t segmentSize) : segmentSize(segmentSize)
+    {
+        LOG_THIS_MEMBER(DOM);
+    }
+
+    InstanceRingBuffer::~InstanceRingBuffer()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        destroy();
+    }
+
+    void InstanceRingBuffer::initialize()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        const size_t totalSize = segmentSize * NbSegments;
+
+        glGenBuffers(1, &bufferId);
+        glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+
+        version = nextInstanceSourceVersion();
+
+#ifndef __EMSCRIPTEN__
+        persistent = GLEW_VERSION_4_4 or GLEW_ARB_buffer_storage;
+        baseInstance = GLEW_VERSION_4_2 or GLEW_ARB_base_instance;
+
+        if (persistent)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+            glBufferStorage(GL_ARRAY_BUFFER, totalSize, nullptr, flags);
+            mapping = glMapBufferRange(GL_ARRAY_BUFFER, 0, totalSize, flags);
+
+            if (not mapping)
+            {
+                LOG_ERROR(DOM, "Failed to persistently map the instance buffer, falling back to sub data uploads");
+
+                // A buffer created with glBufferStorage is immutable, so we need a new one for the fallback path
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+                glDeleteBuffers(1, &bufferId);
+
+                glGenBuffers(1, &bufferId);
+                glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+
+                persistent = false;
+            }
+        }
+#endif
+
+        if (not persistent)
+            glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        LOG_INFO(DOM, "Created instance buffer of " << totalSize << " bytes (persistent: " << persistent << ", base instance: " << baseInstance << ")");
+
+        currentSegment = 0;
+        cursor = 0;
+
+        initialized = true;
+    }
+
+    void InstanceRingBuffer::destroy()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (not initialized)
+            return;
+
+#ifndef __EMSCRIPTEN__
+        for (auto& fence : fences)
+        {
+            if (fence)
+            {
+                glDeleteSync(static_cast<GLsync>(fence));
+                fence = nullptr;
+            }
+        }
+
+        if (mapping)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            mapping = nullptr;
+        }
+#endif
+
+        glDeleteBuffers(1, &bufferId);
+
+        bufferId = 0;
+        persistent = false;
+        initialized = false;
+    }
+
+    void InstanceRingBuffer::waitSegment(size_t segment)
+    {
+#ifndef __EMSCRIPTEN__
+        if (not fences[segment])
+            return;
+
+        auto fence = static_cast<GLsync>(fences[segment]);
+
+        // Flush on the first wait only, so the fence is guaranteed to be signaled eventually
+        GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+
+        while (true)
+        {
+            const GLenum result = glClientWaitSync(fence, waitFlags, 1000000);
+
+            if (result == GL_ALREADY_SIGNALED or result == GL_CONDITION_SATISFIED)
+                break;
+
+            if (result == GL_WAIT_FAILED)
+            {
+                LOG_ERROR(DOM, "Failed to wait on the fence of segment " << segment);
+                break;
+            }
+
+            waitFlags = 0;
+        }
+
+        glDeleteSync(fence);
+        fences[segment] = nullptr;
+#else
+        (void)segment;
+#endif
+    }
+
+    void InstanceRingBuffer::beginFrame()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (not initialized)
+            return;
+
+        if (requestedSize > segmentSize)
+        {
+            LOG_INFO(DOM, "Growing instance buffer segments from " << segmentSize << " to " << requestedSize << " bytes");
+
+            // The old buffer may still be read by the gpu, so every segment must be done before deleting it
+            for (size_t i = 0; i < NbSegments; i++)
+                waitSegment(i);
+
+            destroy();
+
+            segmentSize = requestedSize;
+            requestedSize = 0;
+
+            nbReallocations++;
+
+            initialize();
+
+            return;
+        }
+
+        currentSegment = (currentSegment + 1) % NbSegments;
+        cursor = 0;
+
+        waitSegment(currentSegment);
+
+#ifdef __EMSCRIPTEN__
+        // Without fences, orphan the storage on wrap around so the driver hands us fresh memory instead of stalling
+        if (currentSegment == 0)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+            glBufferData(GL_ARRAY_BUFFER, segmentSize * NbSegments, nullptr, GL_STREAM_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+#endif
+    }
+
+    void InstanceRingBuffer::endFrame()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (not initialized or cursor == 0)
+            return;
+
+#ifndef __EMSCRIPTEN__
+        if (fences[currentSegment])
+            glDeleteSync(static_cast<GLsync>(fences[currentSegment]));
+
+        fences[currentSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+    }
+
+    bool InstanceRingBuffer::write(const void *data, size_t size, size_t stride, size_t& offset)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (size == 0 or stride == 0)
+            return false;
+
+        if (not initialized)
+            initialize();
+
+        const size_t segmentStart = currentSegment * segmentSize;
+
+        // Align the absolute offset on the stride so that offset / stride is an integral base instance
+        size_t start = segmentStart + cursor;
+        start = ((start + stride - 1) / stride) * stride;
+
+        if (start + size > segmentStart + segmentSize)
+        {
+            size_t needed = segmentSize * 2;
+
+            while (needed < (start - segmentStart) + size)
+                needed *= 2;
+
+            if (needed > requestedSize)
+            {
+                LOG_MILE(DOM, "Instance buffer segment is full, requesting " << needed << " bytes for the next frame");
+                requestedSize = needed;
+            }
+
+            return false;
+        }
+
+        if (persistent)
+        {
+            std::memcpy(static_cast<char*>(mapping) + start, data, size);
+        }
+        else
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+            glBufferSubData(GL_ARRAY_BUFFER, start, size, data);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+
+        cursor = start + size - segmentStart;
+        offset = start;
+
+        return true;
+    }
+}
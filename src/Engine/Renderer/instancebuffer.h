@@ -0,0 +1,143 @@
+#pragma once
+
+/**
+ * @file instancebuffer.h
+ * @author Pigeon Codeur
+ * @brief Definition of the streaming buffer used to upload the instance data of the render calls
+ * @version 0.1
+ * @date 2025-02-27
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <cstddef>
+
+namespace pg
+{
+    /**
+     * @brief Get a new version number for a GL buffer used as an instance source
+     *
+     * GL may give back the id of a deleted buffer to a new one, so meshes identify their instance source with (id, version)
+     */
+    size_t nextInstanceSourceVersion();
+
+    /**
+     * @brief A ring buffer streaming the per instance data of all the render calls of a frame
+     *
+     * The buffer is split into NbSegments segments, each frame writes its instance data in the next segment.
+     * Before reusing a segment, the ring waits on the fence placed when the segment was last written,
+     * so the cpu never overwrites data that the gpu may still be reading.
+     *
+     * When ARB_buffer_storage is available, the whole buffer is persistently mapped once and written with a memcpy.
+     * Otherwise (GLES / WebGL) the data is uploaded with glBufferSubData and the buffer storage is orphaned on wrap around.
+     *
+     * The GL objects are only created on the first write, so a renderer running without a context never touches GL.
+     *
+     * @warning Must only be used from the render thread
+     */
+    class InstanceRingBuffer
+    {
+    public:
+        /** Number of frames that can be in flight at the same time */
+        static constexpr size_t NbSegments = 3;
+
+        /**
+         * @brief Construct a new Instance Ring Buffer object
+         *
+         * @param segmentSize Size in bytes of the instance data that can be written in a frame
+         */
+        InstanceRingBuffer(size_t segmentSize = 4 * 1024 * 1024);
+
+        /** Ring buffers can't be copied as they own GL objects */
+        InstanceRingBuffer(const InstanceRingBuffer&) = delete;
+
+        /** Destroy the Instance Ring Buffer object and delete the GL buffer */
+        ~InstanceRingBuffer();
+
+        /**
+         * @brief Start writing the instance data of a new frame
+         *
+         * Move to the next segment and wait until the gpu is done with it.
+         * If the previous frame ran out of space, the buffer is recreated with a bigger segment size here.
+         */
+        void beginFrame();
+
+        /** Place a fence after the draw calls of the current frame */
+        void endFrame();
+
+        /**
+         * @brief Write the instance data of a draw call in the current segment
+         *
+         * @param data Pointer to the instance data
+         * @param size Size in bytes of the data
+         * @param stride Size in bytes of a single instance, the data is aligned on it so that offset / stride is a valid base instance
+         * @param offset Receive the offset in bytes of the written data from the start of the buffer
+         *
+         * @return true If the data was written in the buffer
+         * @return false If the segment is full, the caller must upload the data another way for this frame
+         */
+        bool write(const void *data, size_t size, size_t stride, size_t& offset);
+
+        /** Get the id of the GL buffer (0 if not created yet) */
+        inline unsigned int getBufferId() const { return bufferId; }
+
+        /** Check if the buffer is persistently mapped */
+        inline bool isPersistent() const { return persistent; }
+
+        /** Check if draw calls can start reading from a base instance (glDrawElementsInstancedBaseInstance) */
+        inline bool supportsBaseInstance() const { return baseInstance; }
+
+        /** Get the size in bytes of a segment */
+        inline size_t getSegmentSize() const { return segmentSize; }
+
+        /** Get the number of bytes written in the current frame */
+        inline size_t getUsedBytes() const { return cursor; }
+
+        /** Get the number of times the buffer was recreated to grow */
+        inline size_t getNbReallocations() const { return nbReallocations; }
+
+        /** Get the version of the current GL buffer (see nextInstanceSourceVersion) */
+        inline size_t getVersion() const { return version; }
+
+    private:
+        /** Create the GL buffer, and map it if persistent mapping is supported */
+        void initialize();
+
+        /** Delete the GL buffer and all the pending fences */
+        void destroy();
+
+        /** Block until the gpu is done with the given segment */
+        void waitSegment(size_t segment);
+
+        /** Size in bytes of a segment */
+        size_t segmentSize;
+
+        /** Segment size requested after an overflow, applied on the next frame */
+        size_t requestedSize = 0;
+
+        /** Index of the segment written in the current frame */
+        size_t currentSegment = 0;
+
+        /** Number of bytes already written in the current segment */
+        size_t cursor = 0;
+
+        /** Id of the GL buffer */
+        unsigned int bufferId = 0;
+
+        /** Version of the GL buffer */
+        size_t version = 0;
+
+        /** Pointer to the persistent mapping of the buffer */
+        void *mapping = nullptr;
+
+        /** Fences (GLsync) placed at the end of the last frame that wrote in each segment */
+        void *fences[NbSegments] = {nullptr};
+
+        bool initialized = false;
+        bool persistent = false;
+        bool baseInstance = false;
+
+        size_t nbReallocations = 0;
+    };
+}
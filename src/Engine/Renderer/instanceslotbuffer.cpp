@@ -0,0 +1,272 @@
+#include "stdafx.h"
+
+#include "instanceslotbuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "logger.h"
+
+#include "instancebuffer.h"
+
+#include "Helpers/openglobject.h"
+
+namespace pg
+{
+    namespace
+    {
+        static constexpr const char * const DOM = "Instance Slot Buffer";
+    }
+
+    InstanceSlotBuffer::InstanceSlotBuffer(size_t stride) : stride(stride)
+    {
+        LOG_THIS_MEMBER(DOM);
+    }
+
+    InstanceSlotBuffer::~InstanceSlotBuffer()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (bufferId != 0)
+            glDeleteBuffers(1, &bufferId);
+    }
+
+    void InstanceSlotBuffer::set(_unique_id id, const float *attributes)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        size_t slot;
+
+        auto it = slots.find(id);
+
+        if (it == slots.end())
+        {
+            slot = owners.size();
+
+            slots.emplace(id, slot);
+            owners.push_back(id);
+
+            data.resize(owners.size() * stride);
+        }
+        else
+        {
+            slot = it->second;
+
+            // Nothing changed, no need to upload this slot again
+            if (std::memcmp(data.data() + slot * stride, attributes, stride * sizeof(float)) == 0)
+                return;
+        }
+
+        std::memcpy(data.data() + slot * stride, attributes, stride * sizeof(float));
+
+        dirtySlots.push_back(slot);
+    }
+
+    bool InstanceSlotBuffer::remove(_unique_id id)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = slots.find(id);
+
+        if (it == slots.end())
+            return false;
+
+        const size_t slot = it->second;
+        const size_t last = owners.size() - 1;
+
+        slots.erase(it);
+
+        // Move the last slot in the hole to keep the instances contiguous
+        if (slot != last)
+        {
+            const auto movedId = owners[last];
+
+            std::memcpy(data.data() + slot * stride, data.data() + last * stride, stride * sizeof(float));
+
+            owners[slot] = movedId;
+            slots[movedId] = slot;
+
+            dirtySlots.push_back(slot);
+        }
+
+        owners.pop_back();
+        data.resize(owners.size() * stride);
+
+        return true;
+    }
+
+    bool InstanceSlotBuffer::has(_unique_id id) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        return slots.find(id) != slots.end();
+    }
+
+    size_t InstanceSlotBuffer::size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        return owners.size();
+    }
+
+    void InstanceSlotBuffer::setBounds(const CullRect& bounds)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        this->bounds = bounds;
+
+        hasBounds = true;
+    }
+
+    bool InstanceSlotBuffer::getBounds(CullRect& bounds) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (not hasBounds)
+            return false;
+
+        bounds = this->bounds;
+
+        return true;
+    }
+
+    size_t InstanceSlotBuffer::upload()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        const size_t nbInstances = owners.size();
+
+        nbLastUploadRanges = 0;
+        lastUploadSize = 0;
+
+        if (nbInstances == 0)
+        {
+            dirtySlots.clear();
+            return 0;
+        }
+
+        if (bufferId == 0)
+        {
+            glGenBuffers(1, &bufferId);
+
+            version = nextInstanceSourceVersion();
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+
+        if (nbInstances > gpuCapacity)
+        {
+            // Grow geometrically so that adding entities one by one doesn't reallocate the storage every frame
+            gpuCapacity = std::max(nbInstances, gpuCapacity * 2);
+
+            glBufferData(GL_ARRAY_BUFFER, gpuCapacity * stride * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, nbInstances * stride * sizeof(float), data.data());
+
+            nbLastUploadRanges = 1;
+            lastUploadSize = nbInstances * stride * sizeof(float);
+        }
+        else if (not dirtySlots.empty())
+        {
+            for (const auto& range : coalesceSlots(dirtySlots))
+            {
+                // Slots freed since they were written are not part of the buffer anymore
+                const size_t end = std::min(range.second, nbInstances);
+
+                if (range.first >= end)
+                    continue;
+
+                glBufferSubData(GL_ARRAY_BUFFER, range.first * stride * sizeof(float), (end - range.first) * stride * sizeof(float), data.data() + range.first * stride);
+
+                nbLastUploadRanges++;
+                lastUploadSize += (end - range.first) * stride * sizeof(float);
+            }
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        dirtySlots.clear();
+
+        return nbInstances;
+    }
+
+    size_t InstanceSlotBuffer::discardDirtySlots()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::sort(dirtySlots.begin(), dirtySlots.end());
+
+        const auto last = std::unique(dirtySlots.begin(), dirtySlots.end());
+
+        // Slots freed since they were written are not part of the buffer anymore
+        const size_t nbDirty = std::count_if(dirtySlots.begin(), last, [this](size_t slot) { return slot < owners.size(); });
+
+        dirtySlots.clear();
+
+        return nbDirty;
+    }
+
+    size_t InstanceSlotBuffer::copyData(std::vector<float>& out) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        out = data;
+
+        return owners.size();
+    }
+
+    std::vector<InstanceSlotBuffer::SlotRange> InstanceSlotBuffer::coalesceSlots(std::vector<size_t>& slots, size_t maxGap, size_t maxRanges)
+    {
+        std::vector<SlotRange> ranges;
+
+        if (slots.empty())
+            return ranges;
+
+        std::sort(slots.begin(), slots.end());
+
+        for (auto slot : slots)
+        {
+            if (not ranges.empty() and slot <= ranges.back().second + maxGap)
+                ranges.back().second = std::max(ranges.back().second, slot + 1);
+            else
+                ranges.emplace_back(slot, slot + 1);
+        }
+
+        if (maxRanges == 0 or ranges.size() <= maxRanges)
+            return ranges;
+
+        // Too many ranges: close the smallest gaps until only maxRanges ranges are left
+        const size_t nbMerges = ranges.size() - maxRanges;
+
+        std::vector<std::pair<size_t, size_t>> gaps;
+        gaps.reserve(ranges.size() - 1);
+
+        for (size_t i = 1; i < ranges.size(); ++i)
+            gaps.emplace_back(ranges[i].first - ranges[i - 1].second, i);
+
+        std::nth_element(gaps.begin(), gaps.begin() + (nbMerges - 1), gaps.end());
+
+        std::vector<bool> mergeWithPrevious(ranges.size(), false);
+
+        for (size_t i = 0; i < nbMerges; ++i)
+            mergeWithPrevious[gaps[i].second] = true;
+
+        std::vector<SlotRange> merged;
+        merged.reserve(maxRanges);
+
+        for (size_t i = 0; i < ranges.size(); ++i)
+        {
+            if (mergeWithPrevious[i])
+                merged.back().second = ranges[i].second;
+            else
+                merged.push_back(ranges[i]);
+        }
+
+        return merged;
+    }
+}
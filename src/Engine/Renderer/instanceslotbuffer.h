@@ -0,0 +1,173 @@
+#pragma once
+
+/**
+ * @file instanceslotbuffer.h
+ * @author Pigeon Codeur
+ * @brief Definition of a persistent instance buffer where each entity owns a stable slot
+ * @version 0.1
+ * @date 2025-03-10
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "ECS/uniqueid.h"
+
+#include "culling.h"
+
+namespace pg
+{
+    /**
+     * @brief A persistent instance buffer where each entity owns a slot of attributes
+     *
+     * The attributes are kept in a cpu side mirror of the GL buffer, writing the attributes of an entity only
+     * flags its slot as dirty. On upload, the dirty slots are coalesced into a few ranges so that only
+     * the data that changed is sent to the gpu with glBufferSubData.
+     *
+     * Slots are kept contiguous: removing an entity moves the last slot in the hole, so the buffer can always be
+     * drawn as a single instanced call of size() instances.
+     *
+     * Writes happen on the ecs thread while uploads happen on the render thread, so all the accesses are guarded by a mutex.
+     */
+    class InstanceSlotBuffer
+    {
+    public:
+        /** A range of slots [first, second[ */
+        using SlotRange = std::pair<size_t, size_t>;
+
+        /** Dirty slots separated by at most this number of clean slots are uploaded in a single range */
+        static constexpr size_t MaxGap = 16;
+
+        /** Maximum number of glBufferSubData calls issued by an upload, the closest ranges are merged beyond that */
+        static constexpr size_t MaxRanges = 8;
+
+        /**
+         * @brief Construct a new Instance Slot Buffer object
+         *
+         * @param stride Number of floats of the attributes of a single instance
+         */
+        InstanceSlotBuffer(size_t stride);
+
+        /** Slot buffers can't be copied as they own a GL buffer */
+        InstanceSlotBuffer(const InstanceSlotBuffer&) = delete;
+
+        /** Destroy the Instance Slot Buffer object and delete the GL buffer */
+        ~InstanceSlotBuffer();
+
+        /**
+         * @brief Write the attributes of an entity, a slot is attributed to the entity if it doesn't own one yet
+         *
+         * @param id Id of the entity
+         * @param attributes Pointer to stride floats
+         */
+        void set(_unique_id id, const float *attributes);
+
+        /**
+         * @brief Give back the slot of an entity
+         *
+         * @param id Id of the entity
+         *
+         * @return true If the entity owned a slot in this buffer
+         */
+        bool remove(_unique_id id);
+
+        /** Check if an entity owns a slot in this buffer */
+        bool has(_unique_id id) const;
+
+        /** Get the number of instances held in the buffer */
+        size_t size() const;
+
+        /** Get the number of floats of a single instance */
+        inline size_t getStride() const { return stride; }
+
+        /**
+         * @brief Send the dirty slots to the gpu, must be called from the render thread
+         *
+         * @return size_t The number of instances to draw
+         *
+         * The GL buffer is created on the first upload and recreated with a bigger storage when the slots don't fit anymore
+         */
+        size_t upload();
+
+        /**
+         * @brief Forget the dirty slots without sending them, used by backends without a gpu
+         *
+         * @return size_t The number of slots that would have been uploaded
+         */
+        size_t discardDirtySlots();
+
+        /**
+         * @brief Set the area of the world covered by the instances
+         *
+         * A buffer with bounds is culled as a whole by the master renderer when its bounds are out of its viewport.
+         */
+        void setBounds(const CullRect& bounds);
+
+        /** Get the area covered by the instances, return false if no bounds were set */
+        bool getBounds(CullRect& bounds) const;
+
+        /** Copy the attributes of all the instances (used when a mesh can't read from this buffer) */
+        size_t copyData(std::vector<float>& out) const;
+
+        /** Get the id of the GL buffer (0 if not uploaded yet) */
+        inline unsigned int getBufferId() const { return bufferId; }
+
+        /** Get the version of the GL buffer (see nextInstanceSourceVersion) */
+        inline size_t getVersion() const { return version; }
+
+        /** Get the number of glBufferSubData calls issued by the last upload */
+        inline size_t getNbLastUploadRanges() const { return nbLastUploadRanges; }
+
+        /** Get the number of bytes sent by the last upload */
+        inline size_t getLastUploadSize() const { return lastUploadSize; }
+
+        /**
+         * @brief Sort a list of dirty slots and coalesce them into ranges
+         *
+         * @param slots Dirty slots, duplicates are allowed, the list is sorted in place
+         * @param maxGap Slots separated by at most maxGap clean slots end up in the same range
+         * @param maxRanges Maximum number of ranges returned, the ranges separated by the smallest gaps are merged first
+         *
+         * @return std::vector<SlotRange> The coalesced ranges in ascending order
+         */
+        static std::vector<SlotRange> coalesceSlots(std::vector<size_t>& slots, size_t maxGap = MaxGap, size_t maxRanges = MaxRanges);
+
+    private:
+        /** Number of floats per instance */
+        size_t stride;
+
+        /** Cpu side mirror of the instance data */
+        std::vector<float> data;
+
+        /** Slot owned by each entity */
+        std::unordered_map<_unique_id, size_t> slots;
+
+        /** Owner of each slot */
+        std::vector<_unique_id> owners;
+
+        /** Slots written since the last upload */
+        std::vector<size_t> dirtySlots;
+
+        /** Number of instances the GL buffer can currently hold */
+        size_t gpuCapacity = 0;
+
+        unsigned int bufferId = 0;
+
+        size_t version = 0;
+
+        size_t nbLastUploadRanges = 0;
+
+        size_t lastUploadSize = 0;
+
+        CullRect bounds;
+
+        bool hasBounds = false;
+
+        mutable std::mutex mutex;
+    };
+}
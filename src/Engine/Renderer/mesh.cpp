@@ -8,6 +8,49 @@
 
 namespace pg
 {
+    namespace
+    {
+        /**
+         * @brief Set the vertex attribute pointers of the instance data from the currently bound array buffer
+         *
+         * @param attributes Size of each instance attribute, in floats
+         * @param firstLocation Location of the first instance attribute
+         * @param offset Offset in bytes of the first instance in the buffer
+         */
+        void setInstanceAttributes(const std::vector<size_t>& attributes, size_t firstLocation, size_t offset)
+        {
+            // Calculate the total size of the attributes requested
+            size_t totalSize = 0;
+
+            for (auto att : attributes)
+            {
+                totalSize += att;
+            }
+
+            size_t currentSize = 0;
+
+            for (size_t i = 0; i < attributes.size(); ++i)
+            {
+                glEnableVertexAttribArray(i + firstLocation);
+                glVertexAttribPointer(i + firstLocation, attributes[i], GL_FLOAT, GL_FALSE, totalSize * sizeof(float), (void*)(offset + currentSize * sizeof(float)));
+
+                currentSize += attributes[i];
+
+                glVertexAttribDivisor(i + firstLocation, 1); // tell OpenGL this is an instanced vertex attribute.
+            }
+        }
+
+        /** Set the instance attribute pointers from the given buffer */
+        void updateInstanceSource(const std::vector<size_t>& attributes, size_t firstLocation, unsigned int bufferId, size_t offset)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+
+            setInstanceAttributes(attributes, firstLocation, offset);
+
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+    }
+
     OpenGLObject::OpenGLObject()
     {
         LOG_THIS_MEMBER("OpenGLObject");
@@ -76,25 +119,11 @@ namespace pg
 
         openGLMesh.instanceVBO->bind();
 
-        // Calculate the total size of the attributes requested
-        size_t totalSize = 0;
+        setInstanceAttributes(attributes, 1, 0);
 
-        for (auto att : attributes)
-        {
-            totalSize += att;
-        }
-
-        size_t currentSize = 0;
-
-        for (size_t i = 0; i < attributes.size(); ++i)
-        {
-            glEnableVertexAttribArray(i + 1);
-            glVertexAttribPointer(i + 1, attributes[i], GL_FLOAT, GL_FALSE, totalSize * sizeof(float), (void*)(currentSize * sizeof(float)));
-
-            currentSize += attributes[i];
-
-            glVertexAttribDivisor(i + 1, 1); // tell OpenGL this is an instanced vertex attribute.
-        }
+        instanceSourceBuffer = openGLMesh.instanceVBO->bufferId();
+        instanceSourceOffset = 0;
+        instanceSourceVersion = 0;
 
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
@@ -107,6 +136,20 @@ namespace pg
         initialized = true;
     }
 
+    bool SimpleSquareMesh::setInstanceSource(unsigned int bufferId, size_t offset, size_t version)
+    {
+        if (instanceSourceBuffer == bufferId and instanceSourceOffset == offset and instanceSourceVersion == version)
+            return true;
+
+        updateInstanceSource(attributes, 1, bufferId, offset);
+
+        instanceSourceBuffer = bufferId;
+        instanceSourceOffset = offset;
+        instanceSourceVersion = version;
+
+        return true;
+    }
+
     SimpleSquareMesh::~SimpleSquareMesh()
     {
         LOG_THIS_MEMBER("Simple square mesh");
@@ -137,25 +180,11 @@ namespace pg
 
         openGLMesh.instanceVBO->bind();
 
-        // Calculate the total size of the attributes requested
-        size_t totalSize = 0;
+        setInstanceAttributes(attributes, 2, 0);
 
-        for (auto att : attributes)
-        {
-            totalSize += att;
-        }
-
-        size_t currentSize = 0;
-
-        for (size_t i = 0; i < attributes.size(); ++i)
-        {
-            glEnableVertexAttribArray(i + 2);
-            glVertexAttribPointer(i + 2, attributes[i], GL_FLOAT, GL_FALSE, totalSize * sizeof(float), (void*)(currentSize * sizeof(float)));
-
-            currentSize += attributes[i];
-
-            glVertexAttribDivisor(i + 2, 1); // tell OpenGL this is an instanced vertex attribute.
-        }
+        instanceSourceBuffer = openGLMesh.instanceVBO->bufferId();
+        instanceSourceOffset = 0;
+        instanceSourceVersion = 0;
 
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
@@ -168,6 +197,20 @@ namespace pg
         initialized = true;
     }
 
+    bool SimpleTexturedSquareMesh::setInstanceSource(unsigned int bufferId, size_t offset, size_t version)
+    {
+        if (instanceSourceBuffer == bufferId and instanceSourceOffset == offset and instanceSourceVersion == version)
+            return true;
+
+        updateInstanceSource(attributes, 2, bufferId, offset);
+
+        instanceSourceBuffer = bufferId;
+        instanceSourceOffset = offset;
+        instanceSourceVersion = version;
+
+        return true;
+    }
+
     SimpleTexturedSquareMesh::~SimpleTexturedSquareMesh()
     {
         LOG_THIS_MEMBER("Simple square mesh");
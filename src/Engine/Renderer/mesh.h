@@ -38,9 +38,29 @@ namespace pg
 
         virtual void generateMesh() = 0;
 
+        /**
+         * @brief Point the instance vertex attributes of the mesh to another buffer
+         *
+         * @param bufferId Id of the GL buffer holding the instance data
+         * @param offset Offset in bytes of the first instance in the buffer
+         * @param version Version of the buffer, used to detect a recreated buffer that got back the same id
+         *
+         * @return true If the mesh now reads its instances from the given buffer
+         * @return false If the mesh only supports its own instance VBO
+         *
+         * @warning The VAO of the mesh must be bound
+         */
+        virtual bool setInstanceSource(unsigned int, size_t, size_t = 0) { return false; }
+
         OpenGLObject openGLMesh;
         constant::ModelInfo modelInfo;
         bool initialized = false;
+
+    protected:
+        /** Buffer the instance attributes currently read from */
+        unsigned int instanceSourceBuffer = 0;
+        size_t instanceSourceOffset = 0;
+        size_t instanceSourceVersion = 0;
     };
 
     struct SimpleSquareMesh : public Mesh
@@ -67,6 +87,8 @@ namespace pg
 
         void generateMesh();
 
+        bool setInstanceSource(unsigned int bufferId, size_t offset, size_t version = 0) override;
+
         /**
          * @brief Vector responsible of generating the vertex attributes pointer of the instance VBO
          * 
@@ -103,6 +125,8 @@ namespace pg
 
         void generateMesh();
 
+        bool setInstanceSource(unsigned int bufferId, size_t offset, size_t version = 0) override;
+
         /**
          * @brief Vector responsible of generating the vertex attributes pointer of the instance VBO
          * 
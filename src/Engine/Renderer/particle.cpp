@@ -1,49 +1,300 @@
-// #include "particle.h"
+#include "stdafx.h"
 
-// namespace pg
-// {
-//     template <>
-//     void renderer(MasterRenderer* masterRenderer, ParticleComponent* particle)
-//     {
-//         auto rTable = masterRenderer->getParameter();
-//         const int screenWidth = rTable.get<int>("ScreenWidth");
-//         const int screenHeight = rTable.get<int>("ScreenHeight");
+#include "particle.h"
 
-//         auto extraFunctions = masterRenderer->getExtraFunctions();
+#include <algorithm>
 
-//         auto instanceVBO = particle->instanceVBO;
+#if defined(__SSE2__)
+#include <xmmintrin.h>
+#endif
 
-//         QMatrix4x4 projection;
-//         QMatrix4x4 view;
-//         QMatrix4x4 model;
-//         QMatrix4x4 scale;
+#include "logger.h"
 
-//         auto particleShaderProgram = masterRenderer->getShader("particle");
+#include "Memory/parallelfor.h"
 
-//         particleShaderProgram->bind();
+namespace pg
+{
+    namespace
+    {
+        static constexpr const char * const DOM = "Particle System";
 
-//         glBindTexture(GL_TEXTURE_2D, particle->texture);
+        /** Smallest number of particles processed by a job */
+        static constexpr size_t ParticleChunkSize = 4096;
 
-//         projection.setToIdentity();
-//         view.setToIdentity();
-//         scale.setToIdentity();
-//         model.setToIdentity();
+        /** Xorshift generator, good enough to scatter particles and cheap enough to draw millions of numbers */
+        inline float randomRange(uint32_t& state, float min, float max)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
 
-//         scale.scale(QVector3D(1.0f / screenWidth, 1.0f / screenHeight, 0.0f));
-//         view.translate(QVector3D(-1.0f, 1.0f, 0.0f));
+            return min + (max - min) * static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+        }
 
-//         particleShaderProgram->setUniformValue(particleShaderProgram->uniformLocation("projection"), projection);
-//         particleShaderProgram->setUniformValue(particleShaderProgram->uniformLocation("view"), view);
-//         particleShaderProgram->setUniformValue(particleShaderProgram->uniformLocation("model"), model);
-//         particleShaderProgram->setUniformValue(particleShaderProgram->uniformLocation("scale"), scale);
+        inline float lerp(float a, float b, float t)
+        {
+            return a + (b - a) * t;
+        }
+    }
 
-//         particle->openglObject.VAO->bind();
+    void ParticleBuffer::reserve(size_t n)
+    {
+        x.reserve(n);
+        y.reserve(n);
+        vx.reserve(n);
+        vy.reserve(n);
+        age.reserve(n);
+        lifetime.reserve(n);
+    }
 
-//         instanceVBO->bind();
-//         instanceVBO->setUsagePattern(QOpenGLBuffer::StreamDraw);
-//         instanceVBO->allocate(particle->particleList, particle->count * sizeof(Particle));
+    void ParticleBuffer::clear()
+    {
+        x.clear();
+        y.clear();
+        vx.clear();
+        vy.clear();
+        age.clear();
+        lifetime.clear();
+    }
 
-//         // TODO the renderer can only draw 2D square particles !!
-//         extraFunctions->glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, particle->count);
-//     }
-// }
\ No newline at end of file
+    void ParticleBuffer::push(float posX, float posY, float velX, float velY, float life)
+    {
+        x.push_back(posX);
+        y.push_back(posY);
+        vx.push_back(velX);
+        vy.push_back(velY);
+        age.push_back(0.0f);
+        lifetime.push_back(life);
+    }
+
+    size_t ParticleBuffer::removeDead()
+    {
+        size_t nbAlive = size();
+        size_t i = 0;
+
+        while (i < nbAlive)
+        {
+            if (age[i] < lifetime[i])
+            {
+                ++i;
+                continue;
+            }
+
+            // The last particle takes the place of the dead one, and is checked in turn
+            --nbAlive;
+
+            x[i] = x[nbAlive];
+            y[i] = y[nbAlive];
+            vx[i] = vx[nbAlive];
+            vy[i] = vy[nbAlive];
+            age[i] = age[nbAlive];
+            lifetime[i] = lifetime[nbAlive];
+        }
+
+        const size_t nbRemoved = size() - nbAlive;
+
+        x.resize(nbAlive);
+        y.resize(nbAlive);
+        vx.resize(nbAlive);
+        vy.resize(nbAlive);
+        age.resize(nbAlive);
+        lifetime.resize(nbAlive);
+
+        return nbRemoved;
+    }
+
+    void integrateParticles(ParticleBuffer& particles, size_t start, size_t end, float dt, float ax, float ay)
+    {
+        float *x = particles.x.data();
+        float *y = particles.y.data();
+        float *vx = particles.vx.data();
+        float *vy = particles.vy.data();
+        float *age = particles.age.data();
+
+        const float dvx = ax * dt;
+        const float dvy = ay * dt;
+
+        size_t i = start;
+
+#if defined(__SSE2__)
+        const __m128 dtV = _mm_set1_ps(dt);
+        const __m128 dvxV = _mm_set1_ps(dvx);
+        const __m128 dvyV = _mm_set1_ps(dvy);
+
+        for (; i + 4 <= end; i += 4)
+        {
+            const __m128 newVx = _mm_add_ps(_mm_loadu_ps(vx + i), dvxV);
+            const __m128 newVy = _mm_add_ps(_mm_loadu_ps(vy + i), dvyV);
+
+            _mm_storeu_ps(vx + i, newVx);
+            _mm_storeu_ps(vy + i, newVy);
+
+            _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(newVx, dtV)));
+            _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(newVy, dtV)));
+
+            _mm_storeu_ps(age + i, _mm_add_ps(_mm_loadu_ps(age + i), dtV));
+        }
+#endif
+
+        // Tail of the range, or the whole range without SSE (the loop stays simple enough to be vectorized by the compiler)
+        for (; i < end; ++i)
+        {
+            vx[i] += dvx;
+            vy[i] += dvy;
+
+            x[i] += vx[i] * dt;
+            y[i] += vy[i] * dt;
+
+            age[i] += dt;
+        }
+    }
+
+    void writeParticleInstances(const ParticleEmitter& emitter, size_t start, size_t end, float *out)
+    {
+        const auto& particles = emitter.particles;
+
+        for (size_t i = start; i < end; ++i)
+        {
+            const float t = std::min(particles.age[i] / particles.lifetime[i], 1.0f);
+
+            const float size = lerp(emitter.startSize, emitter.endSize, t);
+
+            // The shape is drawn from its top left corner, so the particle is centered on its position
+            out[0] = particles.x[i] - size * 0.5f;
+            out[1] = particles.y[i] - size * 0.5f;
+            out[2] = emitter.z;
+            out[3] = size;
+            out[4] = size;
+            out[5] = 0.0f;
+            out[6] = lerp(emitter.startColor.x, emitter.endColor.x, t);
+            out[7] = lerp(emitter.startColor.y, emitter.endColor.y, t);
+            out[8] = lerp(emitter.startColor.z, emitter.endColor.z, t);
+            out[9] = lerp(emitter.startColor.w, emitter.endColor.w, t);
+
+            out += ParticleInstanceSize;
+        }
+    }
+
+    size_t simulateParticles(ParticleEmitter& emitter, float dt)
+    {
+        auto& particles = emitter.particles;
+
+        // Update the particles already alive first, so the new ones start at the emitter position
+        parallelForChunks(particles.size(), ParticleChunkSize, [&particles, &emitter, dt](size_t start, size_t end, size_t) {
+            integrateParticles(particles, start, end, dt, emitter.acceleration.x, emitter.acceleration.y);
+        });
+
+        particles.removeDead();
+
+        size_t nbNew = emitter.pendingBurst;
+
+        emitter.pendingBurst = 0;
+
+        if (emitter.emitting and emitter.rate > 0.0f)
+        {
+            emitter.emissionDebt += emitter.rate * dt;
+
+            const size_t nbEmitted = static_cast<size_t>(emitter.emissionDebt);
+
+            emitter.emissionDebt -= static_cast<float>(nbEmitted);
+
+            nbNew += nbEmitted;
+        }
+
+        nbNew = std::min(nbNew, emitter.maxParticles > particles.size() ? emitter.maxParticles - particles.size() : 0);
+
+        particles.reserve(particles.size() + nbNew);
+
+        for (size_t i = 0; i < nbNew; ++i)
+        {
+            const float velX = randomRange(emitter.seed, emitter.minVelocity.x, emitter.maxVelocity.x);
+            const float velY = randomRange(emitter.seed, emitter.minVelocity.y, emitter.maxVelocity.y);
+            const float life = randomRange(emitter.seed, emitter.minLifetime, emitter.maxLifetime);
+
+            // A particle with no lifetime would never be drawn
+            if (life <= 0.0f)
+                continue;
+
+            particles.push(emitter.x, emitter.y, velX, velY, life);
+        }
+
+        return particles.size();
+    }
+
+    void buildParticleRenderCall(const ParticleEmitter& emitter, uint64_t materialId, const RenderStage& stage, RenderCall& call)
+    {
+        const size_t nbParticles = emitter.particles.size();
+
+        call.setVisibility(nbParticles > 0);
+
+        call.setOpacity(OpacityType::Additive);
+
+        call.setRenderStage(stage);
+
+        call.setMaterial(materialId);
+
+        call.setViewport(emitter.viewport);
+
+        call.setDepth(static_cast<int>(emitter.z));
+
+        call.data.resize(nbParticles * ParticleInstanceSize);
+
+        float *out = call.data.data();
+
+        // Each chunk writes its own range of the payload
+        parallelForChunks(nbParticles, ParticleChunkSize, [&emitter, out](size_t start, size_t end, size_t) {
+            writeParticleInstances(emitter, start, end, out + start * ParticleInstanceSize);
+        });
+    }
+
+    void ParticleSystem::init()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        Material particleMaterial;
+
+        particleMaterial.shader = masterRenderer->getShader("2DShapes");
+
+        particleMaterial.nbTextures = 0;
+
+        particleMaterial.uniformMap.emplace("sWidth", "ScreenWidth");
+        particleMaterial.uniformMap.emplace("sHeight", "ScreenHeight");
+
+        particleMaterial.setSimpleMesh({3, 2, 1, 4});
+
+        materialId = masterRenderer->registerMaterial("__particle", particleMaterial);
+    }
+
+    void ParticleSystem::execute()
+    {
+        if (elapsed <= 0.0f)
+            return;
+
+        const float dt = elapsed / 1000.0f;
+
+        elapsed = 0.0f;
+
+        const auto& emitters = view<ParticleEmitter>();
+
+        // Components of a view start at index 1
+        const size_t nbEmitters = emitters.nbComponents() > 0 ? emitters.nbComponents() - 1 : 0;
+
+        if (nbEmitters == 0 and renderCallList.empty())
+            return;
+
+        renderCallList.resize(nbEmitters);
+
+        for (size_t i = 0; i < nbEmitters; ++i)
+        {
+            auto emitter = emitters[i + 1];
+
+            simulateParticles(*emitter, dt);
+
+            const uint64_t emitterMaterial = emitter->material.empty() ? materialId : masterRenderer->getMaterialID(emitter->material);
+
+            buildParticleRenderCall(*emitter, emitterMaterial, renderStage, renderCallList[i]);
+        }
+
+        finishChanges();
+    }
+}
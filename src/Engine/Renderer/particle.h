@@ -1,51 +1,195 @@
-// #pragma once
-
-// #include <vector>
-// #include <functional>
-
-// #include "../constant.h"
-// #include "renderer.h"
-
-// //TODO create a 3D particles system -> this one can only draw 2D particles
-// namespace pg
-// {
-//     //#pragma pack(1)
-//     struct Particle
-//     {
-//         float lifetime;
-//         constant::Vector3D pos;
-//         float texOffset;
-//         float scale;
-//     };
-//     //#pragma pop
-
-//     struct ParticleSubData {};
-
-//     struct ParticleComponent : protected QOpenGLFunctions
-//     {
-//         ParticleComponent() { initializeOpenGLFunctions(); }
-        
-//         unsigned int count;
-//         unsigned int texture;
-//         std::function<void()> onTick;
-
-//         Particle *particleList = nullptr;
-//         ParticleSubData **particleSubDataList = nullptr;
-
-//         OpenGLObject openglObject;
-//         QOpenGLBuffer *instanceVBO = nullptr;
-//     };
-
-//     struct ParticleMoveSubData : public ParticleSubData 
-//     {
-//         ParticleMoveSubData(const constant::Vector3D& velocity, const std::vector<float>& textureSeq, const unsigned int& textureChangeRate) : timeAlive(0), velocity(velocity), textureSeq(textureSeq), textureChangeRate(textureChangeRate) {}
-        
-//         int timeAlive;
-//         constant::Vector3D velocity;
-//         std::vector<float> textureSeq;
-//         unsigned int textureChangeRate;
-//     };
-
-//     //TODO create a particle system that create and manage all the particle component
-
-// }
\ No newline at end of file
+#pragma once
+
+/**
+ * @file particle.h
+ * @author Pigeon Codeur
+ * @brief Definition of the particle emitters and of the system simulating and drawing their particles
+ * @version 0.1
+ * @date 2025-04-24
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <vector>
+#include <cstdint>
+
+#include "Systems/coresystems.h"
+
+#include "renderer.h"
+
+#include "constant.h"
+
+namespace pg
+{
+    /** Number of floats of a particle instance: x, y, z, width, height, rotation, r, g, b, a (same layout as the 2D shapes) */
+    static constexpr size_t ParticleInstanceSize = 10;
+
+    /**
+     * @brief The particles of an emitter, stored as one array per attribute
+     *
+     * Keeping each attribute contiguous lets the update kernels process several particles per instruction.
+     */
+    struct ParticleBuffer
+    {
+        inline size_t size() const { return x.size(); }
+
+        inline bool empty() const { return x.empty(); }
+
+        void reserve(size_t n);
+
+        void clear();
+
+        /** Add a particle at the end of the buffer */
+        void push(float posX, float posY, float velX, float velY, float life);
+
+        /**
+         * @brief Remove the particles that outlived their lifetime
+         *
+         * The last particles are moved in the holes, so the order of the particles is not kept.
+         *
+         * @return size_t The number of removed particles
+         */
+        size_t removeDead();
+
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> vx;
+        std::vector<float> vy;
+
+        /** Time since the particle was emitted, in seconds */
+        std::vector<float> age;
+
+        /** Time the particle lives, in seconds */
+        std::vector<float> lifetime;
+    };
+
+    /**
+     * @brief A source of particles
+     *
+     * Particles are not entities: they live in the buffer of their emitter and are drawn with a single instanced render call.
+     * Each particle gets a random velocity and lifetime in the ranges of the emitter,
+     * its size and color go from the start to the end values over its lifetime.
+     */
+    struct ParticleEmitter
+    {
+        ParticleEmitter() {}
+
+        /** Emit count particles at the next update, even if the emitter is not emitting */
+        inline void burst(size_t count) { pendingBurst += count; }
+
+        /** Position particles are emitted from */
+        float x = 0.0f;
+        float y = 0.0f;
+        float z = 0.0f;
+
+        /** Number of particles emitted per second */
+        float rate = 100.0f;
+
+        /** Particles are not emitted past this number */
+        size_t maxParticles = 10000;
+
+        /** Range of the lifetime of a particle, in seconds */
+        float minLifetime = 1.0f;
+        float maxLifetime = 1.0f;
+
+        /** Range of the initial velocity of a particle, in pixels per second */
+        constant::Vector2D minVelocity {-50.0f, -50.0f};
+        constant::Vector2D maxVelocity {50.0f, 50.0f};
+
+        /** Acceleration applied to all the particles, in pixels per second squared */
+        constant::Vector2D acceleration {0.0f, 0.0f};
+
+        float startSize = 4.0f;
+        float endSize = 4.0f;
+
+        constant::Vector4D startColor {255.0f, 255.0f, 255.0f, 255.0f};
+        constant::Vector4D endColor {255.0f, 255.0f, 255.0f, 0.0f};
+
+        size_t viewport = 0;
+
+        /** Name of the material drawing the particles, the default particle material is used if empty */
+        std::string material = "";
+
+        bool emitting = true;
+
+        ParticleBuffer particles;
+
+        /** Fraction of particle left over by the last update, so low rates still emit over several frames */
+        float emissionDebt = 0.0f;
+
+        size_t pendingBurst = 0;
+
+        /** State of the random generator of the emitter */
+        uint32_t seed = 0x9E3779B9;
+    };
+
+    /**
+     * @brief Move a range of particles and make them older
+     *
+     * Processes four particles at a time with SSE when available.
+     *
+     * @param particles Particles to update
+     * @param start First particle of the range
+     * @param end Last particle of the range (excluded)
+     * @param dt Elapsed time in seconds
+     * @param ax Acceleration on the x axis
+     * @param ay Acceleration on the y axis
+     */
+    void integrateParticles(ParticleBuffer& particles, size_t start, size_t end, float dt, float ax, float ay);
+
+    /**
+     * @brief Write the instance data of a range of particles
+     *
+     * @param emitter Emitter holding the particles
+     * @param start First particle of the range
+     * @param end Last particle of the range (excluded)
+     * @param out Receive ParticleInstanceSize floats per particle, starting with the particle start
+     */
+    void writeParticleInstances(const ParticleEmitter& emitter, size_t start, size_t end, float *out);
+
+    /**
+     * @brief Emit the new particles of an emitter, update the others and remove the dead ones
+     *
+     * @param emitter Emitter to update
+     * @param dt Elapsed time in seconds
+     *
+     * @return size_t The number of particles alive
+     */
+    size_t simulateParticles(ParticleEmitter& emitter, float dt);
+
+    /**
+     * @brief Fill the render call drawing all the particles of an emitter
+     *
+     * @param emitter Emitter to draw
+     * @param materialId Material of the call
+     * @param stage Render stage of the call
+     * @param call Receive the call, its payload is reused
+     */
+    void buildParticleRenderCall(const ParticleEmitter& emitter, uint64_t materialId, const RenderStage& stage, RenderCall& call);
+
+    /**
+     * @brief Simulate the particles of all the emitters and draw each emitter with a single instanced call
+     *
+     * The particles are updated and written out in parallel chunks on the job pool.
+     */
+    struct ParticleSystem : public AbstractRenderer, System<Own<ParticleEmitter>, Listener<TickEvent>, InitSys>
+    {
+        ParticleSystem(MasterRenderer* masterRenderer) : AbstractRenderer(masterRenderer, RenderStage::Render) { }
+        virtual ~ParticleSystem() { }
+
+        virtual std::string getSystemName() const override { return "Particle System"; }
+
+        virtual void init() override;
+
+        virtual void onEvent(const TickEvent& event) override { elapsed += event.tick; }
+
+        virtual void execute() override;
+
+        /** Material used by the emitters without one */
+        uint64_t materialId = 0;
+
+        /** Time accumulated since the last update, in ms */
+        float elapsed = 0.0f;
+    };
+}
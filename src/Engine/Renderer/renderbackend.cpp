@@ -0,0 +1,472 @@
+#include "stdafx.h"
+
+#include "renderbackend.h"
+
+#include "renderer.h"
+
+#include "logger.h"
+
+#include "Helpers/openglobject.h"
+
+namespace pg
+{
+    namespace
+    {
+        static constexpr const char * const DOM = "Render Backend";
+    }
+
+    unsigned int OpenGLRenderBackend::uploadTexture(const unsigned char *data, int width, int height, unsigned int oldId)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        unsigned int texture;
+
+        if (oldId)
+        {
+            texture = oldId;
+        }
+        else
+        {
+            glGenTextures(1, &texture);
+        }
+
+        glBindTexture(GL_TEXTURE_2D, texture);
+        // set the texture wrapping parameters
+        //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+// #ifdef __EMSCRIPTEN__
+//         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+//         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+//         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+//         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+// #else
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+        // set texture filtering parameters
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        // load image, create texture and generate mipmaps
+// #endif
+
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+
+        // Todo this doesn't work properly with fully solid textures
+        // if (nrChannels == 4)
+        // {
+        //     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        //     tex.transparent = true;
+        // }
+        // else
+        // {
+        //     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+        //     tex.transparent = false;
+        // }
+
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        return texture;
+    }
+
+    void OpenGLRenderBackend::useProgram(size_t, const Material& material)
+    {
+        material.shader->bind();
+
+        boundProgram = material.shader;
+    }
+
+    void OpenGLRenderBackend::releaseProgram()
+    {
+        if (boundProgram)
+        {
+            boundProgram->release();
+            boundProgram = nullptr;
+        }
+    }
+
+    void OpenGLRenderBackend::setState(const OpenGLState& state, const OpenGLState& previous, int screenHeight)
+    {
+        if (previous.scissorEnabled != state.scissorEnabled)
+        {
+            if (state.scissorEnabled)
+            {
+                glEnable(GL_SCISSOR_TEST);
+            }
+            else
+            {
+                glDisable(GL_SCISSOR_TEST);
+            }
+        }
+
+        if (previous.scissorBound != state.scissorBound)
+        {
+            //glScissor defined the box from the bottom left corner (x, y, w, h);
+            glScissor(state.scissorBound.x, (screenHeight - state.scissorBound.w) - state.scissorBound.y, state.scissorBound.z, state.scissorBound.w);
+        }
+    }
+
+    void OpenGLRenderBackend::setDepthMode(DepthMode mode)
+    {
+        // Higher depths are drawn on top, and the depth buffer is cleared to 0, so the nearest fragment has the greatest depth
+        switch (mode)
+        {
+            case DepthMode::Disabled:
+                glDisable(GL_DEPTH_TEST);
+                // The mask also applies to glClear, it must be left writable for the clear of the next frame
+                glDepthMask(GL_TRUE);
+                break;
+
+            case DepthMode::TestAndWrite:
+                glEnable(GL_DEPTH_TEST);
+                glDepthFunc(GL_GEQUAL);
+                glDepthMask(GL_TRUE);
+                break;
+
+            case DepthMode::TestOnly:
+                glEnable(GL_DEPTH_TEST);
+                glDepthFunc(GL_GEQUAL);
+                glDepthMask(GL_FALSE);
+                break;
+        }
+    }
+
+    void OpenGLRenderBackend::clearDepth()
+    {
+        // The depth mask must be writable for the clear to go through
+        glDepthMask(GL_TRUE);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    void OpenGLRenderBackend::bindTexture(size_t unit, unsigned int textureId)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, textureId);
+    }
+
+    void OpenGLRenderBackend::setUniforms(const Material& material, const constant::RefracTable& rTable)
+    {
+        auto shaderProgram = material.shader;
+
+        const auto& uniforms = material.uniforms;
+
+        for (size_t i = 0; i < material.nbTextures and i < 16; ++i)
+        {
+            shaderProgram->setUniformAt(uniforms.textures[i], static_cast<int>(i));
+        }
+
+        // Uniform writes are filtered by the shader, values that didn't change since the last draw are not sent again
+        for (const auto& uniform : uniforms.values)
+        {
+            const auto index = uniform.first;
+            const auto& value = uniform.second;
+
+            if (index < 0)
+                continue;
+
+            switch (value.type)
+            {
+                case UniformType::INT:
+                    shaderProgram->setUniformAt(index, std::get<int>(value.value));
+                    break;
+                case UniformType::FLOAT:
+                    shaderProgram->setUniformAt(index, std::get<float>(value.value));
+                    break;
+                case UniformType::VEC2D:
+                    shaderProgram->setUniformAt(index, std::get<glm::vec2>(value.value));
+                    break;
+                case UniformType::VEC3D:
+                    shaderProgram->setUniformAt(index, std::get<glm::vec3>(value.value));
+                    break;
+                case UniformType::VEC4D:
+                    shaderProgram->setUniformAt(index, std::get<glm::vec4>(value.value));
+                    break;
+                case UniformType::MAT4D:
+                    shaderProgram->setUniformAt(index, std::get<glm::mat4>(value.value));
+                    break;
+                case UniformType::ID:
+                {
+                    const std::string& id = std::get<std::string>(value.value);
+
+                    const auto& param = rTable.at(id);
+
+                    switch(param.type)
+                    {
+                        case ElementType::UnionType::FLOAT:
+                            shaderProgram->setUniformAt(index, param.get<float>());
+                            break;
+                        case ElementType::UnionType::INT:
+                        case ElementType::UnionType::SIZE_T:
+                            shaderProgram->setUniformAt(index, param.get<int>());
+                            break;
+                        case ElementType::UnionType::BOOL:
+                            shaderProgram->setUniformAt(index, static_cast<int>(param.get<bool>()));
+                            break;
+                        case ElementType::UnionType::STRING:
+                        default:
+                        {
+                            LOG_ERROR(DOM, "Cannot set uniform for id:" << id << ", Unsupported type :" << param.getTypeString());
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void OpenGLRenderBackend::bindCamera(const Material& material, CameraUniformBuffer& cameras, size_t viewport)
+    {
+        auto shaderProgram = material.shader;
+
+        // Camera matrices are computed once per frame, draws only select the block of their viewport
+        if (shaderProgram->usesCameraBlock())
+        {
+            cameras.bind(viewport);
+        }
+        else
+        {
+            const auto& uniforms = material.uniforms;
+            const auto& block = cameras.getBlock(viewport);
+
+            shaderProgram->setUniformAt(uniforms.projection, block.projection);
+            shaderProgram->setUniformAt(uniforms.model, block.model);
+            shaderProgram->setUniformAt(uniforms.scale, block.scale);
+            shaderProgram->setUniformAt(uniforms.view, block.view);
+        }
+    }
+
+    DrawResult OpenGLRenderBackend::draw(const RenderCall& call, const Material& material)
+    {
+        DrawResult result;
+
+        if (not call.mesh)
+        {
+            LOG_ERROR(DOM, "Mesh not set for render call with key: " << call.key);
+            return result;
+        }
+
+        // Todo initialize material in another call !
+        if (not call.mesh->initialized)
+        {
+            LOG_MILE(DOM, "Generating mesh");
+            call.mesh->generateMesh();
+        }
+
+        call.mesh->bind();
+
+        if (call.slotBuffer)
+        {
+            // Persistent instance buffers only send the slots that changed since the last frame
+            size_t nbInstances = call.slotBuffer->upload();
+
+            result.nbBytes = call.slotBuffer->getLastUploadSize();
+
+            if (nbInstances > 0 and not call.mesh->setInstanceSource(call.slotBuffer->getBufferId(), 0, call.slotBuffer->getVersion()))
+            {
+                std::vector<float> instances;
+
+                nbInstances = call.slotBuffer->copyData(instances);
+
+                call.mesh->openGLMesh.instanceVBO->allocate(instances.data(), instances.size() * sizeof(float));
+
+                result.nbBytes += instances.size() * sizeof(float);
+            }
+
+            if (nbInstances > 0)
+                glDrawElementsInstanced(GL_TRIANGLES, call.mesh->modelInfo.nbIndices, GL_UNSIGNED_INT, 0, nbInstances);
+
+            result.nbInstances = nbInstances;
+
+            return result;
+        }
+
+        const size_t dataSize = call.data.size() * sizeof(float);
+        const size_t stride = material.nbAttributes * sizeof(float);
+        size_t offset = 0;
+
+        bool drawn = false;
+
+        if (instanceBuffer.write(call.data.data(), dataSize, stride, offset))
+        {
+            const auto bufferId = instanceBuffer.getBufferId();
+            const auto version = instanceBuffer.getVersion();
+
+#ifndef __EMSCRIPTEN__
+            // With base instances, the attributes of the mesh stay on the start of the ring and never need to be respecified
+            if (instanceBuffer.supportsBaseInstance() and call.mesh->setInstanceSource(bufferId, 0, version))
+            {
+                glDrawElementsInstancedBaseInstance(GL_TRIANGLES, call.mesh->modelInfo.nbIndices, GL_UNSIGNED_INT, 0, call.nbElements, offset / stride);
+                drawn = true;
+            }
+            else
+#endif
+            if (call.mesh->setInstanceSource(bufferId, offset, version))
+            {
+                glDrawElementsInstanced(GL_TRIANGLES, call.mesh->modelInfo.nbIndices, GL_UNSIGNED_INT, 0, call.nbElements);
+                drawn = true;
+            }
+        }
+
+        // Fallback when the ring is full or the mesh doesn't support external instance buffers
+        if (not drawn)
+        {
+            call.mesh->setInstanceSource(call.mesh->openGLMesh.instanceVBO->bufferId(), 0);
+
+            call.mesh->openGLMesh.instanceVBO->allocate(call.data.data(), dataSize);
+
+            glDrawElementsInstanced(GL_TRIANGLES, call.mesh->modelInfo.nbIndices, GL_UNSIGNED_INT, 0, call.nbElements);
+        }
+
+        result.nbInstances = call.nbElements;
+        result.nbBytes = dataSize;
+
+        return result;
+    }
+
+    void OpenGLRenderBackend::beginStage(size_t stage)
+    {
+        if (not measuringStages)
+        {
+            stageTimer.beginFrame();
+
+            measuringStages = true;
+        }
+
+        stageTimer.beginStage(stage);
+    }
+
+    void OpenGLRenderBackend::endStages()
+    {
+        if (not measuringStages)
+            return;
+
+        stageTimer.endFrame();
+
+        measuringStages = false;
+    }
+
+    void NullRenderBackend::beginFrame()
+    {
+        commands.clear();
+
+        boundViewport = static_cast<size_t>(-1);
+
+        stats.nbFrames++;
+    }
+
+    unsigned int NullRenderBackend::uploadTexture(const unsigned char *, int width, int height, unsigned int oldId)
+    {
+        stats.nbTextureUploads++;
+        stats.nbTextureBytes += static_cast<size_t>(width) * height * 4;
+
+        return oldId ? oldId : nextTextureId++;
+    }
+
+    void NullRenderBackend::record(const RenderCommand& command)
+    {
+        if (recordCommands)
+            commands.push_back(command);
+    }
+
+    void NullRenderBackend::useProgram(size_t materialId, const Material&)
+    {
+        stats.nbProgramBinds++;
+
+        RenderCommand command;
+        command.type = RenderCommand::Type::UseProgram;
+        command.materialId = materialId;
+
+        record(command);
+    }
+
+    void NullRenderBackend::setState(const OpenGLState&, const OpenGLState&, int)
+    {
+        stats.nbStateChanges++;
+
+        RenderCommand command;
+        command.type = RenderCommand::Type::SetState;
+
+        record(command);
+    }
+
+    void NullRenderBackend::setDepthMode(DepthMode mode)
+    {
+        stats.nbStateChanges++;
+
+        RenderCommand command;
+        command.type = RenderCommand::Type::SetDepth;
+        command.slot = static_cast<size_t>(mode);
+
+        record(command);
+    }
+
+    void NullRenderBackend::clearDepth()
+    {
+        stats.nbStateChanges++;
+
+        RenderCommand command;
+        command.type = RenderCommand::Type::ClearDepth;
+
+        record(command);
+    }
+
+    void NullRenderBackend::bindTexture(size_t unit, unsigned int textureId)
+    {
+        stats.nbTextureBinds++;
+
+        RenderCommand command;
+        command.type = RenderCommand::Type::BindTexture;
+        command.slot = unit;
+        command.textureId = textureId;
+
+        record(command);
+    }
+
+    void NullRenderBackend::setUniforms(const Material& material, const constant::RefracTable&)
+    {
+        stats.nbUniformUpdates += material.uniforms.values.size();
+    }
+
+    void NullRenderBackend::bindCamera(const Material&, CameraUniformBuffer&, size_t viewport)
+    {
+        if (viewport == boundViewport)
+            return;
+
+        boundViewport = viewport;
+
+        RenderCommand command;
+        command.type = RenderCommand::Type::BindCamera;
+        command.slot = viewport;
+
+        record(command);
+    }
+
+    DrawResult NullRenderBackend::draw(const RenderCall& call, const Material&)
+    {
+        RenderCommand command;
+        command.type = RenderCommand::Type::Draw;
+        command.materialId = call.getMaterialId();
+
+        if (call.slotBuffer)
+        {
+            // Only the slots written since the last frame would be sent
+            command.nbInstances = call.slotBuffer->size();
+            command.nbBytes = call.slotBuffer->discardDirtySlots() * call.slotBuffer->getStride() * sizeof(float);
+        }
+        else
+        {
+            command.nbInstances = call.nbElements;
+            command.nbBytes = call.data.size() * sizeof(float);
+        }
+
+        if (command.nbInstances == 0)
+            return DrawResult{};
+
+        stats.nbDrawCalls++;
+        stats.nbInstances += command.nbInstances;
+        stats.nbUploadedBytes += command.nbBytes;
+
+        record(command);
+
+        return DrawResult{command.nbInstances, command.nbBytes};
+    }
+}
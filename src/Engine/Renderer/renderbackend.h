@@ -0,0 +1,286 @@
+#pragma once
+
+/**
+ * @file renderbackend.h
+ * @author Pigeon Codeur
+ * @brief Definition of the backends executing the draw stream of the master renderer (OpenGL and headless)
+ * @version 0.1
+ * @date 2025-04-12
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <vector>
+#include <cstdint>
+
+#include "constant.h"
+
+#include "instancebuffer.h"
+#include "renderstats.h"
+
+namespace pg
+{
+    struct RenderCall;
+    struct Material;
+    struct OpenGLState;
+    class CameraUniformBuffer;
+    class OpenGLShaderProgram;
+
+    /** How the draws use the depth buffer */
+    enum class DepthMode : uint8_t
+    {
+        /** No depth test, the draws are only ordered by the sort */
+        Disabled,
+        /** Opaque draws: keep the nearest fragment and write its depth */
+        TestAndWrite,
+        /** Transparent draws: hidden behind opaque geometry but don't hide anything themselves */
+        TestOnly
+    };
+
+    /** What a backend sent to the gpu to draw a render call */
+    struct DrawResult
+    {
+        /** Number of instances drawn, 0 if nothing was drawn */
+        size_t nbInstances = 0;
+
+        /** Number of instance bytes uploaded for the draw */
+        size_t nbBytes = 0;
+    };
+
+    /**
+     * @brief Interface of the commands issued by the master renderer while rendering a frame
+     *
+     * The master renderer already filters redundant program, state and texture changes,
+     * so a backend receives the exact stream that reaches the gpu.
+     */
+    class RenderBackend
+    {
+    public:
+        virtual ~RenderBackend() {}
+
+        /** Headless backends don't need a GL context, so materials without shaders or meshes can still be drawn */
+        virtual bool isHeadless() const { return false; }
+
+        virtual void beginFrame() {}
+
+        virtual void endFrame() {}
+
+        /**
+         * @brief Create or fill a texture with RGBA pixels
+         *
+         * @param oldId Id of the texture to reuse, 0 to create a new one
+         *
+         * @return unsigned int The id of the texture
+         */
+        virtual unsigned int uploadTexture(const unsigned char *data, int width, int height, unsigned int oldId) = 0;
+
+        /** Bind the shader of a material */
+        virtual void useProgram(size_t materialId, const Material& material) = 0;
+
+        /** Unbind the current program at the end of the frame */
+        virtual void releaseProgram() = 0;
+
+        /**
+         * @brief Apply the scissor state of a render call
+         *
+         * @param state New state
+         * @param previous State applied before
+         * @param screenHeight Height of the screen, as GL scissors start from the bottom left corner
+         */
+        virtual void setState(const OpenGLState& state, const OpenGLState& previous, int screenHeight) = 0;
+
+        /** Change how the following draws use the depth buffer */
+        virtual void setDepthMode(DepthMode mode) = 0;
+
+        /** Reset the depth buffer, so the opaque draws of a viewport don't hide the ones of the next viewport */
+        virtual void clearDepth() = 0;
+
+        virtual void bindTexture(size_t unit, unsigned int textureId) = 0;
+
+        /** Send the uniforms of a material, values of the renderer table are resolved with rTable */
+        virtual void setUniforms(const Material& material, const constant::RefracTable& rTable) = 0;
+
+        /** Select the camera block of a viewport */
+        virtual void bindCamera(const Material& material, CameraUniformBuffer& cameras, size_t viewport) = 0;
+
+        /** Upload the instances of a render call and draw them */
+        virtual DrawResult draw(const RenderCall& call, const Material& material) = 0;
+
+        /** Start measuring the gpu time of a render stage, ending the measure of the previous one */
+        virtual void beginStage(size_t) {}
+
+        /** End the measure of the last stage of the frame */
+        virtual void endStages() {}
+
+        /**
+         * @brief Read back the gpu time of the render stages
+         *
+         * @param times Receive the time of each stage in microseconds (NbTimedRenderStages values)
+         *
+         * @return true If a new measure was available
+         */
+        virtual bool readStageTimes(double *) { return false; }
+    };
+
+    /** Backend issuing the commands to OpenGL */
+    class OpenGLRenderBackend : public RenderBackend
+    {
+    public:
+        virtual void beginFrame() override { instanceBuffer.beginFrame(); }
+
+        virtual void endFrame() override { instanceBuffer.endFrame(); }
+
+        virtual unsigned int uploadTexture(const unsigned char *data, int width, int height, unsigned int oldId) override;
+
+        virtual void useProgram(size_t materialId, const Material& material) override;
+
+        virtual void releaseProgram() override;
+
+        virtual void setState(const OpenGLState& state, const OpenGLState& previous, int screenHeight) override;
+
+        virtual void setDepthMode(DepthMode mode) override;
+
+        virtual void clearDepth() override;
+
+        virtual void bindTexture(size_t unit, unsigned int textureId) override;
+
+        virtual void setUniforms(const Material& material, const constant::RefracTable& rTable) override;
+
+        virtual void bindCamera(const Material& material, CameraUniformBuffer& cameras, size_t viewport) override;
+
+        virtual DrawResult draw(const RenderCall& call, const Material& material) override;
+
+        virtual void beginStage(size_t stage) override;
+
+        virtual void endStages() override;
+
+        virtual bool readStageTimes(double *times) override { return stageTimer.collect(times); }
+
+        inline const InstanceRingBuffer& getInstanceBuffer() const { return instanceBuffer; }
+
+    private:
+        /** Ring buffer shared by the instances of every render call of a frame */
+        InstanceRingBuffer instanceBuffer;
+
+        /** Timer queries of the render stages, only issued when the master renderer asks for them */
+        GpuStageTimer stageTimer;
+
+        /** A stage was measured during the current frame */
+        bool measuringStages = false;
+
+        /** Program bound by the last useProgram, released at the end of the frame */
+        OpenGLShaderProgram *boundProgram = nullptr;
+    };
+
+    /** A command received by a null render backend */
+    struct RenderCommand
+    {
+        enum class Type : uint8_t
+        {
+            UseProgram,
+            SetState,
+            SetDepth,
+            ClearDepth,
+            BindTexture,
+            BindCamera,
+            Draw,
+        };
+
+        Type type;
+
+        /** Material of the program or of the draw */
+        size_t materialId = 0;
+
+        /** Texture unit of a texture bind, viewport of a camera bind, depth mode of a depth change */
+        size_t slot = 0;
+
+        /** Id of the bound texture */
+        unsigned int textureId = 0;
+
+        size_t nbInstances = 0;
+
+        /** Number of instance bytes sent for a draw */
+        size_t nbBytes = 0;
+    };
+
+    /** Counters accumulated by a null render backend */
+    struct NullBackendStats
+    {
+        size_t nbFrames = 0;
+        size_t nbDrawCalls = 0;
+        size_t nbInstances = 0;
+        size_t nbUploadedBytes = 0;
+        size_t nbProgramBinds = 0;
+        size_t nbStateChanges = 0;
+        size_t nbTextureBinds = 0;
+        size_t nbUniformUpdates = 0;
+        size_t nbTextureUploads = 0;
+        size_t nbTextureBytes = 0;
+    };
+
+    /**
+     * @brief A backend recording the commands instead of issuing them to a gpu
+     *
+     * It lets the whole render pipeline run without a GL context, for load testing on machines without a gpu,
+     * and lets tests assert on the exact draw stream of a frame.
+     *
+     * The commands of the current frame are kept until the next beginFrame, the counters accumulate until reset.
+     */
+    class NullRenderBackend : public RenderBackend
+    {
+    public:
+        /**
+         * @brief Construct a new Null Render Backend object
+         *
+         * @param recordCommands Keep the command stream of each frame, disable it to only count when load testing
+         */
+        NullRenderBackend(bool recordCommands = true) : recordCommands(recordCommands) {}
+
+        virtual bool isHeadless() const override { return true; }
+
+        virtual void beginFrame() override;
+
+        virtual unsigned int uploadTexture(const unsigned char *data, int width, int height, unsigned int oldId) override;
+
+        virtual void useProgram(size_t materialId, const Material& material) override;
+
+        virtual void releaseProgram() override {}
+
+        virtual void setState(const OpenGLState& state, const OpenGLState& previous, int screenHeight) override;
+
+        virtual void setDepthMode(DepthMode mode) override;
+
+        virtual void clearDepth() override;
+
+        virtual void bindTexture(size_t unit, unsigned int textureId) override;
+
+        virtual void setUniforms(const Material& material, const constant::RefracTable& rTable) override;
+
+        virtual void bindCamera(const Material& material, CameraUniformBuffer& cameras, size_t viewport) override;
+
+        virtual DrawResult draw(const RenderCall& call, const Material& material) override;
+
+        /** Get the commands received since the start of the frame */
+        inline const std::vector<RenderCommand>& getCommands() const { return commands; }
+
+        inline const NullBackendStats& getStats() const { return stats; }
+
+        inline void resetStats() { stats = NullBackendStats{}; }
+
+    private:
+        void record(const RenderCommand& command);
+
+        bool recordCommands;
+
+        std::vector<RenderCommand> commands;
+
+        NullBackendStats stats;
+
+        /** Viewport of the last camera bind, the camera buffer only rebinds when it changes */
+        size_t boundViewport = static_cast<size_t>(-1);
+
+        /** Fake texture ids handed out by uploadTexture */
+        unsigned int nextTextureId = 1;
+    };
+}
@@ -4,7 +4,9 @@
 #define STB_IMAGE_IMPLEMENTATION
 
 #include "renderer.h"
+#include "renderqueue.h"
 
+#include <chrono>
 #include <filesystem>
 namespace fs = std::filesystem;
 
@@ -12,6 +14,8 @@ namespace fs = std::filesystem;
 
 #include "Helpers/openglobject.h"
 
+#include "Memory/parallelfor.h"
+
 #include "Loaders/stb_image.h"
 
 #include "UI/uisystem.h"
@@ -92,6 +96,32 @@ namespace pg
         setDepth(component->z);
     }
 
+    void Material::resolveUniforms()
+    {
+        uniforms = MaterialUniforms{};
+
+        uniforms.values.reserve(uniformMap.size());
+
+        // Unresolved uniforms keep an index of -1 and are skipped when rendering
+        for (const auto& uniform : uniformMap)
+        {
+            uniforms.values.emplace_back(shader ? shader->getUniformIndex(uniform.first) : -1, uniform.second);
+        }
+
+        if (not shader)
+            return;
+
+        for (size_t i = 0; i < nbTextures and i < 16; ++i)
+        {
+            uniforms.textures[i] = shader->getUniformIndex("texture" + std::to_string(i));
+        }
+
+        uniforms.projection = shader->getUniformIndex("projection");
+        uniforms.model = shader->getUniformIndex("model");
+        uniforms.scale = shader->getUniformIndex("scale");
+        uniforms.view = shader->getUniformIndex("view");
+    }
+
     BaseAbstractRenderer::BaseAbstractRenderer(MasterRenderer *masterRenderer, const RenderStage& stage) : masterRenderer(masterRenderer), renderStage(stage)
     {
         LOG_THIS_MEMBER("Base Abstract Renderer");
@@ -103,6 +133,8 @@ namespace pg
     {
         LOG_THIS_MEMBER(DOM);
 
+        textureDecoder.setCache(&textureCache);
+
         if (noneTexturePath != "")
         {
             registerTexture("NoneIcon", noneTexturePath.c_str());
@@ -143,61 +175,296 @@ namespace pg
         // }
     }
 
-    void MasterRenderer::execute()
+    namespace
     {
-        // Todo Fix in group and ecs ! ( whereaver we are holding pointer of a comp actually ! )
-        // Todo hold a ref to the component list and the component index inside of this list instead of the raw pointer to not get invalidated on resize !
+        /**
+         * @brief Add a render call to a sorted list of batches
+         *
+         * @param batches Output list of batches
+         * @param runStart Index of the first batch sharing the key of the call
+         * @param rc Render call to add
+         *
+         * The call is merged in the first batch of the run it can be batched with, or appended as a new batch
+         */
+        template <typename Call>
+        void batchRenderCall(std::vector<RenderCall>& batches, size_t runStart, Call&& rc)
+        {
+            if (rc.batchable)
+            {
+                for (size_t i = runStart; i < batches.size(); ++i)
+                {
+                    auto& call = batches[i];
+
+                    if (call.batchable and call.state == rc.state)
+                    {
+                        call.data.insert(call.data.end(), rc.data.begin(), rc.data.end());
+                        return;
+                    }
+                }
+            }
 
-        // inSwap = true;
+            batches.emplace_back(std::forward<Call>(rc));
+        }
 
-        // {
-        //     std::unique_lock lk(renderMutex);
-        //     execCv.notify_all();
+        /**
+         * @brief Merge lists of sorted batches into a single sorted list
+         *
+         * @param lists Lists to merge, sorted by sort key, batches sharing a key keep the order of their lists
+         * @param merged Output list
+         *
+         * Batches of non const lists are moved out of them instead of being copied
+         */
+        template <typename List>
+        void spliceBatches(const std::vector<List*>& lists, std::vector<RenderCall>& merged)
+        {
+            const size_t nbLists = lists.size();
 
-        //     renderCv.wait(lk, [this]{ return inBetweenRender.load();});
-        // }
+            size_t nbBatches = 0;
 
-        // for (auto renderer : renderers)
-        // {
-        //     renderer->updateMeshes();
-        // }
+            for (const auto list : lists)
+            {
+                nbBatches += list->size();
+            }
+
+            merged.reserve(merged.size() + nbBatches);
 
-        if (inSwap)
+            // Read position in each list, they are all already sorted
+            std::vector<size_t> cursors(nbLists, 0);
+
+            size_t runStart = 0;
+            uint64_t runKey = 0;
+
+            while (true)
+            {
+                // Pick the list with the lowest next key, ties go to the first list to keep the submission order
+                size_t next = nbLists;
+
+                for (size_t i = 0; i < nbLists; ++i)
+                {
+                    if (cursors[i] >= lists[i]->size())
+                        continue;
+
+                    if (next == nbLists or (*lists[i])[cursors[i]].getSortKey() < (*lists[next])[cursors[next]].getSortKey())
+                        next = i;
+                }
+
+                if (next == nbLists)
+                    break;
+
+                auto& batch = (*lists[next])[cursors[next]++];
+
+                if (merged.empty() or batch.key != runKey)
+                {
+                    runStart = merged.size();
+                    runKey = batch.key;
+                }
+
+                // Batches of different lists sharing a key can still be drawn together
+                if constexpr (std::is_const_v<List>)
+                    batchRenderCall(merged, runStart, batch);
+                else
+                    batchRenderCall(merged, runStart, std::move(batch));
+            }
+        }
+    }
+
+    bool MasterRenderer::updateCullRects()
+    {
+        // 3 bits of the key are used by the viewport
+        constexpr size_t nbViewports = 8;
+
+        std::vector<std::pair<bool, CullRect>> rects(nbViewports, {false, CullRect{}});
+
+        if (cullingEnabled)
         {
-            return;
+            const auto& rTable = getParameter();
+            const float screenWidth = rTable.at("ScreenWidth").get<int>();
+            const float screenHeight = rTable.at("ScreenHeight").get<int>();
+
+            for (size_t viewport = 0; viewport < nbViewports; ++viewport)
+            {
+                // Unknown viewports are drawn with an identity view
+                glm::mat4 view = glm::mat4(1.0f);
+
+                if (viewport == 0)
+                {
+                    view = camera.getViewMatrix();
+                }
+                else if (viewport - 1 < cameraList.size())
+                {
+                    const auto *camera2D = cameraList[viewport - 1];
+
+                    if (camera2D->width <= 0.0f or camera2D->height <= 0.0f)
+                        continue;
+
+                    // The render thread may not have rebuilt the matrices of a moved camera yet
+                    view = camera2D->computeViewMatrix();
+                }
+
+                rects[viewport].first = computeCullRect(view, screenWidth, screenHeight, rects[viewport].second);
+            }
         }
 
-        if (newMaterialRegistered)
+        if (rects == viewportCullRects)
+            return false;
+
+        viewportCullRects.swap(rects);
+
+        return true;
+    }
+
+    MasterRenderer::CullResult MasterRenderer::cullRenderCall(const RenderCall& rc, RendererCulling& culling, std::vector<float>& visible) const
+    {
+        // Persistent instance buffers are drawn as a whole, or culled as a whole when they know the area they cover
+        if (rc.slotBuffer)
         {
-            return;
+            CullRect bounds;
+
+            if (not rc.slotBuffer->getBounds(bounds))
+                return CullResult::Visible;
+
+            culling.cullable = true;
+
+            const auto viewport = rc.getViewport();
+
+            if (viewport >= viewportCullRects.size() or not viewportCullRects[viewport].first)
+                return CullResult::Visible;
+
+            if (bounds.intersects(viewportCullRects[viewport].second))
+                return CullResult::Visible;
+
+            culling.nbCulled += rc.slotBuffer->size();
+
+            return CullResult::Hidden;
         }
 
-        if (materialRegisterQueue.size() > 0)
+        if (rc.data.empty())
+            return CullResult::Visible;
+
+        const auto materialId = rc.getMaterialId();
+
+        if (materialId >= materials.size())
+            return CullResult::Visible;
+
+        const auto& material = materials[materialId];
+
+        const size_t stride = material.nbAttributes;
+
+        if (not material.cullable or stride < (material.rotatedElements ? 6u : 5u))
+            return CullResult::Visible;
+
+        culling.cullable = true;
+
+        const auto viewport = rc.getViewport();
+
+        if (viewport >= viewportCullRects.size() or not viewportCullRects[viewport].first)
+            return CullResult::Visible;
+
+        const auto& rect = viewportCullRects[viewport].second;
+
+        const size_t nbInstances = rc.data.size() / stride;
+        const size_t nbVisible = countVisibleQuads(rc.data.data(), nbInstances, stride, rect, material.rotatedElements);
+
+        if (nbVisible == nbInstances)
+            return CullResult::Visible;
+
+        culling.nbCulled += nbInstances - nbVisible;
+
+        if (nbVisible == 0)
+            return CullResult::Hidden;
+
+        copyVisibleQuads(rc.data.data(), nbInstances, stride, rect, material.rotatedElements, visible);
+
+        return CullResult::Partial;
+    }
+
+    void MasterRenderer::mergeRendererCalls(const RenderCall *calls, size_t nbCalls, std::vector<RenderCall>& batches, RendererCulling& culling)
+    {
+        batches.clear();
+
+        culling = RendererCulling{};
+
+        // The queue only lives during this function, so it is built on the frame allocator of the ecs
+        RenderQueue queue(ecsRef ? &ecsRef->getFrameAllocator() : nullptr);
+
+        queue.reserve(nbCalls);
+
+        for (const RenderCall *it = calls; it != calls + nbCalls; ++it)
+        {
+            const auto& rc = *it;
+
+            // Invisible render calls are never processed so there is no need to sort them
+            if (rc.key > (static_cast<uint64_t>(1) << 63))
+                continue;
+
+            // Opaque calls are ordered by material then front to back, transparent ones back to front
+            queue.push(rc.getSortKey(), &rc);
+        }
+
+        queue.sort();
+
+        batches.reserve(queue.size());
+
+        // Calls can only be batched with calls sharing the same key, and the sort put all of them next to each other
+        size_t runStart = 0;
+        uint64_t runKey = 0;
+
+        std::vector<float> visible;
+
+        for (const auto& entry : queue)
         {
-            materialListTemp.clear();
-            materialDictTemp.clear();
+            // Culling happens before batching, so instances outside of their viewport are never copied nor uploaded
+            const auto result = cullRenderCall(*entry.call, culling, visible);
 
-            materialListTemp = materialList;
-            materialDictTemp = materialDict;
+            if (result == CullResult::Hidden)
+                continue;
 
-            for (const auto& holder : materialRegisterQueue)
+            if (batches.empty() or entry.key != runKey)
             {
-                LOG_MILE(DOM, "Registering material");
-                materialListTemp.push_back(holder.material);
+                runStart = batches.size();
+                runKey = entry.key;
+            }
 
-                if (holder.materialName != "")
-                    materialDictTemp[holder.materialName] = nbMaterials;
+            if (result == CullResult::Partial)
+            {
+                RenderCall partial(*entry.call);
+
+                partial.data = visible;
 
-                nbMaterials++;
+                batchRenderCall(batches, runStart, partial);
             }
+            else
+            {
+                batchRenderCall(batches, runStart, *entry.call);
+            }
+        }
+    }
 
-            newMaterialRegistered = true;
+    void MasterRenderer::spliceRendererBatches(std::vector<RenderCall>& merged)
+    {
+        const size_t nbRenderers = std::min(renderers.size(), rendererBatches.size());
 
-            materialRegisterQueue.clear();
+        std::vector<const std::vector<RenderCall>*> lists;
+        lists.reserve(nbRenderers);
 
-            return;
+        for (size_t i = 0; i < nbRenderers; ++i)
+        {
+            lists.push_back(&rendererBatches[i]);
         }
 
+        spliceBatches(lists, merged);
+    }
+
+    void MasterRenderer::execute()
+    {
+        // Todo Fix in group and ecs ! ( whereaver we are holding pointer of a comp actually ! )
+        // Todo hold a ref to the component list and the component index inside of this list instead of the raw pointer to not get invalidated on resize !
+
+        // for (auto renderer : renderers)
+        // {
+        //     renderer->updateMeshes();
+        // }
+
         if (cameraRegisterQueue.size() > 0)
         {
             processCameraRegister();
@@ -210,19 +477,102 @@ namespace pg
             return;
         }
 
-        auto tempRenderList = currentRenderList == 0 ? 1 : 0;
-
         // auto start = std::chrono::steady_clock::now();
 
-        renderCallList[tempRenderList].clear();
+        if (rendererBatches.size() < renderers.size())
+        {
+            rendererBatches.resize(renderers.size());
+            rendererCulling.resize(renderers.size());
+        }
 
         bool isDirty = false;
 
-        for (auto renderer : renderers)
+        const bool cullRectsChanged = updateCullRects();
+
+        mergeJobs.clear();
+
+        // Only the renderers that changed since the last pass, or that hold culled calls of a moved viewport, are sorted and merged again
+        for (size_t i = 0; i < renderers.size(); ++i)
         {
-            isDirty |= renderer->isDirty();
+            auto renderer = renderers[i];
+
+            if (not renderer->isDirty() and not (cullRectsChanged and rendererCulling[i].cullable))
+                continue;
+
+            const size_t nbCalls = renderer->getRenderCalls().size();
+
+            // Large renderers are split in chunks merged on their own, the sorted chunks are spliced back afterward
+            size_t nbChunks;
+
+            if (mergeChunkSize == 0)
+                nbChunks = std::min(nbCalls / MinMergeChunkSize, JobPool::get().getNbThreads());
+            else
+                nbChunks = nbCalls / mergeChunkSize;
+
+            nbChunks = std::max(nbChunks, static_cast<size_t>(1));
+
+            for (size_t chunk = 0; chunk < nbChunks; ++chunk)
+            {
+                mergeJobs.push_back(MergeJob{i, nbCalls * chunk / nbChunks, nbCalls * (chunk + 1) / nbChunks});
+            }
 
             renderer->setDirty(false);
+
+            isDirty = true;
+        }
+
+        if (mergeJobBatches.size() < mergeJobs.size())
+        {
+            mergeJobBatches.resize(mergeJobs.size());
+            mergeJobCulling.resize(mergeJobs.size());
+        }
+
+        // Each job writes in its own buffers, so all the renderers and chunks are merged at the same time
+        JobPool::get().run(mergeJobs.size(), [this](size_t job, size_t) {
+            const auto& mergeJob = mergeJobs[job];
+            const auto& calls = renderers[mergeJob.renderer]->getRenderCalls();
+
+            mergeRendererCalls(calls.data() + mergeJob.start, mergeJob.end - mergeJob.start, mergeJobBatches[job], mergeJobCulling[job]);
+        });
+
+        for (size_t job = 0; job < mergeJobs.size();)
+        {
+            const size_t renderer = mergeJobs[job].renderer;
+
+            size_t last = job + 1;
+
+            while (last < mergeJobs.size() and mergeJobs[last].renderer == renderer)
+                ++last;
+
+            if (last - job == 1)
+            {
+                // Swapped so the buffer of the job keeps the storage of the old batches for the next merge
+                rendererBatches[renderer].swap(mergeJobBatches[job]);
+                rendererCulling[renderer] = mergeJobCulling[job];
+            }
+            else
+            {
+                auto& culling = rendererCulling[renderer];
+
+                culling = RendererCulling{};
+
+                std::vector<std::vector<RenderCall>*> chunks;
+                chunks.reserve(last - job);
+
+                for (size_t i = job; i < last; ++i)
+                {
+                    chunks.push_back(&mergeJobBatches[i]);
+
+                    culling.cullable |= mergeJobCulling[i].cullable;
+                    culling.nbCulled += mergeJobCulling[i].nbCulled;
+                }
+
+                rendererBatches[renderer].clear();
+
+                spliceBatches(chunks, rendererBatches[renderer]);
+            }
+
+            job = last;
         }
 
         // bool isCameraDirty = false;
@@ -253,85 +603,84 @@ namespace pg
             return;
         }
 
-        std::map<uint64_t, std::vector<RenderCall>> buckets;
+        std::vector<RenderCall> merged;
 
-        for (auto renderer : renderers)
-        {
-            const auto& calls = renderer->getRenderCalls();
+        spliceRendererBatches(merged);
 
-            for (auto& rc : calls)
-            {
-                auto& group = buckets[rc.key];
-                bool found = false;
+        // Pre process the render calls before passing them to the render stage
+        size_t nbValidCalls = 0;
 
-                for (auto& call : group)
-                {
-                    if (call.batchable and rc.batchable and call.state == rc.state)
-                    {
-                        call.data.insert(call.data.end(), rc.data.begin(), rc.data.end());
-                        found = true;
-                        break;
-                    }
-                }
+        for (auto& call : merged)
+        {
+            auto materialId = call.getMaterialId();
 
-                if (not found)
-                    group.emplace_back(std::move(rc));
+            if (materialId >= materials.size())
+            {
+                LOG_ERROR(DOM, "Unknown material id: " << materialId);
+                continue;
             }
-        }
 
-        std::vector<RenderCall> merged;
-        merged.reserve(renderCallList[tempRenderList].size());
+            const auto& material = getMaterial(materialId);
 
-        for (auto& pair : buckets)
-        {
-            // After this point all the render calls are invisible so we don't need to process them
-            if (pair.first > (static_cast<uint64_t>(1) << 63))
+            // If the mesh is not set we use the one from the material
+            if (not call.mesh)
             {
-                break;
+                call.mesh = material.mesh;
             }
 
-            // Pre process the render calls before passing them to the render stage
-            for (auto& call : pair.second)
+            // We get the number of elements to render, persistent buffers give it at render time
+            if (call.slotBuffer)
+            {
+                call.nbElements = 0;
+            }
+            else if (material.nbAttributes == 0)
+            {
+                call.nbElements = 1;
+            }
+            else
             {
-                auto materialId = call.getMaterialId();
+                call.nbElements = call.data.size() / material.nbAttributes;
 
-                if (materialId >= materialList.size())
+                if (call.nbElements == 0)
                 {
-                    LOG_ERROR(DOM, "Unknown material id: " << materialId);
+                    LOG_ERROR(DOM, "No elements in the render call should be impossible !");
                     continue;
                 }
+            }
 
-                const auto& material = getMaterial(materialId);
+            if (&merged[nbValidCalls] != &call)
+                merged[nbValidCalls] = std::move(call);
 
-                // If the mesh is not set we use the one from the material
-                if (not call.mesh)
-                {
-                    call.mesh = material.mesh;
-                }
+            nbValidCalls++;
+        }
 
-                // We get the number of elements to render
-                if (material.nbAttributes == 0)
-                {
-                    call.nbElements = 1;
-                }
-                else
-                {
-                    call.nbElements = call.data.size() / material.nbAttributes;
+        merged.resize(nbValidCalls);
 
-                    if (call.nbElements == 0)
-                    {
-                        LOG_ERROR(DOM, "No elements in the render call should be impossible !");
-                        continue;
-                    }
-                }
+        RenderStats stats;
 
-                merged.emplace_back(std::move(call));
-            }
+        stats.nbRenderCalls = nbValidCalls;
+
+        for (const auto& call : merged)
+        {
+            if (not call.slotBuffer)
+                stats.nbInstances += call.nbElements;
+        }
+
+        for (size_t i = 0; i < renderers.size(); ++i)
+        {
+            stats.nbCulledInstances += rendererCulling[i].nbCulled;
         }
 
-        renderCallList[tempRenderList].swap(merged);
+        // The render thread never touches the back packet, so it is filled without any lock
+        auto& packet = framePackets.back();
 
-        nbGeneratedFrames++;
+        packet.calls.swap(merged);
+        packet.stats = stats;
+        packet.id = ++nbGeneratedFrames;
+        packet.publishedAt = std::chrono::steady_clock::now();
+
+        if (framePackets.publish())
+            nbDroppedFrames++;
 
         if (reRenderAll)
         {
@@ -344,8 +693,6 @@ namespace pg
             LOG_INFO(DOM, "Re-rendering all the renderers");
             reRenderAll = false;
         }
-
-        inSwap = true;
     }
 
     void MasterRenderer::registerTexture(const std::string& name, const std::function<OpenGLTexture(size_t)>& callback)
@@ -376,17 +723,40 @@ namespace pg
         }
     }
 
-    void MasterRenderer::getFrameData()
+    void MasterRenderer::onEvent(const SaveCurrentFrameEvent& event)
     {
-        auto& rTable = getParameter();
-        const int screenWidth = rTable["ScreenWidth"].get<int>();
-        const int screenHeight = rTable["ScreenHeight"].get<int>();
+        std::lock_guard<std::mutex> lock(captureMutex);
 
-        std::vector<unsigned char> pixels(screenWidth * screenHeight * 4); // RGB24 format
+        saveCurrentFrame = true;
+        capturePath = event.path;
+    }
 
-        glReadPixels(0, 0, screenWidth, screenHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    void MasterRenderer::processFrameCaptures(int screenWidth, int screenHeight)
+    {
+        {
+            std::lock_guard<std::mutex> lock(captureMutex);
+
+            // The readback is only queued here, the pixels are mapped a few frames later without waiting on the gpu
+            if (saveCurrentFrame)
+            {
+                frameCapture.capture(screenWidth, screenHeight, capturePath, nbRenderedFrames, backend->isHeadless());
 
-        ecsRef->sendEvent(SavedFrameData{ std::move(pixels), screenWidth, screenHeight });
+                saveCurrentFrame = false;
+                capturePath.clear();
+            }
+        }
+
+        capturedFrames.clear();
+
+        frameCapture.collect(nbRenderedFrames, capturedFrames);
+
+        for (auto& frame : capturedFrames)
+        {
+            if (not frame.path.empty())
+                frameEncoder.request(std::move(frame));
+            else if (ecsRef)
+                ecsRef->sendEvent(SavedFrameData{ std::move(frame.pixels), frame.width, frame.height });
+        }
     }
 
     void MasterRenderer::processTextureRegister()
@@ -409,6 +779,8 @@ namespace pg
 
         processTextureRegister();
 
+        processTextureUploads();
+
         for (auto* camera : cameraList)
         {
             if (camera->dirty)
@@ -422,34 +794,114 @@ namespace pg
         const int screenWidth = rTable.at("ScreenWidth").get<int>();
         const int screenHeight = rTable.at("ScreenHeight").get<int>();
 
-        for (const auto& call : renderCallList[currentRenderList])
+        backend->beginFrame();
+
+        updateCameraBlocks(screenWidth, screenHeight);
+
+        // Other code may have touched the GL state between two frames, so the cache starts empty
+        boundProgram = nullptr;
+        std::fill(std::begin(boundTextures), std::end(boundTextures), static_cast<unsigned int>(-1));
+
+        // The depth buffer is cleared with the screen and the previous frame left the depth test disabled
+        currentDepthMode = DepthMode::Disabled;
+        depthWritten = false;
+
+        const auto frameStart = std::chrono::steady_clock::now();
+
+        // Take the newest frame generated by execute, the last one is drawn again when no new frame is ready
+        framePackets.acquire();
+
+        const auto& packet = framePackets.front();
+        const auto& calls = packet.calls;
+
+        frameStats = FrameStats{};
+        frameStats.nbBatches = calls.size();
+        frameStats.nbCulledInstances = packet.stats.nbCulledInstances;
+        frameStats.frameId = packet.id;
+
+        if (packet.id > 0)
+            frameStats.frameLatency = std::chrono::duration<double, std::micro>(frameStart - packet.publishedAt).count();
+
+        const bool measureStages = gpuTimersEnabled;
+
+        for (const auto& call : calls)
+        {
+            // The calls are sorted by stage first, so the backend only switches timer once per stage
+            if (measureStages)
+                backend->beginStage(static_cast<size_t>(call.getRenderStage()));
+
+            processRenderCall(call, rTable);
+        }
+
+        if (boundProgram)
         {
-            processRenderCall(call, rTable, screenWidth, screenHeight);
+            backend->releaseProgram();
+            boundProgram = nullptr;
         }
 
-        if (saveCurrentFrame)
+        if (currentDepthMode != DepthMode::Disabled)
         {
-            getFrameData();
+            backend->setDepthMode(DepthMode::Disabled);
+            currentDepthMode = DepthMode::Disabled;
 
-            saveCurrentFrame = false;
+            frameStats.nbStateChanges++;
         }
 
-        nbRenderedFrames++;
+        if (measureStages)
+        {
+            backend->endStages();
 
-        if (inSwap)
+            // Timer queries are read back a few frames late, the last measure is kept until a new one is available
+            hasGpuTime |= backend->readStageTimes(lastGpuTime);
+        }
+        else
         {
-            currentRenderList ^= 1;
+            hasGpuTime = false;
+        }
+
+        backend->endFrame();
+
+        frameStats.cpuTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - frameStart).count();
 
-            inSwap = false;
+        if (hasGpuTime)
+        {
+            frameStats.hasGpuTime = true;
+            std::copy(std::begin(lastGpuTime), std::end(lastGpuTime), std::begin(frameStats.gpuTime));
         }
 
-        if (newMaterialRegistered)
         {
-            std::swap(materialListTemp, materialList);
-            std::swap(materialDictTemp, materialDict);
+            std::lock_guard<std::mutex> lock(statsMutex);
 
-            newMaterialRegistered = false;
+            statsHistory.push(frameStats);
         }
+
+        processFrameCaptures(screenWidth, screenHeight);
+
+        nbRenderedFrames++;
+    }
+
+    void MasterRenderer::updateCameraBlocks(int screenWidth, int screenHeight)
+    {
+        // One block for the main camera, one per registered camera and a last one with an identity view for unknown viewports
+        cameraBuffer.beginFrame(cameraList.size() + 2);
+
+        CameraBlock block;
+
+        block.scale = glm::scale(glm::mat4(1.0f), glm::vec3(2.0f / screenWidth, 2.0f / screenHeight, 1.0f));
+
+        block.view = camera.getViewMatrix();
+        cameraBuffer.setBlock(0, block);
+
+        for (size_t i = 0; i < cameraList.size(); ++i)
+        {
+            // Todo fix this
+            // block.projection = cameraList[i]->getProjectionMatrix();
+            block.view = cameraList[i]->getViewMatrix();
+            cameraBuffer.setBlock(i + 1, block);
+        }
+
+        block.view = glm::mat4(1.0f);
+        cameraBuffer.setBlock(cameraList.size() + 1, block);
     }
 
     void MasterRenderer::registerShader(const std::string& name, OpenGLShaderProgram *shaderProgram)
@@ -474,87 +926,140 @@ namespace pg
     {
         LOG_THIS_MEMBER(DOM);
 
-        int width, height, nrChannels;
+        DecodedTexture decoded;
+
         // Todo change this with our custom file opener (stbi_load_from_memory)
+        if (not decodeTextureFile(texturePath, decoded, &textureCache))
+            return OpenGLTexture{};
 
-        unsigned char *data = stbi_load(texturePath, &width, &height, &nrChannels, STBI_rgb_alpha);
+        LOG_INFO(DOM, "Loaded texture " << name << " from " << texturePath << " with width = " << decoded.width << " height = " << decoded.height << (decoded.mapped ? " (cached)" : ""));
 
-        if (not data)
+        auto tex = uploadTexture(decoded.data(), decoded.width, decoded.height, oldId);
+
+        // Keep the pixels of the none icon to use them as a placeholder while the other textures are decoded
+        if (name == "NoneIcon")
+            placeholderTexture = decoded;
+
+        if (instantRegister)
+            registerTexture(name, tex);
+
+        if (texturePacking)
+            packTexture(name, decoded.data(), decoded.width, decoded.height);
+
+        return tex;
+    }
+
+    OpenGLTexture MasterRenderer::uploadTexture(const unsigned char *data, int width, int height, unsigned int oldId)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        OpenGLTexture tex;
+
+        tex.id = backend->uploadTexture(data, width, height, oldId);
+        tex.transparent = true;
+
+        return tex;
+    }
+
+    OpenGLTexture MasterRenderer::registerTextureAsync(const std::string& name, const std::string& path, size_t oldId)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        OpenGLTexture tex;
+
+        if (placeholderTexture.size() > 0)
         {
-            if (stbi_failure_reason())
-            {
-                LOG_ERROR(DOM, "Failed to load texture: " << texturePath << ", error: " << stbi_failure_reason());
-            }
-            else
+            tex = uploadTexture(placeholderTexture.data(), placeholderTexture.width, placeholderTexture.height, oldId);
+        }
+        else
+        {
+            const unsigned char transparentPixel[4] = {0, 0, 0, 0};
+
+            tex = uploadTexture(transparentPixel, 1, 1, oldId);
+        }
+
+        textureDecoder.request(name, path, tex.id);
+
+        return tex;
+    }
+
+    void MasterRenderer::processTextureUploads()
+    {
+        const size_t budget = textureUploadBudget;
+
+        size_t nbUploadedBytes = 0;
+
+        DecodedTexture decoded;
+
+        while (nbUploadedBytes < budget and textureDecoder.tryPop(decoded))
+        {
+            if (decoded.size() == 0)
             {
-                LOG_ERROR(DOM, "Failed to load texture: Unknown");
+                LOG_WARNING(DOM, "Texture " << decoded.name << " keeps its placeholder as " << decoded.path << " couldn't be decoded");
+                continue;
             }
 
-            return OpenGLTexture{};
+            uploadTexture(decoded.data(), decoded.width, decoded.height, decoded.textureId);
+
+            if (texturePacking)
+                packTexture(decoded.name, decoded.data(), decoded.width, decoded.height);
+
+            nbUploadedBytes += decoded.size();
+
+            LOG_MILE(DOM, "Uploaded decoded texture " << decoded.name);
         }
+    }
+
+    void MasterRenderer::packTexture(const std::string& name, const unsigned char *data, int width, int height)
+    {
+        LOG_THIS_MEMBER(DOM);
 
-        LOG_INFO(DOM, "Loaded texture " << name << " from " << texturePath << " with width = " << width << " height = " << height << " nbchannels = " << nrChannels);
+        // Atlas pages are GL textures
+        if (backend->isHeadless() or not runtimeAtlas.accepts(width, height))
+            return;
 
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        RuntimeTextureAtlas::Placement placement;
 
-        unsigned int texture;
+        auto it = packedPlacements.find(name);
 
-        if (oldId)
+        // A texture replaced by one of the same size is written in place
+        if (it != packedPlacements.end() and it->second.width == static_cast<unsigned int>(width) and it->second.height == static_cast<unsigned int>(height))
         {
-            texture = oldId;
-            glBindTexture(GL_TEXTURE_2D, texture);
+            placement = it->second;
+        }
+        else if (runtimeAtlas.place(width, height, placement))
+        {
+            packedPlacements[name] = placement;
         }
         else
         {
-            glGenTextures(1, &texture);
-        }
-
-        glBindTexture(GL_TEXTURE_2D, texture);
-        // set the texture wrapping parameters
-        //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-// #ifdef __EMSCRIPTEN__
-//         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-//         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-//         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-//         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-// #else
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-        // set texture filtering parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        // load image, create texture and generate mipmaps
-// #endif
-        OpenGLTexture tex;
+            return;
+        }
 
-        tex.id = texture;
+        const auto pageName = "RuntimeAtlasPage" + std::to_string(placement.page);
 
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        tex.transparent = true;
+        OpenGLTexture page;
+        page.id = runtimeAtlas.upload(placement, data);
+        page.transparent = true;
 
-        // Todo this doesn't work properly with fully solid textures
-        // if (nrChannels == 4)
-        // {
-        //     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        //     tex.transparent = true;
-        // }
-        // else
-        // {
-        //     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        //     tex.transparent = false;
-        // }
+        registerTexture(pageName, page);
 
-        glGenerateMipmap(GL_TEXTURE_2D);
+        AtlasTexture texture;
+        texture.setName(name);
+        texture.setWidth(width);
+        texture.setHeight(height);
+        texture.setTextureLimit(placement.limits);
 
-        if (instantRegister)
-            registerTexture(name, tex);
+        auto& atlas = atlasMap[pageName];
+        atlas.setSize(runtimeAtlas.getPageSize(), runtimeAtlas.getPageSize());
+        texture.setId(atlas.addTexture(texture));
 
-        stbi_image_free(data);
+        std::lock_guard<std::mutex> lock(packedTexturesMutex);
 
-        return tex;
-    }
+        packedTextures[name] = PackedTexture{pageName, texture};
 
+        LOG_MILE(DOM, "Packed texture " << name << " in " << pageName);
+    }
 
     void MasterRenderer::registerTexture(const std::string& name, const char* texturePath)
     {
@@ -573,29 +1078,63 @@ namespace pg
         registerTexture(name, texturePath);
     }
 
-    void MasterRenderer::setState(const OpenGLState& state)
+    void MasterRenderer::setDepthState(const RenderCall& call)
     {
-        if (currentState.scissorEnabled != state.scissorEnabled)
+        // Only the main pass is depth tested, pre render and post process passes draw over the whole screen
+        if (call.getRenderStage() != RenderStage::Render)
         {
-            if (state.scissorEnabled)
+            if (currentDepthMode != DepthMode::Disabled)
             {
-                glEnable(GL_SCISSOR_TEST);
-            }
-            else
-            {
-                glDisable(GL_SCISSOR_TEST);
+                backend->setDepthMode(DepthMode::Disabled);
+                currentDepthMode = DepthMode::Disabled;
+
+                frameStats.nbStateChanges++;
             }
+
+            return;
         }
 
-        if (currentState.scissorBound != state.scissorBound)
+        const uint8_t viewport = call.getViewport();
+
+        // Opaque calls of a viewport must not hide the calls of the viewports drawn after it
+        if (depthWritten and viewport != depthViewport)
         {
-            auto& rTable = getParameter();
-            const int screenHeight = rTable["ScreenHeight"].get<int>();
+            backend->clearDepth();
+            depthWritten = false;
 
-            //glScissor defined the box from the bottom left corner (x, y, w, h);
-            glScissor(state.scissorBound.x, (screenHeight - state.scissorBound.w) - state.scissorBound.y, state.scissorBound.z, state.scissorBound.w);
+            frameStats.nbStateChanges++;
         }
 
+        DepthMode mode = DepthMode::Disabled;
+
+        if (call.getOpacity() == OpacityType::Opaque)
+        {
+            mode = DepthMode::TestAndWrite;
+
+            depthWritten = true;
+            depthViewport = viewport;
+        }
+        // Transparent calls only need the test when an opaque call of their viewport may hide them
+        else if (depthWritten)
+        {
+            mode = DepthMode::TestOnly;
+        }
+
+        if (mode != currentDepthMode)
+        {
+            backend->setDepthMode(mode);
+            currentDepthMode = mode;
+
+            frameStats.nbStateChanges++;
+        }
+    }
+
+    void MasterRenderer::setState(const OpenGLState& state)
+    {
+        const int screenHeight = getParameter()["ScreenHeight"].get<int>();
+
+        backend->setState(state, currentState, screenHeight);
+
         currentState = state;
     }
 
@@ -603,7 +1142,7 @@ namespace pg
     {
 #ifdef PROFILE
 
-        for (const auto& calls : renderCallList[currentRenderList])
+        for (const auto& calls : framePackets.front().calls)
         {
             std::cout << "Call Key:" << calls.key << ", batchable: " << calls.batchable << ", nbElements:" << calls.data.size() << std::endl;
         }
@@ -611,149 +1150,116 @@ namespace pg
 #endif
     }
 
-    void MasterRenderer::processRenderCall(const RenderCall& call, const RefracRef& rTable, unsigned int screenWidth, unsigned int screenHeight)
+    void MasterRenderer::processRenderCall(const RenderCall& call, const RefracRef& rTable)
     {
         // This should never happens anymore
         // if (not call.getVisibility())
         //     return;
 
-        // Todo initialize material in another call !
-        if (not call.mesh->initialized)
-        {
-            LOG_MILE(DOM, "Generating mesh");
-            call.mesh->generateMesh();
-        }
-
         auto materialId = call.getMaterialId();
 
         const auto& material = getMaterial(materialId);
 
         auto shaderProgram = material.shader;
 
-        if (not shaderProgram or shaderProgram->ID < 0)
+        const bool headless = backend->isHeadless();
+
+        if (not headless and (not shaderProgram or shaderProgram->ID < 0))
         {
             LOG_ERROR(DOM, "Shader not found");
 
             return;
         }
 
-        // Todo only grab the camera when the viewport changes from last time
-        glm::mat4 projection = glm::mat4(1.0f);
-        glm::mat4 view = glm::mat4(1.0f);
+        if (not headless and not call.mesh)
+        {
+            LOG_ERROR(DOM, "Mesh not set for render call with key: " << call.key);
+            return;
+        }
 
-        auto viewport = call.getViewport();
+        size_t viewport = call.getViewport();
 
-        if (viewport == 0)
+        // The last camera block holds the identity view used for unknown viewports
+        if (viewport + 1 >= cameraBuffer.size())
         {
-            view = camera.getViewMatrix();
+            LOG_MILE(DOM, "Unknown viewport: " << viewport << ", defaulting to 0");
+
+            viewport = cameraBuffer.size() - 1;
         }
-        else
-        {
-            int cameraIndex = viewport - 1;
 
-            if (cameraIndex < 0 or static_cast<size_t>(cameraIndex) >= cameraList.size())
-            {
-                LOG_MILE(DOM, "Unknown viewport: " << viewport << ", defaulting to 0");
-            }
-            else
-            {
-                view = cameraList[cameraIndex]->getViewMatrix();
+        const void *program = shaderProgram ? static_cast<const void*>(shaderProgram) : static_cast<const void*>(&material);
 
-                // Todo fix this
-                // projection = cameraList[cameraIndex]->getProjectionMatrix();
-            }
-        }
+        // Only switch program when the material uses a different shader than the previous call
+        if (boundProgram != program)
+        {
+            backend->useProgram(materialId, material);
+            boundProgram = program;
 
-        shaderProgram->bind();
+            frameStats.nbProgramBinds++;
+        }
 
         if (call.state != currentState)
         {
             setState(call.state);
-        }
 
-        for (size_t i = 0; i < material.nbTextures; ++i)
-        {
-            glActiveTexture(GL_TEXTURE0 + i);
-            glBindTexture(GL_TEXTURE_2D, material.textureId[i]);
-            shaderProgram->setUniformValue("texture" + std::to_string(i), static_cast<int>(i));
+            frameStats.nbStateChanges++;
         }
 
-        glm::mat4 model = glm::mat4(1.0f);
-        glm::mat4 scale = glm::mat4(1.0f);
-
-        scale = glm::scale(scale, glm::vec3(2.0f / screenWidth, 2.0f / screenHeight, 1.0f));
+        setDepthState(call);
 
-        // Todo create a uniform feeder
-
-        for (const auto& uniform : material.uniformMap)
+        for (size_t i = 0; i < material.nbTextures and i < 16; ++i)
         {
-            switch (uniform.second.type)
+            if (boundTextures[i] != material.textureId[i])
             {
-                case UniformType::INT:
-                    shaderProgram->setUniformValue(uniform.first, std::get<int>(uniform.second.value));
-                    break;
-                case UniformType::FLOAT:
-                    shaderProgram->setUniformValue(uniform.first, std::get<float>(uniform.second.value));
-                    break;
-                case UniformType::VEC2D:
-                    shaderProgram->setUniformValue(uniform.first, std::get<glm::vec2>(uniform.second.value));
-                    break;
-                case UniformType::VEC3D:
-                    shaderProgram->setUniformValue(uniform.first, std::get<glm::vec3>(uniform.second.value));
-                    break;
-                case UniformType::VEC4D:
-                    shaderProgram->setUniformValue(uniform.first, std::get<glm::vec4>(uniform.second.value));
-                    break;
-                case UniformType::MAT4D:
-                    shaderProgram->setUniformValue(uniform.first, std::get<glm::mat4>(uniform.second.value));
-                    break;
-                case UniformType::ID:
-                {
-                    std::string id = std::get<std::string>(uniform.second.value);
+                backend->bindTexture(i, material.textureId[i]);
 
-                    const auto& value = rTable.at(id);
+                boundTextures[i] = material.textureId[i];
 
-                    switch(value.type)
-                    {
-                        case ElementType::UnionType::FLOAT:
-                            shaderProgram->setUniformValue(uniform.first, value.get<float>());
-                            break;
-                        case ElementType::UnionType::INT:
-                        case ElementType::UnionType::SIZE_T:
-                            shaderProgram->setUniformValue(uniform.first, value.get<int>());
-                            break;
-                        case ElementType::UnionType::BOOL:
-                            shaderProgram->setUniformValue(uniform.first, value.get<bool>());
-                            break;
-                        case ElementType::UnionType::STRING:
-                        default:
-                        {
-                            LOG_ERROR(DOM, "Cannot set uniform for id:" << id << ", Unsupported type :" << value.getTypeString());
-                        }
-                    }
-                }
+                frameStats.nbTextureBinds++;
             }
         }
 
-        shaderProgram->setUniformValue("projection", projection);
-        shaderProgram->setUniformValue("model", model);
-        shaderProgram->setUniformValue("scale", scale);
-        shaderProgram->setUniformValue("view", view);
+        backend->setUniforms(material, rTable);
+
+        backend->bindCamera(material, cameraBuffer, viewport);
+
+        const auto result = backend->draw(call, material);
 
-        if (not call.mesh)
+        if (result.nbInstances > 0)
         {
-            LOG_ERROR(DOM, "Mesh not set for render call with key: " << call.key);
-            return;
+            frameStats.nbDrawCalls++;
+            frameStats.nbInstances += result.nbInstances;
         }
 
-        call.mesh->bind();
+        frameStats.nbUploadedBytes += result.nbBytes;
+    }
 
-        call.mesh->openGLMesh.instanceVBO->allocate(call.data.data(), call.data.size() * sizeof(float));
+    FrameStats MasterRenderer::getLastFrameStats() const
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+
+        return statsHistory.empty() ? FrameStats{} : statsHistory.back();
+    }
+
+    MetricSummary MasterRenderer::getStatsSummary(RenderMetric metric) const
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+
+        return statsHistory.summarize(metric);
+    }
+
+    RenderStatsHistory MasterRenderer::getStatsHistory() const
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
 
-        glDrawElementsInstanced(GL_TRIANGLES, call.mesh->modelInfo.nbIndices, GL_UNSIGNED_INT, 0, call.nbElements);
+        return statsHistory;
+    }
+
+    void MasterRenderer::setStatsHistorySize(size_t nbFrames)
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
 
-        // Todo only release if the shader need to change
-        shaderProgram->release();
+        statsHistory.setCapacity(nbFrames);
     }
 
     void MasterRenderer::initializeParameters()
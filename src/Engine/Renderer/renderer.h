@@ -5,6 +5,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
 
 #include <cstdarg>
 
@@ -12,11 +13,25 @@
 
 #include "Input/inputcomponent.h"
 
+#include "Memory/parallelfor.h"
+#include "Memory/triplebuffer.h"
+#include "Memory/appendonlytable.h"
+
 #include "Loaders/atlasloader.h"
 
 #include "constant.h"
 #include "mesh.h"
 #include "camera.h"
+#include "instancebuffer.h"
+#include "camerabuffer.h"
+#include "culling.h"
+#include "texturepacker.h"
+#include "textureloader.h"
+#include "renderbackend.h"
+#include "renderpayload.h"
+#include "renderstats.h"
+#include "framecapture.h"
+#include "instanceslotbuffer.h"
 
 namespace pg
 {
@@ -65,6 +80,16 @@ namespace pg
         bool transparent = false;
     };
 
+    /** A texture copied in a page of the runtime atlas */
+    struct PackedTexture
+    {
+        /** Name of the texture of the page, also registered as an atlas */
+        std::string pageName;
+
+        /** Place of the texture in the page */
+        AtlasTexture texture;
+    };
+
     struct OpenGLState
     {
         OpenGLState() {}
@@ -133,8 +158,8 @@ namespace pg
          */
         uint64_t key = 0;
 
-        /** All the data stored of this render call */
-        std::vector<float> data;
+        /** All the data stored of this render call, its storage is recycled through the RenderPayloadPool */
+        RenderPayload data;
 
         /** Flag indicating if this call can be batch with other similar call (key with the same value) */
         bool batchable = true;
@@ -148,10 +173,13 @@ namespace pg
         /** (Internal) Number of elements to render */
         size_t nbElements = 0;
 
+        /** Persistent instance buffer to draw from instead of data (the call is never batched) */
+        std::shared_ptr<InstanceSlotBuffer> slotBuffer;
+
         RenderCall() {}
         RenderCall(std::shared_ptr<Mesh> mesh) : batchable(false), mesh(mesh) {}
-        RenderCall(const RenderCall& other) : key(other.key), data(other.data), batchable(other.batchable), state(other.state), mesh(other.mesh), nbElements(other.nbElements) {}
-        RenderCall(RenderCall&& other) : key(std::move(other.key)), data(std::move(other.data)), batchable(std::move(other.batchable)), state(std::move(other.state)), mesh(std::move(other.mesh)), nbElements(std::move(other.nbElements)) {}
+        RenderCall(const RenderCall& other) : key(other.key), data(other.data), batchable(other.batchable), state(other.state), mesh(other.mesh), nbElements(other.nbElements), slotBuffer(other.slotBuffer) {}
+        RenderCall(RenderCall&& other) : key(std::move(other.key)), data(std::move(other.data)), batchable(std::move(other.batchable)), state(std::move(other.state)), mesh(std::move(other.mesh)), nbElements(std::move(other.nbElements)), slotBuffer(std::move(other.slotBuffer)) {}
         ~RenderCall() {};
 
         RenderCall & operator=(const RenderCall& other)
@@ -162,6 +190,7 @@ namespace pg
             state      = other.state;
             mesh       = other.mesh;
             nbElements = other.nbElements;
+            slotBuffer = other.slotBuffer;
 
             return *this;
         }
@@ -174,6 +203,7 @@ namespace pg
             state      = std::move(other.state);
             mesh       = std::move(other.mesh);
             nbElements = std::move(other.nbElements);
+            slotBuffer = std::move(other.slotBuffer);
 
             return *this;
         }
@@ -276,12 +306,29 @@ namespace pg
             return key & 0b111111111111111111111111111111;
         }
 
-        bool operator<(const RenderCall& other) const
+        /**
+         * @brief Get the key used by the master renderer to order the draws
+         *
+         * Transparent calls keep their key, so they are drawn back to front (highest depth drawn last, on top).
+         * Opaque calls are drawn before them (Opaque is the lowest opacity value), grouped by material to reduce
+         * the program and texture binds, then front to back inside a material so the depth test rejects the hidden fragments.
+         * Visibility, pass and viewport stay in the highest bits, so the order of the passes is unchanged.
+         */
+        uint64_t getSortKey() const
         {
-            // Todo find a way (in depth maybe ?) to better order opaque calls as the following does not work correctly
-            // This cause a strict weak ordering fault that can cause the engine to crash.
-            // return getOpacity() != OpacityType::Opaque ? key < other.key : key > other.key;
+            if (getOpacity() != OpacityType::Opaque)
+                return key;
+
+            const uint64_t depthMask = 0b111111111111111111111111;
+
+            const uint64_t reversedDepth = depthMask - ((key >> 30) & depthMask);
+
+            return (key & ~(((uint64_t)1 << 54) - 1)) | (getMaterialId() << 24) | reversedDepth;
+        }
 
+        bool operator<(const RenderCall& other) const
+        {
+            // Plain key order, the master renderer orders the draws with getSortKey()
             return key < other.key;
         }
     };
@@ -304,6 +351,33 @@ namespace pg
         bool isDirty() const { return dirty; }
 
     protected:
+        /**
+         * @brief Copy the render call held by each component of a view in renderCallList
+         *
+         * Large views are split in chunks copied on the job pool, each chunk writing its own range of the list.
+         * The calls already in the list are overwritten in place, so their payloads keep their storage.
+         *
+         * @param renderCallView A view over components holding their render call in a 'call' member
+         */
+        template <typename View>
+        void gatherRenderCalls(const View& renderCallView)
+        {
+            // Components of a view start at index 1
+            const size_t nbCalls = renderCallView.nbComponents() > 0 ? renderCallView.nbComponents() - 1 : 0;
+
+            renderCallList.resize(nbCalls);
+
+            parallelForChunks(nbCalls, GatherChunkSize, [this, &renderCallView](size_t start, size_t end, size_t) {
+                for (size_t i = start; i < end; ++i)
+                {
+                    renderCallList[i] = renderCallView[i + 1]->call;
+                }
+            });
+        }
+
+        /** Smallest number of render calls copied by a job of gatherRenderCalls */
+        static constexpr size_t GatherChunkSize = 1024;
+
         MasterRenderer *masterRenderer;
 
         std::vector<RenderCall> renderCallList;
@@ -391,10 +465,27 @@ namespace pg
         UniformType type;
     };
 
+    /** Index in the uniform table of the shader of all the uniforms set when drawing a material */
+    struct MaterialUniforms
+    {
+        MaterialUniforms() { std::fill(std::begin(textures), std::end(textures), -1); }
+
+        /** Uniforms of the uniform map with their index */
+        std::vector<std::pair<int, UniformValue>> values;
+
+        /** Index of the textureN samplers */
+        int textures[16];
+
+        int projection = -1;
+        int model = -1;
+        int scale = -1;
+        int view = -1;
+    };
+
     struct Material
     {
         Material() {}
-        Material(const Material& rhs) : shader(rhs.shader), nbTextures(rhs.nbTextures), nbAttributes(rhs.nbAttributes), uniformMap(rhs.uniformMap), mesh(rhs.mesh)
+        Material(const Material& rhs) : shader(rhs.shader), nbTextures(rhs.nbTextures), nbAttributes(rhs.nbAttributes), cullable(rhs.cullable), rotatedElements(rhs.rotatedElements), uniformMap(rhs.uniformMap), mesh(rhs.mesh), uniforms(rhs.uniforms)
         {
             for (size_t i = 0; i < nbTextures; ++i)
             {
@@ -407,8 +498,11 @@ namespace pg
             shader = rhs.shader;
             nbTextures = rhs.nbTextures;
             nbAttributes = rhs.nbAttributes;
+            cullable = rhs.cullable;
+            rotatedElements = rhs.rotatedElements;
             uniformMap = rhs.uniformMap;
             mesh = rhs.mesh;
+            uniforms = rhs.uniforms;
 
             for (size_t i = 0; i < nbTextures; ++i)
             {
@@ -426,9 +520,20 @@ namespace pg
             {
                 nbAttributes += value;
             }
+
+            // Simple meshes are quads placed with a vec3 position followed by a vec2 size and usually a rotation
+            cullable = attributes.size() >= 2 and attributes[0] == 3 and attributes[1] == 2;
+            rotatedElements = cullable and attributes.size() >= 3 and attributes[2] == 1;
         }
 
-        OpenGLShaderProgram* shader;
+        /**
+         * @brief Resolve the uniforms of the material against the uniform table of its shader
+         *
+         * Done once when the material is registered, so drawing the material never looks up a uniform by name
+         */
+        void resolveUniforms();
+
+        OpenGLShaderProgram* shader = nullptr;
 
         // Todo limit the number of texture to 16 max
         size_t nbTextures = 1;
@@ -437,43 +542,61 @@ namespace pg
         /** Number of attributes per elements in render call */
         size_t nbAttributes = 0;
 
+        /** Elements start with x, y, z, width, height, so the master renderer can cull the ones outside of their viewport */
+        bool cullable = false;
+
+        /** The attribute following the size of the elements is a rotation in degree */
+        bool rotatedElements = false;
+
         std::unordered_map<std::string, UniformValue> uniformMap;
 
         std::shared_ptr<Mesh> mesh = nullptr;
+
+        /** (Internal) Uniforms resolved by resolveUniforms */
+        MaterialUniforms uniforms;
     };
 
     struct SkipRenderPass { size_t count = 1; };
 
     struct ReRendererAll { };
 
-    struct SaveCurrentFrameEvent { };
+    /** Capture the next frame drawn, it is saved as a png file if a path is given, else it is sent back in a SavedFrameData event */
+    struct SaveCurrentFrameEvent { std::string path = ""; };
 
     struct SavedFrameData { std::vector<unsigned char> pixels; const int width = 0; const int height = 0; };
 
-    // Todo fix crash on renderer when failure to grab a missing texture or shader
+    /** Statistics of a frame generated by the master renderer */
+    struct RenderStats
+    {
+        /** Number of batches sent to the render thread */
+        size_t nbRenderCalls = 0;
 
-    class MasterRenderer : public System<Own<BaseCamera2D>, Listener<OnSDLScanCode>, Listener<SkipRenderPass>, Listener<ReRendererAll>, Listener<SaveCurrentFrameEvent>>
+        /** Number of instances held by the batches (persistent instance buffers not included) */
+        size_t nbInstances = 0;
+
+        /** Number of instances skipped because they were outside of their viewport */
+        size_t nbCulledInstances = 0;
+    };
+
+    /** A frame generated by the master renderer, handed from the ecs thread to the render thread */
+    struct FramePacket
     {
-    private:
-        struct MaterialHolder
-        {
-            MaterialHolder(const std::string& name, const Material& material, size_t index) : materialName(name), material(material), index(index) {}
-            MaterialHolder(const MaterialHolder& other) : materialName(other.materialName), material(other.material), index(other.index) {}
+        std::vector<RenderCall> calls;
 
-            MaterialHolder& operator=(const MaterialHolder& other)
-            {
-                materialName = other.materialName;
-                material = other.material;
-                index = other.index;
+        RenderStats stats;
 
-                return *this;
-            }
+        /** Number of the generated frame, 0 for a packet that was never filled */
+        size_t id = 0;
 
-            std::string materialName;
-            Material material;
-            size_t index;
-        };
+        /** When execute handed the packet to the render thread */
+        std::chrono::steady_clock::time_point publishedAt;
+    };
 
+    // Todo fix crash on renderer when failure to grab a missing texture or shader
+
+    class MasterRenderer : public System<Own<BaseCamera2D>, Listener<OnSDLScanCode>, Listener<SkipRenderPass>, Listener<ReRendererAll>, Listener<SaveCurrentFrameEvent>>
+    {
+    private:
         struct TextureRegisteringQueueItem
         {
             std::string name;
@@ -489,12 +612,19 @@ namespace pg
         virtual void onEvent(const OnSDLScanCode& event) override;
         virtual void onEvent(const SkipRenderPass& event ) override { skipRenderPass += event.count; }
         virtual void onEvent(const ReRendererAll&) override { reRenderAll = true; }
-        virtual void onEvent(const SaveCurrentFrameEvent&) override { saveCurrentFrame = true; }
+        virtual void onEvent(const SaveCurrentFrameEvent& event) override;
 
         virtual void execute() override;
 
         void processTextureRegister();
 
+        /**
+         * @brief Upload the textures decoded by the workers, until the upload budget of the frame is spent
+         *
+         * At least one texture is uploaded per call, the others stay queued for the next frames.
+         */
+        void processTextureUploads();
+
         void renderAll();
 
         void registerShader(const std::string& name, OpenGLShaderProgram *shaderProgram);
@@ -508,7 +638,7 @@ namespace pg
         void queueRegisterTexture(const std::string& name, const char* texturePath)
         {
             std::string path = texturePath;
-            std::function<OpenGLTexture(size_t)> f = [name, path, this](size_t oldId) { return registerTextureHelper(name, path.c_str(), oldId, false); };
+            std::function<OpenGLTexture(size_t)> f = [name, path, this](size_t oldId) { return registerTextureAsync(name, path, oldId); };
 
             queueRegisterTexture(name, f);
         }
@@ -552,38 +682,31 @@ namespace pg
 
         size_t registerMaterial(const Material& material)
         {
-            LOG_MILE("Renderer", "Registering a new material");
-
-            std::lock_guard<std::mutex> lock(materialRegisterMutex);
-            auto index = nbRegisteredMaterials++;
-            materialRegisterQueue.emplace_back("", material, index);
-
-            return index;
+            return registerMaterial("", material);
         }
 
+        /**
+         * @brief Register a material, it can be used by the render calls right away
+         *
+         * Registering a name again points the name to the new material, the old material keeps its id.
+         *
+         * @return size_t The id of the material, it never changes
+         */
         size_t registerMaterial(const std::string& materialName, const Material& material)
         {
             LOG_MILE("Renderer", "Registering a new material: " << materialName);
-            std::lock_guard<std::mutex> lock(materialRegisterMutex);
-            auto index = nbRegisteredMaterials++;
-            materialRegisterQueue.emplace_back(materialName, material, index);
 
-            return index;
+            Material registered = material;
+            registered.resolveUniforms();
+
+            return materials.push(materialName, std::move(registered));
         }
 
         bool hasMaterial(const std::string& materialName) const
         {
-            bool result = false;
-
-            {
-                std::lock_guard<std::mutex> lock(materialRegisterMutex);
-
-                auto it = std::find_if(materialRegisterQueue.begin(), materialRegisterQueue.end(), [materialName](const MaterialHolder& holder) { return holder.materialName == materialName; });
+            size_t id;
 
-                result = materialDict.find(materialName) != materialDict.end() or it != materialRegisterQueue.end();
-            }
-
-            return result;
+            return materials.find(materialName, id);
         }
 
         //TODO raise exception on none presence of attribute
@@ -633,59 +756,80 @@ namespace pg
             return atlasMap.at(textureName).getTexture(atlasTextureName);
         }
 
+        /**
+         * @brief Get where a texture was copied in the runtime atlas
+         *
+         * @param name Name of the texture
+         * @param packed Receive the page and the texture limits of the texture
+         *
+         * @return true If the texture is available in the runtime atlas
+         */
+        bool getPackedTexture(const std::string& name, PackedTexture& packed) const
+        {
+            std::lock_guard<std::mutex> lock(packedTexturesMutex);
+
+            auto it = packedTextures.find(name);
+
+            if (it == packedTextures.end())
+                return false;
+
+            packed = it->second;
+
+            return true;
+        }
+
+        /** Enable or disable the packing of the textures registered from now on */
+        inline void setTexturePacking(bool enabled) { texturePacking = enabled; }
+
+        /** Set the number of bytes of decoded textures that can be uploaded each frame */
+        inline void setTextureUploadBudget(size_t nbBytes) { textureUploadBudget = nbBytes; }
+
+        /**
+         * @brief Set the directory where decoded textures are cached, so the next launches skip their decoding
+         *
+         * An empty directory disables the cache. This must be set before textures are queued as the decoding workers read it.
+         */
+        inline void setTextureCacheDirectory(const std::string& directory) { textureCache.setDirectory(directory); }
+
+        /** Get the number of textures still being decoded or waiting for their upload */
+        inline size_t getNbPendingTextures() const { return textureDecoder.getNbPending(); }
+
         const Material& getMaterial(const std::string& name) const
         {
-            try
-            {
-                return materialList.at(materialDict.at(name));
-            }
-            catch (const std::exception& e)
-            {
-                LOG_ERROR("Renderer", "Material named " << name << " don't exist !");
+            size_t id;
 
-                static Material dummyMaterial;
+            if (materials.find(name, id))
+                return materials[id];
 
-                return dummyMaterial;
-            }
+            LOG_ERROR("Renderer", "Material named " << name << " don't exist !");
+
+            static Material dummyMaterial;
+
+            return dummyMaterial;
         }
 
         const Material& getMaterial(size_t id) const
         {
-            try
-            {
-                return materialList.at(id);
-            }
-            catch (const std::exception& e)
-            {
-                LOG_ERROR("Renderer", "Material id " << id << " don't exist !");
+            if (id < materials.size())
+                return materials[id];
 
-                static Material dummyMaterial;
+            LOG_ERROR("Renderer", "Material id " << id << " don't exist !");
 
-                return dummyMaterial;
-            }
+            static Material dummyMaterial;
+
+            return dummyMaterial;
         }
 
         size_t getMaterialID(const std::string& name) const
         {
-            std::lock_guard<std::mutex> lock(materialRegisterMutex);
+            size_t id;
 
-            auto it = std::find_if(materialRegisterQueue.begin(), materialRegisterQueue.end(), [name](const MaterialHolder& holder) { return holder.materialName == name; });
+            if (materials.find(name, id))
+                return id;
 
-            if (it != materialRegisterQueue.end())
-                return it->index;
-            else
-            {
-                try
-                {
-                    return materialDict.at(name);
-                }
-                catch (const std::exception& e)
-                {
-                    LOG_ERROR("Renderer", "Material named " << name << " don't exist !");
+            LOG_ERROR("Renderer", "Material named " << name << " don't exist !");
 
-                    return 0;
-                }
-            }
+            return 0;
         }
 
         template <typename... Args>
@@ -710,69 +854,188 @@ namespace pg
 
         inline void addRenderer(BaseAbstractRenderer* renderer) { renderers.push_back(renderer); }
 
-        inline size_t getNbMaterials() const { return nbMaterials; }
+        inline size_t getNbMaterials() const { return materials.size(); }
 
         inline size_t getNbGeneratedFrames() const { return nbGeneratedFrames; }
 
         inline size_t getNbRenderedFrames() const { return nbRenderedFrames; }
 
-        inline size_t getNbRenderCall() const { return renderCallList[currentRenderList.load()].size(); }
+        /** Get the number of captured frames not handed back or written yet, must be called from the render thread */
+        inline size_t getNbPendingCaptures() const { return frameCapture.getNbPending() + frameEncoder.getNbPending(); }
+
+        /**
+         * @brief Replace the backend receiving the draw stream, must be set before the first frame is rendered
+         *
+         * A NullRenderBackend lets the whole pipeline run without a GL context.
+         */
+        inline void setBackend(std::unique_ptr<RenderBackend> backend) { this->backend = std::move(backend); }
+
+        inline RenderBackend* getBackend() const { return backend.get(); }
+
+        inline const CameraUniformBuffer& getCameraBuffer() const { return cameraBuffer; }
+
+        inline size_t getNbRenderCall() const { return framePackets.front().calls.size(); }
+
+        /** Get the statistics of the frame currently rendered */
+        inline RenderStats getRenderStats() const { return framePackets.front().stats; }
+
+        /** Get the number of generated frames replaced by a newer one before the render thread could draw them */
+        inline size_t getNbDroppedFrames() const { return nbDroppedFrames; }
+
+        /** Get the counters of the last frame drawn */
+        FrameStats getLastFrameStats() const;
+
+        /** Compute the average, 99th percentile and maximum of a metric over the frames of the stats history */
+        MetricSummary getStatsSummary(RenderMetric metric) const;
+
+        /** Get a copy of the stats of the last frames */
+        RenderStatsHistory getStatsHistory() const;
+
+        /** Set the number of frames kept in the stats history (240 by default), the history is cleared */
+        void setStatsHistorySize(size_t nbFrames);
+
+        /** Measure the gpu time of each render stage with timer queries, when the backend supports them */
+        inline void setGpuTimers(bool enabled) { gpuTimersEnabled = enabled; }
+
+        inline bool isGpuTimersEnabled() const { return gpuTimersEnabled; }
+
+        /** Enable or disable the culling of the instances outside of their viewport */
+        inline void setCulling(bool enabled) { cullingEnabled = enabled; }
+
+        inline bool isCullingEnabled() const { return cullingEnabled; }
+
+        /**
+         * @brief Set the number of calls of a merge job, renderers holding at least two jobs worth of calls are merged in parallel chunks
+         *
+         * @param size Number of calls of a job, 0 (the default) to split large renderers in one chunk per thread of the job pool
+         */
+        inline void setMergeChunkSize(size_t size) { mergeChunkSize = size; }
 
         void printAllDrawCalls();
 
+        /**
+         * @brief Get a copy of the render calls of a frame
+         *
+         * @param index 1 for the last frame generated by execute (only safe from the ecs thread), any other value for the frame drawn by renderAll
+         */
         inline std::vector<RenderCall> getRenderCalls(int index = -1) const
         {
-            if (index < 0 or index >= 2)
-                return renderCallList[currentRenderList.load()];
+            if (index == 1)
+                return framePackets.latest().calls;
 
-            return renderCallList[index];
+            return framePackets.front().calls;
         }
 
     private:
-        std::atomic<bool> inSwap {false};
-        std::atomic<bool> newMaterialRegistered {false};
-        // std::atomic<bool> inBetweenRender {true};
-
-        // std::condition_variable execCv;
-        // std::condition_variable renderCv;
-
-        mutable std::mutex materialRegisterMutex;
-        std::vector<MaterialHolder> materialRegisterQueue;
-
         std::vector<_unique_id> cameraRegisterQueue;
 
         moodycamel::ConcurrentQueue<TextureRegisteringQueueItem> textureRegisteringQueue;
 
-        size_t nbRegisteredMaterials = 0;
-
         bool reRenderAll = false;
 
+        /** Guard the capture request, set from the ecs thread and read by the render thread */
+        std::mutex captureMutex;
+
         bool saveCurrentFrame = false;
 
+        std::string capturePath;
+
     private:
         void initializeParameters();
 
         void setState(const OpenGLState& state);
 
-        void processRenderCall(const RenderCall& call, const RefracRef& rTable, unsigned int screenWidth, unsigned int screenHeight);
+        /** Select the depth mode of a call: opaque calls test and write, transparent ones only test */
+        void setDepthState(const RenderCall& call);
+
+        void processRenderCall(const RenderCall& call, const RefracRef& rTable);
+
+        /** Compute the camera matrices of every viewport for the frame */
+        void updateCameraBlocks(int screenWidth, int screenHeight);
+
+        /** Result of the last merge of a renderer regarding culling */
+        struct RendererCulling
+        {
+            /** The renderer submitted calls that can be culled, so it must be merged again when a viewport moves */
+            bool cullable = false;
+
+            /** Number of instances culled during the last merge */
+            size_t nbCulled = 0;
+        };
+
+        /** Outcome of the culling of a render call */
+        enum class CullResult
+        {
+            Visible,
+            Partial,
+            Hidden
+        };
+
+        /**
+         * @brief Compute the visible rectangle of every viewport
+         *
+         * @return true If a rectangle changed since the last call
+         */
+        bool updateCullRects();
+
+        /**
+         * @brief Test the instances of a render call against the rectangle of its viewport
+         *
+         * @param rc Render call to test
+         * @param culling Culling state of the renderer of the call
+         * @param visible Receive the visible instances when only part of them are visible
+         */
+        CullResult cullRenderCall(const RenderCall& rc, RendererCulling& culling, std::vector<float>& visible) const;
+
+        /** Sort, cull and batch a range of render calls of a single renderer, can run on any thread */
+        void mergeRendererCalls(const RenderCall *calls, size_t nbCalls, std::vector<RenderCall>& batches, RendererCulling& culling);
+
+        /** Merge the cached batches of all the renderers into a single sorted list */
+        void spliceRendererBatches(std::vector<RenderCall>& merged);
 
         void registerTexture(const std::string& name, const std::function<OpenGLTexture(size_t)>& callback);
 
-        void getFrameData();
+        /**
+         * @brief Copy a small texture in the runtime atlas, must be called from the render thread
+         *
+         * @param name Name of the texture
+         * @param data Pixels of the texture in RGBA
+         * @param width Width of the texture
+         * @param height Height of the texture
+         */
+        void packTexture(const std::string& name, const unsigned char *data, int width, int height);
+
+        /**
+         * @brief Create or fill a GL texture with RGBA pixels, must be called from the render thread
+         *
+         * @param data Pixels of the texture in RGBA
+         * @param width Width of the texture
+         * @param height Height of the texture
+         * @param oldId Id of the GL texture to reuse, 0 to create a new one
+         */
+        OpenGLTexture uploadTexture(const unsigned char *data, int width, int height, unsigned int oldId = 0);
+
+        /**
+         * @brief Register a texture showing the placeholder right away and send its file to the decoding workers
+         *
+         * @param name Name of the texture
+         * @param path Path of the file to decode
+         * @param oldId Id of the GL texture to reuse, 0 to create a new one
+         */
+        OpenGLTexture registerTextureAsync(const std::string& name, const std::string& path, size_t oldId);
+
+        /** Start the readback of the frame just drawn if one was asked, and hand back the captures that are done */
+        void processFrameCaptures(int screenWidth, int screenHeight);
 
     private:
         RefracRef systemParameters;
         std::unordered_map<std::string, OpenGLShaderProgram*> shaderList;
         std::unordered_map<std::string, OpenGLTexture> textureList;
-        std::vector<Material> materialList;
-        std::unordered_map<std::string, size_t> materialDict;
 
-        std::vector<BaseCamera2D*> cameraList;
+        /** Registered materials, ids are given at registration and read by both threads without locking */
+        AppendOnlyTable<Material> materials;
 
-        std::vector<Material> materialListTemp;
-        std::unordered_map<std::string, size_t> materialDictTemp;
-
-        size_t nbMaterials = 0;
+        std::vector<BaseCamera2D*> cameraList;
 
         size_t nbCamera = 0;
 
@@ -785,18 +1048,122 @@ namespace pg
         // BaseCamera2D camera;
         Camera camera;
 
-        std::vector<RenderCall> renderCallList[2];
+        /**
+         * Frames handed from execute to renderAll, neither side waits for the other.
+         * renderAll draws the newest packet available, older ones published in between are dropped
+         */
+        TripleBuffer<FramePacket> framePackets;
 
-        std::atomic<unsigned char> currentRenderList {0};
+        std::atomic<size_t> nbDroppedFrames {0};
 
         std::unordered_map<std::string, LoadedAtlas> atlasMap;
 
+        /** Pages where the small textures are packed, so sprites using different textures can share a batch */
+        RuntimeTextureAtlas runtimeAtlas;
+
+        /** Place of each packed texture in the runtime atlas, only used by the render thread */
+        std::unordered_map<std::string, RuntimeTextureAtlas::Placement> packedPlacements;
+
+        /** Place of each packed texture, written by the render thread and read by the ecs */
+        std::unordered_map<std::string, PackedTexture> packedTextures;
+
+        mutable std::mutex packedTexturesMutex;
+
+        std::atomic<bool> texturePacking {true};
+
+        /** Decoded textures stored on disk, disabled until a directory is set */
+        TextureCache textureCache;
+
+        /** Workers decoding the textures queued with a path */
+        AsyncTextureDecoder textureDecoder;
+
+        std::atomic<size_t> textureUploadBudget {4 * 1024 * 1024};
+
+        /** Pixels of the NoneIcon, shown by the textures until their decoded pixels are uploaded */
+        DecodedTexture placeholderTexture;
+
         size_t nbGeneratedFrames = 0;
 
         size_t nbRenderedFrames = 0;
 
         std::vector<BaseAbstractRenderer*> renderers;
 
+        /** Sorted batches of each renderer, only rebuilt when the renderer is dirty */
+        std::vector<std::vector<RenderCall>> rendererBatches;
+
+        /** Culling state of each renderer, matching rendererBatches */
+        std::vector<RendererCulling> rendererCulling;
+
+        /** Counters of the frame being drawn, only touched by the render thread */
+        FrameStats frameStats;
+
+        /** Guard the stats history, read from other threads */
+        mutable std::mutex statsMutex;
+
+        RenderStatsHistory statsHistory;
+
+        std::atomic<bool> gpuTimersEnabled {false};
+
+        /** Last gpu time of each stage read back from the backend */
+        double lastGpuTime[NbTimedRenderStages] = {0.0, 0.0, 0.0};
+
+        bool hasGpuTime = false;
+
+        /** Pixel buffers reading the captured frames back */
+        FrameCapture frameCapture;
+
+        /** Worker writing the captured frames saved to a file */
+        FrameEncoder frameEncoder;
+
+        /** Captures handed back by the frame capture, kept to reuse its storage */
+        std::vector<CapturedFrame> capturedFrames;
+
+        /** A range of the render calls of a renderer, merged on its own by the job pool */
+        struct MergeJob
+        {
+            size_t renderer;
+            size_t start;
+            size_t end;
+        };
+
+        /** Merges of the current pass, the chunks of a renderer follow each other */
+        std::vector<MergeJob> mergeJobs;
+
+        /** Output of each merge job, kept between passes to reuse their storage */
+        std::vector<std::vector<RenderCall>> mergeJobBatches;
+
+        std::vector<RendererCulling> mergeJobCulling;
+
+        /** Smallest number of calls of a merge job when the chunks are sized from the number of threads */
+        static constexpr size_t MinMergeChunkSize = 4096;
+
+        /** Number of calls of a merge job, 0 to split large renderers in one chunk per thread of the job pool */
+        size_t mergeChunkSize = 0;
+
+        /** Visible rectangle of each viewport, the viewports without one are never culled */
+        std::vector<std::pair<bool, CullRect>> viewportCullRects;
+
+        std::atomic<bool> cullingEnabled {true};
+
         OpenGLState currentState;
+
+        /** Program currently bound during renderAll, used to skip redundant binds (the material stands for it when it has no shader) */
+        const void *boundProgram = nullptr;
+
+        /** Texture currently bound to each texture unit during renderAll */
+        unsigned int boundTextures[16] = {0};
+
+        /** Depth mode currently set on the backend during renderAll */
+        DepthMode currentDepthMode = DepthMode::Disabled;
+
+        /** An opaque call wrote in the depth buffer during renderAll, in the viewport depthViewport */
+        bool depthWritten = false;
+        uint8_t depthViewport = 0;
+
+        /** Backend receiving the filtered draw stream */
+        std::unique_ptr<RenderBackend> backend = std::make_unique<OpenGLRenderBackend>();
+
+        /** Camera matrices of every viewport, shared by all the draws of the frame */
+        CameraUniformBuffer cameraBuffer;
     };
 }
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include "stdafx.h"
+
+#include "renderpayload.h"
+
+#include <algorithm>
+#include <new>
+
+#include "logger.h"
+
+namespace pg
+{
+    namespace
+    {
+        static constexpr const char * const DOM = "Render Payload";
+
+        /** Guard of the spinlocks of the pool */
+        struct SpinLockGuard
+        {
+            SpinLockGuard(std::atomic_flag& lock) : lock(lock) { while (lock.test_and_set(std::memory_order_acquire)) { } }
+            ~SpinLockGuard() { lock.clear(std::memory_order_release); }
+
+            std::atomic_flag& lock;
+        };
+    }
+
+    RenderPayloadPool& RenderPayloadPool::get()
+    {
+        // Never destroyed, so render calls held by static objects can still give their blocks back at exit
+        static RenderPayloadPool *pool = new RenderPayloadPool();
+
+        return *pool;
+    }
+
+    RenderPayloadPool::~RenderPayloadPool()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        for (size_t i = 0; i < NbClasses; ++i)
+        {
+            if ((MinBlockSize << i) <= MaxSlabBlockSize)
+                continue;
+
+            auto block = classes[i].freeList;
+
+            while (block)
+            {
+                auto next = block->next;
+
+                ::operator delete(block);
+
+                block = next;
+            }
+        }
+
+        for (auto slab : slabs)
+            ::operator delete(slab);
+    }
+
+    size_t RenderPayloadPool::classOf(size_t size)
+    {
+        size_t index = 0;
+
+        while ((MinBlockSize << index) < size)
+            ++index;
+
+        return index;
+    }
+
+    float* RenderPayloadPool::carve(size_t capacity)
+    {
+        SpinLockGuard guard(slabLock);
+
+        if (slabOffset + capacity > SlabSize)
+        {
+            // The end of the previous slab is lost, it is at most a block smaller than MaxSlabBlockSize
+            slabs.push_back(static_cast<float*>(::operator new(SlabSize * sizeof(float))));
+            slabOffset = 0;
+
+            nbHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        auto block = slabs.back() + slabOffset;
+
+        slabOffset += capacity;
+
+        return block;
+    }
+
+    float* RenderPayloadPool::allocate(size_t size, size_t& capacity)
+    {
+        const size_t index = classOf(std::max(size, MinBlockSize));
+
+        if (index >= NbClasses)
+        {
+            // Bigger than the biggest class, the block is never recycled
+            capacity = size;
+
+            nbHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+            return static_cast<float*>(::operator new(size * sizeof(float)));
+        }
+
+        capacity = MinBlockSize << index;
+
+        auto& sizeClass = classes[index];
+
+        {
+            SpinLockGuard guard(sizeClass.lock);
+
+            if (sizeClass.freeList)
+            {
+                auto block = sizeClass.freeList;
+
+                sizeClass.freeList = block->next;
+                sizeClass.retainedBytes -= capacity * sizeof(float);
+
+                return reinterpret_cast<float*>(block);
+            }
+        }
+
+        if (capacity <= MaxSlabBlockSize)
+            return carve(capacity);
+
+        nbHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+        return static_cast<float*>(::operator new(capacity * sizeof(float)));
+    }
+
+    void RenderPayloadPool::release(float *block, size_t capacity)
+    {
+        if (not block)
+            return;
+
+        const size_t index = classOf(capacity);
+
+        if (index >= NbClasses or (MinBlockSize << index) != capacity)
+        {
+            ::operator delete(block);
+            return;
+        }
+
+        auto& sizeClass = classes[index];
+
+        const size_t bytes = capacity * sizeof(float);
+
+        {
+            SpinLockGuard guard(sizeClass.lock);
+
+            // Blocks carved out of slabs always go back to their list, big blocks are only kept up to a limit
+            if (capacity <= MaxSlabBlockSize or sizeClass.retainedBytes + bytes <= MaxRetainedBytes)
+            {
+                auto freeBlock = reinterpret_cast<FreeBlock*>(block);
+
+                freeBlock->next = sizeClass.freeList;
+                sizeClass.freeList = freeBlock;
+                sizeClass.retainedBytes += bytes;
+
+                return;
+            }
+        }
+
+        ::operator delete(block);
+    }
+
+    void RenderPayload::release()
+    {
+        RenderPayloadPool::get().release(buffer, capacity_);
+
+        buffer = nullptr;
+        count = 0;
+        capacity_ = 0;
+    }
+
+    void RenderPayload::reserve(size_t n)
+    {
+        if (n <= capacity_)
+            return;
+
+        size_t newCapacity;
+
+        auto newBuffer = RenderPayloadPool::get().allocate(std::max(n, capacity_ * 2), newCapacity);
+
+        if (count > 0)
+            std::memcpy(newBuffer, buffer, count * sizeof(float));
+
+        const size_t oldCount = count;
+
+        release();
+
+        buffer = newBuffer;
+        count = oldCount;
+        capacity_ = newCapacity;
+    }
+
+    void RenderPayload::resize(size_t n, float value)
+    {
+        reserve(n);
+
+        if (n > count)
+            std::fill(buffer + count, buffer + n, value);
+
+        count = n;
+    }
+
+    void RenderPayload::assign(const float *first, const float *last)
+    {
+        const size_t n = static_cast<size_t>(last - first);
+
+        count = 0;
+
+        reserve(n);
+
+        if (n > 0)
+            std::memcpy(buffer, first, n * sizeof(float));
+
+        count = n;
+    }
+
+    RenderPayload::iterator RenderPayload::insert(const_iterator pos, const float *first, const float *last)
+    {
+        const size_t index = static_cast<size_t>(pos - buffer);
+        const size_t n = static_cast<size_t>(last - first);
+
+        if (n == 0)
+            return buffer + index;
+
+        // The inserted range can't come from this payload as reserve may move it
+        reserve(count + n);
+
+        if (index < count)
+            std::memmove(buffer + index + n, buffer + index, (count - index) * sizeof(float));
+
+        std::memcpy(buffer + index, first, n * sizeof(float));
+
+        count += n;
+
+        return buffer + index;
+    }
+}
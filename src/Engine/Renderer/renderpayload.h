@@ -0,0 +1,241 @@
+#pragma once
+
+/**
+ * @file renderpayload.h
+ * @author Pigeon Codeur
+ * @brief Definition of the instance data of the render calls and of the slab pool recycling it
+ * @version 0.1
+ * @date 2025-04-16
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+#include <vector>
+#include <initializer_list>
+
+namespace pg
+{
+    /**
+     * @brief A pool of float blocks sorted in power of two size classes
+     *
+     * Small blocks are carved out of big slabs, bigger ones are allocated on their own. Freed blocks go back to the
+     * free list of their class and are handed out again to the next payload of the same class, so once the render calls
+     * of a scene reached their steady state, generating and merging them doesn't touch the heap anymore.
+     *
+     * Each class is guarded by its own spinlock, blocks can be allocated and freed from any thread.
+     */
+    class RenderPayloadPool
+    {
+    public:
+        /** Number of floats of the smallest class */
+        static constexpr size_t MinBlockSize = 16;
+
+        /** Number of size classes, the biggest one holds MinBlockSize << (NbClasses - 1) floats */
+        static constexpr size_t NbClasses = 24;
+
+        /** Blocks up to this number of floats are carved out of slabs */
+        static constexpr size_t MaxSlabBlockSize = 1024;
+
+        /** Number of floats of a slab */
+        static constexpr size_t SlabSize = 64 * 1024;
+
+        /** Bytes of free blocks kept by each class of standalone blocks, the others are given back to the heap */
+        static constexpr size_t MaxRetainedBytes = 32 * 1024 * 1024;
+
+        /** Get the pool shared by all the render calls */
+        static RenderPayloadPool& get();
+
+        RenderPayloadPool() {}
+
+        /** Pools can't be copied as they own memory */
+        RenderPayloadPool(const RenderPayloadPool&) = delete;
+
+        ~RenderPayloadPool();
+
+        /**
+         * @brief Get a block able to hold at least size floats
+         *
+         * @param size Number of floats needed
+         * @param capacity Receive the real number of floats of the block
+         */
+        float* allocate(size_t size, size_t& capacity);
+
+        /** Give back a block allocated with the given capacity */
+        void release(float *block, size_t capacity);
+
+        /** Get the number of blocks allocated on the heap (slabs and standalone blocks) since the creation of the pool */
+        inline size_t getNbHeapAllocations() const { return nbHeapAllocations.load(std::memory_order_relaxed); }
+
+    private:
+        /** Header written at the start of a free block, linking it to the next free block of its class */
+        struct FreeBlock
+        {
+            FreeBlock *next;
+        };
+
+        struct alignas(64) SizeClass
+        {
+            std::atomic_flag lock = ATOMIC_FLAG_INIT;
+
+            FreeBlock *freeList = nullptr;
+
+            /** Bytes of the blocks held in the free list */
+            size_t retainedBytes = 0;
+        };
+
+        /** Get the class of the smallest block holding size floats */
+        static size_t classOf(size_t size);
+
+        /** Carve a new block of a small class out of the current slab */
+        float* carve(size_t capacity);
+
+        SizeClass classes[NbClasses];
+
+        std::atomic_flag slabLock = ATOMIC_FLAG_INIT;
+
+        std::vector<float*> slabs;
+
+        /** Floats left in the last slab */
+        size_t slabOffset = SlabSize;
+
+        std::atomic<size_t> nbHeapAllocations {0};
+    };
+
+    /**
+     * @brief The instance data of a render call
+     *
+     * Behaves like a std::vector<float> but its storage comes from the RenderPayloadPool,
+     * so the per entity calls and the batches merged every frame recycle the same blocks instead of going through the heap.
+     */
+    class RenderPayload
+    {
+    public:
+        using value_type = float;
+        using size_type = size_t;
+        using iterator = float*;
+        using const_iterator = const float*;
+
+        RenderPayload() {}
+
+        RenderPayload(std::initializer_list<float> values) { assign(values.begin(), values.end()); }
+
+        RenderPayload(const std::vector<float>& values) { assign(values.data(), values.data() + values.size()); }
+
+        RenderPayload(const RenderPayload& other) { assign(other.begin(), other.end()); }
+
+        RenderPayload(RenderPayload&& other) noexcept : buffer(other.buffer), count(other.count), capacity_(other.capacity_)
+        {
+            other.buffer = nullptr;
+            other.count = 0;
+            other.capacity_ = 0;
+        }
+
+        ~RenderPayload() { release(); }
+
+        RenderPayload& operator=(const RenderPayload& other)
+        {
+            if (this != &other)
+                assign(other.begin(), other.end());
+
+            return *this;
+        }
+
+        RenderPayload& operator=(RenderPayload&& other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+
+                buffer = other.buffer;
+                count = other.count;
+                capacity_ = other.capacity_;
+
+                other.buffer = nullptr;
+                other.count = 0;
+                other.capacity_ = 0;
+            }
+
+            return *this;
+        }
+
+        RenderPayload& operator=(std::initializer_list<float> values)
+        {
+            assign(values.begin(), values.end());
+
+            return *this;
+        }
+
+        RenderPayload& operator=(const std::vector<float>& values)
+        {
+            assign(values.data(), values.data() + values.size());
+
+            return *this;
+        }
+
+        inline size_t size() const { return count; }
+        inline size_t capacity() const { return capacity_; }
+        inline bool empty() const { return count == 0; }
+
+        inline float* data() { return buffer; }
+        inline const float* data() const { return buffer; }
+
+        inline float& operator[](size_t index) { return buffer[index]; }
+        inline const float& operator[](size_t index) const { return buffer[index]; }
+
+        inline iterator begin() { return buffer; }
+        inline iterator end() { return buffer + count; }
+        inline const_iterator begin() const { return buffer; }
+        inline const_iterator end() const { return buffer + count; }
+
+        /** Make room for at least n floats, the content is kept */
+        void reserve(size_t n);
+
+        /** Resize the payload, new floats are set to value */
+        void resize(size_t n, float value = 0.0f);
+
+        /** Empty the payload but keep its block */
+        inline void clear() { count = 0; }
+
+        inline void push_back(float value)
+        {
+            if (count == capacity_)
+                reserve(count + 1);
+
+            buffer[count++] = value;
+        }
+
+        /** Replace the content with the floats in [first, last[ */
+        void assign(const float *first, const float *last);
+
+        /** Insert the floats in [first, last[ before pos */
+        iterator insert(const_iterator pos, const float *first, const float *last);
+
+        /** Append count floats at the end of the payload */
+        inline void append(const float *values, size_t n) { insert(end(), values, values + n); }
+
+        inline void swap(RenderPayload& other) noexcept
+        {
+            std::swap(buffer, other.buffer);
+            std::swap(count, other.count);
+            std::swap(capacity_, other.capacity_);
+        }
+
+        bool operator==(const RenderPayload& rhs) const { return count == rhs.count and (count == 0 or std::memcmp(buffer, rhs.buffer, count * sizeof(float)) == 0); }
+
+        bool operator!=(const RenderPayload& rhs) const { return not (*this == rhs); }
+
+    private:
+        /** Give the block back to the pool */
+        void release();
+
+        float *buffer = nullptr;
+
+        size_t count = 0;
+
+        size_t capacity_ = 0;
+    };
+}
@@ -0,0 +1,69 @@
+#include "stdafx.h"
+
+#include "renderqueue.h"
+
+#include <cstring>
+
+namespace pg
+{
+    void radixSortRenderQueue(RenderQueueEntry *entries, RenderQueueEntry *scratch, size_t count)
+    {
+        if (count < 2)
+            return;
+
+        // Build the histograms of the 8 bytes of the keys in a single read of the entries
+        size_t histograms[8][256];
+        std::memset(histograms, 0, sizeof(histograms));
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const uint64_t key = entries[i].key;
+
+            for (size_t pass = 0; pass < 8; pass++)
+                histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+        }
+
+        RenderQueueEntry *src = entries;
+        RenderQueueEntry *dst = scratch;
+
+        for (size_t pass = 0; pass < 8; pass++)
+        {
+            auto& histogram = histograms[pass];
+
+            const size_t shift = pass * 8;
+
+            // All the keys have the same byte here, this pass would not move anything
+            if (histogram[(src[0].key >> shift) & 0xFF] == count)
+                continue;
+
+            size_t offset = 0;
+
+            for (size_t digit = 0; digit < 256; digit++)
+            {
+                const size_t nb = histogram[digit];
+                histogram[digit] = offset;
+                offset += nb;
+            }
+
+            for (size_t i = 0; i < count; i++)
+            {
+                const auto& entry = src[i];
+
+                dst[histogram[(entry.key >> shift) & 0xFF]++] = entry;
+            }
+
+            std::swap(src, dst);
+        }
+
+        // An odd number of passes leaves the result in the scratch buffer
+        if (src != entries)
+            std::memcpy(entries, src, count * sizeof(RenderQueueEntry));
+    }
+
+    void RenderQueue::sort()
+    {
+        scratch.resize(entries.size());
+
+        radixSortRenderQueue(entries.data(), scratch.data(), entries.size());
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+/**
+ * @file renderqueue.h
+ * @author Pigeon Codeur
+ * @brief Definition of the flat render queue used to sort the render calls of a frame
+ * @version 0.1
+ * @date 2025-03-03
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "Memory/frameallocator.h"
+
+namespace pg
+{
+    // Forward declarations
+    struct RenderCall;
+
+    /** An entry of the render queue: the sort key of a render call and where to find it */
+    struct RenderQueueEntry
+    {
+        uint64_t key;
+
+        const RenderCall *call;
+    };
+
+    /**
+     * @brief Sort an array of render queue entries by key using an LSD radix sort
+     *
+     * @param entries Entries to sort, they are sorted in place
+     * @param scratch Scratch buffer of at least count entries
+     * @param count Number of entries
+     *
+     * The sort is stable, entries with the same key stay in submission order.
+     * Passes over a byte that is identical for all the keys are skipped.
+     */
+    void radixSortRenderQueue(RenderQueueEntry *entries, RenderQueueEntry *scratch, size_t count);
+
+    /**
+     * @brief A flat list of render calls to be sorted by key
+     *
+     * Entries only reference the render calls, so building the queue doesn't copy nor allocate any call.
+     * The storage comes from a frame allocator when one is given, so the queue must not outlive the next frame.
+     */
+    class RenderQueue
+    {
+    public:
+        using Entries = std::vector<RenderQueueEntry, ArenaAllocator<RenderQueueEntry>>;
+
+        RenderQueue(FrameAllocator *frame = nullptr) : entries(ArenaAllocator<RenderQueueEntry>(frame)), scratch(ArenaAllocator<RenderQueueEntry>(frame)) {}
+
+        /** Reserve space for a number of entries */
+        inline void reserve(size_t size) { entries.reserve(size); }
+
+        /** Add a render call to the queue */
+        inline void push(uint64_t key, const RenderCall *call) { entries.push_back(RenderQueueEntry{key, call}); }
+
+        /** Sort the queue by key, keeping the submission order of calls with the same key */
+        void sort();
+
+        inline size_t size() const { return entries.size(); }
+
+        inline bool empty() const { return entries.empty(); }
+
+        inline const RenderQueueEntry& operator[](size_t index) const { return entries[index]; }
+
+        inline Entries::const_iterator begin() const { return entries.begin(); }
+        inline Entries::const_iterator end() const { return entries.end(); }
+
+    private:
+        Entries entries;
+
+        Entries scratch;
+    };
+}
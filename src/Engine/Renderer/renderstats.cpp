@@ -0,0 +1,268 @@
+#include "stdafx.h"
+
+#include "renderstats.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "logger.h"
+
+#include "Helpers/openglobject.h"
+
+namespace pg
+{
+    namespace
+    {
+        static constexpr const char * const DOM = "Render Stats";
+    }
+
+    RenderStatsHistory::RenderStatsHistory(size_t capacity) : frames(std::max(capacity, static_cast<size_t>(1)))
+    {
+        LOG_THIS_MEMBER(DOM);
+    }
+
+    void RenderStatsHistory::push(const FrameStats& stats)
+    {
+        frames[next] = stats;
+
+        next = (next + 1) % frames.size();
+
+        if (count < frames.size())
+            count++;
+    }
+
+    void RenderStatsHistory::clear()
+    {
+        next = 0;
+        count = 0;
+    }
+
+    void RenderStatsHistory::setCapacity(size_t capacity)
+    {
+        frames.assign(std::max(capacity, static_cast<size_t>(1)), FrameStats{});
+
+        clear();
+    }
+
+    const FrameStats& RenderStatsHistory::at(size_t index) const
+    {
+        // The oldest frame sits right after the last written one once the buffer wrapped around
+        const size_t first = (next + frames.size() - count) % frames.size();
+
+        return frames[(first + index) % frames.size()];
+    }
+
+    double RenderStatsHistory::getMetric(const FrameStats& stats, RenderMetric metric)
+    {
+        switch (metric)
+        {
+            case RenderMetric::Batches:         return static_cast<double>(stats.nbBatches);
+            case RenderMetric::DrawCalls:       return static_cast<double>(stats.nbDrawCalls);
+            case RenderMetric::Instances:       return static_cast<double>(stats.nbInstances);
+            case RenderMetric::UploadedBytes:   return static_cast<double>(stats.nbUploadedBytes);
+            case RenderMetric::ProgramBinds:    return static_cast<double>(stats.nbProgramBinds);
+            case RenderMetric::StateChanges:    return static_cast<double>(stats.nbStateChanges);
+            case RenderMetric::TextureBinds:    return static_cast<double>(stats.nbTextureBinds);
+            case RenderMetric::CulledInstances: return static_cast<double>(stats.nbCulledInstances);
+            case RenderMetric::CpuTime:         return stats.cpuTime;
+            case RenderMetric::FrameLatency:    return stats.frameLatency;
+            case RenderMetric::GpuTime:
+            {
+                double total = 0.0;
+
+                for (size_t i = 0; i < NbTimedRenderStages; ++i)
+                    total += stats.gpuTime[i];
+
+                return total;
+            }
+        }
+
+        return 0.0;
+    }
+
+    MetricSummary RenderStatsHistory::summarize(RenderMetric metric) const
+    {
+        MetricSummary summary;
+
+        std::vector<double> values;
+        values.reserve(count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto& stats = at(i);
+
+            if (metric == RenderMetric::GpuTime and not stats.hasGpuTime)
+                continue;
+
+            values.push_back(getMetric(stats, metric));
+        }
+
+        if (values.empty())
+            return summary;
+
+        double total = 0.0;
+
+        for (auto value : values)
+        {
+            total += value;
+            summary.max = std::max(summary.max, value);
+        }
+
+        summary.nbFrames = values.size();
+        summary.average = total / values.size();
+
+        // Nearest rank percentile: the smallest value greater or equal to 99% of the frames
+        const size_t rank = static_cast<size_t>(std::ceil(0.99 * values.size()));
+        const auto p99 = values.begin() + (rank > 0 ? rank - 1 : 0);
+
+        std::nth_element(values.begin(), p99, values.end());
+
+        summary.p99 = *p99;
+
+        return summary;
+    }
+
+    GpuStageTimer::~GpuStageTimer()
+    {
+        if (not initialized)
+            return;
+
+#ifndef __EMSCRIPTEN__
+        for (auto& frame : frames)
+            glDeleteQueries(NbTimedRenderStages, frame.queries);
+#endif
+    }
+
+    bool GpuStageTimer::isSupported()
+    {
+        if (initialized)
+            return supported;
+
+        initialized = true;
+
+#ifdef __EMSCRIPTEN__
+        // WebGL only exposes timer queries through an extension that is disabled in most browsers
+        supported = false;
+#else
+        supported = GLEW_VERSION_3_3 or GLEW_ARB_timer_query;
+
+        if (supported)
+        {
+            for (auto& frame : frames)
+                glGenQueries(NbTimedRenderStages, frame.queries);
+        }
+        else
+        {
+            LOG_WARNING(DOM, "Timer queries are not supported by this context, the gpu time of the stages won't be measured");
+        }
+#endif
+
+        return supported;
+    }
+
+    void GpuStageTimer::beginFrame()
+    {
+        if (not isSupported())
+            return;
+
+        auto& frame = frames[current];
+
+        // Measures never read are dropped, the queries are reused for this frame
+        frame.pending = false;
+
+        std::fill(std::begin(frame.used), std::end(frame.used), false);
+
+        runningStage = NbTimedRenderStages;
+    }
+
+    void GpuStageTimer::beginStage(size_t stage)
+    {
+        if (not isSupported() or stage >= NbTimedRenderStages or stage == runningStage)
+            return;
+
+        endStage();
+
+        auto& frame = frames[current];
+
+        // Stages are sorted in the render calls, but a stage drawn twice in a frame would reuse its query
+        if (frame.used[stage])
+            return;
+
+#ifndef __EMSCRIPTEN__
+        glBeginQuery(GL_TIME_ELAPSED, frame.queries[stage]);
+#endif
+
+        frame.used[stage] = true;
+
+        runningStage = stage;
+    }
+
+    void GpuStageTimer::endStage()
+    {
+        if (runningStage >= NbTimedRenderStages)
+            return;
+
+#ifndef __EMSCRIPTEN__
+        glEndQuery(GL_TIME_ELAPSED);
+#endif
+
+        runningStage = NbTimedRenderStages;
+    }
+
+    void GpuStageTimer::endFrame()
+    {
+        if (not isSupported())
+            return;
+
+        endStage();
+
+        frames[current].pending = true;
+
+        current = (current + 1) % NbFramesInFlight;
+    }
+
+    bool GpuStageTimer::collect(double *times)
+    {
+        if (not isSupported())
+            return false;
+
+        // Once endFrame moved on, the current slot holds the oldest frame in flight
+        auto& frame = frames[current];
+
+        if (not frame.pending)
+            return false;
+
+#ifndef __EMSCRIPTEN__
+        for (size_t i = 0; i < NbTimedRenderStages; ++i)
+        {
+            if (not frame.used[i])
+                continue;
+
+            GLint available = 0;
+
+            glGetQueryObjectiv(frame.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+
+            if (not available)
+                return false;
+        }
+
+        for (size_t i = 0; i < NbTimedRenderStages; ++i)
+        {
+            times[i] = 0.0;
+
+            if (not frame.used[i])
+                continue;
+
+            GLuint64 elapsed = 0;
+
+            glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &elapsed);
+
+            times[i] = elapsed / 1000.0;
+        }
+#endif
+
+        frame.pending = false;
+
+        return true;
+    }
+}
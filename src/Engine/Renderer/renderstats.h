@@ -0,0 +1,204 @@
+#pragma once
+
+/**
+ * @file renderstats.h
+ * @author Pigeon Codeur
+ * @brief Definition of the per frame statistics of the master renderer, their history and the gpu timers of the render stages
+ * @version 0.1
+ * @date 2025-04-18
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pg
+{
+    /** Number of render stages measured by the gpu timers (Render, PreRender and PostProcess) */
+    constexpr size_t NbTimedRenderStages = 3;
+
+    /** Counters of a frame drawn by the master renderer */
+    struct FrameStats
+    {
+        /** Number of render calls of the frame, after batching */
+        size_t nbBatches = 0;
+
+        /** Number of draws issued, batches with no instance to draw are not counted */
+        size_t nbDrawCalls = 0;
+
+        size_t nbInstances = 0;
+
+        /** Number of instance bytes sent to the gpu */
+        size_t nbUploadedBytes = 0;
+
+        size_t nbProgramBinds = 0;
+
+        /** Number of scissor and depth state changes */
+        size_t nbStateChanges = 0;
+
+        size_t nbTextureBinds = 0;
+
+        /** Number of instances skipped because they were outside of their viewport */
+        size_t nbCulledInstances = 0;
+
+        /** Time spent by the render thread issuing the frame, in microseconds */
+        double cpuTime = 0.0;
+
+        /** Number of the generated frame that was drawn, the same frame is drawn again when execute didn't produce a new one */
+        size_t frameId = 0;
+
+        /** Time between the generation of the drawn frame and the start of its draw, in microseconds */
+        double frameLatency = 0.0;
+
+        /**
+         * @brief Gpu time of each render stage, in microseconds
+         *
+         * Timer queries are read a few frames after they were issued, so this is the last measure available when the frame ended
+         */
+        double gpuTime[NbTimedRenderStages] = {0.0, 0.0, 0.0};
+
+        /** The gpu timers are enabled and a measure was available */
+        bool hasGpuTime = false;
+    };
+
+    /** A value tracked by the stats history */
+    enum class RenderMetric : uint8_t
+    {
+        Batches,
+        DrawCalls,
+        Instances,
+        UploadedBytes,
+        ProgramBinds,
+        StateChanges,
+        TextureBinds,
+        CulledInstances,
+        CpuTime,
+        FrameLatency,
+        /** Sum of the gpu time of all the stages, frames without a measure are ignored */
+        GpuTime
+    };
+
+    /** Aggregated values of a metric over the frames of a history */
+    struct MetricSummary
+    {
+        double average = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+
+        /** Number of frames the summary is computed from */
+        size_t nbFrames = 0;
+    };
+
+    /** Ring buffer keeping the stats of the last frames */
+    class RenderStatsHistory
+    {
+    public:
+        /**
+         * @brief Construct a new Render Stats History object
+         *
+         * @param capacity Number of frames kept, the oldest ones are overwritten
+         */
+        RenderStatsHistory(size_t capacity = 240);
+
+        void push(const FrameStats& stats);
+
+        void clear();
+
+        /** Change the number of frames kept, the history is cleared */
+        void setCapacity(size_t capacity);
+
+        inline size_t capacity() const { return frames.size(); }
+
+        inline size_t size() const { return count; }
+
+        inline bool empty() const { return count == 0; }
+
+        /** Get a frame of the history, 0 being the oldest one */
+        const FrameStats& at(size_t index) const;
+
+        /** Get the most recent frame, the history must not be empty */
+        inline const FrameStats& back() const { return at(count - 1); }
+
+        /** Compute the average, 99th percentile and maximum of a metric over the history */
+        MetricSummary summarize(RenderMetric metric) const;
+
+        /** Get the value of a metric for a single frame */
+        static double getMetric(const FrameStats& stats, RenderMetric metric);
+
+    private:
+        std::vector<FrameStats> frames;
+
+        /** Index where the next frame is written */
+        size_t next = 0;
+
+        size_t count = 0;
+    };
+
+    /**
+     * @brief GL_TIME_ELAPSED queries measuring the gpu time of each render stage
+     *
+     * The queries of a frame are only read NbFramesInFlight frames later, once they are available,
+     * so measuring never stalls the pipeline. Must be used from the render thread.
+     */
+    class GpuStageTimer
+    {
+    public:
+        /** Number of frames whose queries can be pending at the same time */
+        static constexpr size_t NbFramesInFlight = 3;
+
+        GpuStageTimer() {}
+
+        /** Timers own gl queries, they can't be copied */
+        GpuStageTimer(const GpuStageTimer&) = delete;
+
+        ~GpuStageTimer();
+
+        /** Check if the current context supports timer queries */
+        bool isSupported();
+
+        void beginFrame();
+
+        /** End the measure of the previous stage and start the measure of this one */
+        void beginStage(size_t stage);
+
+        void endFrame();
+
+        /**
+         * @brief Read the measures of the oldest frame in flight
+         *
+         * @param times Receive the time of each stage in microseconds, stages not drawn in the frame are set to 0
+         *
+         * @return true If a frame was measured since the last call
+         */
+        bool collect(double *times);
+
+    private:
+        struct FrameQueries
+        {
+            unsigned int queries[NbTimedRenderStages] = {0, 0, 0};
+
+            /** The stage was drawn during the frame */
+            bool used[NbTimedRenderStages] = {false, false, false};
+
+            /** The queries of the frame were issued and not read yet */
+            bool pending = false;
+        };
+
+        void endStage();
+
+        FrameQueries frames[NbFramesInFlight];
+
+        /** Frame whose queries are being issued */
+        size_t current = 0;
+
+        /** Stage whose query is running, NbTimedRenderStages if none */
+        size_t runningStage = NbTimedRenderStages;
+
+        bool initialized = false;
+
+        bool supported = false;
+    };
+}
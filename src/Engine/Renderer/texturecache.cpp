@@ -0,0 +1,286 @@
+#include "stdafx.h"
+
+#include "texturecache.h"
+
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <functional>
+
+#if defined(__linux__) || defined(__APPLE__)
+#define PG_TEXTURE_CACHE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "logger.h"
+
+namespace pg
+{
+    namespace
+    {
+        static constexpr const char * const DOM = "Texture Cache";
+
+        /** Pixels start on a 16 bytes boundary so they can be read with aligned loads */
+        static constexpr uint32_t PixelsAlignment = 16;
+
+        bool hashFile(const std::string& path, uint64_t& hash)
+        {
+            std::ifstream file(path, std::ios::binary);
+
+            if (not file)
+                return false;
+
+            hash = fnv1aHash(nullptr, 0);
+
+            std::vector<char> chunk(64 * 1024);
+
+            while (file)
+            {
+                file.read(chunk.data(), chunk.size());
+
+                hash = fnv1aHash(reinterpret_cast<const unsigned char*>(chunk.data()), static_cast<size_t>(file.gcount()), hash);
+            }
+
+            return true;
+        }
+
+        bool getSourceInfo(const std::string& path, int64_t& time, uint64_t& size)
+        {
+            std::error_code ec;
+
+            const auto writeTime = std::filesystem::last_write_time(path, ec);
+
+            if (ec)
+                return false;
+
+            size = std::filesystem::file_size(path, ec);
+
+            if (ec)
+                return false;
+
+            time = static_cast<int64_t>(writeTime.time_since_epoch().count());
+
+            return true;
+        }
+    }
+
+    uint64_t fnv1aHash(const unsigned char *data, size_t size, uint64_t hash)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= data[i];
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    std::shared_ptr<MappedTexture> MappedTexture::open(const std::string& cachePath)
+    {
+        std::shared_ptr<MappedTexture> texture(new MappedTexture());
+
+#ifdef PG_TEXTURE_CACHE_MMAP
+        const int fd = ::open(cachePath.c_str(), O_RDONLY);
+
+        if (fd < 0)
+            return nullptr;
+
+        struct stat info;
+
+        if (fstat(fd, &info) != 0 or info.st_size <= 0)
+        {
+            ::close(fd);
+            return nullptr;
+        }
+
+        void *address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+        // The mapping stays valid once the descriptor is closed
+        ::close(fd);
+
+        if (address == MAP_FAILED)
+            return nullptr;
+
+        texture->data = static_cast<const unsigned char*>(address);
+        texture->size = static_cast<size_t>(info.st_size);
+        texture->mapped = true;
+#else
+        std::ifstream file(cachePath, std::ios::binary | std::ios::ate);
+
+        if (not file)
+            return nullptr;
+
+        texture->buffer.resize(static_cast<size_t>(file.tellg()));
+
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(texture->buffer.data()), texture->buffer.size());
+
+        texture->data = texture->buffer.data();
+        texture->size = texture->buffer.size();
+#endif
+
+        if (not texture->isValid())
+            return nullptr;
+
+        return texture;
+    }
+
+    MappedTexture::~MappedTexture()
+    {
+#ifdef PG_TEXTURE_CACHE_MMAP
+        if (mapped)
+            munmap(const_cast<unsigned char*>(data), size);
+#endif
+    }
+
+    bool MappedTexture::isValid() const
+    {
+        if (size < sizeof(TextureCacheHeader))
+            return false;
+
+        const auto& header = getHeader();
+        const TextureCacheHeader expected;
+
+        if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 or header.version != expected.version)
+            return false;
+
+        if (sizeof(TextureCacheHeader) + header.pathLength > header.pixelsOffset)
+            return false;
+
+        return header.pixelsOffset + getPixelsSize() <= size;
+    }
+
+    void TextureCache::setDirectory(const std::string& directory)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        this->directory = directory;
+
+        if (directory.empty())
+            return;
+
+        std::error_code ec;
+
+        std::filesystem::create_directories(directory, ec);
+
+        if (ec)
+        {
+            LOG_ERROR(DOM, "Can't create the texture cache directory " << directory << ": " << ec.message() << ", the cache is disabled");
+            this->directory.clear();
+        }
+    }
+
+    std::string TextureCache::getCachePath(const std::string& sourcePath) const
+    {
+        const uint64_t hash = fnv1aHash(reinterpret_cast<const unsigned char*>(sourcePath.data()), sourcePath.size());
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.pgtex", static_cast<unsigned long long>(hash));
+
+        return (std::filesystem::path(directory) / name).string();
+    }
+
+    std::shared_ptr<MappedTexture> TextureCache::load(const std::string& sourcePath) const
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (not isEnabled())
+            return nullptr;
+
+        int64_t sourceTime;
+        uint64_t sourceSize;
+
+        if (not getSourceInfo(sourcePath, sourceTime, sourceSize))
+            return nullptr;
+
+        auto texture = MappedTexture::open(getCachePath(sourcePath));
+
+        if (not texture)
+            return nullptr;
+
+        const auto& header = texture->getHeader();
+
+        // Two paths can share a hash, so the cached path must match
+        if (header.sourceSize != sourceSize or texture->getSourcePath() != sourcePath)
+            return nullptr;
+
+        if (header.sourceTime != sourceTime)
+        {
+            // The file was touched, it is only worth decoding again if its content changed
+            uint64_t hash;
+
+            if (not hashFile(sourcePath, hash) or hash != header.sourceHash)
+                return nullptr;
+        }
+
+        return texture;
+    }
+
+    bool TextureCache::store(const std::string& sourcePath, int width, int height, const unsigned char *rgba) const
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (not isEnabled() or width <= 0 or height <= 0)
+            return false;
+
+        TextureCacheHeader header;
+
+        header.width = static_cast<uint32_t>(width);
+        header.height = static_cast<uint32_t>(height);
+        header.pathLength = static_cast<uint32_t>(sourcePath.size());
+
+        const uint32_t pathEnd = static_cast<uint32_t>(sizeof(TextureCacheHeader)) + header.pathLength;
+
+        header.pixelsOffset = (pathEnd + PixelsAlignment - 1) / PixelsAlignment * PixelsAlignment;
+
+        if (not getSourceInfo(sourcePath, header.sourceTime, header.sourceSize) or not hashFile(sourcePath, header.sourceHash))
+            return false;
+
+        const auto cachePath = getCachePath(sourcePath);
+
+        // Written aside then renamed, so a reader never maps a half written file
+        const auto tempPath = cachePath + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+            if (not file)
+            {
+                LOG_ERROR(DOM, "Can't write the texture cache file " << tempPath);
+                return false;
+            }
+
+            const char padding[PixelsAlignment] = {};
+
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(sourcePath.data(), sourcePath.size());
+            file.write(padding, header.pixelsOffset - pathEnd);
+            file.write(reinterpret_cast<const char*>(rgba), static_cast<std::streamsize>(header.width) * header.height * 4);
+
+            if (not file)
+            {
+                LOG_ERROR(DOM, "Failed to write the texture cache file " << tempPath);
+                file.close();
+                std::filesystem::remove(tempPath);
+                return false;
+            }
+        }
+
+        std::error_code ec;
+
+        std::filesystem::rename(tempPath, cachePath, ec);
+
+        if (ec)
+        {
+            LOG_ERROR(DOM, "Can't move the texture cache file to " << cachePath << ": " << ec.message());
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+/**
+ * @file texturecache.h
+ * @author Pigeon Codeur
+ * @brief Definition of the disk cache holding decoded textures, so they can be loaded without decoding their image again
+ * @version 0.1
+ * @date 2025-04-09
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace pg
+{
+    /** Header written at the start of each cached texture, followed by the source path and the RGBA pixels */
+    struct TextureCacheHeader
+    {
+        char magic[4] = {'P', 'G', 'T', 'X'};
+        uint32_t version = 1;
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        /** Last write time of the source file */
+        int64_t sourceTime = 0;
+        uint64_t sourceSize = 0;
+
+        /** FNV-1a hash of the content of the source file */
+        uint64_t sourceHash = 0;
+
+        uint32_t pathLength = 0;
+
+        /** Offset of the pixels from the start of the file */
+        uint32_t pixelsOffset = 0;
+    };
+
+    /**
+     * @brief The pixels of a cached texture, mapped in memory for as long as this object lives
+     *
+     * On platforms without mmap the file is read in memory instead.
+     */
+    class MappedTexture
+    {
+    public:
+        /** Map a cache file, return nullptr if it can't be opened */
+        static std::shared_ptr<MappedTexture> open(const std::string& cachePath);
+
+        ~MappedTexture();
+
+        MappedTexture(const MappedTexture&) = delete;
+        MappedTexture& operator=(const MappedTexture&) = delete;
+
+        inline const TextureCacheHeader& getHeader() const { return *reinterpret_cast<const TextureCacheHeader*>(data); }
+
+        /** Get the source path stored after the header */
+        inline std::string getSourcePath() const { return std::string(reinterpret_cast<const char*>(data) + sizeof(TextureCacheHeader), getHeader().pathLength); }
+
+        inline const unsigned char* getPixels() const { return data + getHeader().pixelsOffset; }
+
+        inline size_t getPixelsSize() const { return static_cast<size_t>(getHeader().width) * getHeader().height * 4; }
+
+        /** Check that the header is complete and that the pixels fit in the file */
+        bool isValid() const;
+
+    private:
+        MappedTexture() {}
+
+        const unsigned char *data = nullptr;
+        size_t size = 0;
+
+        /** Storage used when the file couldn't be mapped */
+        std::vector<unsigned char> buffer;
+
+        bool mapped = false;
+    };
+
+    /**
+     * @brief Cache of decoded textures stored in a directory
+     *
+     * Each source image gets a file named after the hash of its path. A cached texture is used as long as the source
+     * keeps its size and last write time, or its content hash when only the write time changed (e.g. after a checkout).
+     *
+     * The cache is disabled until a directory is set.
+     */
+    class TextureCache
+    {
+    public:
+        TextureCache(const std::string& directory = "") { setDirectory(directory); }
+
+        /** Set the directory holding the cache files, it is created if needed. An empty path disables the cache */
+        void setDirectory(const std::string& directory);
+
+        inline const std::string& getDirectory() const { return directory; }
+
+        inline bool isEnabled() const { return not directory.empty(); }
+
+        /**
+         * @brief Load the cached pixels of an image
+         *
+         * @param sourcePath Path of the source image
+         *
+         * @return The mapped texture, nullptr if the image isn't cached or changed since it was cached
+         */
+        std::shared_ptr<MappedTexture> load(const std::string& sourcePath) const;
+
+        /**
+         * @brief Write the decoded pixels of an image in the cache
+         *
+         * @param sourcePath Path of the source image
+         * @param width Width of the image
+         * @param height Height of the image
+         * @param rgba Pixels of the image, 4 bytes per pixel
+         *
+         * @return true If the cache file was written
+         */
+        bool store(const std::string& sourcePath, int width, int height, const unsigned char *rgba) const;
+
+        /** Get the path of the cache file of an image */
+        std::string getCachePath(const std::string& sourcePath) const;
+
+    private:
+        std::string directory;
+    };
+
+    /** Hash a buffer with the 64 bits FNV-1a function */
+    uint64_t fnv1aHash(const unsigned char *data, size_t size, uint64_t hash = 14695981039346656037ull);
+}
@@ -0,0 +1,154 @@
+#include "stdafx.h"
+
+#include "textureloader.h"
+
+#include <cstring>
+
+#include "logger.h"
+
+#include "Loaders/stb_image.h"
+
+namespace pg
+{
+    namespace
+    {
+        static constexpr const char * const DOM = "Texture Decoder";
+
+        /** Time a worker sleeps on an empty queue before checking if it should stop */
+        static constexpr std::int64_t WorkerWaitUs = 50000;
+    }
+
+    bool decodeTextureFile(const std::string& path, DecodedTexture& texture, const TextureCache *cache)
+    {
+        if (cache)
+        {
+            texture.mapped = cache->load(path);
+
+            if (texture.mapped)
+            {
+                texture.width = static_cast<int>(texture.mapped->getHeader().width);
+                texture.height = static_cast<int>(texture.mapped->getHeader().height);
+                texture.pixels.clear();
+
+                return true;
+            }
+        }
+
+        int width, height, nrChannels;
+
+        unsigned char *data = stbi_load(path.c_str(), &width, &height, &nrChannels, STBI_rgb_alpha);
+
+        if (not data)
+        {
+            LOG_ERROR(DOM, "Failed to load texture: " << path << ", error: " << (stbi_failure_reason() ? stbi_failure_reason() : "Unknown"));
+
+            return false;
+        }
+
+        texture.width = width;
+        texture.height = height;
+        texture.pixels.resize(static_cast<size_t>(width) * height * 4);
+
+        std::memcpy(texture.pixels.data(), data, texture.pixels.size());
+
+        stbi_image_free(data);
+
+        if (cache)
+            cache->store(path, width, height, texture.pixels.data());
+
+        return true;
+    }
+
+    AsyncTextureDecoder::AsyncTextureDecoder(size_t nbWorkers) : nbWorkers(nbWorkers)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (this->nbWorkers == 0)
+        {
+            const unsigned int nbCores = std::thread::hardware_concurrency();
+
+            // Keep a core for the ecs and one for the render thread
+            this->nbWorkers = nbCores > 3 ? nbCores - 2 : 1;
+        }
+    }
+
+    AsyncTextureDecoder::~AsyncTextureDecoder()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        running = false;
+
+        for (auto& worker : workers)
+        {
+            if (worker.joinable())
+                worker.join();
+        }
+    }
+
+    void AsyncTextureDecoder::request(const std::string& name, const std::string& path, unsigned int textureId)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        nbPending++;
+
+#ifdef __EMSCRIPTEN__
+        decode(Request{name, path, textureId});
+#else
+        std::call_once(startFlag, [this]() { start(); });
+
+        requests.enqueue(Request{name, path, textureId});
+#endif
+    }
+
+    bool AsyncTextureDecoder::tryPop(DecodedTexture& texture)
+    {
+        if (not decoded.try_dequeue(texture))
+            return false;
+
+        nbPending--;
+
+        return true;
+    }
+
+    void AsyncTextureDecoder::start()
+    {
+        LOG_INFO(DOM, "Starting " << nbWorkers << " texture decoding workers");
+
+        running = true;
+
+        workers.reserve(nbWorkers);
+
+        for (size_t i = 0; i < nbWorkers; ++i)
+        {
+            workers.emplace_back(&AsyncTextureDecoder::workerLoop, this);
+        }
+    }
+
+    void AsyncTextureDecoder::workerLoop()
+    {
+        Request request;
+
+        while (running)
+        {
+            if (requests.wait_dequeue_timed(request, WorkerWaitUs))
+                decode(request);
+        }
+    }
+
+    void AsyncTextureDecoder::decode(const Request& request)
+    {
+        DecodedTexture texture;
+
+        texture.name = request.name;
+        texture.path = request.path;
+        texture.textureId = request.textureId;
+
+        // A failed decode is still handed back (without pixels) so the placeholder stays and the request is accounted for
+        if (decodeTextureFile(request.path, texture, cache))
+        {
+            LOG_INFO(DOM, "Decoded texture " << texture.name << " from " << texture.path << " with width = " << texture.width << " height = " << texture.height);
+        }
+
+        decoded.enqueue(std::move(texture));
+    }
+}
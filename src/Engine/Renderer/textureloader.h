@@ -0,0 +1,134 @@
+#pragma once
+
+/**
+ * @file textureloader.h
+ * @author Pigeon Codeur
+ * @brief Definition of the worker threads decoding texture files outside of the render thread
+ * @version 0.1
+ * @date 2025-04-07
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+#include "Memory/blockingconcurrentqueue.h"
+
+#include "texturecache.h"
+
+namespace pg
+{
+    /** Pixels of a texture decoded by a worker, waiting to be uploaded by the render thread */
+    struct DecodedTexture
+    {
+        /** Name the texture is registered with */
+        std::string name;
+
+        /** Path of the decoded file */
+        std::string path;
+
+        /** GL texture that will receive the pixels (it shows a placeholder until then) */
+        unsigned int textureId = 0;
+
+        int width = 0;
+        int height = 0;
+
+        /** Pixels in RGBA, empty if the decoding failed or if the texture was found in the cache */
+        std::vector<unsigned char> pixels;
+
+        /** Cached pixels, mapped from the texture cache instead of being decoded */
+        std::shared_ptr<MappedTexture> mapped;
+
+        inline const unsigned char* data() const { return mapped ? mapped->getPixels() : pixels.data(); }
+
+        inline size_t size() const { return mapped ? mapped->getPixelsSize() : pixels.size(); }
+    };
+
+    /**
+     * @brief Decode an image file in RGBA
+     *
+     * @param path Path of the file
+     * @param texture Receive the size and the pixels of the image
+     * @param cache Cache used to skip the decoding of files already decoded, and filled with the new ones (can be null)
+     *
+     * @return true If the file could be decoded
+     */
+    bool decodeTextureFile(const std::string& path, DecodedTexture& texture, const TextureCache *cache = nullptr);
+
+    /**
+     * @brief A set of worker threads decoding texture files into staging memory
+     *
+     * The workers are only started with the first request. Decoded textures are handed back through a lock free queue,
+     * and the render thread is left with the GL upload only.
+     *
+     * On platforms without threads (emscripten), the file is decoded directly when requested.
+     */
+    class AsyncTextureDecoder
+    {
+    public:
+        /**
+         * @brief Construct a new Async Texture Decoder object
+         *
+         * @param nbWorkers Number of decoding threads, 0 to pick one from the number of cores
+         */
+        AsyncTextureDecoder(size_t nbWorkers = 0);
+
+        /** Stop and join all the workers, the requests not decoded yet are dropped */
+        ~AsyncTextureDecoder();
+
+        AsyncTextureDecoder(const AsyncTextureDecoder&) = delete;
+
+        /**
+         * @brief Ask for a file to be decoded
+         *
+         * @param name Name of the texture
+         * @param path Path of the file
+         * @param textureId GL texture that will receive the pixels
+         */
+        void request(const std::string& name, const std::string& path, unsigned int textureId);
+
+        /** Get a decoded texture if one is ready */
+        bool tryPop(DecodedTexture& texture);
+
+        /** Get the number of requests not handed back yet */
+        inline size_t getNbPending() const { return nbPending.load(); }
+
+        /** Set the cache looked up before decoding, must be set before the first request */
+        inline void setCache(const TextureCache *cache) { this->cache = cache; }
+
+    private:
+        struct Request
+        {
+            std::string name;
+            std::string path;
+            unsigned int textureId = 0;
+        };
+
+        void start();
+
+        void workerLoop();
+
+        void decode(const Request& request);
+
+        size_t nbWorkers;
+
+        const TextureCache *cache = nullptr;
+
+        std::vector<std::thread> workers;
+
+        std::once_flag startFlag;
+
+        std::atomic<bool> running {false};
+
+        std::atomic<size_t> nbPending {0};
+
+        moodycamel::BlockingConcurrentQueue<Request> requests;
+
+        moodycamel::ConcurrentQueue<DecodedTexture> decoded;
+    };
+}
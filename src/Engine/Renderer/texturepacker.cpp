@@ -0,0 +1,256 @@
+#include "stdafx.h"
+
+#include "texturepacker.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "logger.h"
+
+#include "Helpers/openglobject.h"
+
+namespace pg
+{
+    namespace
+    {
+        static constexpr const char * const DOM = "Texture Packer";
+    }
+
+    SkylinePacker::SkylinePacker(unsigned int width, unsigned int height) : width(width), height(height)
+    {
+        skyline.push_back(Node{0, 0, width});
+    }
+
+    bool SkylinePacker::fits(size_t index, unsigned int width, unsigned int height, unsigned int& y) const
+    {
+        const unsigned int x = skyline[index].x;
+
+        if (x + width > this->width)
+            return false;
+
+        unsigned int widthLeft = width;
+
+        y = skyline[index].y;
+
+        // The rectangle rests on the highest node it spans
+        while (widthLeft > 0)
+        {
+            if (index >= skyline.size())
+                return false;
+
+            y = std::max(y, skyline[index].y);
+
+            if (y + height > this->height)
+                return false;
+
+            widthLeft -= std::min(widthLeft, skyline[index].width);
+
+            ++index;
+        }
+
+        return true;
+    }
+
+    bool SkylinePacker::pack(unsigned int width, unsigned int height, unsigned int& x, unsigned int& y)
+    {
+        if (width == 0 or height == 0)
+            return false;
+
+        size_t bestIndex = skyline.size();
+        unsigned int bestBottom = std::numeric_limits<unsigned int>::max();
+        unsigned int bestWidth = std::numeric_limits<unsigned int>::max();
+        unsigned int bestY = 0;
+
+        for (size_t i = 0; i < skyline.size(); ++i)
+        {
+            unsigned int top;
+
+            if (not fits(i, width, height, top))
+                continue;
+
+            // Lowest bottom first, then the narrowest node to waste as little space as possible
+            if (top + height < bestBottom or (top + height == bestBottom and skyline[i].width < bestWidth))
+            {
+                bestIndex = i;
+                bestBottom = top + height;
+                bestWidth = skyline[i].width;
+                bestY = top;
+            }
+        }
+
+        if (bestIndex == skyline.size())
+            return false;
+
+        x = skyline[bestIndex].x;
+        y = bestY;
+
+        skyline.insert(skyline.begin() + bestIndex, Node{x, y + height, width});
+
+        // Cut the nodes now hidden under the new one
+        const unsigned int end = x + width;
+
+        for (size_t i = bestIndex + 1; i < skyline.size();)
+        {
+            auto& node = skyline[i];
+
+            if (node.x >= end)
+                break;
+
+            const unsigned int shrink = end - node.x;
+
+            if (node.width <= shrink)
+            {
+                skyline.erase(skyline.begin() + i);
+                continue;
+            }
+
+            node.x += shrink;
+            node.width -= shrink;
+
+            break;
+        }
+
+        // Merge the neighbours standing at the same height
+        for (size_t i = 0; i + 1 < skyline.size();)
+        {
+            if (skyline[i].y == skyline[i + 1].y)
+            {
+                skyline[i].width += skyline[i + 1].width;
+                skyline.erase(skyline.begin() + i + 1);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        usedArea += static_cast<size_t>(width) * height;
+
+        return true;
+    }
+
+    RuntimeTextureAtlas::RuntimeTextureAtlas(unsigned int pageSize, unsigned int maxTextureSize, unsigned int padding) : pageSize(pageSize), maxTextureSize(maxTextureSize), padding(padding)
+    {
+        LOG_THIS_MEMBER(DOM);
+    }
+
+    RuntimeTextureAtlas::~RuntimeTextureAtlas()
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        for (auto& page : pages)
+        {
+            if (page.textureId != 0)
+                glDeleteTextures(1, &page.textureId);
+        }
+    }
+
+    bool RuntimeTextureAtlas::place(unsigned int width, unsigned int height, Placement& placement)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (not accepts(width, height))
+            return false;
+
+        const unsigned int paddedWidth = width + 2 * padding;
+        const unsigned int paddedHeight = height + 2 * padding;
+
+        unsigned int x = 0, y = 0;
+
+        size_t page = 0;
+
+        for (; page < pages.size(); ++page)
+        {
+            if (pages[page].packer.pack(paddedWidth, paddedHeight, x, y))
+                break;
+        }
+
+        if (page == pages.size())
+        {
+            pages.emplace_back(pageSize);
+
+            if (not pages.back().packer.pack(paddedWidth, paddedHeight, x, y))
+            {
+                LOG_ERROR(DOM, "Texture of " << width << "x" << height << " doesn't fit in an empty page of " << pageSize);
+                pages.pop_back();
+                return false;
+            }
+
+            LOG_INFO(DOM, "Opened atlas page " << page);
+        }
+
+        placement.page = page;
+        placement.x = x + padding;
+        placement.y = y + padding;
+        placement.width = width;
+        placement.height = height;
+
+        const float size = static_cast<float>(pageSize);
+
+        placement.limits = constant::Vector4D(placement.x / size, placement.y / size, (placement.x + width) / size, (placement.y + height) / size);
+
+        return true;
+    }
+
+    unsigned int RuntimeTextureAtlas::upload(const Placement& placement, const unsigned char *rgba)
+    {
+        LOG_THIS_MEMBER(DOM);
+
+        if (placement.page >= pages.size())
+        {
+            LOG_ERROR(DOM, "Uploading in an unknown page: " << placement.page);
+            return 0;
+        }
+
+        auto& page = pages[placement.page];
+
+        if (page.textureId == 0)
+        {
+            glGenTextures(1, &page.textureId);
+
+            glBindTexture(GL_TEXTURE_2D, page.textureId);
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, pageSize, pageSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        else
+        {
+            glBindTexture(GL_TEXTURE_2D, page.textureId);
+        }
+
+        // Extrude the borders of the texture in its padding
+        const unsigned int paddedWidth = placement.width + 2 * padding;
+        const unsigned int paddedHeight = placement.height + 2 * padding;
+
+        padded.resize(static_cast<size_t>(paddedWidth) * paddedHeight * 4);
+
+        for (unsigned int row = 0; row < paddedHeight; ++row)
+        {
+            const unsigned int srcRow = std::min(std::max(row, padding) - padding, placement.height - 1);
+
+            const unsigned char *src = rgba + static_cast<size_t>(srcRow) * placement.width * 4;
+            unsigned char *dst = padded.data() + static_cast<size_t>(row) * paddedWidth * 4;
+
+            for (unsigned int i = 0; i < padding; ++i)
+            {
+                std::memcpy(dst + i * 4, src, 4);
+                std::memcpy(dst + (padding + placement.width + i) * 4, src + (placement.width - 1) * 4, 4);
+            }
+
+            std::memcpy(dst + padding * 4, src, static_cast<size_t>(placement.width) * 4);
+        }
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        glTexSubImage2D(GL_TEXTURE_2D, 0, placement.x - padding, placement.y - padding, paddedWidth, paddedHeight, GL_RGBA, GL_UNSIGNED_BYTE, padded.data());
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        return page.textureId;
+    }
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+/**
+ * @file texturepacker.h
+ * @author Pigeon Codeur
+ * @brief Definition of the runtime atlas packing small textures into shared pages
+ * @version 0.1
+ * @date 2025-03-31
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <vector>
+
+#include "constant.h"
+
+namespace pg
+{
+    /**
+     * @brief A rectangle packer following the skyline bottom-left heuristic
+     *
+     * The packer only keeps the top edge (the skyline) of the rectangles already placed,
+     * and puts every new rectangle where its top would be the lowest.
+     */
+    class SkylinePacker
+    {
+    public:
+        SkylinePacker(unsigned int width, unsigned int height);
+
+        /**
+         * @brief Find a free spot for a rectangle
+         *
+         * @param width Width of the rectangle
+         * @param height Height of the rectangle
+         * @param x Receive the left of the rectangle
+         * @param y Receive the top of the rectangle
+         *
+         * @return true If the rectangle was placed
+         * @return false If the rectangle doesn't fit anymore
+         */
+        bool pack(unsigned int width, unsigned int height, unsigned int& x, unsigned int& y);
+
+        inline unsigned int getWidth() const { return width; }
+        inline unsigned int getHeight() const { return height; }
+
+        /** Get the ratio of the area covered by packed rectangles */
+        inline float getOccupancy() const { return static_cast<float>(usedArea) / (static_cast<float>(width) * height); }
+
+    private:
+        /** A segment of the skyline starting at x, width wide, at the height y */
+        struct Node
+        {
+            unsigned int x;
+            unsigned int y;
+            unsigned int width;
+        };
+
+        /**
+         * @brief Check if a rectangle fits on the skyline starting at a node
+         *
+         * @return true If it fits, y receives the lowest top the rectangle can have there
+         */
+        bool fits(size_t index, unsigned int width, unsigned int height, unsigned int& y) const;
+
+        unsigned int width;
+        unsigned int height;
+
+        std::vector<Node> skyline;
+
+        size_t usedArea = 0;
+    };
+
+    /**
+     * @brief Pages of GL textures holding small textures packed side by side
+     *
+     * Textures are padded with a copy of their borders so that sampling their edges never reads a neighbour.
+     * The GL texture of a page is only created when the first texture is uploaded in it.
+     *
+     * @warning upload must only be called from the render thread
+     */
+    class RuntimeTextureAtlas
+    {
+    public:
+        /** Where a texture was placed */
+        struct Placement
+        {
+            size_t page = 0;
+
+            unsigned int x = 0;
+            unsigned int y = 0;
+            unsigned int width = 0;
+            unsigned int height = 0;
+
+            /** Texture coordinates of the texture in its page (left, top, right, bottom) */
+            constant::Vector4D limits;
+        };
+
+        /**
+         * @brief Construct a new Runtime Texture Atlas object
+         *
+         * @param pageSize Width and height of a page
+         * @param maxTextureSize Textures wider or higher than this are never packed
+         * @param padding Number of border pixels duplicated around each texture
+         */
+        RuntimeTextureAtlas(unsigned int pageSize = 2048, unsigned int maxTextureSize = 256, unsigned int padding = 1);
+
+        /** Runtime atlases can't be copied as they own GL textures */
+        RuntimeTextureAtlas(const RuntimeTextureAtlas&) = delete;
+
+        /** Destroy the Runtime Texture Atlas object and delete the GL textures of the pages */
+        ~RuntimeTextureAtlas();
+
+        /** Check if a texture is small enough to be packed */
+        inline bool accepts(unsigned int width, unsigned int height) const { return width > 0 and height > 0 and width <= maxTextureSize and height <= maxTextureSize; }
+
+        /**
+         * @brief Reserve room for a texture, a new page is opened when the current ones are full
+         *
+         * @return true If the texture got a place
+         */
+        bool place(unsigned int width, unsigned int height, Placement& placement);
+
+        /**
+         * @brief Copy the pixels of a texture in its page
+         *
+         * @param placement Place reserved with place
+         * @param rgba Pixels of the texture, 4 bytes per pixel, row by row
+         *
+         * @return unsigned int The id of the GL texture of the page
+         */
+        unsigned int upload(const Placement& placement, const unsigned char *rgba);
+
+        inline size_t getNbPages() const { return pages.size(); }
+
+        inline unsigned int getPageSize() const { return pageSize; }
+
+        /** Get the id of the GL texture of a page (0 if nothing was uploaded in it yet) */
+        inline unsigned int getPageTextureId(size_t page) const { return page < pages.size() ? pages[page].textureId : 0; }
+
+    private:
+        struct Page
+        {
+            Page(unsigned int size) : packer(size, size) {}
+
+            SkylinePacker packer;
+
+            unsigned int textureId = 0;
+        };
+
+        unsigned int pageSize;
+        unsigned int maxTextureSize;
+        unsigned int padding;
+
+        std::vector<Page> pages;
+
+        /** Scratch image holding a texture with its padding before the upload */
+        std::vector<unsigned char> padded;
+    };
+}
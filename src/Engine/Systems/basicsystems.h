@@ -109,6 +109,115 @@ namespace pg
         size_t lastNbOfGeneratedFrames = 0;
     };
 
+    /**
+     * @brief Overlay showing the render stats of the last frames in the top left corner of the main window
+     *
+     * Hidden by default, the toggle key (F3 by default) shows it and enables the gpu stage timers of the renderer while it is visible.
+     * Each line shows the average and the 99th percentile of a metric over the stats history of the renderer.
+     */
+    struct RenderStatsOverlaySystem : public System<Listener<TickEvent>, Listener<OnSDLScanCode>, InitSys, StoragePolicy>
+    {
+        /** Number of lines of the overlay */
+        static constexpr size_t NbLines = 7;
+
+        RenderStatsOverlaySystem(SDL_Scancode toggleKey = SDL_SCANCODE_F3) : toggleKey(toggleKey) {}
+
+        virtual std::string getSystemName() const override { return "Render Stats Overlay System"; }
+
+        virtual void init() override
+        {
+            auto mainWindowEnt = ecsRef->getEntity(ecsRef->getSystem<EntityNameSystem>()->getEntityId("__MainWindow"));
+
+            auto ui = mainWindowEnt->get<UiComponent>();
+
+            for (size_t i = 0; i < NbLines; ++i)
+            {
+                auto sentence = makeSentence(ecsRef, 0, 0, {""});
+
+                auto sentenceUi = sentence.get<UiComponent>();
+
+                sentenceUi->setZ(10);
+                sentenceUi->setLeftAnchor(ui->left);
+
+                if (i == 0)
+                    sentenceUi->setTopAnchor(ui->top);
+                else
+                    sentenceUi->setTopAnchor(lines[i - 1]->bottom);
+
+                sentenceUi->setVisibility(false);
+
+                lines[i] = sentenceUi;
+                texts[i] = sentence.get<SentenceText>();
+            }
+        }
+
+        virtual void onEvent(const OnSDLScanCode& event) override
+        {
+            if (event.key != toggleKey)
+                return;
+
+            visible = not visible;
+
+            for (auto& line : lines)
+                line->setVisibility(visible);
+
+            if (auto rendererSys = ecsRef->getSystem<MasterRenderer>())
+                rendererSys->setGpuTimers(visible);
+
+            // Show the stats right away instead of waiting for the next refresh
+            accumulatedTick = RefreshRate;
+        }
+
+        virtual void onEvent(const TickEvent& event) override
+        {
+            if (not visible)
+                return;
+
+            accumulatedTick += event.tick;
+
+            if (accumulatedTick < RefreshRate)
+                return;
+
+            accumulatedTick = 0;
+
+            auto rendererSys = ecsRef->getSystem<MasterRenderer>();
+
+            if (not rendererSys)
+                return;
+
+            const auto history = rendererSys->getStatsHistory();
+
+            auto line = [&history](const std::string& name, RenderMetric metric, double scale = 1.0) {
+                const auto summary = history.summarize(metric);
+
+                if (summary.nbFrames == 0)
+                    return name + ": -";
+
+                return (Strfy() << name << ": " << static_cast<size_t>(summary.average * scale) << " (p99 " << static_cast<size_t>(summary.p99 * scale) << ")").getData();
+            };
+
+            texts[0]->setText(line("Draws", RenderMetric::DrawCalls));
+            texts[1]->setText(line("Batches", RenderMetric::Batches));
+            texts[2]->setText(line("Instances", RenderMetric::Instances));
+            texts[3]->setText(line("Upload KB", RenderMetric::UploadedBytes, 1.0 / 1024.0));
+            texts[4]->setText(line("Binds", RenderMetric::ProgramBinds) + " / " + line("Tex", RenderMetric::TextureBinds));
+            texts[5]->setText(line("Cpu us", RenderMetric::CpuTime) + " / " + line("Latency", RenderMetric::FrameLatency));
+            texts[6]->setText(line("Gpu us", RenderMetric::GpuTime));
+        }
+
+        /** Time between two refreshes of the overlay in ms */
+        static constexpr size_t RefreshRate = 500;
+
+        SDL_Scancode toggleKey;
+
+        CompRef<UiComponent> lines[NbLines];
+        CompRef<SentenceText> texts[NbLines];
+
+        bool visible = false;
+
+        size_t accumulatedTick = 0;
+    };
+
     struct MoveToComponent
     {
         MoveToComponent(constant::Vector2D endPos, float speed, float distanceToTravel = 0.0f, bool destroyUponMoved = true, CallablePtr callback = nullptr) : endPos(endPos), speed(speed), distanceToTravel(distanceToTravel), destroyUponMoved(destroyUponMoved), callback(callback) {}
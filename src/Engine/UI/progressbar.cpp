@@ -106,16 +106,7 @@ namespace pg
         if (not changed)
             return;
 
-        renderCallList.clear();
-
-        const auto& renderCallView = view<ProgressBarRenderCall>();
-
-        renderCallList.reserve(renderCallView.nbComponents());
-
-        for (const auto& renderCall : renderCallView)
-        {
-            renderCallList.push_back(renderCall->call);
-        }
+        gatherRenderCalls(view<ProgressBarRenderCall>());
 
         finishChanges();
     }
@@ -150,16 +150,7 @@ namespace pg
         if (not changed)
             return;
 
-        renderCallList.clear();
-
-        const auto& renderCallView = view<SentenceRenderCall>();
-
-        renderCallList.reserve(renderCallView.nbComponents());
-
-        for (const auto& renderCall : renderCallView)
-        {
-            renderCallList.push_back(renderCall->call);
-        }
+        gatherRenderCalls(view<SentenceRenderCall>());
 
         finishChanges();
     }
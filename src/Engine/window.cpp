@@ -12,6 +12,7 @@
 
 #include "Renderer/renderer.h"
 #include "Renderer/renderermodule.h"
+#include "Renderer/particle.h"
 
 #include "Input/input.h"
 #include "Input/inputmodule.h"
@@ -29,6 +30,7 @@
 #include "2D/position.h"
 #include "2D/simple2dobject.h"
 #include "2D/texture.h"
+#include "2D/tilemap.h"
 
 #include "Scene/scenemanager.h"
 
@@ -323,8 +325,12 @@ namespace pg
         // glDisable(GL_CULL_FACE);
         LOG_INFO(DOM, "Disable cull face");
             // printf("Enable cull face");
-#ifndef __EMSCRIPTEN__
-        // glEnable(GL_DEPTH_TEST);
+        // The depth test is switched on by the master renderer for the opaque calls only.
+        // Higher depths are drawn on top, so the depth buffer is cleared to the farthest value: 0
+#ifdef __EMSCRIPTEN__
+        glClearDepthf(0.0f);
+#else
+        glClearDepth(0.0);
 #endif
         LOG_INFO(DOM, "Enable depth testing");
         glEnable(GL_ALPHA_TEST);
@@ -374,6 +380,11 @@ namespace pg
         // [Start] Master render definition
 
         masterRenderer = ecs.createSystem<MasterRenderer>("res/None.png");
+
+#ifndef __EMSCRIPTEN__
+        // Decoded textures are kept on disk so the next launches skip the image decoding
+        masterRenderer->setTextureCacheDirectory("cache/textures");
+#endif
         interpreter->addSystemModule("renderer", RendererModule{masterRenderer});
 
         // Configure the master renderer system
@@ -393,6 +404,10 @@ namespace pg
 
         ecs.createSystem<Texture2DComponentSystem>(masterRenderer);
 
+        ecs.createSystem<ParticleSystem>(masterRenderer);
+
+        ecs.createSystem<TileMapSystem>(masterRenderer);
+
         ecs.createSystem<ProgressBarComponentSystem>(masterRenderer);
 
         ecs.createSystem<SentenceSystem>(masterRenderer, "res/font/fontmap.ft");
@@ -445,6 +460,7 @@ namespace pg
         // Todo make all derived class from AbstractRenderer automaticly run before MasterRenderer
         ecs.succeed<MasterRenderer, Simple2DObjectSystem>();
         ecs.succeed<MasterRenderer, Texture2DComponentSystem>();
+        ecs.succeed<MasterRenderer, TileMapSystem>();
         ecs.succeed<MasterRenderer, SentenceSystem>();
         ecs.succeed<MasterRenderer, ProgressBarComponentSystem>();
         ecs.succeed<MasterRenderer, PrefabSystem>();
@@ -460,6 +476,9 @@ namespace pg
         // Log taskflow for this window
         ecs.dumbTaskflow();
 
+        // Log the time spent in the init of each system to keep an eye on the cold start
+        ecs.reportInitTimings();
+
         screenEntity = ecs.createEntity();
         // Todo remove this
         screenUi = ecs.attach<UiComponent>(screenEntity);
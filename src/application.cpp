@@ -216,6 +216,8 @@ void initGame()
 
     mainWindow->ecs.createSystem<FpsSystem>();
 
+    mainWindow->ecs.createSystem<RenderStatsOverlaySystem>();
+
     auto ttfSys = mainWindow->ecs.createSystem<TTFTextSystem>(mainWindow->masterRenderer);
     ttfSys->registerFont("res/font/Inter/static/Inter_28pt-Light.ttf");
     ttfSys->registerFont("res/font/Inter/static/Inter_28pt-Bold.ttf");
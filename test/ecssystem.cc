@@ -1137,5 +1137,301 @@ namespace pg
         }
 
 
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(component_set_test, compaction_by_entity_id)
+        {
+            ComponentSet<A> set;
+
+            for (_unique_id id = 1; id <= 100; id++)
+                set.addComponent(id, static_cast<int>(id), 0);
+
+            // Churn the set so the dense order is no longer sorted
+            for (_unique_id id = 1; id <= 100; id += 3)
+                set.removeComponent(id);
+
+            for (_unique_id id = 1; id <= 100; id += 6)
+                set.addComponent(id, static_cast<int>(id), 0);
+
+            EXPECT_FALSE(set.isCompacted());
+
+            EXPECT_TRUE(set.compact(std::chrono::seconds(1)));
+            EXPECT_TRUE(set.isCompacted());
+
+            for (size_t i = 2; i < set.nbElements(); i++)
+                EXPECT_LT(set.at(i - 1), set.at(i));
+
+            for (size_t i = 1; i < set.nbElements(); i++)
+            {
+                EXPECT_EQ(set.find(set.at(i)), i);
+                EXPECT_EQ(set[i]->value, static_cast<int>(set.at(i)));
+            }
+
+            set.removeComponent(2);
+
+            EXPECT_FALSE(set.isCompacted());
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(component_set_test, compaction_with_key_is_resumable)
+        {
+            ComponentSet<A> set;
+
+            for (_unique_id id = 1; id <= 1000; id++)
+                set.addComponent(id, static_cast<int>(id), 0);
+
+            auto key = [](_unique_id, const A* comp) { return static_cast<uint64_t>(2000 - comp->value); };
+
+            // A deadline in the past forces the pass to stop after a few swaps
+            size_t nbCalls = 1;
+
+            while (not set.compact(std::chrono::steady_clock::now() - std::chrono::seconds(1), key))
+                nbCalls++;
+
+            EXPECT_GT(nbCalls, 1);
+
+            for (size_t i = 1; i < set.nbElements(); i++)
+            {
+                EXPECT_EQ(set.at(i), 1001 - i);
+                EXPECT_EQ(set.atEntity(set.at(i))->value, static_cast<int>(set.at(i)));
+            }
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(system_test, compaction_in_basic_task)
+        {
+            EntitySystem ecs;
+
+            auto sys = ecs.createSystem<ASystem>();
+
+            std::vector<EntityRef> entities;
+
+            for (size_t i = 0; i < 50; i++)
+            {
+                auto entity = ecs.createEntity();
+                ecs.attachGeneric<A>(entity, static_cast<int>(entity.id), 0);
+                entities.push_back(entity);
+            }
+
+            for (size_t i = 0; i < 50; i += 4)
+                ecs.removeEntity(entities[i]);
+
+            ecs.enableCompaction<A>();
+            ecs.setCompactionBudget(std::chrono::milliseconds(10));
+
+            ecs.executeOnce();
+
+            auto view = ecs.view<A>();
+
+            EXPECT_EQ(view.nbComponents(), sys->getNbComponents());
+
+            for (size_t i = 2; i < view.nbComponents(); i++)
+                EXPECT_LT(view[i - 1]->value, view[i]->value);
+        }
+    }
+
+    namespace test
+    {
+        namespace
+        {
+            struct Relocated
+            {
+                Relocated(int value) : value(value) {}
+
+                int value;
+            };
+        }
+    }
+
+    template <>
+    struct RelocatableComponent<test::Relocated> : public std::true_type {};
+
+    namespace test
+    {
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(component_set_test, compaction_relocates_memory)
+        {
+            ComponentSet<Relocated> set;
+
+            for (_unique_id id = 1; id <= 64; id++)
+                set.addComponent(id, static_cast<int>(id));
+
+            for (_unique_id id = 1; id <= 64; id += 2)
+                set.removeComponent(id);
+
+            for (_unique_id id = 1; id <= 64; id += 2)
+                set.addComponent(id, static_cast<int>(id));
+
+            EXPECT_TRUE(set.compact(std::chrono::seconds(1)));
+
+            for (size_t i = 1; i < set.nbElements(); i++)
+            {
+                EXPECT_EQ(set.at(i), i);
+                EXPECT_EQ(set[i]->value, static_cast<int>(i));
+            }
+
+            for (size_t i = 2; i < set.nbElements(); i++)
+                EXPECT_TRUE(std::less<Relocated*>()(set[i - 1], set[i]));
+        }
+    }
+
+    namespace test
+    {
+        namespace
+        {
+            struct AlignedVelocity
+            {
+                float x, y, z, w;
+            };
+        }
+    }
+
+    template <>
+    struct ComponentPoolTraits<test::AlignedVelocity> : public AlignedComponentPool<test::AlignedVelocity, 16, 8> {};
+
+    namespace test
+    {
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(component_set_test, aligned_pool_policy)
+        {
+            ComponentSet<AlignedVelocity> set;
+
+            for (_unique_id id = 1; id <= 20; id++)
+                set.addComponent(id, AlignedVelocity{static_cast<float>(id), 0.0f, 0.0f, 0.0f});
+
+            const auto& pool = set.getPool();
+
+            EXPECT_EQ(pool.getNbElements(), 20);
+            EXPECT_TRUE(pool.elementAligned);
+
+            for (size_t i = 1; i < set.nbElements(); i++)
+            {
+                EXPECT_EQ(reinterpret_cast<uintptr_t>(set[i]) % 16, 0);
+                EXPECT_EQ(set[i]->x, static_cast<float>(set.at(i)));
+            }
+
+            set.removeComponent(5);
+
+            EXPECT_EQ(pool.getNbElements(), 19);
+        }
+
+        namespace
+        {
+            std::mutex initOrderMutex;
+            std::vector<int> initOrder;
+
+            void recordInit(int value)
+            {
+                std::lock_guard<std::mutex> lock(initOrderMutex);
+                initOrder.push_back(value);
+            }
+
+            struct SerialInitA : public System<InitSys>
+            {
+                virtual void init() override { recordInit(1); }
+            };
+
+            struct ParallelInitB : public System<InitSys>
+            {
+                virtual void init() override { recordInit(2); }
+
+                virtual bool canInitInParallel() const override { return true; }
+            };
+
+            struct SerialInitC : public System<InitSys>
+            {
+                virtual void init() override { recordInit(3); }
+            };
+
+            struct ParallelInitD : public System<InitSys>
+            {
+                virtual void init() override { recordInit(4); }
+
+                virtual bool canInitInParallel() const override { return true; }
+            };
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(system_test, immediate_init_is_timed)
+        {
+            initOrder.clear();
+
+            EntitySystem ecs;
+
+            auto sysA = ecs.createSystem<SerialInitA>();
+            ecs.createSystem<SerialInitC>();
+
+            ASSERT_EQ(initOrder.size(), 2);
+            EXPECT_EQ(initOrder[0], 1);
+            EXPECT_EQ(initOrder[1], 3);
+
+            const auto& timings = ecs.getInitTimings();
+
+            ASSERT_EQ(timings.size(), 2);
+            EXPECT_EQ(timings[0].id, sysA->_id);
+            EXPECT_FALSE(timings[0].parallel);
+            EXPECT_GE(timings[0].duration, 0);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(system_test, deferred_init_with_dependencies)
+        {
+            initOrder.clear();
+
+            EntitySystem ecs;
+
+            ecs.setDeferredInit(true);
+
+            ecs.createSystem<ParallelInitB>();
+            ecs.createSystem<SerialInitA>();
+            ecs.createSystem<ParallelInitD>();
+            ecs.createSystem<SerialInitC>();
+
+            ecs.initAfter<ParallelInitB, SerialInitC>();
+            ecs.initAfter<SerialInitC, ParallelInitD>();
+
+            // Nothing ran yet
+            EXPECT_TRUE(initOrder.empty());
+
+            ecs.fakeStart();
+
+            ASSERT_EQ(initOrder.size(), 4);
+
+            auto position = [](int value) { return std::find(initOrder.begin(), initOrder.end(), value) - initOrder.begin(); };
+
+            // Serial inits keep their creation order, and declared dependencies are respected
+            EXPECT_LT(position(1), position(3));
+            EXPECT_LT(position(4), position(3));
+            EXPECT_LT(position(3), position(2));
+
+            const auto& timings = ecs.getInitTimings();
+
+            ASSERT_EQ(timings.size(), 4);
+
+            size_t nbParallel = 0;
+
+            for (const auto& timing : timings)
+                nbParallel += timing.parallel ? 1 : 0;
+
+            EXPECT_EQ(nbParallel, 2);
+
+            // Running the deferred inits again does nothing
+            ecs.runDeferredInits();
+
+            EXPECT_EQ(initOrder.size(), 4);
+        }
     }
-}
\ No newline at end of file
+}
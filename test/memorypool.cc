@@ -3,6 +3,13 @@
 #include "gtest/gtest.h"
 
 #include "Memory/memorypool.h"
+#include "Memory/concurrentpool.h"
+#include "Memory/frameallocator.h"
+#include "Memory/parallelfor.h"
+
+#include <thread>
+#include <set>
+#include <map>
 
 namespace pg
 {
@@ -131,5 +138,380 @@ namespace pg
             EXPECT_EQ(pool.getNbElements(), 0);
             EXPECT_EQ(pool.getSize(), 5);
         }
+
+        struct PackedVec3
+        {
+            float x, y, z;
+        };
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(aligned_memorypool_test, packed_and_aligned_blocks)
+        {
+            AlignedAllocatorPool<PackedVec3, 32, 16> pool;
+
+            std::vector<PackedVec3*> elements;
+
+            for (int i = 0; i < 40; i++)
+                elements.push_back(pool.allocate(PackedVec3{static_cast<float>(i), 0.0f, 0.0f}));
+
+            EXPECT_EQ(pool.getNbElements(), 40);
+            EXPECT_EQ(pool.getSize(), 48);
+            EXPECT_EQ(pool.getNbBlocks(), 3);
+
+            for (size_t i = 0; i < pool.getNbBlocks(); i++)
+                EXPECT_EQ(reinterpret_cast<uintptr_t>(pool.getBlock(i)) % 32, 0);
+
+            EXPECT_EQ(pool.getNbUsedInBlock(0), 16);
+            EXPECT_EQ(pool.getNbUsedInBlock(2), 8);
+
+            // Elements of a same block are tightly packed
+            for (size_t i = 1; i < 16; i++)
+                EXPECT_EQ(reinterpret_cast<char*>(elements[i]) - reinterpret_cast<char*>(elements[i - 1]), static_cast<std::ptrdiff_t>(sizeof(PackedVec3)));
+
+            for (size_t i = 0; i < elements.size(); i++)
+                EXPECT_EQ(pool.getElement(i)->x, static_cast<float>(i));
+
+            for (auto element : elements)
+                pool.release(element);
+
+            EXPECT_EQ(pool.getNbElements(), 0);
+            EXPECT_EQ(pool.getSize(), 48);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(aligned_memorypool_test, released_slot_is_reused)
+        {
+            AlignedAllocatorPool<PackedVec3> pool;
+
+            auto first = pool.allocate();
+            auto second = pool.allocate();
+
+            pool.release(first);
+
+            auto third = pool.allocate();
+
+            EXPECT_EQ(third, first);
+            EXPECT_NE(third, second);
+            EXPECT_EQ(pool.getNbElements(), 2);
+
+            pool.release(second);
+            pool.release(third);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(concurrent_memorypool_test, single_thread_alloc)
+        {
+            ConcurrentAllocatorPool<BasicObject, 4, 8> pool;
+
+            auto elem = pool.allocate(BasicObject{5});
+
+            EXPECT_NE(elem, nullptr);
+            EXPECT_EQ(elem->id, 5);
+            EXPECT_EQ(pool.getNbElements(), 1);
+            EXPECT_EQ(pool.getSize(), 8);
+
+            pool.release(elem);
+
+            auto stats = pool.getStats();
+
+            EXPECT_EQ(stats.nbElements, 0);
+            EXPECT_EQ(stats.nbAllocations, 1);
+            EXPECT_EQ(stats.nbReleases, 1);
+            EXPECT_EQ(stats.nbBlocks, 1);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(concurrent_memorypool_test, bulk_alloc_and_release)
+        {
+            ConcurrentAllocatorPool<BasicObject, 4, 8> pool;
+
+            std::vector<BasicObject*> elements(20, nullptr);
+
+            pool.allocateN(elements.data(), elements.size(), BasicObject{3});
+
+            std::set<BasicObject*> uniques(elements.begin(), elements.end());
+
+            EXPECT_EQ(uniques.size(), 20);
+            EXPECT_EQ(pool.getNbElements(), 20);
+            EXPECT_EQ(pool.getSize(), 24);
+
+            for (auto element : elements)
+                EXPECT_EQ(element->id, 3);
+
+            pool.releaseN(elements.data(), elements.size());
+
+            EXPECT_EQ(pool.getNbElements(), 0);
+
+            // Released slots are reused before growing again
+            pool.allocateN(elements.data(), elements.size(), BasicObject{4});
+
+            EXPECT_EQ(pool.getSize(), 24);
+
+            pool.releaseN(elements.data(), elements.size());
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(concurrent_memorypool_test, multi_thread_alloc)
+        {
+            constexpr size_t nbThreads = 4;
+            constexpr size_t nbIterations = 5000;
+
+            ConcurrentAllocatorPool<BasicObject, 16, 64> pool;
+
+            std::vector<std::thread> threads;
+            std::vector<std::vector<BasicObject*>> kept(nbThreads);
+
+            for (size_t t = 0; t < nbThreads; t++)
+            {
+                threads.emplace_back([&pool, &kept, t]() {
+                    for (size_t i = 0; i < nbIterations; i++)
+                    {
+                        auto elem = pool.allocate(BasicObject{static_cast<int>(t)});
+
+                        // Keep one element out of four alive, release the others right away
+                        if (i % 4 == 0)
+                            kept[t].push_back(elem);
+                        else
+                            pool.release(elem);
+                    }
+                });
+            }
+
+            for (auto& thread : threads)
+                thread.join();
+
+            std::set<BasicObject*> uniques;
+
+            for (size_t t = 0; t < nbThreads; t++)
+            {
+                for (auto elem : kept[t])
+                {
+                    EXPECT_EQ(elem->id, static_cast<int>(t));
+                    uniques.insert(elem);
+                }
+            }
+
+            EXPECT_EQ(uniques.size(), nbThreads * nbIterations / 4);
+            EXPECT_EQ(pool.getNbElements(), nbThreads * nbIterations / 4);
+
+            auto stats = pool.getStats();
+
+            EXPECT_EQ(stats.nbAllocations, nbThreads * nbIterations);
+            EXPECT_EQ(stats.nbReleases, nbThreads * nbIterations * 3 / 4);
+
+            // Release the kept elements from another thread than the one that allocated them
+            for (size_t t = 0; t < nbThreads; t++)
+                pool.releaseN(kept[t].data(), kept[t].size());
+
+            EXPECT_EQ(pool.getNbElements(), 0);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(frame_arena_test, bump_and_reset)
+        {
+            FrameArena arena(128);
+
+            auto first = static_cast<char*>(arena.allocate(10, 1));
+            auto second = static_cast<char*>(arena.allocate(8, 8));
+
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(second) % 8, 0);
+            EXPECT_GE(second, first + 10);
+            EXPECT_EQ(arena.getUsedBytes(), 18);
+
+            // Bigger than a slab, a dedicated slab is created
+            auto big = arena.allocate(1000, 16);
+
+            EXPECT_NE(big, nullptr);
+            EXPECT_GE(arena.getCapacity(), 1128);
+
+            arena.reset();
+
+            EXPECT_EQ(arena.getUsedBytes(), 0);
+
+            // After a reset the slabs are merged so the same workload fits in one slab
+            auto capacity = arena.getCapacity();
+
+            arena.allocate(10, 1);
+            arena.allocate(8, 8);
+            arena.allocate(1000, 16);
+
+            EXPECT_EQ(arena.getCapacity(), capacity);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(frame_allocator_test, memory_survives_one_frame)
+        {
+            FrameAllocator frame(256);
+
+            auto values = frame.allocate<int>(16);
+
+            for (int i = 0; i < 16; i++)
+                values[i] = i;
+
+            frame.nextFrame();
+
+            EXPECT_EQ(frame.getUsedBytes(), 0);
+
+            auto otherValues = frame.allocate<int>(16);
+
+            // Memory of the previous frame is still intact
+            EXPECT_NE(values, otherValues);
+
+            for (int i = 0; i < 16; i++)
+                EXPECT_EQ(values[i], i);
+
+            frame.nextFrame();
+
+            // Back on the first buffer, its memory is reused
+            EXPECT_EQ(frame.allocate<int>(16), values);
+            EXPECT_EQ(frame.getFrameIndex(), 2);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(frame_allocator_test, stl_adaptor)
+        {
+            FrameAllocator frame;
+
+            std::vector<int, ArenaAllocator<int>> values{ArenaAllocator<int>(&frame)};
+
+            for (int i = 0; i < 1000; i++)
+                values.push_back(i);
+
+            EXPECT_GE(frame.getUsedBytes(), 1000 * sizeof(int));
+
+            std::map<int, int, std::less<int>, ArenaAllocator<std::pair<const int, int>>> map{ArenaAllocator<int>(&frame)};
+
+            for (int i = 0; i < 100; i++)
+                map[i] = values[i];
+
+            EXPECT_EQ(map.size(), 100);
+            EXPECT_EQ(map[50], 50);
+
+            // Without a frame allocator the adaptor uses the heap
+            std::vector<int, ArenaAllocator<int>> heapValues;
+            heapValues.resize(10, 3);
+
+            EXPECT_EQ(heapValues[9], 3);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(frame_allocator_test, multi_thread_alloc)
+        {
+            FrameAllocator frame(1024);
+
+            std::vector<std::thread> threads;
+            std::vector<std::vector<int*>> blocks(4);
+
+            for (size_t t = 0; t < 4; t++)
+            {
+                threads.emplace_back([&frame, &blocks, t]() {
+                    for (int i = 0; i < 1000; i++)
+                    {
+                        auto value = frame.allocate<int>(1);
+                        *value = static_cast<int>(t) * 1000 + i;
+                        blocks[t].push_back(value);
+                    }
+                });
+            }
+
+            for (auto& thread : threads)
+                thread.join();
+
+            for (size_t t = 0; t < 4; t++)
+                for (int i = 0; i < 1000; i++)
+                    EXPECT_EQ(*blocks[t][i], static_cast<int>(t) * 1000 + i);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(job_pool_test, every_job_runs_once)
+        {
+            JobPool pool(3);
+
+            EXPECT_EQ(pool.getNbThreads(), 4u);
+
+            std::vector<std::atomic<int>> runs(1000);
+            std::atomic<bool> validThread {true};
+
+            // Run a few batches so the workers wake up more than once
+            for (size_t batch = 0; batch < 5; ++batch)
+            {
+                pool.run(runs.size(), [&](size_t job, size_t thread) {
+                    runs[job]++;
+
+                    if (thread >= pool.getNbThreads())
+                        validThread = false;
+                });
+            }
+
+            for (const auto& run : runs)
+                EXPECT_EQ(run.load(), 5);
+
+            EXPECT_TRUE(validThread);
+        }
+
+        TEST(job_pool_test, nested_batches_run_in_place)
+        {
+            JobPool pool(2);
+
+            std::atomic<int> nbInnerJobs {0};
+
+            pool.run(8, [&](size_t, size_t thread) {
+                // The inner batch runs on the thread of the outer job
+                pool.run(4, [&](size_t, size_t innerThread) {
+                    EXPECT_EQ(innerThread, 0u);
+
+                    nbInnerJobs++;
+                });
+
+                EXPECT_LT(thread, pool.getNbThreads());
+            });
+
+            EXPECT_EQ(nbInnerJobs.load(), 32);
+        }
+
+        TEST(job_pool_test, parallel_for_chunks_covers_the_range)
+        {
+            std::vector<int> values(10000, 0);
+
+            parallelForChunks(values.size(), 100, [&values](size_t start, size_t end, size_t) {
+                for (size_t i = start; i < end; ++i)
+                    values[i] += static_cast<int>(i);
+            });
+
+            for (size_t i = 0; i < values.size(); ++i)
+                EXPECT_EQ(values[i], static_cast<int>(i));
+
+            // Loops smaller than two chunks run in place as a single chunk
+            size_t nbChunks = 0;
+
+            parallelForChunks(150, 100, [&nbChunks](size_t start, size_t end, size_t) {
+                EXPECT_EQ(start, 0u);
+                EXPECT_EQ(end, 150u);
+
+                nbChunks++;
+            });
+
+            EXPECT_EQ(nbChunks, 1u);
+        }
     }
-}
\ No newline at end of file
+}
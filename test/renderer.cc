@@ -2,7 +2,17 @@
 
 #include "gtest/gtest.h"
 
+#include <random>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <thread>
+#include <functional>
+
 #include "Renderer/renderer.h"
+#include "Renderer/renderqueue.h"
+#include "Renderer/particle.h"
 
 namespace pg
 {
@@ -99,6 +109,13 @@ namespace pg
             // sorted by key which includes depth bits, so near (smaller depth) first
             EXPECT_EQ(v[0].getDepth(), -10);
             EXPECT_EQ(v[1].getDepth(), +5);
+
+            // The sort key of the renderer draws opaque calls front to back, and before every transparent call
+            RenderCall transparentCall(true, RenderStage::Render, OpacityType::Additive, -10, 0);
+
+            EXPECT_LT(farCall.getSortKey(), nearCall.getSortKey());
+            EXPECT_LT(nearCall.getSortKey(), transparentCall.getSortKey());
+            EXPECT_EQ(transparentCall.getSortKey(), transparentCall.key);
         }
 
         TEST(renderer_test, register_material)
@@ -107,28 +124,149 @@ namespace pg
 
             EXPECT_EQ(masterRenderer.getNbMaterials(), 0ull);
 
-            masterRenderer.registerMaterial("testMaterial", Material());
+            // The material can be used right away, without waiting for a frame
+            EXPECT_EQ(masterRenderer.registerMaterial("testMaterial", Material()), 0ull);
 
-            EXPECT_EQ(masterRenderer.getNbMaterials(), 0ull);
+            EXPECT_EQ(masterRenderer.getNbMaterials(), 1ull);
+
+            EXPECT_TRUE(masterRenderer.hasMaterial("testMaterial"));
+            EXPECT_FALSE(masterRenderer.hasMaterial("otherMaterial"));
+            EXPECT_EQ(masterRenderer.getMaterialID("testMaterial"), 0ull);
+
+            // Registering a name again points it to the new material, ids never change
+            Material other;
+            other.nbAttributes = 3;
+
+            EXPECT_EQ(masterRenderer.registerMaterial(other), 1ull);
+            EXPECT_EQ(masterRenderer.registerMaterial("testMaterial", other), 2ull);
+
+            EXPECT_EQ(masterRenderer.getNbMaterials(), 3ull);
+            EXPECT_EQ(masterRenderer.getMaterialID("testMaterial"), 2ull);
+            EXPECT_EQ(masterRenderer.getMaterial("testMaterial").nbAttributes, 3u);
+            EXPECT_EQ(masterRenderer.getMaterial(0).nbAttributes, 0u);
+        }
+
+        TEST(renderer_test, materials_are_readable_while_being_registered)
+        {
+            AppendOnlyTable<std::pair<size_t, size_t>, 16, 64> table;
+
+            constexpr size_t nbValues = 1000;
+
+            std::thread writer([&table]() {
+                for (size_t i = 0; i < nbValues; ++i)
+                    table.push("value" + std::to_string(i), {i, i * 2});
+            });
+
+            size_t nbWrong = 0;
+
+            // Every published value is complete and keeps its id while the table grows
+            while (table.size() < nbValues)
+            {
+                const size_t size = table.size();
+
+                for (size_t i = 0; i < size; ++i)
+                {
+                    const auto& value = table[i];
+
+                    if (value.first != i or value.second != i * 2)
+                        nbWrong++;
+                }
+
+                size_t id;
+
+                if (size > 0 and (not table.find("value" + std::to_string(size - 1), id) or id != size - 1))
+                    nbWrong++;
+            }
+
+            writer.join();
+
+            EXPECT_EQ(nbWrong, 0u);
+
+            size_t id;
+            EXPECT_TRUE(table.find("value999", id));
+            EXPECT_EQ(id, 999u);
+            EXPECT_FALSE(table.find("value1000", id));
+            EXPECT_FALSE(table.find("", id));
+        }
+
+        TEST(renderer_test, material_registered_during_a_frame_is_drawn_by_this_frame)
+        {
+            MasterRenderer masterRenderer;
+
+            auto backend = new NullRenderBackend();
+            masterRenderer.setBackend(std::unique_ptr<RenderBackend>(backend));
+
+            masterRenderer.getParameter()["ScreenWidth"] = 800;
+            masterRenderer.getParameter()["ScreenHeight"] = 600;
+
+            MockRenderer renderer(&masterRenderer, RenderStage::Render);
+
+            Material material;
+            material.nbAttributes = 1;
+
+            // The id is known at registration, so the call can be built before any frame
+            RenderCall call;
+            call.setMaterial(masterRenderer.registerMaterial("streamed", material));
+            call.data = {1.0f};
+
+            renderer.addRenderCall(call);
+
+            const size_t nbGenerated = masterRenderer.getNbGeneratedFrames();
 
-            // Need to execute and render to finalize the material registration
             masterRenderer.execute();
             masterRenderer.renderAll();
 
-            EXPECT_EQ(masterRenderer.getNbMaterials(), 1ull);
+            EXPECT_EQ(masterRenderer.getNbGeneratedFrames(), nbGenerated + 1);
+            EXPECT_EQ(backend->getStats().nbDrawCalls, 1u);
+        }
 
-            EXPECT_TRUE(masterRenderer.hasMaterial("testMaterial"));
-            EXPECT_EQ(masterRenderer.getMaterialID("testMaterial"), 0ull);
+        TEST(renderer_test, material_uniforms_resolved_on_registration)
+        {
+            MasterRenderer masterRenderer;
+
+            Material material;
+            material.uniformMap.emplace("sWidth", UniformValue(std::string("ScreenWidth")));
+
+            masterRenderer.registerMaterial("testMaterial", material);
+
+            // Without a shader nothing can be resolved, but every uniform of the map is still listed
+            const auto& uniforms = masterRenderer.getMaterial("testMaterial").uniforms;
+
+            ASSERT_EQ(uniforms.values.size(), 1u);
+            EXPECT_EQ(uniforms.values[0].first, -1);
+            EXPECT_EQ(uniforms.textures[0], -1);
+            EXPECT_EQ(uniforms.projection, -1);
+            EXPECT_EQ(uniforms.view, -1);
         }
 
-        TEST(renderer_test, basic_render)
+        TEST(renderer_test, camera_blocks_computed_once_per_frame)
         {
             MasterRenderer masterRenderer;
-            masterRenderer.registerMaterial("testMaterial", Material());
-            // Need to execute and render to finalize the material registration
+
+            masterRenderer.getParameter()["ScreenWidth"] = 800;
+            masterRenderer.getParameter()["ScreenHeight"] = 400;
+
             masterRenderer.execute();
             masterRenderer.renderAll();
 
+            const auto& cameraBuffer = masterRenderer.getCameraBuffer();
+
+            // The main camera and the identity block of unknown viewports
+            ASSERT_EQ(cameraBuffer.size(), 2u);
+
+            EXPECT_FLOAT_EQ(cameraBuffer.getBlock(0).scale[0][0], 2.0f / 800.0f);
+            EXPECT_FLOAT_EQ(cameraBuffer.getBlock(0).scale[1][1], 2.0f / 400.0f);
+            EXPECT_EQ(cameraBuffer.getBlock(1).view, glm::mat4(1.0f));
+
+            // Nothing was drawn, so the blocks never had to reach the gpu
+            EXPECT_EQ(cameraBuffer.getNbUploads(), 0u);
+        }
+
+        TEST(renderer_test, basic_render)
+        {
+            MasterRenderer masterRenderer;
+            masterRenderer.registerMaterial("testMaterial", Material());
+
             MockRenderer renderer(&masterRenderer, RenderStage::Render);
 
             RenderCall call1, call2;
@@ -161,9 +299,6 @@ namespace pg
         {
             MasterRenderer masterRenderer;
             masterRenderer.registerMaterial("testMaterial", Material());
-            // Need to execute and render to finalize the material registration
-            masterRenderer.execute();
-            masterRenderer.renderAll();
 
             MockRenderer renderer(&masterRenderer, RenderStage::Render);
 
@@ -199,9 +334,6 @@ namespace pg
             MasterRenderer masterRenderer;
             masterRenderer.registerMaterial("testMaterial", Material());
             masterRenderer.registerMaterial("testMaterial2", Material());
-            // Need to execute and render to finalize the material registration
-            masterRenderer.execute();
-            masterRenderer.renderAll();
 
             MockRenderer renderer(&masterRenderer, RenderStage::Render);
 
@@ -226,9 +358,6 @@ namespace pg
             MasterRenderer masterRenderer;
             masterRenderer.registerMaterial("testMaterial", Material());
             masterRenderer.registerMaterial("testMaterial2", Material());
-            // Need to execute and render to finalize the material registration
-            masterRenderer.execute();
-            masterRenderer.renderAll();
 
             MockRenderer renderer(&masterRenderer, RenderStage::Render);
 
@@ -251,9 +380,6 @@ namespace pg
         {
             MasterRenderer masterRenderer;
             masterRenderer.registerMaterial("testMaterial", Material());
-            // Need to execute and render to finalize the material registration
-            masterRenderer.execute();
-            masterRenderer.renderAll();
 
             MockRenderer renderer(&masterRenderer, RenderStage::Render);
 
@@ -271,9 +397,6 @@ namespace pg
             MasterRenderer masterRenderer;
             masterRenderer.registerMaterial("testMaterial", Material());
             masterRenderer.registerMaterial("testMaterial2", Material());
-            // Need to execute and render to finalize the material registration
-            masterRenderer.execute();
-            masterRenderer.renderAll();
 
             MockRenderer renderer(&masterRenderer, RenderStage::Render);
 
@@ -294,9 +417,6 @@ namespace pg
         {
             MasterRenderer masterRenderer;
             masterRenderer.registerMaterial("testMaterial", Material());
-            // Need to execute and render to finalize the material registration
-            masterRenderer.execute();
-            masterRenderer.renderAll();
 
             MockRenderer renderer(&masterRenderer, RenderStage::Render);
 
@@ -323,9 +443,6 @@ namespace pg
         {
             MasterRenderer masterRenderer;
             masterRenderer.registerMaterial("testMaterial", Material());
-            // Need to execute and render to finalize the material registration
-            masterRenderer.execute();
-            masterRenderer.renderAll();
 
             MockRenderer renderer(&masterRenderer, RenderStage::Render);
 
@@ -362,9 +479,6 @@ namespace pg
         {
             MasterRenderer masterRenderer;
             masterRenderer.registerMaterial("testMaterial", Material());
-            // Need to execute and render to finalize the material registration
-            masterRenderer.execute();
-            masterRenderer.renderAll();
 
             MockRenderer renderer(&masterRenderer, RenderStage::Render);
 
@@ -388,9 +502,6 @@ namespace pg
         {
             MasterRenderer masterRenderer;
             masterRenderer.registerMaterial("testMaterial", Material());
-            // Need to execute and render to finalize the material registration
-            masterRenderer.execute();
-            masterRenderer.renderAll();
 
             MockRenderer renderer(&masterRenderer, RenderStage::Render);
 
@@ -413,9 +524,6 @@ namespace pg
         {
             MasterRenderer masterRenderer;
             masterRenderer.registerMaterial("testMaterial", Material());
-            // Need to execute and render to finalize the material registration
-            masterRenderer.execute();
-            masterRenderer.renderAll();
 
             MockRenderer renderer(&masterRenderer, RenderStage::Render);
 
@@ -432,6 +540,1425 @@ namespace pg
             EXPECT_EQ(calls[0].data.size(), 1u);
             EXPECT_FLOAT_EQ(calls[0].data[0], 4.0f);
         }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+
+        TEST(render_queue_test, radix_sort_is_stable)
+        {
+            std::vector<RenderCall> calls(2000);
+
+            std::mt19937_64 rng(42);
+
+            RenderQueue queue;
+
+            for (auto& call : calls)
+            {
+                // Few distinct keys spread over all the bytes to get a lot of ties
+                call.key = (rng() % 16) << 60 | (rng() % 4) << 30 | (rng() % 8);
+                queue.push(call.key, &call);
+            }
+
+            std::vector<RenderQueueEntry> expected(queue.begin(), queue.end());
+            std::stable_sort(expected.begin(), expected.end(), [](const RenderQueueEntry& lhs, const RenderQueueEntry& rhs) { return lhs.key < rhs.key; });
+
+            queue.sort();
+
+            ASSERT_EQ(queue.size(), expected.size());
+
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                EXPECT_EQ(queue[i].key, expected[i].key);
+                EXPECT_EQ(queue[i].call, expected[i].call);
+            }
+        }
+
+        TEST(render_queue_test, interleaved_states_are_batched)
+        {
+            MasterRenderer masterRenderer;
+            masterRenderer.registerMaterial("testMaterial", Material());
+
+            MockRenderer renderer(&masterRenderer, RenderStage::Render);
+
+            RenderCall call1, call2, call3;
+            call1.data = {1.0f};
+            call2.data = {2.0f};
+            call3.data = {3.0f};
+
+            call2.state.scissorEnabled = true;
+
+            renderer.addRenderCall(call1);
+            renderer.addRenderCall(call2);
+            renderer.addRenderCall(call3);
+            masterRenderer.execute();
+
+            const auto& calls = masterRenderer.getRenderCalls(1);
+            ASSERT_EQ(calls.size(), 2u);
+            EXPECT_EQ(calls[0].data, (std::vector<float>{1, 3}));
+            EXPECT_EQ(calls[1].data, (std::vector<float>{2}));
+        }
+
+        TEST(render_queue_test, only_dirty_renderers_are_merged_again)
+        {
+            MasterRenderer masterRenderer;
+            masterRenderer.registerMaterial("testMaterial", Material());
+
+            MockRenderer staticRenderer(&masterRenderer, RenderStage::Render);
+            MockRenderer movingRenderer(&masterRenderer, RenderStage::Render);
+
+            RenderCall call1, call2;
+            call1.data = {1.0f};
+            call2.data = {2.0f};
+
+            staticRenderer.addRenderCall(call1);
+            movingRenderer.addRenderCall(call2);
+            masterRenderer.execute();
+
+            {
+                const auto& calls = masterRenderer.getRenderCalls(1);
+                ASSERT_EQ(calls.size(), 1u);
+                EXPECT_EQ(calls[0].data, (std::vector<float>{1, 2}));
+            }
+
+            masterRenderer.renderAll();
+
+            // The static renderer is not flagged as dirty, so its cached batches must be reused as is
+            RenderCall call3, call4;
+            call3.data = {3.0f};
+            call4.data = {4.0f};
+
+            staticRenderer.addRenderCall(call3);
+            movingRenderer.addRenderCall(call4);
+            movingRenderer.setDirty(true);
+            masterRenderer.execute();
+
+            const auto& calls = masterRenderer.getRenderCalls(1);
+            ASSERT_EQ(calls.size(), 1u);
+            EXPECT_EQ(calls[0].data, (std::vector<float>{1, 2, 4}));
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+
+        TEST(frame_packet_test, triple_buffer_keeps_the_newest_value)
+        {
+            TripleBuffer<int> buffer;
+
+            EXPECT_FALSE(buffer.acquire());
+
+            buffer.back() = 1;
+            EXPECT_FALSE(buffer.publish());
+
+            // The first value was never taken by the consumer, so it is replaced
+            buffer.back() = 2;
+            EXPECT_TRUE(buffer.publish());
+            EXPECT_EQ(buffer.latest(), 2);
+
+            EXPECT_TRUE(buffer.acquire());
+            EXPECT_EQ(buffer.front(), 2);
+
+            // Nothing new was published, the consumer keeps its value
+            EXPECT_FALSE(buffer.acquire());
+            EXPECT_EQ(buffer.front(), 2);
+
+            // The producer writes while the consumer still reads its value
+            buffer.back() = 3;
+            EXPECT_EQ(buffer.front(), 2);
+            EXPECT_FALSE(buffer.publish());
+
+            EXPECT_TRUE(buffer.acquire());
+            EXPECT_EQ(buffer.front(), 3);
+        }
+
+        TEST(frame_packet_test, values_are_never_torn_across_threads)
+        {
+            constexpr size_t nbValues = 100000;
+
+            TripleBuffer<std::pair<size_t, size_t>> buffer;
+
+            std::thread producer([&buffer]() {
+                for (size_t i = 1; i <= nbValues; ++i)
+                {
+                    buffer.back() = {i, i};
+                    buffer.publish();
+                }
+            });
+
+            size_t last = 0;
+            size_t nbTorn = 0;
+            size_t nbOutOfOrder = 0;
+
+            // The last publication is never dropped, so the consumer always ends up with it
+            while (last < nbValues)
+            {
+                if (not buffer.acquire())
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                const auto value = buffer.front();
+
+                if (value.first != value.second)
+                    nbTorn++;
+
+                if (value.first <= last)
+                    nbOutOfOrder++;
+
+                last = value.first;
+            }
+
+            producer.join();
+
+            EXPECT_EQ(nbTorn, 0u);
+            EXPECT_EQ(nbOutOfOrder, 0u);
+            EXPECT_EQ(last, nbValues);
+        }
+
+        TEST(frame_packet_test, execute_never_waits_for_the_render_thread)
+        {
+            MasterRenderer masterRenderer;
+
+            auto backend = new NullRenderBackend();
+            masterRenderer.setBackend(std::unique_ptr<RenderBackend>(backend));
+
+            masterRenderer.getParameter()["ScreenWidth"] = 800;
+            masterRenderer.getParameter()["ScreenHeight"] = 600;
+
+            Material material;
+            material.nbAttributes = 1;
+
+            masterRenderer.registerMaterial("testMaterial", material);
+
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            MockRenderer renderer(&masterRenderer, RenderStage::Render);
+
+            RenderCall call1, call2;
+            call1.data = {1.0f};
+            call2.data = {2.0f};
+
+            const size_t nbGenerated = masterRenderer.getNbGeneratedFrames();
+
+            renderer.addRenderCall(call1);
+            masterRenderer.execute();
+
+            // The render thread didn't take the first frame yet, the second pass still runs and replaces it
+            renderer.addRenderCall(call2);
+            renderer.setDirty(true);
+            masterRenderer.execute();
+
+            EXPECT_EQ(masterRenderer.getNbGeneratedFrames(), nbGenerated + 2);
+            EXPECT_EQ(masterRenderer.getNbDroppedFrames(), 1u);
+
+            // The newest frame is drawn by the next render
+            masterRenderer.renderAll();
+
+            const auto calls = masterRenderer.getRenderCalls();
+            ASSERT_EQ(calls.size(), 1u);
+            EXPECT_EQ(calls[0].data, (std::vector<float>{1, 2}));
+
+            EXPECT_EQ(backend->getStats().nbInstances, 2u);
+
+            auto frame = masterRenderer.getLastFrameStats();
+            EXPECT_EQ(frame.frameId, masterRenderer.getNbGeneratedFrames());
+            EXPECT_GE(frame.frameLatency, 0.0);
+
+            // Without a new frame the last one is drawn again
+            masterRenderer.renderAll();
+
+            EXPECT_EQ(masterRenderer.getLastFrameStats().frameId, frame.frameId);
+            EXPECT_EQ(masterRenderer.getNbDroppedFrames(), 1u);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+
+        TEST(culling_test, quads_outside_of_the_viewport_are_culled)
+        {
+            CullRect rect;
+            ASSERT_TRUE(computeCullRect(glm::mat4(1.0f), 800.0f, 600.0f, rect));
+
+            EXPECT_EQ(rect, (CullRect{0.0f, 0.0f, 800.0f, 600.0f}));
+
+            // x, y, z, w, h, rotation
+            std::vector<float> data = {
+                10.0f, 10.0f, 0.0f, 20.0f, 20.0f, 0.0f,
+                900.0f, 10.0f, 0.0f, 20.0f, 20.0f, 0.0f,
+                -15.0f, 10.0f, 0.0f, 20.0f, 20.0f, 0.0f,
+                -22.0f, 10.0f, 0.0f, 20.0f, 20.0f, 45.0f,
+                -30.0f, 10.0f, 0.0f, 20.0f, 20.0f, 45.0f};
+
+            // The rotated quad at -22 reaches past the left edge once rotated, the one at -30 doesn't
+            EXPECT_EQ(countVisibleQuads(data.data(), 5, 6, rect, true), 3u);
+            EXPECT_EQ(countVisibleQuads(data.data(), 5, 6, rect, false), 2u);
+
+            std::vector<float> visible;
+            EXPECT_EQ(copyVisibleQuads(data.data(), 5, 6, rect, false, visible), 2u);
+
+            ASSERT_EQ(visible.size(), 12u);
+            EXPECT_EQ(visible[0], 10.0f);
+            EXPECT_EQ(visible[6], -15.0f);
+
+            // Views rotating the world can't be culled with a rectangle
+            EXPECT_FALSE(computeCullRect(glm::rotate(glm::mat4(1.0f), 0.5f, glm::vec3(0.0f, 0.0f, 1.0f)), 800.0f, 600.0f, rect));
+        }
+
+        TEST(culling_test, master_renderer_culls_before_batching)
+        {
+            MasterRenderer masterRenderer;
+
+            masterRenderer.getParameter()["ScreenWidth"] = 800;
+            masterRenderer.getParameter()["ScreenHeight"] = 600;
+
+            Material material;
+            material.nbAttributes = 6;
+            material.cullable = true;
+            material.rotatedElements = true;
+
+            masterRenderer.registerMaterial("testMaterial", material);
+
+            MockRenderer renderer(&masterRenderer, RenderStage::Render);
+
+            RenderCall inside, outside, overlapping;
+            inside.data = {10.0f, 10.0f, 0.0f, 20.0f, 20.0f, 0.0f};
+            outside.data = {900.0f, 10.0f, 0.0f, 20.0f, 20.0f, 0.0f};
+            overlapping.data = {-15.0f, 590.0f, 0.0f, 20.0f, 20.0f, 0.0f};
+
+            renderer.addRenderCall(inside);
+            renderer.addRenderCall(outside);
+            renderer.addRenderCall(overlapping);
+
+            masterRenderer.execute();
+
+            {
+                const auto& calls = masterRenderer.getRenderCalls(1);
+                ASSERT_EQ(calls.size(), 1u);
+                EXPECT_EQ(calls[0].nbElements, 2u);
+                EXPECT_EQ(calls[0].data[0], 10.0f);
+                EXPECT_EQ(calls[0].data[6], -15.0f);
+            }
+
+            masterRenderer.renderAll();
+
+            const auto stats = masterRenderer.getRenderStats();
+            EXPECT_EQ(stats.nbRenderCalls, 1u);
+            EXPECT_EQ(stats.nbInstances, 2u);
+            EXPECT_EQ(stats.nbCulledInstances, 1u);
+
+            // The renderer is not dirty, but its calls must be merged again once the visible area changes
+            masterRenderer.setCulling(false);
+            masterRenderer.execute();
+
+            const auto& calls = masterRenderer.getRenderCalls(1);
+            ASSERT_EQ(calls.size(), 1u);
+            EXPECT_EQ(calls[0].nbElements, 3u);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+
+        TEST(instance_slot_buffer_test, slots_stay_contiguous)
+        {
+            InstanceSlotBuffer buffer(2);
+
+            float a[2] = {1.0f, 1.0f};
+            float b[2] = {2.0f, 2.0f};
+            float c[2] = {3.0f, 3.0f};
+
+            buffer.set(10, a);
+            buffer.set(11, b);
+            buffer.set(12, c);
+
+            EXPECT_EQ(buffer.size(), 3u);
+
+            // Removing the first slot moves the last one in its place
+            EXPECT_TRUE(buffer.remove(10));
+            EXPECT_FALSE(buffer.remove(10));
+
+            EXPECT_EQ(buffer.size(), 2u);
+            EXPECT_FALSE(buffer.has(10));
+            EXPECT_TRUE(buffer.has(11));
+            EXPECT_TRUE(buffer.has(12));
+
+            std::vector<float> data;
+            EXPECT_EQ(buffer.copyData(data), 2u);
+            EXPECT_EQ(data, (std::vector<float>{3, 3, 2, 2}));
+
+            // Writing an entity again only changes its own slot
+            float d[2] = {4.0f, 5.0f};
+            buffer.set(11, d);
+
+            buffer.copyData(data);
+            EXPECT_EQ(data, (std::vector<float>{3, 3, 4, 5}));
+        }
+
+        TEST(instance_slot_buffer_test, coalesce_dirty_slots)
+        {
+            std::vector<size_t> slots = {40, 3, 2, 3, 100, 1, 45};
+
+            auto ranges = InstanceSlotBuffer::coalesceSlots(slots, 4, 8);
+
+            ASSERT_EQ(ranges.size(), 3u);
+            EXPECT_EQ(ranges[0], (InstanceSlotBuffer::SlotRange{1, 4}));
+            EXPECT_EQ(ranges[1], (InstanceSlotBuffer::SlotRange{40, 46}));
+            EXPECT_EQ(ranges[2], (InstanceSlotBuffer::SlotRange{100, 101}));
+
+            // With a limit of 2 ranges the closest ones are merged
+            ranges = InstanceSlotBuffer::coalesceSlots(slots, 4, 2);
+
+            ASSERT_EQ(ranges.size(), 2u);
+            EXPECT_EQ(ranges[0], (InstanceSlotBuffer::SlotRange{1, 46}));
+            EXPECT_EQ(ranges[1], (InstanceSlotBuffer::SlotRange{100, 101}));
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+
+        TEST(texture_packer_test, skyline_packs_without_overlap)
+        {
+            SkylinePacker packer(64, 64);
+
+            std::mt19937 rng(42);
+
+            struct Rect { unsigned int x, y, w, h; };
+            std::vector<Rect> rects;
+
+            for (size_t i = 0; i < 200; ++i)
+            {
+                Rect rect;
+                rect.w = 1 + rng() % 12;
+                rect.h = 1 + rng() % 12;
+
+                if (packer.pack(rect.w, rect.h, rect.x, rect.y))
+                    rects.push_back(rect);
+            }
+
+            ASSERT_FALSE(rects.empty());
+
+            for (size_t i = 0; i < rects.size(); ++i)
+            {
+                const auto& a = rects[i];
+
+                EXPECT_LE(a.x + a.w, 64u);
+                EXPECT_LE(a.y + a.h, 64u);
+
+                for (size_t j = i + 1; j < rects.size(); ++j)
+                {
+                    const auto& b = rects[j];
+
+                    const bool overlap = a.x < b.x + b.w and b.x < a.x + a.w and a.y < b.y + b.h and b.y < a.y + a.h;
+
+                    EXPECT_FALSE(overlap) << "Rect " << i << " overlaps rect " << j;
+                }
+            }
+
+            // Bottom-left packing of small rectangles should leave little room unused
+            EXPECT_GT(packer.getOccupancy(), 0.7f);
+
+            unsigned int x, y;
+            EXPECT_FALSE(packer.pack(65, 1, x, y));
+        }
+
+        TEST(texture_packer_test, runtime_atlas_opens_pages_when_full)
+        {
+            RuntimeTextureAtlas atlas(64, 32, 1);
+
+            EXPECT_FALSE(atlas.accepts(33, 8));
+            EXPECT_TRUE(atlas.accepts(32, 32));
+
+            RuntimeTextureAtlas::Placement placement;
+
+            // Padded to 34x34, only one fits in a 64x64 page
+            ASSERT_TRUE(atlas.place(32, 32, placement));
+            EXPECT_EQ(placement.page, 0u);
+            EXPECT_EQ(placement.x, 1u);
+            EXPECT_EQ(placement.y, 1u);
+            EXPECT_FLOAT_EQ(placement.limits.x, 1.0f / 64.0f);
+            EXPECT_FLOAT_EQ(placement.limits.w, 33.0f / 64.0f);
+
+            ASSERT_TRUE(atlas.place(32, 32, placement));
+            EXPECT_EQ(placement.page, 1u);
+
+            // Small textures still go in the free space of the first page
+            ASSERT_TRUE(atlas.place(8, 8, placement));
+            EXPECT_EQ(placement.page, 0u);
+
+            EXPECT_EQ(atlas.getNbPages(), 2u);
+
+            // Nothing was uploaded so no GL texture exists yet
+            EXPECT_EQ(atlas.getPageTextureId(0), 0u);
+        }
+
+        TEST(texture_packer_test, runtime_atlas_textures_are_added_to_a_loaded_atlas)
+        {
+            LoadedAtlas atlas;
+            atlas.setSize(64, 64);
+
+            AtlasTexture texture;
+            texture.setName("sprite");
+            texture.setTextureLimit(constant::Vector4D(0.0f, 0.0f, 0.5f, 0.5f));
+
+            EXPECT_EQ(atlas.addTexture(texture), 0u);
+
+            texture.setName("other");
+            EXPECT_EQ(atlas.addTexture(texture), 1u);
+
+            // Replacing a texture keeps its id
+            texture.setName("sprite");
+            texture.setTextureLimit(constant::Vector4D(0.5f, 0.5f, 1.0f, 1.0f));
+            EXPECT_EQ(atlas.addTexture(texture), 0u);
+
+            EXPECT_FLOAT_EQ(atlas.getTexture("sprite").getTextureLimit().x, 0.5f);
+            EXPECT_EQ(atlas.getTexture("other").getId(), 1);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+
+        namespace
+        {
+            bool waitForDecodedTexture(AsyncTextureDecoder& decoder, DecodedTexture& texture)
+            {
+                for (size_t i = 0; i < 200; ++i)
+                {
+                    if (decoder.tryPop(texture))
+                        return true;
+
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+
+                return false;
+            }
+        }
+
+        TEST(texture_decoder_test, files_are_decoded_by_the_workers)
+        {
+            const auto path = (std::filesystem::temp_directory_path() / "pg_texture_decoder_test.ppm").string();
+
+            {
+                // A 2x1 image with a red and a blue pixel
+                std::ofstream file(path, std::ios::binary);
+                file << "P6\n2 1\n255\n";
+                const unsigned char pixels[6] = {255, 0, 0, 0, 0, 255};
+                file.write(reinterpret_cast<const char*>(pixels), sizeof(pixels));
+            }
+
+            AsyncTextureDecoder decoder(1);
+
+            decoder.request("image", path, 12);
+
+            EXPECT_EQ(decoder.getNbPending(), 1u);
+
+            DecodedTexture texture;
+
+            ASSERT_TRUE(waitForDecodedTexture(decoder, texture));
+
+            EXPECT_EQ(decoder.getNbPending(), 0u);
+
+            EXPECT_EQ(texture.name, "image");
+            EXPECT_EQ(texture.textureId, 12u);
+            EXPECT_EQ(texture.width, 2);
+            EXPECT_EQ(texture.height, 1);
+
+            // Pixels are always expanded to RGBA
+            ASSERT_EQ(texture.size(), 8u);
+            EXPECT_EQ(texture.pixels[0], 255);
+            EXPECT_EQ(texture.pixels[3], 255);
+            EXPECT_EQ(texture.pixels[6], 255);
+
+            std::filesystem::remove(path);
+        }
+
+        TEST(texture_decoder_test, failed_decodes_are_handed_back_without_pixels)
+        {
+            AsyncTextureDecoder decoder(1);
+
+            decoder.request("missing", "res/this_texture_does_not_exist.png", 3);
+
+            DecodedTexture texture;
+
+            ASSERT_TRUE(waitForDecodedTexture(decoder, texture));
+
+            EXPECT_EQ(texture.name, "missing");
+            EXPECT_EQ(texture.size(), 0u);
+            EXPECT_EQ(decoder.getNbPending(), 0u);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+
+        namespace
+        {
+            void writeTestImage(const std::string& path, unsigned char blue)
+            {
+                // A 2x1 image with a red and a blue pixel
+                std::ofstream file(path, std::ios::binary | std::ios::trunc);
+                file << "P6\n2 1\n255\n";
+                const unsigned char pixels[6] = {255, 0, 0, 0, 0, blue};
+                file.write(reinterpret_cast<const char*>(pixels), sizeof(pixels));
+            }
+        }
+
+        TEST(texture_cache_test, decoded_textures_are_mapped_from_the_cache)
+        {
+            const auto directory = std::filesystem::temp_directory_path() / "pg_texture_cache_test";
+            const auto path = (std::filesystem::temp_directory_path() / "pg_texture_cache_test.ppm").string();
+
+            std::filesystem::remove_all(directory);
+
+            writeTestImage(path, 255);
+
+            TextureCache cache(directory.string());
+
+            ASSERT_TRUE(cache.isEnabled());
+            EXPECT_EQ(cache.load(path), nullptr);
+
+            // The first decode fills the cache
+            DecodedTexture decoded;
+            ASSERT_TRUE(decodeTextureFile(path, decoded, &cache));
+            EXPECT_EQ(decoded.mapped, nullptr);
+
+            DecodedTexture cached;
+            ASSERT_TRUE(decodeTextureFile(path, cached, &cache));
+            ASSERT_NE(cached.mapped, nullptr);
+
+            EXPECT_EQ(cached.width, 2);
+            EXPECT_EQ(cached.height, 1);
+            ASSERT_EQ(cached.size(), decoded.size());
+            EXPECT_TRUE(std::equal(decoded.data(), decoded.data() + decoded.size(), cached.data()));
+
+            EXPECT_EQ(cached.mapped->getSourcePath(), path);
+
+            // Pixels are aligned to be read straight from the mapping
+            EXPECT_EQ(cached.mapped->getHeader().pixelsOffset % 16, 0u);
+
+            std::filesystem::remove_all(directory);
+            std::filesystem::remove(path);
+        }
+
+        TEST(texture_cache_test, changed_sources_invalidate_the_cache)
+        {
+            const auto directory = std::filesystem::temp_directory_path() / "pg_texture_cache_invalidation_test";
+            const auto path = (std::filesystem::temp_directory_path() / "pg_texture_cache_invalidation_test.ppm").string();
+
+            std::filesystem::remove_all(directory);
+
+            writeTestImage(path, 255);
+
+            TextureCache cache(directory.string());
+
+            const unsigned char pixels[8] = {255, 0, 0, 255, 0, 0, 255, 255};
+
+            ASSERT_TRUE(cache.store(path, 2, 1, pixels));
+            ASSERT_NE(cache.load(path), nullptr);
+
+            // Only touching the file keeps the cache as its content hash didn't change
+            std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) + std::chrono::hours(1));
+            EXPECT_NE(cache.load(path), nullptr);
+
+            // A new content of the same size is detected through its hash
+            writeTestImage(path, 128);
+            std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) + std::chrono::hours(2));
+            EXPECT_EQ(cache.load(path), nullptr);
+
+            // A disabled cache never hits
+            TextureCache disabled;
+            EXPECT_FALSE(disabled.isEnabled());
+            EXPECT_FALSE(disabled.store(path, 2, 1, pixels));
+            EXPECT_EQ(disabled.load(path), nullptr);
+
+            std::filesystem::remove_all(directory);
+            std::filesystem::remove(path);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+
+        TEST(render_backend_test, null_backend_records_the_draw_stream)
+        {
+            MasterRenderer masterRenderer;
+
+            auto backend = new NullRenderBackend();
+            masterRenderer.setBackend(std::unique_ptr<RenderBackend>(backend));
+
+            masterRenderer.getParameter()["ScreenWidth"] = 800;
+            masterRenderer.getParameter()["ScreenHeight"] = 600;
+
+            Material spriteA;
+            spriteA.nbAttributes = 2;
+            spriteA.textureId[0] = 7;
+
+            Material spriteB;
+            spriteB.nbAttributes = 2;
+            spriteB.textureId[0] = 9;
+
+            masterRenderer.registerMaterial("spriteA", spriteA);
+            masterRenderer.registerMaterial("spriteB", spriteB);
+
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            MockRenderer renderer(&masterRenderer, RenderStage::Render);
+
+            RenderCall a1, a2, b;
+
+            a1.setMaterial(0);
+            a1.data = {1, 2};
+
+            a2.setMaterial(0);
+            a2.data = {3, 4};
+
+            b.setMaterial(1);
+            b.data = {5, 6};
+            b.state.setScissor(0, 0, 10, 10);
+
+            renderer.addRenderCall(a1);
+            renderer.addRenderCall(a2);
+            renderer.addRenderCall(b);
+
+            masterRenderer.execute();
+
+            // The frame generated by execute is drawn by the next render
+            masterRenderer.renderAll();
+
+            const auto& commands = backend->getCommands();
+
+            ASSERT_EQ(commands.size(), 10u);
+
+            EXPECT_EQ(commands[0].type, RenderCommand::Type::UseProgram);
+            EXPECT_EQ(commands[0].materialId, 0u);
+
+            // Default calls are opaque, so they are depth tested
+            EXPECT_EQ(commands[1].type, RenderCommand::Type::SetDepth);
+            EXPECT_EQ(commands[1].slot, static_cast<size_t>(DepthMode::TestAndWrite));
+
+            EXPECT_EQ(commands[2].type, RenderCommand::Type::BindTexture);
+            EXPECT_EQ(commands[2].slot, 0u);
+            EXPECT_EQ(commands[2].textureId, 7u);
+
+            EXPECT_EQ(commands[3].type, RenderCommand::Type::BindCamera);
+            EXPECT_EQ(commands[3].slot, 0u);
+
+            // Both calls of spriteA are batched in a single draw
+            EXPECT_EQ(commands[4].type, RenderCommand::Type::Draw);
+            EXPECT_EQ(commands[4].materialId, 0u);
+            EXPECT_EQ(commands[4].nbInstances, 2u);
+            EXPECT_EQ(commands[4].nbBytes, 4 * sizeof(float));
+
+            EXPECT_EQ(commands[5].type, RenderCommand::Type::UseProgram);
+            EXPECT_EQ(commands[5].materialId, 1u);
+
+            EXPECT_EQ(commands[6].type, RenderCommand::Type::SetState);
+
+            EXPECT_EQ(commands[7].type, RenderCommand::Type::BindTexture);
+            EXPECT_EQ(commands[7].textureId, 9u);
+
+            // The camera block of the viewport is still bound, so it is not bound again
+            EXPECT_EQ(commands[8].type, RenderCommand::Type::Draw);
+            EXPECT_EQ(commands[8].materialId, 1u);
+            EXPECT_EQ(commands[8].nbInstances, 1u);
+
+            // The depth test is turned off at the end of the frame
+            EXPECT_EQ(commands[9].type, RenderCommand::Type::SetDepth);
+            EXPECT_EQ(commands[9].slot, static_cast<size_t>(DepthMode::Disabled));
+
+            const auto& stats = backend->getStats();
+
+            EXPECT_EQ(stats.nbFrames, 2u);
+            EXPECT_EQ(stats.nbDrawCalls, 2u);
+            EXPECT_EQ(stats.nbInstances, 3u);
+            EXPECT_EQ(stats.nbUploadedBytes, 6 * sizeof(float));
+        }
+
+        TEST(render_backend_test, opaque_calls_front_to_back_and_transparent_calls_back_to_front)
+        {
+            MasterRenderer masterRenderer;
+
+            auto backend = new NullRenderBackend();
+            masterRenderer.setBackend(std::unique_ptr<RenderBackend>(backend));
+
+            masterRenderer.getParameter()["ScreenWidth"] = 800;
+            masterRenderer.getParameter()["ScreenHeight"] = 600;
+
+            Material spriteA;
+            spriteA.nbAttributes = 1;
+            spriteA.textureId[0] = 7;
+
+            Material spriteB;
+            spriteB.nbAttributes = 1;
+            spriteB.textureId[0] = 9;
+
+            masterRenderer.registerMaterial("spriteA", spriteA);
+            masterRenderer.registerMaterial("spriteB", spriteB);
+
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            MockRenderer renderer(&masterRenderer, RenderStage::Render);
+
+            // Each call gets a different number of instances to find it back in the draw stream
+            auto addCall = [&renderer](OpacityType opacity, int depth, uint64_t material, size_t nbInstances)
+            {
+                RenderCall call(true, RenderStage::Render, opacity, depth, material);
+                for (size_t i = 0; i < nbInstances; ++i)
+                    call.data.push_back(0.0f);
+
+                renderer.addRenderCall(call);
+            };
+
+            addCall(OpacityType::Opaque, 1, 0, 2);
+            addCall(OpacityType::Opaque, 5, 1, 3);
+            addCall(OpacityType::Opaque, 5, 0, 1);
+            addCall(OpacityType::Opaque, 1, 1, 4);
+            addCall(OpacityType::Additive, 3, 0, 6);
+            addCall(OpacityType::Additive, -2, 1, 5);
+
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            std::vector<size_t> drawOrder;
+            std::vector<size_t> depthModes;
+
+            for (const auto& command : backend->getCommands())
+            {
+                if (command.type == RenderCommand::Type::Draw)
+                    drawOrder.push_back(command.nbInstances);
+                else if (command.type == RenderCommand::Type::SetDepth)
+                    depthModes.push_back(command.slot);
+            }
+
+            // Opaque calls are grouped by material and drawn nearest first, transparent calls are drawn farthest first
+            EXPECT_EQ(drawOrder, (std::vector<size_t>{1, 2, 3, 4, 5, 6}));
+
+            EXPECT_EQ(depthModes, (std::vector<size_t>{
+                static_cast<size_t>(DepthMode::TestAndWrite),
+                static_cast<size_t>(DepthMode::TestOnly),
+                static_cast<size_t>(DepthMode::Disabled)}));
+
+            // The last opaque material is also the first transparent one, so the program is only switched twice
+            const auto frame = masterRenderer.getLastFrameStats();
+
+            EXPECT_EQ(frame.nbProgramBinds, 3u);
+            EXPECT_EQ(frame.nbTextureBinds, 3u);
+            EXPECT_EQ(frame.nbStateChanges, 3u);
+        }
+
+        TEST(render_backend_test, null_backend_only_counts_the_dirty_slots)
+        {
+            MasterRenderer masterRenderer;
+
+            auto backend = new NullRenderBackend(false);
+            masterRenderer.setBackend(std::unique_ptr<RenderBackend>(backend));
+
+            Material material;
+            material.nbAttributes = 2;
+
+            masterRenderer.registerMaterial("slots", material);
+
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            auto slots = std::make_shared<InstanceSlotBuffer>(2);
+
+            const float first[2] = {1, 2};
+            const float second[2] = {3, 4};
+
+            slots->set(1, first);
+            slots->set(2, second);
+
+            MockRenderer renderer(&masterRenderer, RenderStage::Render);
+
+            RenderCall call;
+            call.setMaterial(0);
+            call.slotBuffer = slots;
+
+            renderer.addRenderCall(call);
+
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            EXPECT_EQ(backend->getStats().nbInstances, 2u);
+            EXPECT_EQ(backend->getStats().nbUploadedBytes, 4 * sizeof(float));
+
+            // Only the slot written since the last frame is sent again
+            slots->set(2, first);
+
+            masterRenderer.renderAll();
+
+            EXPECT_EQ(backend->getStats().nbInstances, 4u);
+            EXPECT_EQ(backend->getStats().nbUploadedBytes, 6 * sizeof(float));
+
+            // The commands are only counted
+            EXPECT_TRUE(backend->getCommands().empty());
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+
+        TEST(render_payload_test, behaves_like_a_vector)
+        {
+            RenderPayload payload = {1.0f, 2.0f};
+
+            EXPECT_EQ(payload.size(), 2u);
+            EXPECT_GE(payload.capacity(), RenderPayloadPool::MinBlockSize);
+
+            payload.push_back(3.0f);
+
+            const float more[2] = {4.0f, 5.0f};
+            payload.insert(payload.end(), more, more + 2);
+
+            ASSERT_EQ(payload.size(), 5u);
+            EXPECT_EQ(payload[4], 5.0f);
+
+            // Inserting in the middle keeps the tail
+            payload.insert(payload.begin() + 1, more, more + 1);
+
+            ASSERT_EQ(payload.size(), 6u);
+            EXPECT_EQ(payload[1], 4.0f);
+            EXPECT_EQ(payload[2], 2.0f);
+            EXPECT_EQ(payload[5], 5.0f);
+
+            payload.resize(40, 7.0f);
+
+            EXPECT_EQ(payload.size(), 40u);
+            EXPECT_EQ(payload[39], 7.0f);
+            EXPECT_EQ(payload[5], 5.0f);
+
+            RenderPayload copy = payload;
+            EXPECT_EQ(copy, payload);
+
+            RenderPayload moved = std::move(copy);
+            EXPECT_TRUE(copy.empty());
+            EXPECT_EQ(moved, payload);
+
+            payload.clear();
+            EXPECT_TRUE(payload.empty());
+        }
+
+        TEST(render_payload_test, released_blocks_are_recycled)
+        {
+            const float *first;
+
+            {
+                RenderPayload payload;
+                payload.resize(100);
+
+                first = payload.data();
+            }
+
+            // The block of the same class is handed back right away
+            RenderPayload payload;
+            payload.resize(120);
+
+            EXPECT_EQ(payload.data(), first);
+        }
+
+        TEST(render_payload_test, merging_in_steady_state_does_not_allocate)
+        {
+            MasterRenderer masterRenderer;
+
+            masterRenderer.setBackend(std::unique_ptr<RenderBackend>(new NullRenderBackend(false)));
+
+            Material material;
+            material.nbAttributes = 2;
+
+            masterRenderer.registerMaterial("sprite", material);
+
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            MockRenderer renderer(&masterRenderer, RenderStage::Render);
+
+            for (size_t i = 0; i < 500; ++i)
+            {
+                RenderCall call;
+                call.setMaterial(0);
+                call.data = {static_cast<float>(i), 1.0f};
+
+                renderer.addRenderCall(call);
+            }
+
+            auto frame = [&]() {
+                renderer.setDirty(true);
+                masterRenderer.execute();
+                masterRenderer.renderAll();
+            };
+
+            // Let the pool grow to the size of the batches
+            for (size_t i = 0; i < 3; ++i)
+                frame();
+
+            const auto nbAllocations = RenderPayloadPool::get().getNbHeapAllocations();
+
+            for (size_t i = 0; i < 10; ++i)
+                frame();
+
+            EXPECT_EQ(RenderPayloadPool::get().getNbHeapAllocations(), nbAllocations);
+
+            renderer.setDirty(true);
+            masterRenderer.execute();
+
+            // All the calls are still batched together
+            ASSERT_EQ(masterRenderer.getRenderCalls(1).size(), 1u);
+            EXPECT_EQ(masterRenderer.getRenderCalls(1)[0].data.size(), 1000u);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+
+        TEST(parallel_merge_test, chunked_merge_matches_the_serial_merge)
+        {
+            auto makeCalls = [](MockRenderer& renderer) {
+                for (size_t i = 0; i < 300; ++i)
+                {
+                    RenderCall call;
+                    call.setMaterial(i % 2);
+                    call.setDepth(static_cast<int>(i % 7));
+                    call.data = {static_cast<float>(i), 1.0f};
+
+                    // Some calls can't be batched or need a scissor, so batches of a same key stay apart
+                    call.batchable = i % 11 != 0;
+
+                    if (i % 13 == 0)
+                        call.state.setScissor(0, 0, 10, 10);
+
+                    renderer.addRenderCall(call);
+                }
+            };
+
+            auto merge = [&makeCalls](size_t chunkSize) {
+                MasterRenderer masterRenderer;
+
+                masterRenderer.setBackend(std::unique_ptr<RenderBackend>(new NullRenderBackend(false)));
+                masterRenderer.setMergeChunkSize(chunkSize);
+
+                Material material;
+                material.nbAttributes = 2;
+
+                masterRenderer.registerMaterial("a", material);
+                masterRenderer.registerMaterial("b", material);
+
+                masterRenderer.execute();
+                masterRenderer.renderAll();
+
+                MockRenderer renderer(&masterRenderer, RenderStage::Render);
+
+                makeCalls(renderer);
+
+                masterRenderer.execute();
+
+                return masterRenderer.getRenderCalls(1);
+            };
+
+            const auto serial = merge(100000);
+            const auto chunked = merge(8);
+
+            ASSERT_EQ(serial.size(), chunked.size());
+            EXPECT_GT(serial.size(), 14u);
+
+            for (size_t i = 0; i < serial.size(); ++i)
+            {
+                EXPECT_EQ(serial[i].key, chunked[i].key);
+                EXPECT_EQ(serial[i].state, chunked[i].state);
+                EXPECT_EQ(serial[i].data, chunked[i].data);
+            }
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+
+        TEST(render_stats_test, frame_counters_match_the_draw_stream)
+        {
+            MasterRenderer masterRenderer;
+
+            auto backend = new NullRenderBackend();
+            masterRenderer.setBackend(std::unique_ptr<RenderBackend>(backend));
+
+            // The null backend has no timer, turning them on must not produce any gpu time
+            masterRenderer.setGpuTimers(true);
+
+            Material spriteA;
+            spriteA.nbAttributes = 2;
+            spriteA.textureId[0] = 7;
+
+            Material spriteB;
+            spriteB.nbAttributes = 2;
+            spriteB.textureId[0] = 9;
+
+            masterRenderer.registerMaterial("spriteA", spriteA);
+            masterRenderer.registerMaterial("spriteB", spriteB);
+
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            MockRenderer renderer(&masterRenderer, RenderStage::Render);
+
+            RenderCall a1, a2, b;
+
+            a1.setMaterial(0);
+            a1.data = {1, 2};
+
+            a2.setMaterial(0);
+            a2.data = {3, 4};
+
+            b.setMaterial(1);
+            b.data = {5, 6};
+            b.state.setScissor(0, 0, 10, 10);
+
+            renderer.addRenderCall(a1);
+            renderer.addRenderCall(a2);
+            renderer.addRenderCall(b);
+
+            masterRenderer.execute();
+
+            masterRenderer.renderAll();
+
+            const auto frame = masterRenderer.getLastFrameStats();
+            const auto& backendStats = backend->getStats();
+
+            EXPECT_EQ(frame.nbBatches, 2u);
+            EXPECT_EQ(frame.nbDrawCalls, backendStats.nbDrawCalls);
+            EXPECT_EQ(frame.nbInstances, backendStats.nbInstances);
+            EXPECT_EQ(frame.nbUploadedBytes, backendStats.nbUploadedBytes);
+            EXPECT_EQ(frame.nbProgramBinds, 2u);
+            // One scissor change, the depth test turned on for the opaque calls and off at the end of the frame
+            EXPECT_EQ(frame.nbStateChanges, 3u);
+            EXPECT_EQ(frame.nbTextureBinds, 2u);
+            EXPECT_GE(frame.cpuTime, 0.0);
+            EXPECT_FALSE(frame.hasGpuTime);
+
+            // One entry per rendered frame
+            EXPECT_EQ(masterRenderer.getStatsHistory().size(), 2u);
+            EXPECT_EQ(masterRenderer.getStatsSummary(RenderMetric::DrawCalls).max, 2.0);
+        }
+
+        TEST(render_stats_test, history_wraps_and_summarizes)
+        {
+            RenderStatsHistory history(100);
+
+            // The first 20 frames are pushed out of the history by the next 100
+            for (size_t i = 0; i < 120; ++i)
+            {
+                FrameStats frame;
+                frame.nbDrawCalls = i < 20 ? 1000 : i - 19;
+
+                history.push(frame);
+            }
+
+            ASSERT_EQ(history.size(), 100u);
+            EXPECT_EQ(history.at(0).nbDrawCalls, 1u);
+            EXPECT_EQ(history.back().nbDrawCalls, 100u);
+
+            const auto drawCalls = history.summarize(RenderMetric::DrawCalls);
+
+            EXPECT_EQ(drawCalls.nbFrames, 100u);
+            EXPECT_DOUBLE_EQ(drawCalls.average, 50.5);
+            EXPECT_DOUBLE_EQ(drawCalls.p99, 99.0);
+            EXPECT_DOUBLE_EQ(drawCalls.max, 100.0);
+
+            // Frames without gpu time are left out of the gpu summary
+            EXPECT_EQ(history.summarize(RenderMetric::GpuTime).nbFrames, 0u);
+
+            FrameStats timed;
+            timed.hasGpuTime = true;
+            timed.gpuTime[0] = 10.0;
+            timed.gpuTime[2] = 5.0;
+
+            history.push(timed);
+
+            const auto gpuTime = history.summarize(RenderMetric::GpuTime);
+
+            EXPECT_EQ(gpuTime.nbFrames, 1u);
+            EXPECT_DOUBLE_EQ(gpuTime.max, 15.0);
+
+            history.setCapacity(10);
+
+            EXPECT_TRUE(history.empty());
+            EXPECT_EQ(history.capacity(), 10u);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+
+        namespace
+        {
+            bool waitForCaptures(const std::function<size_t()>& nbPending)
+            {
+                for (size_t i = 0; i < 500; ++i)
+                {
+                    if (nbPending() == 0)
+                        return true;
+
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+
+                return false;
+            }
+        }
+
+        TEST(frame_capture_test, readback_is_handed_back_two_frames_later)
+        {
+            FrameCapture capture;
+
+            std::vector<CapturedFrame> frames;
+
+            capture.capture(4, 2, "", 0, true);
+
+            capture.collect(0, frames);
+            capture.collect(1, frames);
+
+            EXPECT_TRUE(frames.empty());
+            EXPECT_EQ(capture.getNbPending(), 1u);
+
+            capture.collect(2, frames);
+
+            ASSERT_EQ(frames.size(), 1u);
+            EXPECT_EQ(frames[0].frame, 0u);
+            EXPECT_EQ(frames[0].width, 4);
+            EXPECT_EQ(frames[0].height, 2);
+            EXPECT_EQ(frames[0].pixels.size(), 4u * 2u * 4u);
+            EXPECT_EQ(capture.getNbPending(), 0u);
+
+            // Capturing every frame never has more buffers in flight than the ring holds, and frames come back in order
+            frames.clear();
+
+            for (size_t frame = 10; frame < 20; ++frame)
+            {
+                capture.capture(4, 2, "", frame, true);
+                capture.collect(frame, frames);
+
+                EXPECT_LE(capture.getNbPending(), FrameCapture::ReadbackLatency + 1);
+            }
+
+            ASSERT_EQ(frames.size(), 8u);
+
+            for (size_t i = 0; i < frames.size(); ++i)
+                EXPECT_EQ(frames[i].frame, 10 + i);
+        }
+
+        TEST(frame_capture_test, frames_are_encoded_by_the_worker)
+        {
+            const auto path = (std::filesystem::temp_directory_path() / "pg_frame_capture_test.png").string();
+
+            std::filesystem::remove(path);
+
+            // A 1x2 frame, read bottom row first: a red pixel under a blue one
+            CapturedFrame frame;
+            frame.width = 1;
+            frame.height = 2;
+            frame.pixels = {255, 0, 0, 255, 0, 0, 255, 255};
+            frame.path = path;
+
+            FrameEncoder encoder;
+
+            encoder.request(std::move(frame));
+
+            ASSERT_TRUE(waitForCaptures([&encoder]() { return encoder.getNbPending(); }));
+
+            EXPECT_EQ(encoder.getNbFailed(), 0u);
+
+            DecodedTexture texture;
+
+            ASSERT_TRUE(decodeTextureFile(path, texture));
+
+            EXPECT_EQ(texture.width, 1);
+            EXPECT_EQ(texture.height, 2);
+
+            // The png starts with the top row
+            ASSERT_EQ(texture.size(), 8u);
+            EXPECT_EQ(texture.pixels[2], 255);
+            EXPECT_EQ(texture.pixels[4], 255);
+
+            std::filesystem::remove(path);
+        }
+
+        TEST(frame_capture_test, master_renderer_saves_the_requested_frame)
+        {
+            const auto path = (std::filesystem::temp_directory_path() / "pg_saved_frame_test.png").string();
+
+            std::filesystem::remove(path);
+
+            MasterRenderer masterRenderer;
+
+            masterRenderer.setBackend(std::unique_ptr<RenderBackend>(new NullRenderBackend(false)));
+
+            masterRenderer.getParameter()["ScreenWidth"] = 4;
+            masterRenderer.getParameter()["ScreenHeight"] = 2;
+
+            masterRenderer.onEvent(SaveCurrentFrameEvent{path});
+
+            masterRenderer.renderAll();
+
+            EXPECT_EQ(masterRenderer.getNbPendingCaptures(), 1u);
+
+            masterRenderer.renderAll();
+            masterRenderer.renderAll();
+
+            ASSERT_TRUE(waitForCaptures([&masterRenderer]() { return masterRenderer.getNbPendingCaptures(); }));
+
+            DecodedTexture texture;
+
+            ASSERT_TRUE(decodeTextureFile(path, texture));
+
+            EXPECT_EQ(texture.width, 4);
+            EXPECT_EQ(texture.height, 2);
+
+            std::filesystem::remove(path);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+
+        TEST(particle_test, integrate_matches_the_scalar_update)
+        {
+            ParticleBuffer particles;
+
+            // 11 particles, so the vectorized part and the tail are both used
+            for (size_t i = 0; i < 11; ++i)
+                particles.push(static_cast<float>(i), 2.0f * i, 10.0f, -5.0f * i, 1.0f);
+
+            integrateParticles(particles, 0, particles.size(), 0.5f, 2.0f, 4.0f);
+
+            for (size_t i = 0; i < 11; ++i)
+            {
+                const float vx = 10.0f + 1.0f;
+                const float vy = -5.0f * i + 2.0f;
+
+                EXPECT_FLOAT_EQ(particles.vx[i], vx);
+                EXPECT_FLOAT_EQ(particles.vy[i], vy);
+                EXPECT_FLOAT_EQ(particles.x[i], i + vx * 0.5f);
+                EXPECT_FLOAT_EQ(particles.y[i], 2.0f * i + vy * 0.5f);
+                EXPECT_FLOAT_EQ(particles.age[i], 0.5f);
+            }
+
+            // Only the given range is touched
+            integrateParticles(particles, 3, 5, 0.5f, 0.0f, 0.0f);
+
+            EXPECT_FLOAT_EQ(particles.age[2], 0.5f);
+            EXPECT_FLOAT_EQ(particles.age[3], 1.0f);
+            EXPECT_FLOAT_EQ(particles.age[4], 1.0f);
+            EXPECT_FLOAT_EQ(particles.age[5], 0.5f);
+
+            EXPECT_EQ(particles.removeDead(), 2u);
+            EXPECT_EQ(particles.size(), 9u);
+
+            for (size_t i = 0; i < particles.size(); ++i)
+                EXPECT_LT(particles.age[i], particles.lifetime[i]);
+        }
+
+        TEST(particle_test, emitters_spawn_and_retire_particles)
+        {
+            ParticleEmitter emitter;
+            emitter.rate = 100.0f;
+            emitter.minLifetime = 0.45f;
+            emitter.maxLifetime = 0.45f;
+
+            EXPECT_EQ(simulateParticles(emitter, 0.1f), 10u);
+
+            // Particles live for 4 updates and a half, so 5 generations of 10 particles are alive at once
+            for (size_t i = 0; i < 10; ++i)
+                simulateParticles(emitter, 0.1f);
+
+            EXPECT_EQ(emitter.particles.size(), 50u);
+
+            for (size_t i = 0; i < emitter.particles.size(); ++i)
+            {
+                EXPECT_GE(emitter.particles.vx[i], emitter.minVelocity.x);
+                EXPECT_LE(emitter.particles.vx[i], emitter.maxVelocity.x);
+            }
+
+            emitter.maxParticles = 30;
+            emitter.particles.clear();
+
+            for (size_t i = 0; i < 10; ++i)
+                simulateParticles(emitter, 0.1f);
+
+            EXPECT_EQ(emitter.particles.size(), 30u);
+
+            // A stopped emitter still emits its bursts
+            emitter.emitting = false;
+            emitter.particles.clear();
+
+            emitter.burst(7);
+
+            EXPECT_EQ(simulateParticles(emitter, 0.1f), 7u);
+            EXPECT_EQ(simulateParticles(emitter, 0.1f), 7u);
+        }
+
+        TEST(particle_test, emitters_sharing_a_material_are_drawn_in_one_call)
+        {
+            MasterRenderer masterRenderer;
+
+            auto backend = new NullRenderBackend();
+            masterRenderer.setBackend(std::unique_ptr<RenderBackend>(backend));
+
+            Material material;
+            material.nbAttributes = ParticleInstanceSize;
+
+            masterRenderer.registerMaterial("particle", material);
+
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            ParticleEmitter smoke;
+            smoke.x = 100.0f;
+            smoke.y = 50.0f;
+            smoke.startSize = 8.0f;
+            smoke.endSize = 2.0f;
+            smoke.startColor = {255.0f, 0.0f, 0.0f, 255.0f};
+            smoke.emitting = false;
+            smoke.burst(5);
+
+            ParticleEmitter sparks;
+            sparks.emitting = false;
+            sparks.burst(3);
+
+            simulateParticles(smoke, 0.1f);
+            simulateParticles(sparks, 0.1f);
+
+            MockRenderer renderer(&masterRenderer, RenderStage::Render);
+
+            RenderCall smokeCall, sparksCall;
+
+            buildParticleRenderCall(smoke, 0, RenderStage::Render, smokeCall);
+            buildParticleRenderCall(sparks, 0, RenderStage::Render, sparksCall);
+
+            ASSERT_EQ(smokeCall.data.size(), 5 * ParticleInstanceSize);
+
+            // New particles are at the emitter position, with the start size and color
+            EXPECT_FLOAT_EQ(smokeCall.data[0], 96.0f);
+            EXPECT_FLOAT_EQ(smokeCall.data[1], 46.0f);
+            EXPECT_FLOAT_EQ(smokeCall.data[3], 8.0f);
+            EXPECT_FLOAT_EQ(smokeCall.data[6], 255.0f);
+            EXPECT_FLOAT_EQ(smokeCall.data[7], 0.0f);
+            EXPECT_FLOAT_EQ(smokeCall.data[9], 255.0f);
+
+            renderer.addRenderCall(smokeCall);
+            renderer.addRenderCall(sparksCall);
+
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            const auto& stats = backend->getStats();
+
+            EXPECT_EQ(stats.nbDrawCalls, 1u);
+            EXPECT_EQ(stats.nbInstances, 8u);
+        }
     } // namespace test
 
 } // namespace pg
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "stdafx.h"
+
+#include "gtest/gtest.h"
+
+#include "2D/tilemap.h"
+#include "ECS/entitysystem.h"
+
+namespace pg
+{
+    namespace test
+    {
+        namespace
+        {
+            /** Build a map of width x height cells of 16x16 pixels, all drawn with the first tile of a 4x4 tileset */
+            TiledMap makeFilledMap(int width, int height)
+            {
+                TiledMap map;
+
+                map.width = width;
+                map.height = height;
+                map.tileWidth = 16;
+                map.tileHeight = 16;
+
+                TiledTileset tileset;
+                tileset.name = "tiles";
+                tileset.imagePath = "tiles.png";
+                tileset.textureName = "tiles.png";
+                tileset.firstGid = 1;
+                tileset.tileCount = 16;
+                tileset.columns = 4;
+                tileset.tileWidth = 16;
+                tileset.tileHeight = 16;
+                tileset.imageWidth = 64;
+                tileset.imageHeight = 64;
+
+                map.tilesets.push_back(tileset);
+
+                TiledLayer layer;
+                layer.name = "ground";
+                layer.width = width;
+                layer.height = height;
+                layer.tiles.assign(width * height, 1);
+
+                map.layers.push_back(layer);
+
+                return map;
+            }
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(tiled_loader_test, parses_layers_and_tilesets)
+        {
+            const std::string json = R"({
+                "width": 4, "height": 3, "tilewidth": 16, "tileheight": 16,
+                "infinite": false, "orientation": "orthogonal",
+                "layers": [
+                    {"type": "tilelayer", "name": "ground", "width": 4, "height": 3, "opacity": 0.5, "visible": true,
+                     "data": [1, 2, 3, 4, 2147483650, 0, 0, 0, 0, 0, 0, 16]},
+                    {"type": "group", "name": "decor", "offsetx": 8, "visible": true, "layers": [
+                        {"type": "tilelayer", "name": "top", "width": 4, "height": 3, "encoding": "base64",
+                         "data": "AAAAAAAAAAAAAAAAAAAAAAAAAAARAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA"}
+                    ]},
+                    {"type": "objectgroup", "name": "spawns", "objects": [{"id": 1, "name": "player é"}]}
+                ],
+                "tilesets": [
+                    {"firstgid": 17, "name": "tall", "image": "../img/tall.png", "columns": 2, "tilecount": 4,
+                     "tilewidth": 16, "tileheight": 32, "imagewidth": 32, "imageheight": 64, "margin": 0, "spacing": 0},
+                    {"firstgid": 1, "name": "base", "image": "../img/base.png", "columns": 4, "tilecount": 16,
+                     "tilewidth": 16, "tileheight": 16, "imagewidth": 64, "imageheight": 64, "margin": 0, "spacing": 0}
+                ]
+            })";
+
+            TiledMap map;
+
+            ASSERT_TRUE(parseTiledMap(json, "res/maps", map));
+
+            EXPECT_EQ(map.width, 4);
+            EXPECT_EQ(map.height, 3);
+            EXPECT_EQ(map.tileWidth, 16);
+
+            // Tilesets are sorted by first gid and their images are relative to the map
+            ASSERT_EQ(map.tilesets.size(), 2u);
+            EXPECT_EQ(map.tilesets[0].name, "base");
+            EXPECT_EQ(map.tilesets[0].imagePath, "res/img/base.png");
+            EXPECT_EQ(map.tilesets[1].tileHeight, 32);
+
+            // The object layer is dropped and the layer of the group is flattened
+            ASSERT_EQ(map.layers.size(), 2u);
+            EXPECT_EQ(map.layers[0].name, "ground");
+            EXPECT_FLOAT_EQ(map.layers[0].opacity, 0.5f);
+            EXPECT_EQ(map.layers[0].tiles[11], 16u);
+            EXPECT_EQ(map.layers[1].name, "top");
+            EXPECT_FLOAT_EQ(map.layers[1].offsetX, 8.0f);
+            ASSERT_EQ(map.layers[1].tiles.size(), 12u);
+            EXPECT_EQ(map.layers[1].tiles[5], 17u);
+
+            EXPECT_EQ(map.findTileset(0), -1);
+            EXPECT_EQ(map.findTileset(16), 0);
+            EXPECT_EQ(map.findTileset(17), 1);
+            EXPECT_EQ(map.findTileset(21), -1);
+
+            // The flip flag is not part of the id, but swaps the limits of the tile
+            const uint32_t flipped = map.layers[0].tiles[4];
+            EXPECT_EQ(map.findTileset(flipped), 0);
+
+            constant::Vector4D limits;
+            ASSERT_TRUE(map.tilesets[0].getTileLimits(flipped, limits));
+            EXPECT_FLOAT_EQ(limits.x, 0.5f);
+            EXPECT_FLOAT_EQ(limits.y, 0.0f);
+            EXPECT_FLOAT_EQ(limits.z, 0.25f);
+            EXPECT_FLOAT_EQ(limits.w, 0.25f);
+
+            EXPECT_FALSE(map.tilesets[0].getTileLimits(17, limits));
+
+            // Tall tiles are aligned on the bottom of their cell
+            float instance[TileInstanceSize];
+            EXPECT_EQ(writeTileInstance(map, 1, 1, 1, 100.0f, 0.0f, 2.0f, 1.0f, instance), 1);
+            EXPECT_FLOAT_EQ(instance[0], 124.0f);
+            EXPECT_FLOAT_EQ(instance[1], 0.0f);
+            EXPECT_FLOAT_EQ(instance[4], 32.0f);
+
+            EXPECT_EQ(writeTileInstance(map, 1, 0, 0, 0.0f, 0.0f, 0.0f, 1.0f, instance), -1);
+
+            EXPECT_FALSE(parseTiledMap("{\"width\": 4,", "", map));
+            EXPECT_FALSE(parseTiledMap("{\"infinite\": true}", "", map));
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // ---------------------------        Test separator        -------------------------------
+        // ----------------------------------------------------------------------------------------
+        TEST(tilemap_test, chunks_out_of_the_viewport_are_culled)
+        {
+            MasterRenderer masterRenderer;
+
+            EntitySystem ecs;
+
+            auto backend = new NullRenderBackend(false);
+            masterRenderer.setBackend(std::unique_ptr<RenderBackend>(backend));
+
+            masterRenderer.getParameter()["ScreenWidth"] = 800;
+            masterRenderer.getParameter()["ScreenHeight"] = 600;
+
+            Material material;
+            material.nbAttributes = TileInstanceSize;
+
+            masterRenderer.registerMaterial("__tilemap_tiles.png", material);
+
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            auto sys = ecs.createSystem<TileMapSystem>(&masterRenderer);
+
+            // 100 x 20 tiles are cut in 7 x 2 chunks, only the first 4 columns of chunks reach the screen
+            auto entity = ecs.createEntity();
+            ecs.attach<TileMapComponent>(entity, makeFilledMap(100, 20));
+
+            ecs.executeOnce();
+
+            EXPECT_EQ(sys->getNbChunks(), 14u);
+
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            const auto stats = masterRenderer.getRenderStats();
+            EXPECT_EQ(stats.nbRenderCalls, 8u);
+            EXPECT_EQ(stats.nbCulledInstances, 36u * 20u);
+
+            backend->resetStats();
+
+            masterRenderer.renderAll();
+
+            EXPECT_EQ(backend->getStats().nbDrawCalls, 8u);
+            EXPECT_EQ(backend->getStats().nbInstances, 64u * 20u);
+        }
+
+        TEST(tilemap_test, only_the_changed_tiles_are_uploaded)
+        {
+            MasterRenderer masterRenderer;
+
+            EntitySystem ecs;
+
+            auto backend = new NullRenderBackend(false);
+            masterRenderer.setBackend(std::unique_ptr<RenderBackend>(backend));
+
+            masterRenderer.getParameter()["ScreenWidth"] = 800;
+            masterRenderer.getParameter()["ScreenHeight"] = 600;
+
+            Material material;
+            material.nbAttributes = TileInstanceSize;
+
+            masterRenderer.registerMaterial("__tilemap_tiles.png", material);
+
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            auto sys = ecs.createSystem<TileMapSystem>(&masterRenderer);
+
+            auto entity = ecs.createEntity();
+            auto map = ecs.attach<TileMapComponent>(entity, makeFilledMap(32, 16));
+
+            ecs.executeOnce();
+
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            ASSERT_EQ(sys->getNbChunks(), 2u);
+
+            const size_t uploaded = backend->getStats().nbUploadedBytes;
+            EXPECT_EQ(uploaded, 32u * 16u * TileInstanceSize * sizeof(float));
+
+            // Nothing changed, nothing is sent
+            masterRenderer.renderAll();
+            EXPECT_EQ(backend->getStats().nbUploadedBytes, uploaded);
+
+            map->setTile(0, 20, 3, 6);
+
+            ecs.executeOnce();
+            masterRenderer.execute();
+            masterRenderer.renderAll();
+
+            EXPECT_EQ(backend->getStats().nbUploadedBytes, uploaded + TileInstanceSize * sizeof(float));
+            EXPECT_EQ(map->getTile(0, 20, 3), 6u);
+
+            // Emptying every tile of a chunk drops it
+            for (int y = 0; y < 16; ++y)
+            {
+                for (int x = 0; x < 16; ++x)
+                {
+                    map->setTile(0, x, y, 0);
+                }
+            }
+
+            ecs.executeOnce();
+
+            EXPECT_EQ(sys->getNbChunks(), 1u);
+        }
+    } // namespace test
+
+} // namespace pg